@@ -0,0 +1,252 @@
+/**
+ * @file event_store_bench.cpp
+ * @brief EventStore ingest latency with GetEvents-style queries running
+ *
+ * A writer thread appends events at a fixed rate (10k/s by default) with a
+ * realistic mix of types and cameras, while query threads page through the
+ * ring back to back: recent time windows, a rare event type, one camera,
+ * and both filters at once. The ring is filled before timing starts, so
+ * every append also evicts.
+ *
+ * Reports the ingest rate reached, append latency percentiles (the time a
+ * pipeline thread spends recording an event), and query latency and
+ * throughput.
+ *
+ * Example:
+ *   dashcam_event_store_bench --rate 10000 --queries 4 --seconds 5
+ */
+
+#include "dashcam/utils/latency_histogram.h"
+#include "grpc/event_store.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using dashcam::EventPage;
+using dashcam::EventQuery;
+using dashcam::EventStore;
+using dashcam::EventStoreConfig;
+using dashcam::LatencyHistogram;
+using dashcam::LogEvent;
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t MAX_QUERY_THREADS = 64;
+constexpr uint32_t CAMERAS = 4;
+
+struct Options {
+    uint32_t rate = 10000;
+    uint32_t query_threads = 4;
+    uint32_t seconds = 5;
+    size_t capacity = 65536;
+    uint32_t page = 100;
+};
+
+void print_usage(const char* program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --rate <n>       Events appended per second (default 10000)\n"
+        "  --queries <n>    Threads querying back to back (0-%u, default 4)\n"
+        "  --seconds <n>    Duration (default 5)\n"
+        "  --capacity <n>   Events in the ring (default 65536)\n"
+        "  --page <n>       max_events per query (default 100)\n",
+        program,
+        MAX_QUERY_THREADS);
+}
+
+std::optional<Options> parse_options(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string flag = argv[i];
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Missing value for %s\n", flag.c_str());
+            return std::nullopt;
+        }
+        const std::string value = argv[++i];
+        const auto number = [&value] { return std::strtoull(value.c_str(), nullptr, 10); };
+
+        if (flag == "--rate") {
+            options.rate = static_cast<uint32_t>(number());
+        } else if (flag == "--queries") {
+            options.query_threads = static_cast<uint32_t>(number());
+        } else if (flag == "--seconds") {
+            options.seconds = static_cast<uint32_t>(number());
+        } else if (flag == "--capacity") {
+            options.capacity = static_cast<size_t>(number());
+        } else if (flag == "--page") {
+            options.page = static_cast<uint32_t>(number());
+        } else {
+            std::fprintf(stderr, "Unknown option %s\n", flag.c_str());
+            return std::nullopt;
+        }
+    }
+
+    if (options.rate == 0 || options.query_threads > MAX_QUERY_THREADS || options.seconds == 0 ||
+        options.capacity == 0 || options.page == 0 ||
+        options.page > EventStoreConfig{}.max_events_limit) {
+        return std::nullopt;
+    }
+    return options;
+}
+
+/**
+ * @brief The n-th event: mostly frame ticks, some drops, rare incidents
+ */
+LogEvent make_event(uint64_t n, int64_t timestamp_ms) {
+    LogEvent event;
+    event.set_timestamp_ms(timestamp_ms);
+    event.set_event_type(n % 1000 == 0 ? "incident"
+                         : n % 10 == 0   ? "frame_dropped"
+                                         : "segment_written");
+    event.set_camera_id("cam" + std::to_string((n / 3) % CAMERAS));
+    event.set_message("synthetic event " + std::to_string(n));
+    (*event.mutable_metadata())["sequence"] = std::to_string(n);
+    return event;
+}
+
+int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now().time_since_epoch())
+        .count();
+}
+
+/**
+ * @brief Query number n of a thread: a rotating mix of windows and filters
+ */
+EventQuery make_query(uint64_t n, uint32_t page) {
+    EventQuery query;
+    query.max_events = page;
+    switch (n % 4) {
+    case 0: // Last second, everything
+        query.start_ms = now_ms() - 1000;
+        break;
+    case 1: // Rare type across the whole ring
+        query.filter.event_types = {"incident"};
+        break;
+    case 2: // One camera, last five seconds
+        query.start_ms = now_ms() - 5000;
+        query.filter.camera_id = "cam" + std::to_string(n % CAMERAS);
+        break;
+    default: // Both filters
+        query.filter.event_types = {"frame_dropped", "incident"};
+        query.filter.camera_id = "cam1";
+        break;
+    }
+    return query;
+}
+
+int run(const Options& options) {
+    EventStoreConfig config;
+    config.capacity = options.capacity;
+    EventStore store(config);
+
+    // Fill the ring at the same rate, back-dated, so appends evict from the start
+    const int64_t fill_start =
+        now_ms() - static_cast<int64_t>(options.capacity * 1000 / options.rate);
+    uint64_t n = 0;
+    for (; n < options.capacity; ++n) {
+        store.append(make_event(n, fill_start + static_cast<int64_t>(n * 1000 / options.rate)));
+    }
+
+    std::printf("Rate: %u events/s, %u query threads, page %u, ring %zu, %u s, "
+                "%u hardware threads\n",
+                options.rate,
+                options.query_threads,
+                options.page,
+                options.capacity,
+                options.seconds,
+                std::thread::hardware_concurrency());
+
+    std::atomic<bool> done{false};
+    std::vector<LatencyHistogram> query_latency(options.query_threads);
+    std::vector<uint64_t> query_events(options.query_threads, 0);
+    std::vector<std::thread> threads;
+    for (uint32_t q = 0; q < options.query_threads; ++q) {
+        threads.emplace_back([&, q] {
+            for (uint64_t i = q; !done.load(std::memory_order_relaxed); ++i) {
+                const EventQuery query = make_query(i, options.page);
+                const Clock::time_point begin = Clock::now();
+                const EventPage page = store.query(query);
+                query_latency[q].record(Clock::now() - begin);
+                query_events[q] += page.events.size();
+            }
+        });
+    }
+
+    // Paced writer: events are built before the clock starts, as a caller would
+    LatencyHistogram append_latency;
+    const auto period = std::chrono::nanoseconds(1000000000ULL / options.rate);
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point end = start + std::chrono::seconds(options.seconds);
+    Clock::time_point next = start;
+    uint64_t appended = 0;
+    while (Clock::now() < end) {
+        const LogEvent event = make_event(n++, now_ms());
+        std::this_thread::sleep_until(next);
+        const Clock::time_point begin = Clock::now();
+        store.append(event);
+        append_latency.record(Clock::now() - begin);
+        ++appended;
+        next += period;
+    }
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    done = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::printf("Ingest: %.0f events/s (%llu appended)\n",
+                static_cast<double>(appended) / elapsed,
+                static_cast<unsigned long long>(appended));
+    std::printf("Append: p50 %lld ns, p99 %lld ns, p99.9 %lld ns, max %lld ns\n",
+                static_cast<long long>(append_latency.percentile(50.0).count()),
+                static_cast<long long>(append_latency.percentile(99.0).count()),
+                static_cast<long long>(append_latency.percentile(99.9).count()),
+                static_cast<long long>(append_latency.max().count()));
+
+    uint64_t queries = 0;
+    uint64_t returned = 0;
+    std::chrono::nanoseconds query_p50{0};
+    std::chrono::nanoseconds query_p99{0};
+    for (uint32_t q = 0; q < options.query_threads; ++q) {
+        queries += query_latency[q].count();
+        returned += query_events[q];
+        query_p50 = std::max(query_p50, query_latency[q].percentile(50.0));
+        query_p99 = std::max(query_p99, query_latency[q].percentile(99.0));
+    }
+    if (queries > 0) {
+        std::printf("Queries: %.0f/s, %.1f events/page, p50 %lld us, p99 %lld us (worst thread)\n",
+                    static_cast<double>(queries) / elapsed,
+                    static_cast<double>(returned) / static_cast<double>(queries),
+                    static_cast<long long>(query_p50.count() / 1000),
+                    static_cast<long long>(query_p99.count() / 1000));
+    }
+
+    const dashcam::EventStoreStats stats = store.stats();
+    std::printf("Store: %llu stored, %llu evicted, %.1f events scanned per event returned\n",
+                static_cast<unsigned long long>(stats.stored),
+                static_cast<unsigned long long>(stats.evicted),
+                stats.returned > 0
+                    ? static_cast<double>(stats.scanned) / static_cast<double>(stats.returned)
+                    : 0.0);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const std::optional<Options> options = parse_options(argc, argv);
+    if (!options) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    return run(*options);
+}
@@ -0,0 +1,340 @@
+/**
+ * @file grpc_load_bench.cpp
+ * @brief Holds thousands of StreamStatus subscribers open against the server
+ *
+ * Starts a GrpcServer in this process (or targets a running one with
+ * --address) and opens the requested number of StreamStatus streams, spread
+ * over several channels. Every stream is a callback reactor, so the client
+ * side needs no thread per stream either.
+ *
+ * Reports how many streams came up and how long that took, the update rate
+ * actually delivered against the configured cadence, the gap between
+ * consecutive updates on a stream at p50/p99/max, and the process thread
+ * count and resident memory while all streams are open. With an in-process
+ * server the thread count covers both ends.
+ *
+ * The in-process server is fed a simulated 30 fps camera through LiveStatus,
+ * so every tick carries a change. With --delta 1 the streams ask for delta
+ * updates; compare the reported payload bytes against a run without it.
+ *
+ * Example:
+ *   dashcam_grpc_load_bench --subscribers 5000 --channels 8 --seconds 30
+ */
+
+#include "dashcam.grpc.pb.h"
+#include "dashcam/grpc_service.h"
+#include "dashcam/utils/latency_histogram.h"
+#include "dashcam/utils/live_status.h"
+#include "dashcam/utils/logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using dashcam::DashcamService;
+using dashcam::DashcamStatus;
+using dashcam::LatencyHistogram;
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t MAX_SUBSCRIBERS = 100000;
+constexpr uint32_t MAX_CHANNELS = 256;
+
+struct Options {
+    std::string address;                     // Empty: start a server in-process
+    uint16_t port = 50151;
+    uint32_t subscribers = 1000;
+    uint32_t channels = 8;
+    uint32_t seconds = 10;
+    uint32_t interval_ms = 100;
+    int max_threads = 4;
+    bool delta = false;
+};
+
+void print_usage(const char* program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --address <host:port>   Target a running server instead of an in-process one\n"
+        "  --port <n>              Port for the in-process server (default 50151)\n"
+        "  --subscribers <n>       StreamStatus streams to hold open (1-%u, default 1000)\n"
+        "  --channels <n>          Connections to spread streams over (1-%u, default 8)\n"
+        "  --seconds <n>           Measurement period once all streams are up (default 10)\n"
+        "  --interval-ms <n>       In-process server update interval (default 100)\n"
+        "  --max-threads <n>       In-process server thread cap (default 4)\n"
+        "  --delta <0|1>           Request delta updates (default 0)\n",
+        program,
+        MAX_SUBSCRIBERS,
+        MAX_CHANNELS);
+}
+
+std::optional<Options> parse_options(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string flag = argv[i];
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Missing value for %s\n", flag.c_str());
+            return std::nullopt;
+        }
+        const std::string value = argv[++i];
+        const auto number = [&value] { return std::strtoull(value.c_str(), nullptr, 10); };
+
+        if (flag == "--address") {
+            options.address = value;
+        } else if (flag == "--port") {
+            options.port = static_cast<uint16_t>(number());
+        } else if (flag == "--subscribers") {
+            options.subscribers = static_cast<uint32_t>(number());
+        } else if (flag == "--channels") {
+            options.channels = static_cast<uint32_t>(number());
+        } else if (flag == "--seconds") {
+            options.seconds = static_cast<uint32_t>(number());
+        } else if (flag == "--interval-ms") {
+            options.interval_ms = static_cast<uint32_t>(number());
+        } else if (flag == "--max-threads") {
+            options.max_threads = static_cast<int>(number());
+        } else if (flag == "--delta") {
+            options.delta = number() != 0;
+        } else {
+            std::fprintf(stderr, "Unknown option %s\n", flag.c_str());
+            return std::nullopt;
+        }
+    }
+
+    if (options.subscribers == 0 || options.subscribers > MAX_SUBSCRIBERS ||
+        options.channels == 0 || options.channels > MAX_CHANNELS || options.seconds == 0 ||
+        options.interval_ms == 0 || options.max_threads <= 0) {
+        return std::nullopt;
+    }
+    return options;
+}
+
+size_t process_thread_count() {
+    size_t threads = 0;
+    std::error_code error;
+    for (std::filesystem::directory_iterator it("/proc/self/task", error), end; !error && it != end;
+         it.increment(error)) {
+        ++threads;
+    }
+    return threads;
+}
+
+uint64_t resident_kib() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmRSS:", 0) == 0) {
+            return std::strtoull(line.c_str() + 6, nullptr, 10);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Counters shared by every subscriber
+ */
+struct LoadTotals {
+    std::atomic<uint64_t> established{0};    // Received at least one update
+    std::atomic<uint64_t> updates{0};
+    std::atomic<uint64_t> finished{0};
+    std::atomic<uint64_t> failed{0};         // Finished with a status other than CANCELLED
+    std::atomic<uint64_t> payload_bytes{0};  // Message payloads, before gRPC framing
+    LatencyHistogram update_gaps;
+};
+
+class Subscriber final : public grpc::ClientReadReactor<DashcamStatus> {
+public:
+    Subscriber(DashcamService::Stub& stub, LoadTotals& totals, bool delta) : totals_(totals) {
+        request_.set_delta_updates(delta);
+        stub.async()->StreamStatus(&context_, &request_, this);
+        StartRead(&status_);
+        StartCall();
+    }
+
+    void OnReadDone(bool ok) override {
+        if (!ok) {
+            return;
+        }
+        const auto now = Clock::now();
+        if (last_update_ == Clock::time_point{}) {
+            totals_.established.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            totals_.update_gaps.record(now - last_update_);
+        }
+        last_update_ = now;
+        totals_.updates.fetch_add(1, std::memory_order_relaxed);
+        totals_.payload_bytes.fetch_add(status_.ByteSizeLong(), std::memory_order_relaxed);
+        StartRead(&status_);
+    }
+
+    void OnDone(const grpc::Status& status) override {
+        if (!status.ok() && status.error_code() != grpc::StatusCode::CANCELLED) {
+            totals_.failed.fetch_add(1, std::memory_order_relaxed);
+        }
+        totals_.finished.fetch_add(1, std::memory_order_release);
+    }
+
+    void cancel() { context_.TryCancel(); }
+
+private:
+    LoadTotals& totals_;
+    grpc::ClientContext context_;
+    dashcam::GetStatusRequest request_;
+    DashcamStatus status_;
+    Clock::time_point last_update_{};        // Only touched from OnReadDone()
+};
+
+template <typename Predicate>
+bool wait_until(Predicate predicate, std::chrono::seconds timeout) {
+    const auto deadline = Clock::now() + timeout;
+    while (!predicate()) {
+        if (Clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+double to_ms(std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+int run(const Options& options) {
+    std::unique_ptr<dashcam::GrpcServer> server;
+    std::shared_ptr<dashcam::LiveStatus> live_status;
+    std::atomic<bool> camera_running{false};
+    std::thread camera;
+    std::string address = options.address;
+    if (address.empty()) {
+        address = "127.0.0.1:" + std::to_string(options.port);
+        live_status = std::make_shared<dashcam::LiveStatus>();
+        camera_running = true;
+        camera = std::thread([&] {
+            dashcam::CaptureStatus status;
+            status.recording = true;
+            status.current_fps = 30;
+            while (camera_running.load(std::memory_order_relaxed)) {
+                ++status.frames_captured;
+                live_status->publish(0, status);
+                std::this_thread::sleep_for(std::chrono::microseconds(33333));
+            }
+        });
+
+        dashcam::GrpcServerConfig config;
+        config.max_threads = options.max_threads;
+        config.status_interval = std::chrono::milliseconds(options.interval_ms);
+        server = std::make_unique<dashcam::GrpcServer>(
+            address, nullptr, live_status, nullptr, config);
+        if (!server->start()) {
+            std::fprintf(stderr, "Failed to start server on %s\n", address.c_str());
+            camera_running = false;
+            camera.join();
+            return 1;
+        }
+    }
+    const size_t threads_idle = process_thread_count();
+    const uint64_t rss_idle = resident_kib();
+
+    std::vector<std::unique_ptr<DashcamService::Stub>> stubs;
+    for (uint32_t i = 0; i < options.channels; ++i) {
+        // Distinct arguments keep channels on separate connections
+        grpc::ChannelArguments args;
+        args.SetInt("dashcam.bench_channel", static_cast<int>(i));
+        stubs.push_back(DashcamService::NewStub(
+            grpc::CreateCustomChannel(address, grpc::InsecureChannelCredentials(), args)));
+    }
+
+    LoadTotals totals;
+    std::vector<std::unique_ptr<Subscriber>> subscribers;
+    subscribers.reserve(options.subscribers);
+    const auto connect_start = Clock::now();
+    for (uint32_t i = 0; i < options.subscribers; ++i) {
+        subscribers.push_back(
+            std::make_unique<Subscriber>(*stubs[i % options.channels], totals, options.delta));
+    }
+    const bool all_up = wait_until(
+        [&] { return totals.established.load() + totals.finished.load() >= options.subscribers; },
+        std::chrono::seconds(60));
+    const auto connect_time = Clock::now() - connect_start;
+
+    // Measure steady state only
+    totals.update_gaps.reset();
+    const uint64_t updates_before = totals.updates.load();
+    const uint64_t payload_before = totals.payload_bytes.load();
+    const auto measure_start = Clock::now();
+    size_t threads_peak = process_thread_count();
+    for (uint32_t s = 0; s < options.seconds; ++s) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        threads_peak = std::max(threads_peak, process_thread_count());
+    }
+    const double measured_s = std::chrono::duration<double>(Clock::now() - measure_start).count();
+    const uint64_t updates = totals.updates.load() - updates_before;
+    const uint64_t payload = totals.payload_bytes.load() - payload_before;
+    const uint64_t rss_loaded = resident_kib();
+
+    for (auto& subscriber : subscribers) {
+        subscriber->cancel();
+    }
+    wait_until([&] { return totals.finished.load(std::memory_order_acquire) >= options.subscribers; },
+               std::chrono::seconds(30));
+    if (server) {
+        server->stop();
+        camera_running = false;
+        camera.join();
+    }
+
+    const double expected_rate = 1000.0 / options.interval_ms * options.subscribers;
+    std::printf("Streams:      %llu of %u up in %.1f ms%s\n",
+                static_cast<unsigned long long>(totals.established.load()),
+                options.subscribers,
+                to_ms(connect_time),
+                all_up ? "" : " (timed out)");
+    std::printf("Updates:      %.0f/s delivered, %.0f/s configured%s\n",
+                updates / measured_s,
+                expected_rate,
+                options.address.empty() ? "" : " (assuming --interval-ms matches the server)");
+    std::printf("Payload:      %.0f B/s, %.1f B per update%s\n",
+                payload / measured_s,
+                updates == 0 ? 0.0 : static_cast<double>(payload) / updates,
+                options.delta ? " (delta updates)" : "");
+    std::printf("Update gap:   p50 %.1f ms, p99 %.1f ms, max %.1f ms\n",
+                to_ms(totals.update_gaps.percentile(50)),
+                to_ms(totals.update_gaps.percentile(99)),
+                to_ms(totals.update_gaps.max()));
+    std::printf("Threads:      %zu idle, %zu peak with all streams open\n", threads_idle, threads_peak);
+    std::printf("Resident:     %llu KiB idle, %llu KiB loaded (%.1f KiB per stream)\n",
+                static_cast<unsigned long long>(rss_idle),
+                static_cast<unsigned long long>(rss_loaded),
+                static_cast<double>(rss_loaded - std::min(rss_loaded, rss_idle)) / options.subscribers);
+    std::printf("Failed:       %llu\n", static_cast<unsigned long long>(totals.failed.load()));
+    return all_up && totals.failed.load() == 0 ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const std::optional<Options> options = parse_options(argc, argv);
+    if (!options) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    if (!dashcam::Logger::initialize(dashcam::LogLevel::Warning)) {
+        std::fprintf(stderr, "Failed to initialize logging\n");
+        return 1;
+    }
+    const int result = run(*options);
+    dashcam::Logger::shutdown();
+    return result;
+}
@@ -0,0 +1,204 @@
+/**
+ * @file status_bench.cpp
+ * @brief Writer cost of LiveStatus::publish() under reader load
+ *
+ * A writer thread publishes a CaptureStatus in a tight loop, first alone and
+ * then while reader threads call snapshot() as fast as they can, the way
+ * GetStatus polls and the status publisher would. For contrast the same load
+ * is run against the same struct behind a std::mutex.
+ *
+ * The writer times batches of publishes and reports the mean cost per
+ * publish and the p99 of the per-batch mean. Readers report how many
+ * snapshots they took and how often a seqlock read had to retry.
+ *
+ * Example:
+ *   dashcam_status_bench --readers 8 --seconds 3
+ */
+
+#include "dashcam/utils/latency_histogram.h"
+#include "dashcam/utils/live_status.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using dashcam::CaptureStatus;
+using dashcam::LatencyHistogram;
+using dashcam::LiveStatus;
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t MAX_READERS = 256;
+constexpr uint32_t PUBLISHES_PER_BATCH = 1024;
+
+struct Options {
+    uint32_t readers = 4;
+    uint32_t seconds = 3;
+};
+
+void print_usage(const char* program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --readers <n>   Threads calling snapshot() in a loop (0-%u, default 4)\n"
+        "  --seconds <n>   Duration of each run (default 3)\n",
+        program,
+        MAX_READERS);
+}
+
+std::optional<Options> parse_options(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string flag = argv[i];
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Missing value for %s\n", flag.c_str());
+            return std::nullopt;
+        }
+        const std::string value = argv[++i];
+        const auto number = [&value] { return std::strtoull(value.c_str(), nullptr, 10); };
+
+        if (flag == "--readers") {
+            options.readers = static_cast<uint32_t>(number());
+        } else if (flag == "--seconds") {
+            options.seconds = static_cast<uint32_t>(number());
+        } else {
+            std::fprintf(stderr, "Unknown option %s\n", flag.c_str());
+            return std::nullopt;
+        }
+    }
+
+    if (options.readers > MAX_READERS || options.seconds == 0) {
+        return std::nullopt;
+    }
+    return options;
+}
+
+/**
+ * @brief The baseline: the same status behind a lock
+ */
+class LockedStatus {
+public:
+    void publish(const CaptureStatus& status) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        status_ = status;
+    }
+
+    CaptureStatus snapshot() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return status_;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    CaptureStatus status_;
+};
+
+struct RunResult {
+    uint64_t publishes = 0;
+    double mean_ns = 0;
+    std::chrono::nanoseconds batch_p99{0};
+    uint64_t snapshots = 0;
+};
+
+template <typename Publish, typename Snapshot>
+RunResult run_load(const Options& options, uint32_t readers, Publish publish, Snapshot snapshot) {
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> snapshots{0};
+    std::vector<std::thread> threads;
+    for (uint32_t r = 0; r < readers; ++r) {
+        threads.emplace_back([&] {
+            uint64_t local = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                snapshot();
+                ++local;
+            }
+            snapshots.fetch_add(local, std::memory_order_relaxed);
+        });
+    }
+
+    LatencyHistogram batches;
+    CaptureStatus status;
+    status.recording = true;
+    status.current_fps = 30;
+    const Clock::time_point end = Clock::now() + std::chrono::seconds(options.seconds);
+    Clock::duration total{0};
+    RunResult result;
+    while (Clock::now() < end) {
+        const Clock::time_point begin = Clock::now();
+        for (uint32_t i = 0; i < PUBLISHES_PER_BATCH; ++i) {
+            ++status.frames_captured;
+            publish(status);
+        }
+        const Clock::duration elapsed = Clock::now() - begin;
+        total += elapsed;
+        batches.record(elapsed / PUBLISHES_PER_BATCH);
+        result.publishes += PUBLISHES_PER_BATCH;
+    }
+
+    done = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    result.mean_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(total).count()) /
+                     static_cast<double>(result.publishes);
+    result.batch_p99 = batches.percentile(99.0);
+    result.snapshots = snapshots.load();
+    return result;
+}
+
+void print_result(const char* label, const Options& options, const RunResult& result) {
+    std::printf("%-22s %8.1f ns/publish (batch p99 < %lld ns), %6.1f M publishes, %6.1f M snapshots/s\n",
+                label,
+                result.mean_ns,
+                static_cast<long long>(result.batch_p99.count()),
+                static_cast<double>(result.publishes) / 1e6,
+                static_cast<double>(result.snapshots) / 1e6 / options.seconds);
+}
+
+int run(const Options& options) {
+    std::printf("Readers: %u, %u s per run, %u hardware threads\n",
+                options.readers,
+                options.seconds,
+                std::thread::hardware_concurrency());
+
+    {
+        LiveStatus status;
+        const auto publish = [&status](const CaptureStatus& value) { status.publish(0, value); };
+        const auto snapshot = [&status] { return status.snapshot(); };
+        print_result("seqlock, no readers", options, run_load(options, 0, publish, snapshot));
+    }
+    {
+        LiveStatus status;
+        const auto publish = [&status](const CaptureStatus& value) { status.publish(0, value); };
+        const auto snapshot = [&status] { return status.snapshot(); };
+        print_result("seqlock, readers", options, run_load(options, options.readers, publish, snapshot));
+        std::printf("%-22s %llu read retries\n",
+                    "",
+                    static_cast<unsigned long long>(status.stats().read_retries));
+    }
+    {
+        LockedStatus status;
+        const auto publish = [&status](const CaptureStatus& value) { status.publish(value); };
+        const auto snapshot = [&status] { return status.snapshot(); };
+        print_result("mutex, readers", options, run_load(options, options.readers, publish, snapshot));
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const std::optional<Options> options = parse_options(argc, argv);
+    if (!options) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    return run(*options);
+}
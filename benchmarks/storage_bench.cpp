@@ -0,0 +1,601 @@
+/**
+ * @file storage_bench.cpp
+ * @brief Drives the storage stage with synthetic encoded video
+ *
+ * One producer thread emits frames for every camera at the configured
+ * bitrate and frame rate; one storage thread per camera drains a bounded
+ * queue into a SegmentWriter. When paced, the producer consults a
+ * DegradationController exactly as the recorder does, so a slow or failing
+ * directory shows up as queue growth, tier changes and shed frames rather
+ * than as a stall. Unpaced runs block on full queues to measure raw
+ * throughput instead.
+ *
+ * Reports throughput, writev()/fdatasync() latency percentiles and write
+ * amplification (sectors the block device wrote per payload byte). Faults
+ * can be injected to exercise backpressure without a bad card.
+ *
+ * Example:
+ *   dashcam_storage_bench --dir /mnt/sd/bench --cameras 4 --bitrate-mbps 8 \
+ *       --seconds 60 --fault-write-delay-ms 30
+ */
+
+#include "dashcam/storage/degradation_controller.h"
+#include "dashcam/storage/io_fault_injector.h"
+#include "dashcam/storage/segment_writer.h"
+#include "dashcam/storage/storage_accounting.h"
+#include "dashcam/utils/latency_histogram.h"
+#include "dashcam/utils/logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/sysmacros.h>
+#endif
+
+namespace {
+
+using dashcam::DegradationController;
+using dashcam::IoFaultConfig;
+using dashcam::IoFaultInjector;
+using dashcam::LatencyHistogram;
+using dashcam::SegmentWriter;
+using dashcam::SegmentWriterConfig;
+using dashcam::StorageAccounting;
+using dashcam::WriteChunk;
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t MAX_CAMERAS = 16;
+constexpr uint32_t KEYFRAME_WEIGHT = 8;     // A keyframe is this many P-frames
+constexpr uint64_t SECTOR_BYTES = 512;      // Unit of /sys/block/.../stat
+const char* const CAMERA_NAMES[] = {"front", "rear", "left", "right"};
+
+struct Options {
+    std::string directory;
+    uint32_t cameras = 1;
+    double bitrate_mbps = 8.0;
+    uint32_t fps = 30;
+    uint32_t gop_frames = 30;
+    uint32_t seconds = 10;
+    uint32_t segment_seconds = 60;
+    uint32_t queue_frames = 64;
+    bool paced = true;
+    bool keep_files = false;
+    SegmentWriterConfig writer;
+    IoFaultConfig faults;
+};
+
+void print_usage(const char* program) {
+    std::printf(
+        "Usage: %s --dir <path> [options]\n"
+        "  --cameras <n>               Cameras to simulate (1-%u, default 1)\n"
+        "  --bitrate-mbps <x>          Encoded bitrate per camera (default 8)\n"
+        "  --fps <n>                   Frames per second (default 30)\n"
+        "  --gop <n>                   Frames per GOP (default 30)\n"
+        "  --seconds <n>               Media duration to generate (default 10)\n"
+        "  --segment-seconds <n>       Segment rollover interval (default 60)\n"
+        "  --queue-frames <n>          Storage queue capacity per camera (default 64)\n"
+        "  --unpaced                   Generate frames as fast as possible\n"
+        "  --keep                      Keep segment files after the run\n"
+        "  --batch-kib <n>             Writer max batch size (default 4096)\n"
+        "  --batch-latency-ms <n>      Writer max batch latency (default 250)\n"
+        "  --durability <mode>         none | periodic | keyframe (default periodic)\n"
+        "  --sync-interval-ms <n>      Periodic sync interval (default 1000)\n"
+        "  --fault-write-delay-ms <n>  Delay added before each writev()\n"
+        "  --fault-sync-delay-ms <n>   Delay added before each fdatasync()\n"
+        "  --fault-eio-every <n>       Fail every nth writev() with EIO\n"
+        "  --fault-sync-eio-every <n>  Fail every nth fdatasync() with EIO\n"
+        "  --fault-enospc-after-mib <n> Fail writes with ENOSPC after n MiB\n",
+        program,
+        MAX_CAMERAS);
+}
+
+std::optional<Options> parse_options(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string flag = argv[i];
+        if (flag == "--unpaced") {
+            options.paced = false;
+            continue;
+        }
+        if (flag == "--keep") {
+            options.keep_files = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Missing value for %s\n", flag.c_str());
+            return std::nullopt;
+        }
+        const std::string value = argv[++i];
+        const auto number = [&value] { return std::strtoull(value.c_str(), nullptr, 10); };
+        const auto millis = [&number] { return std::chrono::milliseconds(number()); };
+
+        if (flag == "--dir") {
+            options.directory = value;
+        } else if (flag == "--cameras") {
+            options.cameras = static_cast<uint32_t>(number());
+        } else if (flag == "--bitrate-mbps") {
+            options.bitrate_mbps = std::strtod(value.c_str(), nullptr);
+        } else if (flag == "--fps") {
+            options.fps = static_cast<uint32_t>(number());
+        } else if (flag == "--gop") {
+            options.gop_frames = static_cast<uint32_t>(number());
+        } else if (flag == "--seconds") {
+            options.seconds = static_cast<uint32_t>(number());
+        } else if (flag == "--segment-seconds") {
+            options.segment_seconds = static_cast<uint32_t>(number());
+        } else if (flag == "--queue-frames") {
+            options.queue_frames = static_cast<uint32_t>(number());
+        } else if (flag == "--batch-kib") {
+            options.writer.max_batch_bytes = static_cast<size_t>(number()) * 1024;
+        } else if (flag == "--batch-latency-ms") {
+            options.writer.max_batch_latency = millis();
+        } else if (flag == "--durability") {
+            if (value == "none") {
+                options.writer.durability.mode = dashcam::DurabilityMode::None;
+            } else if (value == "periodic") {
+                options.writer.durability.mode = dashcam::DurabilityMode::Periodic;
+            } else if (value == "keyframe") {
+                options.writer.durability.mode = dashcam::DurabilityMode::OnKeyframe;
+            } else {
+                std::fprintf(stderr, "Unknown durability mode '%s'\n", value.c_str());
+                return std::nullopt;
+            }
+        } else if (flag == "--sync-interval-ms") {
+            options.writer.durability.sync_interval = millis();
+        } else if (flag == "--fault-write-delay-ms") {
+            options.faults.write_delay = millis();
+        } else if (flag == "--fault-sync-delay-ms") {
+            options.faults.sync_delay = millis();
+        } else if (flag == "--fault-eio-every") {
+            options.faults.write_errno = EIO;
+            options.faults.fail_every_nth_write = static_cast<uint32_t>(number());
+        } else if (flag == "--fault-sync-eio-every") {
+            options.faults.sync_errno = EIO;
+            options.faults.fail_every_nth_sync = static_cast<uint32_t>(number());
+        } else if (flag == "--fault-enospc-after-mib") {
+            options.faults.enospc_after_bytes = number() * 1024 * 1024;
+        } else {
+            std::fprintf(stderr, "Unknown option %s\n", flag.c_str());
+            return std::nullopt;
+        }
+    }
+
+    if (options.directory.empty() || options.cameras == 0 || options.cameras > MAX_CAMERAS ||
+        options.bitrate_mbps <= 0.0 || options.fps == 0 || options.gop_frames == 0 ||
+        options.seconds == 0 || options.segment_seconds == 0 || options.queue_frames == 0 ||
+        options.writer.max_batch_bytes == 0 ||
+        options.writer.durability.sync_interval.count() <= 0) {
+        return std::nullopt;
+    }
+    return options;
+}
+
+std::string camera_name(uint32_t index) {
+    if (index < std::size(CAMERA_NAMES)) {
+        return CAMERA_NAMES[index];
+    }
+    return "cam" + std::to_string(index);
+}
+
+/**
+ * @brief Sectors written by the block device holding `directory`, if known
+ *
+ * Device-wide, so other writers on the same device inflate the figure.
+ */
+std::optional<uint64_t> device_sectors_written(const std::string& directory) {
+#if defined(__linux__)
+    struct stat info {};
+    if (::stat(directory.c_str(), &info) != 0) {
+        return std::nullopt;
+    }
+    const std::string path = "/sys/dev/block/" + std::to_string(major(info.st_dev)) + ":" +
+                             std::to_string(minor(info.st_dev)) + "/stat";
+    std::ifstream stat_file(path);
+    // Fields: reads, merged, sectors, ticks, writes, merged, sectors, ...
+    uint64_t fields[7] = {};
+    for (uint64_t& field : fields) {
+        if (!(stat_file >> field)) {
+            return std::nullopt;
+        }
+    }
+    return fields[6];
+#else
+    (void)directory;
+    return std::nullopt;
+#endif
+}
+
+void sync_filesystem(const std::string& directory) {
+#if defined(__linux__)
+    const int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::syncfs(fd);
+        ::close(fd);
+    }
+#else
+    (void)directory;
+    ::sync();
+#endif
+}
+
+/**
+ * @brief Bounded frame queue between the producer and one storage thread
+ */
+class FrameQueue {
+public:
+    explicit FrameQueue(uint32_t capacity) : capacity_(capacity) {}
+
+    bool try_push(WriteChunk chunk) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (frames_.size() >= capacity_) {
+                return false;
+            }
+            frames_.push_back(std::move(chunk));
+        }
+        ready_.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Block until there is room; used when measuring raw throughput
+     */
+    void push(WriteChunk chunk) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            space_.wait(lock, [this] { return frames_.size() < capacity_; });
+            frames_.push_back(std::move(chunk));
+        }
+        ready_.notify_one();
+    }
+
+    /**
+     * @brief Wait up to `timeout` for a frame; std::nullopt on timeout or close
+     */
+    std::optional<WriteChunk> pop(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait_for(lock, timeout, [this] { return !frames_.empty() || closed_; });
+        if (frames_.empty()) {
+            return std::nullopt;
+        }
+        WriteChunk chunk = std::move(frames_.front());
+        frames_.pop_front();
+        lock.unlock();
+        space_.notify_one();
+        return chunk;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        ready_.notify_all();
+    }
+
+    bool drained() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return closed_ && frames_.empty();
+    }
+
+    uint32_t depth() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return static_cast<uint32_t>(frames_.size());
+    }
+
+private:
+    const uint32_t capacity_;
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+    std::condition_variable space_;
+    std::deque<WriteChunk> frames_;
+    bool closed_ = false;
+};
+
+/**
+ * @brief Everything one simulated camera owns
+ */
+struct CameraLane {
+    CameraLane(const Options& options, StorageAccounting* accounting, IoFaultInjector* faults)
+        : queue(options.queue_frames), writer(options.writer, accounting, faults) {}
+
+    std::string name;
+    WriteChunk keyframe;
+    WriteChunk delta_frame;
+    FrameQueue queue;
+    SegmentWriter writer;
+    std::vector<std::string> segment_paths;
+
+    uint64_t frames_written = 0;
+    uint64_t append_failures = 0;
+    std::atomic<uint64_t> queue_overflows{0};
+};
+
+WriteChunk random_frame(size_t size_bytes, std::mt19937_64& rng, bool keyframe) {
+    auto buffer = std::make_shared<std::vector<uint8_t>>(size_bytes);
+    // Incompressible, so filesystems with compression report honest numbers
+    for (uint8_t& byte : *buffer) {
+        byte = static_cast<uint8_t>(rng());
+    }
+    return dashcam::make_write_chunk(std::move(buffer), keyframe);
+}
+
+void run_storage_thread(const Options& options, CameraLane& lane) {
+    const uint64_t frames_per_segment =
+        static_cast<uint64_t>(options.segment_seconds) * options.fps;
+    uint64_t frames_in_segment = 0;
+
+    while (!lane.queue.drained()) {
+        std::optional<WriteChunk> frame = lane.queue.pop(options.writer.max_batch_latency / 2 +
+                                                         std::chrono::milliseconds(1));
+        const auto now = Clock::now();
+        if (!frame) {
+            if (lane.writer.is_open() && !lane.writer.poll(now)) {
+                lane.append_failures++;
+            }
+            continue;
+        }
+
+        // Roll over on a keyframe boundary once the segment is long enough
+        if (lane.writer.is_open() && frame->keyframe && frames_in_segment >= frames_per_segment) {
+            lane.writer.close(now);
+        }
+        if (!lane.writer.is_open()) {
+            const std::string path = options.directory + "/" + lane.name + "_" +
+                                     std::to_string(lane.segment_paths.size()) + ".bin";
+            if (!lane.writer.open(path)) {
+                lane.append_failures++;
+                continue;
+            }
+            lane.segment_paths.push_back(path);
+            frames_in_segment = 0;
+        }
+
+        if (lane.writer.append(std::move(*frame), now)) {
+            lane.frames_written++;
+        } else {
+            lane.append_failures++;
+        }
+        frames_in_segment++;
+    }
+    if (lane.writer.is_open()) {
+        lane.writer.close(Clock::now());
+    }
+}
+
+struct LatencySummary {
+    LatencyHistogram::BucketCounts buckets{};
+    std::chrono::nanoseconds max{0};
+    uint64_t count = 0;
+
+    void add(const LatencyHistogram& histogram) {
+        const LatencyHistogram::BucketCounts counts = histogram.bucket_counts();
+        for (uint32_t i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i) {
+            buckets[i] += counts[i];
+        }
+        max = std::max(max, histogram.max());
+        count += histogram.count();
+    }
+
+    void print(const char* label) const {
+        // Buckets are powers of two; never report more than the true maximum
+        const auto us = [this](std::chrono::nanoseconds value) {
+            return static_cast<double>(std::min(value, max).count()) / 1000.0;
+        };
+        std::printf("  %-6s n=%-8llu p50=%9.1fus p99=%9.1fus p99.9=%9.1fus max=%9.1fus\n",
+                    label,
+                    static_cast<unsigned long long>(count),
+                    us(LatencyHistogram::percentile_of(buckets, 50.0)),
+                    us(LatencyHistogram::percentile_of(buckets, 99.0)),
+                    us(LatencyHistogram::percentile_of(buckets, 99.9)),
+                    us(max));
+    }
+};
+
+int run(const Options& options) {
+    std::error_code ec;
+    std::filesystem::create_directories(options.directory, ec);
+    if (ec) {
+        std::fprintf(stderr, "Cannot create '%s': %s\n", options.directory.c_str(),
+                     ec.message().c_str());
+        return 1;
+    }
+
+    StorageAccounting accounting(options.directory);
+    if (!accounting.start(std::chrono::milliseconds(1000))) {
+        return 1;
+    }
+    IoFaultInjector faults(options.faults);
+    DegradationController degradation(dashcam::DegradationConfig{},
+                                      [](const dashcam::LogEvent& event) {
+                                          std::printf("  [%s] %s\n",
+                                                      event.event_type().c_str(),
+                                                      event.message().c_str());
+                                      });
+
+    // Frame sizes that average out to the bitrate over a GOP
+    const double gop_bytes = options.bitrate_mbps * 1e6 / 8.0 * options.gop_frames / options.fps;
+    const auto delta_bytes = static_cast<size_t>(
+        std::max(1.0, gop_bytes / (KEYFRAME_WEIGHT + options.gop_frames - 1)));
+    const size_t keyframe_bytes = delta_bytes * KEYFRAME_WEIGHT;
+
+    std::mt19937_64 rng(0x6461736863616dULL);
+    std::vector<std::unique_ptr<CameraLane>> lanes;
+    for (uint32_t i = 0; i < options.cameras; ++i) {
+        auto lane = std::make_unique<CameraLane>(options, &accounting, &faults);
+        lane->name = camera_name(i);
+        lane->keyframe = random_frame(keyframe_bytes, rng, true);
+        lane->delta_frame = random_frame(delta_bytes, rng, false);
+        lanes.push_back(std::move(lane));
+    }
+
+    sync_filesystem(options.directory);
+    const std::optional<uint64_t> sectors_before = device_sectors_written(options.directory);
+
+    std::vector<std::thread> storage_threads;
+    for (auto& lane : lanes) {
+        storage_threads.emplace_back(run_storage_thread, std::cref(options), std::ref(*lane));
+    }
+
+    // Producer: one frame per camera per tick, paced to real time unless asked not to
+    const uint64_t total_frames = static_cast<uint64_t>(options.seconds) * options.fps;
+    const auto frame_interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / options.fps));
+    const auto started = Clock::now();
+    uint64_t payload_bytes = 0;
+
+    for (uint64_t frame = 0; frame < total_frames; ++frame) {
+        if (options.paced) {
+            std::this_thread::sleep_until(started + frame_interval * frame);
+        }
+        const bool keyframe = frame % options.gop_frames == 0;
+
+        if (options.paced) {
+            dashcam::StoragePressure pressure;
+            pressure.queue_capacity = options.queue_frames;
+            pressure.free_bytes = accounting.usage().available_bytes;
+            for (const auto& lane : lanes) {
+                pressure.queue_depth = std::max(pressure.queue_depth, lane->queue.depth());
+            }
+            degradation.update(pressure, Clock::now());
+        }
+
+        for (auto& lane : lanes) {
+            const WriteChunk& chunk = keyframe ? lane->keyframe : lane->delta_frame;
+            if (!options.paced) {
+                // Raw throughput: wait for the writer instead of shedding
+                lane->queue.push(chunk);
+                payload_bytes += chunk.size_bytes;
+                continue;
+            }
+            if (!degradation.admit_camera_frame(lane->name, keyframe)) {
+                continue;
+            }
+            if (lane->queue.try_push(chunk)) {
+                payload_bytes += chunk.size_bytes;
+            } else {
+                lane->queue_overflows.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+    const auto produced = Clock::now();
+
+    for (auto& lane : lanes) {
+        lane->queue.close();
+    }
+    for (std::thread& thread : storage_threads) {
+        thread.join();
+    }
+    const auto finished = Clock::now();
+    accounting.stop();
+
+    sync_filesystem(options.directory);
+    const std::optional<uint64_t> sectors_after = device_sectors_written(options.directory);
+
+    // Report
+    const double elapsed = std::chrono::duration<double>(finished - started).count();
+    const double drain = std::chrono::duration<double>(finished - produced).count();
+    uint64_t bytes_written = 0;
+    LatencySummary writes;
+    LatencySummary syncs;
+
+    std::printf("\nCameras: %u x %.1f Mbit/s, %u fps, GOP %u, %s, %.2fs elapsed (%.2fs drain)\n",
+                options.cameras,
+                options.bitrate_mbps,
+                options.fps,
+                options.gop_frames,
+                options.paced ? "paced" : "unpaced",
+                elapsed,
+                drain);
+    for (const auto& lane : lanes) {
+        const dashcam::SegmentWriterStats stats = lane->writer.stats(finished);
+        bytes_written += stats.bytes_written;
+        writes.add(lane->writer.write_latency());
+        syncs.add(lane->writer.sync_latency());
+        std::printf("  %-6s frames=%llu overflows=%llu failed=%llu dropped=%lluB "
+                    "avg_write=%.0fB\n",
+                    lane->name.c_str(),
+                    static_cast<unsigned long long>(lane->frames_written),
+                    static_cast<unsigned long long>(lane->queue_overflows.load()),
+                    static_cast<unsigned long long>(lane->append_failures),
+                    static_cast<unsigned long long>(stats.bytes_dropped),
+                    stats.bytes_per_syscall);
+    }
+
+    std::printf("Throughput: %.2f MiB/s written (%.2f MiB payload queued)\n",
+                static_cast<double>(bytes_written) / (1024.0 * 1024.0) / elapsed,
+                static_cast<double>(payload_bytes) / (1024.0 * 1024.0));
+    std::printf("Latency:\n");
+    writes.print("write");
+    syncs.print("sync");
+
+    if (sectors_before && sectors_after && bytes_written > 0) {
+        const uint64_t device_bytes = (*sectors_after - *sectors_before) * SECTOR_BYTES;
+        std::printf("Write amplification: %.3f (%llu device bytes, includes other writers)\n",
+                    static_cast<double>(device_bytes) / static_cast<double>(bytes_written),
+                    static_cast<unsigned long long>(device_bytes));
+    } else {
+        std::printf("Write amplification: unavailable for this directory\n");
+    }
+
+    const dashcam::DegradationStats degraded = degradation.stats();
+    std::printf("Degradation: final=%s escalations=%llu recoveries=%llu frames_shed=%llu\n",
+                std::string(dashcam::to_string(degradation.tier())).c_str(),
+                static_cast<unsigned long long>(degraded.escalations),
+                static_cast<unsigned long long>(degraded.recoveries),
+                static_cast<unsigned long long>(degraded.camera_frames_shed));
+
+    const dashcam::IoFaultStats injected = faults.stats();
+    std::printf("Faults: writes_failed=%llu/%llu syncs_failed=%llu/%llu\n",
+                static_cast<unsigned long long>(injected.writes_failed),
+                static_cast<unsigned long long>(injected.writes_seen),
+                static_cast<unsigned long long>(injected.syncs_failed),
+                static_cast<unsigned long long>(injected.syncs_seen));
+
+    if (!options.keep_files) {
+        for (const auto& lane : lanes) {
+            for (const std::string& path : lane->segment_paths) {
+                std::filesystem::remove(path, ec);
+            }
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const std::optional<Options> options = parse_options(argc, argv);
+    if (!options) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    if (!dashcam::Logger::initialize(dashcam::LogLevel::Warning)) {
+        std::fprintf(stderr, "Failed to initialize logging\n");
+        return 1;
+    }
+    const int result = run(*options);
+    dashcam::Logger::shutdown();
+    return result;
+}
@@ -8,6 +8,7 @@
  * It follows Tiger Style principles of safety, performance, and developer experience.
  */
 
+#include <chrono>
 #include <memory>
 #include <string>
 #include <grpcpp/grpcpp.h>
@@ -15,11 +16,35 @@
 // Forward declare the generated protobuf classes
 namespace dashcam {
     class DashcamServiceImpl;
-    class DashcamEventService;
+    class DashcamEventServiceImpl;
+    class LogEvent;
+    class FrameBuffer;
+    struct PreviewFrameInfo;
+    class StorageAccounting;
+    class LiveStatus;
+    class SegmentIndex;
 }
 
 namespace dashcam {
 
+/**
+ * @brief Server resources and shutdown behaviour
+ */
+struct GrpcServerConfig {
+    int max_threads = 4;                     // Cap on threads the server may spawn
+    std::chrono::milliseconds status_interval{100}; // Longest time between StreamStatus updates
+    bool status_publish_unchanged = true;    // Off: only send StreamStatus updates that differ
+    uint32_t status_full_resync_updates = 100; // Delta streams: most deltas between full snapshots
+    std::chrono::milliseconds stream_max_write_stall{10000}; // Then a stream that stopped reading is cancelled
+    uint32_t preview_max_fps = 30;           // Cap on a StreamPreview request's max_fps
+    uint32_t download_max_concurrent = 2;    // DownloadClip calls served at once; more are refused
+    uint64_t download_max_bytes_per_second = 0; // Per download; 0: client and idle I/O pace it
+    size_t event_capacity = 65536;           // GetEvents ring size; the oldest are overwritten
+    std::string event_log_directory;         // Persist events here for older GetEvents ranges; empty: memory only
+    std::chrono::hours event_log_retention{24 * 28}; // Persisted events older than this are deleted
+    std::chrono::milliseconds shutdown_grace{1000}; // Then in-flight calls are cancelled
+};
+
 /**
  * @brief Main gRPC server for dashcam services
  * 
@@ -32,8 +57,20 @@ public:
      * @brief Construct a new gRPC server
      * 
      * @param address Server address (e.g., "0.0.0.0:50051")
+     * @param storage_accounting Optional storage counters reported in status replies
+     * @param live_status Optional capture status reported in status replies
+     * @param segments Optional segment index; DownloadClip serves its segments
+     *        and pins them while they download
+     * @param config Thread cap, stream cadence, event history and shutdown grace period
+     *
+     * If event_log_directory is set but cannot be opened, the error is
+     * logged and GetEvents serves the in-memory history only.
      */
-    explicit GrpcServer(std::string_view address);
+    explicit GrpcServer(std::string_view address,
+                        std::shared_ptr<const StorageAccounting> storage_accounting = nullptr,
+                        std::shared_ptr<const LiveStatus> live_status = nullptr,
+                        std::shared_ptr<SegmentIndex> segments = nullptr,
+                        const GrpcServerConfig& config = GrpcServerConfig{});
     
     /**
      * @brief Destructor ensures clean shutdown
@@ -58,6 +95,9 @@ public:
     /**
      * @brief Stop the gRPC server gracefully
      * 
+     * Open streams are asked to finish first; calls still running after
+     * shutdown_grace are cancelled.
+     *
      * @post Server is stopped and all connections are closed
      */
     void stop();
@@ -76,14 +116,40 @@ public:
      */
     void wait_for_shutdown();
 
+    /**
+     * @brief Record an event for GetEvents and live StreamEvents streams
+     *
+     * May be called from any thread, before or after start(); never waits
+     * for a client. Suitable as a DegradationController::EventSink.
+     */
+    void record_event(const LogEvent& event);
+
+    /**
+     * @brief Send an encoded preview frame to StreamPreview viewers
+     *
+     * Takes the frame's reference; viewers share the buffer, nothing is
+     * copied. May be called from any thread; never waits for a client.
+     * Frames shed by DegradationController::admit_preview_frame() are
+     * simply never published.
+     */
+    void publish_preview(const PreviewFrameInfo& info, FrameBuffer frame);
+
+    /**
+     * @brief Whether the preview encoder should make its next frame of `camera_id` a keyframe
+     *
+     * Poll before encoding each frame; true when a viewer is waiting to start.
+     */
+    bool take_preview_keyframe_request(std::string_view camera_id);
+
 private:
     std::string server_address_;
+    const GrpcServerConfig config_;
     std::unique_ptr<grpc::Server> server_;
     bool running_;
     
     // Service implementations
     std::unique_ptr<DashcamServiceImpl> dashcam_service_;
-    // std::unique_ptr<DashcamEventServiceImpl> event_service_;
+    std::unique_ptr<DashcamEventServiceImpl> event_service_;
 };
 
 /**
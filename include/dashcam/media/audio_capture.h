@@ -0,0 +1,245 @@
+#pragma once
+
+/**
+ * @file audio_capture.h
+ * @brief Audio capture stage: PCM source, lock-free ring and A/V alignment
+ *
+ * A capture thread pulls fixed-size periods from an AudioSource into a
+ * PcmRing, stamping each with the capture-clock time of its first frame. The
+ * storage thread drains the ring after each video frame, places every period
+ * on the video decode timeline and hands it to the muxer, so audio lands in
+ * the same fragment as the video it accompanies.
+ *
+ * Audio never blocks video: the capture thread drops a period when the ring
+ * is full, the muxer drops a period outside the skew bound, and both are
+ * counted. Encoding is PCM passthrough; the muxer copies the period straight
+ * from the ring into the fragment.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "dashcam/media/fmp4_muxer.h"
+#include "dashcam/media/pcm_ring.h"
+
+namespace dashcam {
+
+/**
+ * @brief Interleaved 16-bit PCM format
+ */
+struct AudioFormat {
+    uint32_t sample_rate = 48000;
+    uint16_t channels = 1;
+};
+
+/**
+ * @brief PCM source for the capture thread: a WAV file or a synthetic tone
+ *
+ * The whole source is held in memory and read sequentially. A microphone
+ * driver would take the same place in AudioCapture.
+ */
+class AudioSource {
+public:
+    AudioSource() = default;
+
+    // Tiger Style: No copy/move, the capture thread holds a reference
+    AudioSource(const AudioSource&) = delete;
+    AudioSource& operator=(const AudioSource&) = delete;
+    AudioSource(AudioSource&&) = delete;
+    AudioSource& operator=(AudioSource&&) = delete;
+
+    /**
+     * @brief Generate one second of a sine tone, looped forever
+     *
+     * @pre format.sample_rate > 0, 0 < format.channels <= 2,
+     *      0 < tone_hz < format.sample_rate / 2
+     */
+    void generate_tone(const AudioFormat& format, uint32_t tone_hz);
+
+    /**
+     * @brief Load a 16-bit PCM WAV file with one or two channels
+     *
+     * @param loop Restart at the end instead of ending the capture
+     * @return false if the file is missing or not 16-bit PCM
+     */
+    bool open_wav(std::string_view path, bool loop);
+
+    bool is_open() const;
+    const AudioFormat& format() const;
+
+    /**
+     * @brief Copy up to `frames` interleaved frames into `out`
+     *
+     * @return Frames copied; 0 once a non-looping source is exhausted
+     */
+    uint32_t read(int16_t* out, uint32_t frames);
+
+private:
+    AudioFormat format_;
+    std::vector<int16_t> pcm_;
+    size_t position_frames_ = 0;
+    bool loop_ = false;
+};
+
+/**
+ * @brief Maps PCM periods onto the video decode timeline
+ *
+ * The epoch is the capture-clock instant the video track maps to decode time
+ * zero, so audio decode time is (capture_time - epoch) * sample_rate. Within
+ * a run of periods, decode time simply advances by each period's frames; this
+ * removes scheduling jitter from the capture timestamps. When the two
+ * disagree by more than the resync threshold (source clock drift) or the
+ * ring reports dropped periods, the timeline snaps back to the capture time.
+ */
+class AudioTimeline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @pre sample_rate > 0
+     */
+    AudioTimeline(uint32_t sample_rate,
+                  Clock::time_point epoch,
+                  std::chrono::microseconds resync_threshold);
+
+    /**
+     * @brief Decode time of a period, in sample_rate units
+     */
+    int64_t place(const PcmPeriodInfo& period);
+
+    /**
+     * @brief Times the timeline snapped back to the capture clock
+     */
+    uint64_t resyncs() const;
+
+private:
+    uint32_t sample_rate_;
+    Clock::time_point epoch_;
+    int64_t resync_threshold_frames_;
+
+    bool started_ = false;
+    int64_t next_decode_time_ = 0;
+    uint64_t resyncs_ = 0;
+};
+
+/**
+ * @brief Period size, buffering and pacing of the capture thread
+ */
+struct AudioCaptureConfig {
+    uint32_t period_frames = 960;     // 20 ms at 48 kHz
+    uint32_t ring_periods = 50;       // One second of slack for a stalled storage thread
+    bool realtime = true;             // Pace reads to the capture clock; off for tests
+    std::chrono::microseconds resync_threshold{20000};
+};
+
+/**
+ * @brief Counters for monitoring the audio path
+ */
+struct AudioCaptureStats {
+    uint64_t periods_captured = 0;
+    uint64_t frames_captured = 0;
+    uint64_t periods_dropped = 0;     // Ring was full; the capture thread moved on
+    uint64_t periods_drained = 0;
+    uint64_t periods_muxed = 0;       // Drained and accepted by the muxer
+    uint64_t resyncs = 0;
+};
+
+/**
+ * @brief One audio source's capture thread and ring
+ *
+ * Threading: start()/stop() from one owner thread. drain() from the storage
+ * thread only, the ring's single consumer. stats() from the storage thread.
+ */
+class AudioCapture {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @param config Period size, ring depth and pacing
+     * @param source PCM source; must outlive the capture and is read only
+     *        by the capture thread while it runs
+     *
+     * @pre source.is_open(), config.period_frames > 0, config.ring_periods > 0
+     */
+    AudioCapture(const AudioCaptureConfig& config, AudioSource& source);
+
+    /**
+     * @brief Destructor stops the capture thread
+     */
+    ~AudioCapture();
+
+    // Tiger Style: No copy/move, owns a thread that captures this
+    AudioCapture(const AudioCapture&) = delete;
+    AudioCapture& operator=(const AudioCapture&) = delete;
+    AudioCapture(AudioCapture&&) = delete;
+    AudioCapture& operator=(AudioCapture&&) = delete;
+
+    /**
+     * @brief Start capturing now
+     *
+     * @param epoch Capture-clock instant the video track maps to decode time 0
+     */
+    void start(Clock::time_point epoch);
+
+    /**
+     * @brief Stop capturing; periods already in the ring stay drainable
+     */
+    void stop();
+
+    /**
+     * @brief Mux every period captured up to `until`
+     *
+     * Call after each video frame with that frame's capture time, so each
+     * period goes into the fragment holding the video it accompanies.
+     * Periods drained while the muxer is between segments are discarded.
+     *
+     * @return Periods drained from the ring
+     *
+     * @pre start() was called; muxer has an audio track in the source's format
+     */
+    uint32_t drain(Fmp4Muxer& muxer, Clock::time_point until, Clock::time_point now);
+
+    AudioCaptureStats stats() const;
+
+    /**
+     * @brief Capture-clock duration of `frames` at `sample_rate`
+     *
+     * Exact for any frame count a capture can reach, so long-running
+     * captures do not drift or wrap.
+     *
+     * @pre sample_rate > 0
+     */
+    static Clock::duration frames_to_duration(uint64_t frames, uint32_t sample_rate);
+
+private:
+    void run(Clock::time_point first_frame_time);
+
+    const AudioCaptureConfig config_;
+    AudioSource& source_;
+    PcmRing ring_;
+
+    // Storage thread only
+    AudioTimeline timeline_;
+    uint64_t periods_drained_ = 0;
+    uint64_t periods_muxed_ = 0;
+
+    // Capture thread only: destination for periods the full ring cannot take
+    std::vector<int16_t> scratch_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_requested_ = false;
+    std::thread thread_;
+
+    std::atomic<uint64_t> periods_captured_{0};
+    std::atomic<uint64_t> frames_captured_{0};
+    std::atomic<uint64_t> periods_dropped_{0};
+};
+
+} // namespace dashcam
@@ -0,0 +1,102 @@
+#pragma once
+
+/**
+ * @file capture_clock.h
+ * @brief One capture timeline shared by every camera
+ *
+ * Segment times are UTC microseconds, but the system clock can step under
+ * NTP while recording. CaptureClock anchors the monotonic clock to UTC once,
+ * so every camera stamps frames on the same timeline and that timeline never
+ * jumps.
+ *
+ * Each camera's driver stamps frames with its own clock, often with a
+ * constant offset plus some delivery latency. CameraClockTracker learns that
+ * offset per camera and maps device timestamps onto the shared timeline.
+ */
+
+#include <chrono>
+#include <cstdint>
+
+namespace dashcam {
+
+/**
+ * @brief Monotonic clock expressed as UTC microseconds
+ *
+ * Threading: immutable after construction; safe from any thread.
+ */
+class CaptureClock {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Anchor the monotonic clock to the system clock now
+     */
+    CaptureClock();
+
+    /**
+     * @brief Anchor explicitly, e.g. to share one anchor across processes
+     */
+    CaptureClock(Clock::time_point steady_anchor, int64_t utc_anchor_us);
+
+    int64_t to_us(Clock::time_point time) const;
+    Clock::time_point from_us(int64_t utc_us) const;
+    int64_t now_us() const;
+
+private:
+    Clock::time_point steady_anchor_;
+    int64_t utc_anchor_us_;
+};
+
+/**
+ * @brief Estimates one camera's device-clock offset from the capture clock
+ *
+ * Every frame gives a sample `arrival - device` = offset + delivery latency.
+ * Latency is never negative and is occasionally close to its minimum, so the
+ * smallest sample over a window is the best estimate of the offset. Two
+ * alternating windows let the estimate follow slow drift without ever
+ * forgetting its whole history at once.
+ *
+ * Threading: the camera's capture thread only.
+ */
+class CameraClockTracker {
+public:
+    /**
+     * @param window_us Length of each minimum-tracking window
+     *
+     * @pre window_us > 0
+     */
+    explicit CameraClockTracker(int64_t window_us);
+
+    /**
+     * @brief Fold in one frame and map it onto the capture clock
+     *
+     * @param device_us Frame timestamp from the driver, in its own clock
+     * @param arrival_us Capture-clock time the frame was dequeued
+     * @return Capture-clock time of the frame
+     */
+    int64_t observe(int64_t device_us, int64_t arrival_us);
+
+    /**
+     * @brief Map a device timestamp with the current estimate
+     *
+     * @pre observe() was called at least once
+     */
+    int64_t to_capture_us(int64_t device_us) const;
+
+    int64_t offset_us() const;
+
+    /**
+     * @brief Latency of the last frame above the best estimate
+     */
+    int64_t last_jitter_us() const;
+
+private:
+    const int64_t window_us_;
+    bool has_estimate_ = false;
+    int64_t window_start_us_ = 0;
+    int64_t current_min_ = 0;
+    int64_t previous_min_ = 0;
+    int64_t last_jitter_us_ = 0;
+};
+
+} // namespace dashcam
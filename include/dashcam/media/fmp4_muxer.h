@@ -0,0 +1,297 @@
+#pragma once
+
+/**
+ * @file fmp4_muxer.h
+ * @brief Fragmented MP4 (ISO BMFF / CMAF) muxer feeding a SegmentWriter
+ *
+ * A classic MP4 keeps its sample tables in a single `moov` box written at
+ * close, so a power cut loses the whole segment. Fmp4Muxer instead writes an
+ * initialization segment (`ftyp` + empty `moov`) once, then a self-contained
+ * `moof` + `mdat` fragment per GOP. Every complete fragment is playable on its
+ * own; a crash loses at most the fragment being written.
+ *
+ * Frame payloads are never copied. Only the small `moof` and `mdat` headers
+ * are serialized; encoder buffers follow them as separate WriteChunks and go
+ * to the kernel in the same writev() batch. With encryption enabled the
+ * payloads are instead encrypted straight into one pooled staging buffer.
+ *
+ * An optional PCM audio track is interleaved per fragment: the mdat holds the
+ * fragment's video samples followed by the audio captured over the same
+ * span. Audio is small, so it is copied into one pooled buffer per fragment.
+ */
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "dashcam/storage/fragment_cipher.h"
+#include "dashcam/storage/integrity_chain.h"
+#include "dashcam/storage/segment_writer.h"
+#include "dashcam/storage/sidecar_index.h"
+
+namespace dashcam {
+
+class Mp4BoxWriter;
+
+/**
+ * @brief Video bitstream carried by the track
+ */
+enum class VideoCodec : uint8_t {
+    H264 = 0,   // Sample entry avc1, payloads in length-prefixed (AVCC) form
+    H265 = 1    // Sample entry hvc1, payloads in length-prefixed (HVCC) form
+};
+
+/**
+ * @brief Audio bitstream carried by the optional audio track
+ */
+enum class AudioCodec : uint8_t {
+    PcmS16 = 0  // Sample entry ipcm: interleaved 16-bit little-endian PCM, passed through
+};
+
+/**
+ * @brief Optional audio track; sample_rate 0 leaves the segment video-only
+ */
+struct Fmp4AudioConfig {
+    AudioCodec codec = AudioCodec::PcmS16;
+    uint32_t sample_rate = 0;                  // Also the audio timescale; <= 65535
+    uint16_t channels = 1;                     // 1 or 2
+    uint32_t max_samples_per_fragment = 512;   // <= MAX_AUDIO_SAMPLES_PER_FRAGMENT
+    uint32_t max_skew_us = 500000;             // Audio further from the video is dropped
+};
+
+/**
+ * @brief Track parameters for the initialization segment
+ */
+struct Fmp4MuxerConfig {
+    VideoCodec codec = VideoCodec::H264;
+    uint16_t width = 1920;
+    uint16_t height = 1080;
+    uint32_t timescale = 90000;                  // Units of SampleTiming
+    std::vector<uint8_t> decoder_config;         // avcC/hvcC record from the encoder
+    uint32_t max_samples_per_fragment = 240;     // Split long GOPs; <= MAX_SAMPLES_PER_FRAGMENT
+    uint64_t max_fragment_bytes = 64 * 1024 * 1024;
+    Fmp4AudioConfig audio;
+};
+
+/**
+ * @brief Decode timing of one sample, in track timescale units
+ */
+struct SampleTiming {
+    int64_t decode_time = 0;
+    uint32_t duration = 0;
+    int32_t composition_offset = 0;   // PTS - DTS, non-zero with B-frames
+};
+
+/**
+ * @brief Counters for monitoring muxer overhead
+ */
+struct Fmp4MuxerStats {
+    uint64_t fragments_written = 0;
+    uint64_t samples_written = 0;
+    uint64_t header_bytes = 0;     // ftyp/moov/moof/mdat headers
+    uint64_t payload_bytes = 0;    // Encoder bytes, passed through by reference
+    uint64_t samples_dropped = 0;  // Lost because their fragment failed to encrypt
+    uint64_t audio_samples_written = 0;
+    uint64_t audio_samples_dropped = 0;  // Outside the skew bound, overlapping, or not encrypted
+};
+
+/**
+ * @brief Writes one fragmented MP4 video segment through a SegmentWriter
+ *
+ * Threading: single storage thread, like the SegmentWriter it feeds.
+ *
+ * Each fragment header is queued as a "keyframe" chunk, so a writer using
+ * DurabilityMode::OnKeyframe makes every completed fragment durable before the
+ * next one starts.
+ */
+class Fmp4Muxer {
+public:
+    using Clock = SegmentWriter::Clock;
+
+    // One moof/mdat header chunk plus the samples fit in a single writev() batch
+    static constexpr uint32_t MAX_SAMPLES_PER_FRAGMENT = SegmentWriter::MAX_BATCH_CHUNKS - 1;
+
+    // Audio samples share one copied buffer, so they cost a single chunk
+    static constexpr uint32_t MAX_AUDIO_SAMPLES_PER_FRAGMENT = 1024;
+
+    /**
+     * @param config Track parameters and fragment limits
+     * @param writer Writer for the segment file; must outlive the muxer
+     * @param sidecar Optional index that receives a seek point per keyframe
+     *        fragment; the recorder resets and writes it per segment
+     * @param cipher Optional encryption at rest; each segment gets a fresh key
+     *        and each fragment's mdat is AES-256-GCM encrypted
+     * @param chain Optional tamper-evidence chain; receives the initialization
+     *        segment and every fragment as written. The owner brackets each
+     *        segment with chain->begin_segment() and chain->end_segment()
+     *
+     * @pre config.decoder_config is not empty
+     * @pre 0 < config.max_samples_per_fragment <= MAX_SAMPLES_PER_FRAGMENT, and
+     *      < MAX_SAMPLES_PER_FRAGMENT with audio to leave room for its chunk
+     */
+    Fmp4Muxer(const Fmp4MuxerConfig& config,
+              SegmentWriter& writer,
+              SidecarIndexBuilder* sidecar = nullptr,
+              FragmentCipher* cipher = nullptr,
+              IntegrityChain* chain = nullptr);
+
+    // Tiger Style: No copy/move, holds a reference to the writer
+    Fmp4Muxer(const Fmp4Muxer&) = delete;
+    Fmp4Muxer& operator=(const Fmp4Muxer&) = delete;
+    Fmp4Muxer(Fmp4Muxer&&) = delete;
+    Fmp4Muxer& operator=(Fmp4Muxer&&) = delete;
+
+    /**
+     * @brief Write the initialization segment into a freshly opened file
+     *
+     * @pre writer is open and empty; no segment in progress
+     */
+    bool begin_segment(Clock::time_point now);
+
+    /**
+     * @brief Add one encoded frame
+     *
+     * A keyframe closes the current fragment and starts a new one. The first
+     * sample of a segment must be a keyframe.
+     *
+     * @param payload Encoded access unit; payload.keyframe marks a sync sample
+     * @param timing Decode time must not go backwards
+     * @return false if the sample was rejected or the writer failed
+     *
+     * @pre begin_segment() succeeded
+     */
+    bool add_sample(WriteChunk payload, const SampleTiming& timing, Clock::time_point now);
+
+    /**
+     * @brief Add one period of audio to the current fragment
+     *
+     * The bytes are copied, so the caller may reuse its buffer at once. The
+     * sample is dropped and counted if no video has been added to the segment
+     * yet, if it overlaps audio already added, or if it starts more than
+     * max_skew_us away from the latest video decode time. A gap in the audio
+     * timeline closes the current fragment so the next one can restate it.
+     *
+     * @param timing Decode time and duration in audio sample_rate units
+     * @return false if the sample was dropped or the writer failed
+     *
+     * @pre begin_segment() succeeded and the audio track is configured
+     */
+    bool add_audio_sample(const uint8_t* data,
+                          size_t size_bytes,
+                          const SampleTiming& timing,
+                          Clock::time_point now);
+
+    /**
+     * @brief Emit the samples gathered so far as one fragment
+     */
+    bool flush_fragment(Clock::time_point now);
+
+    /**
+     * @brief Emit the last fragment; the caller then closes the writer
+     */
+    bool end_segment(Clock::time_point now);
+
+    bool in_segment() const;
+    uint32_t pending_samples() const;
+    uint32_t pending_audio_samples() const;
+    bool has_audio() const;
+    Fmp4MuxerStats stats() const;
+
+private:
+    struct SampleEntry {
+        uint32_t size_bytes;
+        uint32_t duration;
+        uint32_t flags;
+        int32_t composition_offset;
+    };
+
+    struct AudioEntry {
+        uint32_t size_bytes;
+        uint32_t duration;
+    };
+
+    std::shared_ptr<std::vector<uint8_t>> acquire_header_buffer();
+    std::shared_ptr<std::vector<uint8_t>> acquire_audio_buffer();
+    std::shared_ptr<std::vector<uint8_t>> acquire_staging_buffer(size_t size_bytes);
+    bool encrypt_fragment(uint32_t sequence,
+                          uint32_t payload_count,
+                          uint64_t payload_bytes,
+                          Mp4BoxWriter& box,
+                          WriteChunk* ciphertext);
+    void drop_fragment();
+    int64_t audio_segment_base() const;
+    void write_init_segment(std::vector<uint8_t>* out) const;
+    void write_track(Mp4BoxWriter& box, bool audio) const;
+    void write_sample_entry(Mp4BoxWriter& box) const;
+    void write_audio_sample_entry(Mp4BoxWriter& box) const;
+
+    const Fmp4MuxerConfig config_;
+    SegmentWriter& writer_;
+    SidecarIndexBuilder* const sidecar_;
+    FragmentCipher* const cipher_;
+    IntegrityChain* const chain_;
+
+    bool in_segment_ = false;
+    uint32_t fragment_sequence_ = 0;
+    int64_t segment_base_decode_time_ = 0;
+    int64_t last_decode_time_ = 0;
+
+    // Sample table of the fragment being gathered, allocated once
+    std::array<WriteChunk, MAX_SAMPLES_PER_FRAGMENT> payloads_{};
+    std::array<SampleEntry, MAX_SAMPLES_PER_FRAGMENT> samples_{};
+    uint32_t sample_count_ = 0;
+    uint64_t fragment_bytes_ = 0;
+    int64_t fragment_decode_time_ = 0;
+
+    // Audio of the fragment being gathered, copied into one pooled buffer
+    std::array<AudioEntry, MAX_AUDIO_SAMPLES_PER_FRAGMENT> audio_samples_{};
+    std::shared_ptr<std::vector<uint8_t>> audio_buffer_;
+    uint32_t audio_count_ = 0;
+    int64_t audio_fragment_decode_time_ = 0;
+    int64_t audio_next_decode_time_ = 0;
+    bool audio_started_ = false;   // Audio has been added to this segment
+
+    // Header buffers are reused once the writer has released them
+    static constexpr uint32_t HEADER_POOL_SIZE = 4;
+    std::array<std::shared_ptr<std::vector<uint8_t>>, HEADER_POOL_SIZE> header_pool_{};
+    uint32_t next_header_slot_ = 0;
+    static constexpr uint32_t AUDIO_POOL_SIZE = 2;
+    std::array<std::shared_ptr<std::vector<uint8_t>>, AUDIO_POOL_SIZE> audio_pool_{};
+    uint32_t next_audio_slot_ = 0;
+
+    // Encryption: segment salt, tag scratch and ciphertext staging buffers
+    SegmentEncryption encryption_;
+    std::vector<uint8_t> tags_;
+    static constexpr uint32_t STAGING_POOL_SIZE = 2;
+    std::array<std::shared_ptr<std::vector<uint8_t>>, STAGING_POOL_SIZE> staging_pool_{};
+    uint32_t next_staging_slot_ = 0;
+
+    Fmp4MuxerStats stats_;
+};
+
+/**
+ * @brief Length of the longest prefix of an fMP4 file that is fully playable
+ *
+ * Walks the top-level boxes and returns the offset just past the last
+ * complete `mdat` that follows a `moof` (or past `moov` if no fragment is
+ * complete). Recovery truncates a segment to this length after a crash.
+ *
+ * @return 0 if the data does not start with a complete initialization segment
+ */
+uint64_t fmp4_playable_prefix(const uint8_t* data, uint64_t size_bytes);
+
+/**
+ * @brief Decrypt every fragment of an encrypted segment in place
+ *
+ * Reads the segment salt from the initialization segment and each fragment's
+ * tags from its moof. Fragments are authenticated independently, so a caller
+ * may also pass a prefix cut at any fragment boundary.
+ *
+ * @return false if the segment is not encrypted or any fragment fails
+ *         authentication; fragments before the failure are already decrypted
+ */
+bool fmp4_decrypt_segment(uint8_t* data, uint64_t size_bytes, FragmentCipher& cipher);
+
+} // namespace dashcam
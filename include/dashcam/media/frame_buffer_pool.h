@@ -0,0 +1,150 @@
+#pragma once
+
+/**
+ * @file frame_buffer_pool.h
+ * @brief Preallocated, reference-counted buffers for encoded frames
+ *
+ * The preview encoder writes each frame straight into a pooled buffer and
+ * hands the buffer on; every consumer that keeps the frame (a viewer's send
+ * queue, the network stack while it transmits) holds a reference instead of
+ * a copy. When the last reference goes, the buffer returns to the pool. No
+ * frame is allocated or copied after start-up, and a pool that runs dry
+ * makes the encoder drop a frame rather than wait.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace dashcam {
+
+class FrameBufferPool;
+
+/**
+ * @brief Pool size
+ */
+struct FrameBufferPoolConfig {
+    uint32_t buffers = 32;                   // Frames held at once by the encoder and every viewer
+    size_t buffer_bytes = 512 * 1024;        // Largest encoded frame
+};
+
+/**
+ * @brief Counters for monitoring the pool
+ */
+struct FrameBufferPoolStats {
+    uint64_t acquired = 0;
+    uint64_t exhausted = 0;                  // acquire() found no free buffer
+    uint64_t in_use = 0;
+};
+
+/**
+ * @brief One reference to a pooled buffer
+ *
+ * Move-only; share() takes another reference. The bytes must not change
+ * once the buffer is shared.
+ */
+class FrameBuffer {
+public:
+    FrameBuffer() = default;
+    ~FrameBuffer();
+
+    FrameBuffer(const FrameBuffer&) = delete;
+    FrameBuffer& operator=(const FrameBuffer&) = delete;
+    FrameBuffer(FrameBuffer&& other) noexcept;
+    FrameBuffer& operator=(FrameBuffer&& other) noexcept;
+
+    explicit operator bool() const { return slot_ != nullptr; }
+
+    uint8_t* data();
+    const uint8_t* data() const;
+    size_t size() const;
+    size_t capacity() const;
+
+    /**
+     * @brief Set how many bytes of the buffer hold the frame
+     *
+     * @pre *this, size <= capacity()
+     */
+    void resize(size_t size);
+
+    /**
+     * @brief Another reference to the same bytes
+     *
+     * @pre *this
+     */
+    FrameBuffer share() const;
+
+    /**
+     * @brief Hand this reference to a C-style owner
+     *
+     * Leaves *this empty. The owner passes the returned token to
+     * release_token() when it is done with the bytes.
+     *
+     * @pre *this
+     */
+    void* into_token();
+    static void release_token(void* token);
+
+private:
+    friend class FrameBufferPool;
+    struct Slot;
+
+    explicit FrameBuffer(Slot* slot) : slot_(slot) {}
+    static void unref(Slot* slot);
+
+    Slot* slot_ = nullptr;
+};
+
+/**
+ * @brief Fixed set of frame buffers
+ *
+ * Always owned by a shared_ptr (see create()); every buffer in use keeps
+ * its pool alive, so a frame still queued in gRPC may outlive the encoder.
+ *
+ * Threading: acquire() and stats() from any thread; buffers may be released
+ * on any thread.
+ */
+class FrameBufferPool : public std::enable_shared_from_this<FrameBufferPool> {
+public:
+    /**
+     * @pre config.buffers > 0, config.buffer_bytes > 0
+     */
+    static std::shared_ptr<FrameBufferPool> create(const FrameBufferPoolConfig& config);
+
+    ~FrameBufferPool();
+
+    // Tiger Style: No copy/move, buffers point into it
+    FrameBufferPool(const FrameBufferPool&) = delete;
+    FrameBufferPool& operator=(const FrameBufferPool&) = delete;
+    FrameBufferPool(FrameBufferPool&&) = delete;
+    FrameBufferPool& operator=(FrameBufferPool&&) = delete;
+
+    /**
+     * @brief A free buffer with size() 0; empty if all are in use
+     */
+    FrameBuffer acquire();
+
+    FrameBufferPoolStats stats() const;
+
+private:
+    friend class FrameBuffer;
+
+    explicit FrameBufferPool(const FrameBufferPoolConfig& config);
+
+    void release(FrameBuffer::Slot* slot);
+
+    const FrameBufferPoolConfig config_;
+    std::unique_ptr<uint8_t[]> storage_;
+    std::vector<FrameBuffer::Slot> slots_;
+
+    mutable std::mutex mutex_;
+    std::vector<uint32_t> free_;             // Indexes into slots_
+
+    std::atomic<uint64_t> acquired_{0};
+    std::atomic<uint64_t> exhausted_{0};
+};
+
+} // namespace dashcam
@@ -0,0 +1,101 @@
+#pragma once
+
+/**
+ * @file pcm_ring.h
+ * @brief Lock-free single-producer/single-consumer ring of PCM periods
+ *
+ * The audio capture thread writes fixed-size periods of interleaved 16-bit
+ * PCM straight into ring slots; the storage thread reads them in place and
+ * releases them. Neither side takes a lock or allocates, and a full ring
+ * never makes the producer wait: it reports the overflow so the period can be
+ * dropped and counted.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace dashcam {
+
+/**
+ * @brief Metadata carried with each PCM period
+ */
+struct PcmPeriodInfo {
+    std::chrono::steady_clock::time_point capture_time{};   // First frame, capture clock
+    uint32_t frames = 0;
+    bool discontinuity = false;   // Periods were dropped just before this one
+};
+
+/**
+ * @brief Fixed-capacity SPSC ring of PCM periods
+ *
+ * Threading: begin_write()/commit_write() from exactly one producer thread,
+ * front()/pop() from exactly one consumer thread. size() from either.
+ */
+class PcmRing {
+public:
+    /**
+     * @param period_frames Frames per slot
+     * @param channels Interleaved channels per frame
+     * @param capacity_periods Number of slots
+     *
+     * @pre all arguments > 0
+     */
+    PcmRing(uint32_t period_frames, uint16_t channels, uint32_t capacity_periods);
+
+    // Tiger Style: No copy/move, the two threads hold references to the slots
+    PcmRing(const PcmRing&) = delete;
+    PcmRing& operator=(const PcmRing&) = delete;
+    PcmRing(PcmRing&&) = delete;
+    PcmRing& operator=(PcmRing&&) = delete;
+
+    /**
+     * @brief Slot to fill with up to period_frames() frames
+     *
+     * @return nullptr if the ring is full
+     */
+    int16_t* begin_write();
+
+    /**
+     * @brief Publish the slot returned by begin_write()
+     *
+     * @pre begin_write() returned a slot and 0 < info.frames <= period_frames()
+     */
+    void commit_write(const PcmPeriodInfo& info);
+
+    /**
+     * @brief Oldest published period, read in place
+     *
+     * @return nullptr if the ring is empty
+     */
+    const int16_t* front(PcmPeriodInfo* info) const;
+
+    /**
+     * @brief Release the period returned by front()
+     *
+     * @pre front() returned a period
+     */
+    void pop();
+
+    uint32_t size() const;
+    uint32_t capacity() const;
+    uint32_t period_frames() const;
+    uint16_t channels() const;
+
+private:
+    static constexpr size_t CACHE_LINE_BYTES = 64;
+
+    const uint32_t period_frames_;
+    const uint16_t channels_;
+    const uint32_t capacity_;
+    std::vector<int16_t> samples_;
+    std::vector<PcmPeriodInfo> infos_;
+
+    // Monotonic counters; slot = counter % capacity. Kept on separate cache
+    // lines so the producer and consumer do not false-share.
+    alignas(CACHE_LINE_BYTES) std::atomic<uint64_t> write_count_{0};
+    alignas(CACHE_LINE_BYTES) std::atomic<uint64_t> read_count_{0};
+};
+
+} // namespace dashcam
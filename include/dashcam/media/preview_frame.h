@@ -0,0 +1,27 @@
+#pragma once
+
+/**
+ * @file preview_frame.h
+ * @brief Description of one frame from a camera's preview encoder
+ */
+
+#include <cstdint>
+#include <string>
+
+namespace dashcam {
+
+/**
+ * @brief What the encoder knows about one encoded preview frame
+ *
+ * The bytes themselves travel in a FrameBuffer.
+ */
+struct PreviewFrameInfo {
+    std::string camera_id;
+    int64_t timestamp_ms = 0;                        // Capture time
+    bool keyframe = false;                           // Decodable on its own
+    bool discardable = false;                        // No later frame references it; every frame of an all-intra encoder
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+} // namespace dashcam
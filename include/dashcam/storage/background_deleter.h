@@ -0,0 +1,162 @@
+#pragma once
+
+/**
+ * @file background_deleter.h
+ * @brief Throttled eviction of old segment files off the recording thread
+ *
+ * Unlinking a multi-gigabyte file makes ext4 and exFAT free every extent in
+ * one go while holding filesystem locks, which can stall a concurrent writer
+ * for hundreds of milliseconds. BackgroundDeleter performs evictions on its
+ * own idle-I/O-priority thread, shrinks each file with ftruncate() in bounded
+ * steps before the final unlink(), and pauses whenever the recorder's recent
+ * write latency rises above a ceiling.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "dashcam/storage/segment_index.h"
+#include "dashcam/storage/storage_accounting.h"
+#include "dashcam/utils/latency_histogram.h"
+
+namespace dashcam {
+
+/**
+ * @brief Pacing of background deletion
+ */
+struct BackgroundDeleterConfig {
+    uint64_t truncate_step_bytes = 64 * 1024 * 1024;     // Extents freed per ftruncate()
+    std::chrono::milliseconds step_interval{50};         // Minimum pause between steps
+    std::chrono::nanoseconds max_write_p99{std::chrono::milliseconds(20)};
+    uint64_t min_window_samples = 8;    // Fewer recent writes than this never throttle
+    std::chrono::milliseconds throttle_backoff{250};
+    uint32_t max_consecutive_throttles = 40;  // Then take one step anyway, so space is freed
+    uint32_t max_pending_files = 1024;
+    bool idle_io_priority = true;
+};
+
+/**
+ * @brief Counters for monitoring retention
+ */
+struct BackgroundDeleterStats {
+    uint64_t files_deleted = 0;
+    uint64_t files_failed = 0;
+    uint64_t files_rejected = 0;    // enqueue() on a full queue
+    uint64_t files_deferred = 0;    // Times a file was put back because its segment was pinned
+    uint64_t bytes_freed = 0;
+    uint64_t truncate_steps = 0;
+    uint64_t throttle_pauses = 0;
+    uint64_t pending_files = 0;
+};
+
+/**
+ * @brief Single-threaded, rate-limited file eviction
+ *
+ * Threading: enqueue() and stats() may be called from any thread.
+ * start()/stop() must be called from one owner thread.
+ *
+ * Files with more than one link (protected by ClipProtector via a hard link)
+ * are unlinked without truncation, since truncating would destroy the
+ * protected copy that shares the inode.
+ *
+ * A file whose segment is still pinned in the index, for example because a
+ * download has it mapped, is put back at the end of the queue instead:
+ * truncating it would fault the reader's mapping. At stop() it is left on
+ * disk for the next index rebuild.
+ */
+class BackgroundDeleter {
+public:
+    /**
+     * @param config Step size and throttling policy
+     * @param write_latency The recorder's write latency histogram, or null to
+     *        pace by step_interval alone
+     * @param accounting Optional storage counters credited with freed bytes
+     * @param segments Optional index whose pins defer deletion; files are
+     *        matched to segments by their "<segment_id>_<start_us>.mp4" name
+     */
+    BackgroundDeleter(const BackgroundDeleterConfig& config,
+                      const LatencyHistogram* write_latency,
+                      StorageAccounting* accounting,
+                      const SegmentIndex* segments = nullptr);
+
+    /**
+     * @brief Destructor stops the thread, completing queued deletions
+     */
+    ~BackgroundDeleter();
+
+    // Tiger Style: No copy/move, owns a thread that captures this
+    BackgroundDeleter(const BackgroundDeleter&) = delete;
+    BackgroundDeleter& operator=(const BackgroundDeleter&) = delete;
+    BackgroundDeleter(BackgroundDeleter&&) = delete;
+    BackgroundDeleter& operator=(BackgroundDeleter&&) = delete;
+
+    /**
+     * @brief Start the deletion thread
+     *
+     * @pre Not already started
+     */
+    void start();
+
+    /**
+     * @brief Complete queued deletions without throttling, then join
+     *
+     * Recording has stopped by the time the deleter is shut down, so there is
+     * no write latency left to protect. Files of segments still pinned are
+     * left on disk.
+     */
+    void stop();
+
+    /**
+     * @brief Queue a file for deletion
+     *
+     * The caller removes the segment from the SegmentIndex first, which
+     * fails while it is pinned; from then on the file belongs to the deleter.
+     * A file whose segment is still indexed and pinned waits for the pin.
+     *
+     * @return false if the queue is full
+     *
+     * @pre path is not empty
+     */
+    bool enqueue(std::string_view path);
+
+    BackgroundDeleterStats stats() const;
+
+private:
+    void run();
+    void delete_file(const std::string& path);
+    bool segment_pinned(const std::string& path) const;
+    bool truncate_in_steps(int fd, const std::string& path, uint64_t size_bytes);
+    void pace();
+    bool write_latency_high();
+
+    const BackgroundDeleterConfig config_;
+    const LatencyHistogram* const write_latency_;
+    StorageAccounting* const accounting_;
+    const SegmentIndex* const segments_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::string> pending_;
+    bool stop_requested_ = false;
+    std::thread thread_;
+
+    // Only touched by the deletion thread
+    LatencyHistogram::BucketCounts last_write_counts_{};
+
+    std::atomic<uint64_t> files_deleted_{0};
+    std::atomic<uint64_t> files_failed_{0};
+    std::atomic<uint64_t> files_rejected_{0};
+    std::atomic<uint64_t> files_deferred_{0};
+    std::atomic<uint64_t> bytes_freed_{0};
+    std::atomic<uint64_t> truncate_steps_{0};
+    std::atomic<uint64_t> throttle_pauses_{0};
+};
+
+} // namespace dashcam
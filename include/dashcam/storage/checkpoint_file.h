@@ -0,0 +1,55 @@
+#pragma once
+
+/**
+ * @file checkpoint_file.h
+ * @brief Durable record of a segment's signed integrity checkpoints
+ *
+ * Checkpoints must outlive the process that signed them: footage is verified
+ * long after the car is switched off. Each segment's checkpoints are kept
+ * next to it, in "<segment_id>_<start_us>.chain", as fixed-size little-endian
+ * records:
+ *
+ *   segment_id (8) | sequence (4) | genesis (32) | chain_hash (32) |
+ *   signature (64) | CRC-32 of the preceding bytes (4)
+ *
+ * Records are appended and synced one at a time, so a power loss costs at
+ * most the record being written. A torn or corrupt record ends the load;
+ * nothing after it is trusted.
+ */
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "dashcam/storage/segment_index.h"
+
+namespace dashcam {
+
+constexpr size_t CHECKPOINT_RECORD_BYTES = 8 + 4 + 32 + 32 + 64 + 4;
+
+/**
+ * @brief Checkpoint file of a segment: its path with ".mp4" replaced by ".chain"
+ *
+ * @pre segment_path is not empty
+ */
+std::string checkpoint_file_path(std::string_view segment_path);
+
+/**
+ * @brief Append one checkpoint and fdatasync() it
+ *
+ * A torn record left by an earlier crash is cut off first. Creating the file
+ * also syncs its directory.
+ *
+ * @return false on any I/O error; the error is logged
+ */
+bool append_checkpoint_file(std::string_view path, const IntegrityCheckpoint& checkpoint);
+
+/**
+ * @brief Every intact checkpoint in a file, in the order written
+ *
+ * @return Empty if the file is missing
+ */
+std::vector<IntegrityCheckpoint> load_checkpoint_file(std::string_view path);
+
+} // namespace dashcam
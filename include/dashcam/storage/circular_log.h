@@ -0,0 +1,231 @@
+#pragma once
+
+/**
+ * @file circular_log.h
+ * @brief Fixed-size circular recording file
+ *
+ * Segment-per-file recording makes the filesystem allocate, extend, and later
+ * free thousands of files, which fragments FAT/exFAT cards and costs a
+ * metadata write for every create and unlink. CircularRecordLog preallocates a
+ * single file (or uses a raw partition) per camera and writes self-describing
+ * records into it as a ring. Retention is implicit: the oldest records are
+ * overwritten in place, so steady-state recording does no unlink(), no
+ * directory updates, and has a fixed write amplification.
+ *
+ * On-disk layout (all integers little-endian):
+ *
+ *   [superblock A, 4 KiB][superblock B, 4 KiB][data region ...]
+ *
+ * The two superblocks are written alternately, each with a generation number
+ * and CRC, so a torn superblock write always leaves the other one valid. A
+ * superblock records the ring tail (oldest live record) and head. Records in
+ * the data region carry a magic, a sequence number and CRCs of both header and
+ * payload; recovery starts at the checkpointed tail and follows consecutive
+ * sequence numbers, which also recovers records written after the last
+ * checkpoint.
+ */
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/uio.h>
+
+#include "dashcam/storage/segment_writer.h"
+
+namespace dashcam {
+
+/**
+ * @brief Configuration for a CircularRecordLog
+ */
+struct CircularLogConfig {
+    uint64_t file_size_bytes = 0;                      // Total size including superblocks
+    size_t max_batch_bytes = 1024 * 1024;              // Coalesce records up to this size
+    std::chrono::milliseconds max_batch_latency{250};  // ...or until the oldest is this old
+    std::chrono::milliseconds checkpoint_interval{10000}; // Ring-head pointer refresh
+    DurabilityPolicy durability;
+    std::string label;                                 // e.g. camera id, max 31 bytes
+};
+
+/**
+ * @brief Index entry describing one live record in the ring
+ */
+struct RingRecordInfo {
+    uint64_t sequence = 0;
+    uint64_t offset = 0;        // Offset of the record header within the data region
+    int64_t timestamp_us = 0;
+    uint32_t size_bytes = 0;    // Payload size
+    bool keyframe = false;
+};
+
+/**
+ * @brief Counters describing ring activity
+ */
+struct CircularLogStats {
+    uint64_t records_appended = 0;
+    uint64_t records_overwritten = 0;
+    uint64_t payload_bytes_written = 0;
+    uint64_t device_bytes_written = 0; // Payload plus record headers, padding and superblocks
+    uint64_t write_syscalls = 0;
+    uint64_t checkpoints = 0;
+};
+
+/**
+ * @brief Preallocated ring of self-describing records with its own index
+ *
+ * Threading: single writer. Index queries (records_between(), read_record())
+ * must come from the same thread or be externally synchronized.
+ */
+class CircularRecordLog {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr uint64_t SUPERBLOCK_SIZE = 4096;
+    static constexpr uint64_t DATA_OFFSET = 2 * SUPERBLOCK_SIZE;
+    static constexpr uint32_t RECORD_HEADER_SIZE = 40;
+    static constexpr uint32_t RECORD_ALIGNMENT = 8;
+    static constexpr uint32_t MAX_BATCH_RECORDS = 128;
+    static constexpr size_t MAX_LABEL_LENGTH = 31;
+
+    CircularRecordLog() = default;
+
+    /**
+     * @brief Destructor checkpoints and closes the ring
+     */
+    ~CircularRecordLog();
+
+    // Tiger Style: No copy/move, the log owns a file descriptor and live buffers
+    CircularRecordLog(const CircularRecordLog&) = delete;
+    CircularRecordLog& operator=(const CircularRecordLog&) = delete;
+    CircularRecordLog(CircularRecordLog&&) = delete;
+    CircularRecordLog& operator=(CircularRecordLog&&) = delete;
+
+    /**
+     * @brief Open an existing ring or format a new one
+     *
+     * A regular file is created and preallocated to config.file_size_bytes if
+     * it does not exist. A block device is used at its full size and
+     * config.file_size_bytes is ignored. An existing ring is recovered by
+     * scanning forward from its checkpointed tail.
+     *
+     * @return true if the ring is ready for appends
+     *
+     * @pre The log is not already open
+     * @pre config.label is at most MAX_LABEL_LENGTH bytes
+     */
+    bool open(std::string_view path, const CircularLogConfig& config);
+
+    /**
+     * @brief Queue one record, overwriting the oldest records if needed
+     *
+     * @param chunk Payload, kept alive by chunk.owner until written
+     * @param timestamp_us Capture timestamp, must not go backwards
+     * @param now Current time for batching and durability
+     * @return false if the payload cannot fit in the ring or a write failed
+     *
+     * @pre The log is open
+     */
+    bool append(WriteChunk chunk, int64_t timestamp_us, Clock::time_point now);
+
+    /**
+     * @brief Enforce batch latency, sync and checkpoint schedules
+     */
+    bool poll(Clock::time_point now);
+
+    /**
+     * @brief Write all queued records without syncing
+     */
+    bool flush();
+
+    /**
+     * @brief Flush, sync and persist the ring-head pointer
+     */
+    bool checkpoint(Clock::time_point now);
+
+    /**
+     * @brief Checkpoint and close the ring
+     */
+    bool close(Clock::time_point now);
+
+    bool is_open() const;
+
+    /**
+     * @brief Live records with timestamps in [start_us, end_us], oldest first
+     *
+     * Uses binary search on the in-memory index; timestamps are monotonic
+     * because append() rejects time going backwards.
+     */
+    std::vector<RingRecordInfo> records_between(int64_t start_us, int64_t end_us) const;
+
+    /**
+     * @brief Read and validate a record's payload
+     *
+     * Records still queued in the current batch are not readable until the
+     * batch is flushed.
+     *
+     * @return false if the record was overwritten or fails its CRC
+     */
+    bool read_record(const RingRecordInfo& record, std::vector<uint8_t>* payload) const;
+
+    size_t record_count() const;
+    uint64_t data_capacity_bytes() const;
+    CircularLogStats stats() const;
+
+private:
+    struct Superblock {
+        uint64_t generation = 0;
+        uint64_t file_size = 0;
+        uint64_t tail_offset = 0;
+        uint64_t tail_sequence = 0;
+        uint64_t head_offset = 0;
+        uint64_t head_sequence = 0;
+        std::string label;
+    };
+
+    bool format(uint64_t file_size);
+    bool recover(const Superblock& superblock);
+    bool load_superblock(Superblock* superblock) const;
+    bool write_superblock();
+    size_t scan_from(uint64_t offset, uint64_t sequence);
+    bool reserve(uint64_t start, uint64_t end);
+    bool queue_padding();
+    bool sync_data(Clock::time_point now);
+    bool write_batch();
+    void release_batch();
+
+    int fd_ = -1;
+    std::string path_;
+    CircularLogConfig config_;
+    uint64_t data_capacity_ = 0;
+
+    // Ring state. head_ is where the next record lands once queued records
+    // are written; persisted_tail_sequence_ is what the newest durable
+    // superblock points at and must never be overwritten before it moves.
+    uint64_t head_offset_ = 0;
+    uint64_t next_sequence_ = 0;
+    uint64_t superblock_generation_ = 0;
+    uint64_t persisted_tail_sequence_ = 0;
+    int64_t last_timestamp_us_ = INT64_MIN;
+    std::deque<RingRecordInfo> index_;
+
+    // Pending batch: contiguous bytes starting at batch_offset_
+    std::array<std::array<uint8_t, RECORD_HEADER_SIZE>, MAX_BATCH_RECORDS> batch_headers_{};
+    std::array<WriteChunk, MAX_BATCH_RECORDS> batch_payloads_{};
+    std::array<iovec, 3 * MAX_BATCH_RECORDS> iovecs_{};
+    uint32_t batch_records_ = 0;
+    uint32_t batch_iovecs_ = 0;
+    uint64_t batch_offset_ = 0;
+    uint64_t batch_bytes_ = 0;
+    Clock::time_point batch_started_at_;
+    Clock::time_point last_sync_at_;
+    Clock::time_point last_checkpoint_at_;
+    bool unsynced_ = false;
+
+    CircularLogStats stats_;
+};
+
+} // namespace dashcam
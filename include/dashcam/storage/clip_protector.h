@@ -0,0 +1,176 @@
+#pragma once
+
+/**
+ * @file clip_protector.h
+ * @brief Protect incident clips from loop deletion without copying video
+ *
+ * When an incident is flagged, every segment overlapping the clip window must
+ * survive retention. Copying those segments would rewrite gigabytes on the
+ * card exactly when it is busiest. ClipProtector tries the cheapest method
+ * that works for each segment, in this order:
+ *
+ *   1. Reflink (FICLONE): an independent file sharing the same extents, no data I/O
+ *   2. Hard link: a second name for the same inode, one directory entry written
+ *   3. Index pin: the segment stays where it is and retention skips it, no I/O
+ *   4. Range copy (copy_file_range): in-kernel copy, no user-space bounce buffer
+ *   5. Buffered copy: read()/write() through a fixed buffer, last resort
+ *
+ * Reflink and hard link need the protected directory on the same filesystem
+ * as the recordings; FAT/exFAT support neither, so on typical SD cards the
+ * clip is protected by pinning.
+ *
+ * A segment still being recorded is pinned first, whatever the method: a
+ * reflink or copy would only capture the bytes written so far, and footage
+ * after the trigger is what the clip is for. segment_closed() then protects
+ * the finished file with the cheapest method and drops that pin.
+ */
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "dashcam/storage/segment_index.h"
+
+namespace dashcam {
+
+/**
+ * @brief How a single segment was protected
+ */
+enum class ProtectionMethod : uint8_t {
+    Reflink = 0,
+    HardLink = 1,
+    IndexPin = 2,
+    RangeCopy = 3,
+    BufferedCopy = 4
+};
+
+/**
+ * @brief Human-readable name for logging
+ */
+std::string_view to_string(ProtectionMethod method);
+
+/**
+ * @brief Which protection methods ClipProtector may use
+ */
+struct ClipProtectorConfig {
+    std::string protected_dir;   // Root for cloned/linked/copied clips
+    bool allow_reflink = true;
+    bool allow_hard_link = true;
+    bool allow_pinning = true;   // Disable to force detachable copies
+    bool allow_range_copy = true;
+};
+
+/**
+ * @brief One protected segment of a clip
+ */
+struct ProtectedSegment {
+    uint64_t segment_id = 0;
+    ProtectionMethod method = ProtectionMethod::IndexPin;
+    std::string protected_path;  // Empty for IndexPin
+    bool open = false;           // Pinned until segment_closed()
+};
+
+/**
+ * @brief Result of protecting a clip
+ */
+struct ProtectedClip {
+    std::string clip_id;
+    int64_t start_time_us = 0;
+    int64_t end_time_us = 0;
+    std::vector<ProtectedSegment> segments;
+};
+
+/**
+ * @brief Counters for monitoring how clips get protected
+ */
+struct ClipProtectorStats {
+    uint64_t clips_protected = 0;
+    uint64_t segments_by_method[5] = {};  // Open segments count once closed
+    uint64_t bytes_copied = 0;   // Only RangeCopy and BufferedCopy move data
+};
+
+/**
+ * @brief Protects segment ranges from loop deletion at minimal I/O cost
+ *
+ * Threading: protect() and release() may be called from any thread but are
+ * serialized by the caller; the SegmentIndex is internally synchronized.
+ *
+ * Segments still being recorded are passed in `open_segment_ids`; they stay
+ * pinned until the recorder reports them closed through segment_closed().
+ */
+class ClipProtector {
+public:
+    /**
+     * @param index Segment index shared with the recorder and retention
+     * @param config Allowed methods and destination directory
+     */
+    ClipProtector(SegmentIndex& index, const ClipProtectorConfig& config);
+
+    // Tiger Style: No copy/move, holds a reference to the index
+    ClipProtector(const ClipProtector&) = delete;
+    ClipProtector& operator=(const ClipProtector&) = delete;
+    ClipProtector(ClipProtector&&) = delete;
+    ClipProtector& operator=(ClipProtector&&) = delete;
+
+    /**
+     * @brief Protect every segment of every camera overlapping a time window
+     *
+     * @param clip_id Identifier for the clip, used as a subdirectory name
+     * @param start_us Start of the incident window
+     * @param end_us End of the incident window
+     * @param open_segment_ids Segments the recorder is still writing, one per
+     *        camera; they are pinned even if pinning is not allowed
+     * @return The protected clip, or std::nullopt if any segment could not be
+     *         protected (segments protected so far are released again)
+     *
+     * @pre clip_id is not empty and contains no path separators
+     * @pre start_us <= end_us
+     */
+    std::optional<ProtectedClip> protect(std::string_view clip_id,
+                                         int64_t start_us,
+                                         int64_t end_us,
+                                         const std::vector<uint64_t>& open_segment_ids = {});
+
+    /**
+     * @brief Protect a segment of the clip that was open and has now closed
+     *
+     * Replaces the segment's pin with the first method that works for the
+     * finished file and updates `clip` to match.
+     *
+     * @return false if the segment is not open in `clip` or could not be
+     *         protected; it then stays pinned and the call may be retried
+     */
+    bool segment_closed(ProtectedClip& clip, uint64_t segment_id);
+
+    /**
+     * @brief Drop the index pins held by a clip, including those of open segments
+     *
+     * Cloned, linked and copied files, and their checkpoint files, are left
+     * in place; they belong to the user now and are removed through the
+     * export path, not by retention.
+     */
+    void release(const ProtectedClip& clip);
+
+    ClipProtectorStats stats() const;
+
+private:
+    std::optional<ProtectedSegment> protect_segment(const SegmentInfo& segment,
+                                                    const std::string& clip_dir);
+    bool try_reflink(const std::string& source, const std::string& destination);
+    bool try_hard_link(const std::string& source, const std::string& destination);
+    bool try_range_copy(const std::string& source, const std::string& destination);
+    bool try_buffered_copy(const std::string& source, const std::string& destination);
+
+    /**
+     * @brief Link or copy a segment's checkpoint file next to its protected copy
+     */
+    void keep_checkpoints(const std::string& source, const std::string& destination);
+
+    SegmentIndex& index_;
+    const ClipProtectorConfig config_;
+    ClipProtectorStats stats_;
+};
+
+} // namespace dashcam
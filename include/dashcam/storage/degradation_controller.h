@@ -0,0 +1,167 @@
+#pragma once
+
+/**
+ * @file degradation_controller.h
+ * @brief Explicit degradation tiers for a slow or full recording volume
+ *
+ * When the card cannot keep up, a pipeline that simply blocks stalls capture
+ * for every camera at once. DegradationController instead sheds load in a
+ * fixed order, driven by the storage stage's queue depth and the free space
+ * on the volume:
+ *
+ *   Tier 1  DropPreview     - stop the preview branch
+ *   Tier 2  KeyframesOnly   - secondary cameras record keyframes only
+ *   Tier 3  EmergencyEvict  - evict old footage immediately, unthrottled
+ *
+ * The primary (front) camera is never restricted by any tier; it is the last
+ * thing to degrade, and only if the storage queue itself overflows.
+ */
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "dashcam.pb.h"
+
+namespace dashcam {
+
+/**
+ * @brief Load-shedding tiers, ordered by severity
+ */
+enum class DegradationTier : uint8_t {
+    Normal = 0,
+    DropPreview = 1,
+    KeyframesOnly = 2,
+    EmergencyEvict = 3
+};
+
+constexpr uint32_t DEGRADATION_TIER_COUNT = 4;
+
+/**
+ * @brief Name used in logs and LogEvent metadata
+ */
+std::string_view to_string(DegradationTier tier);
+
+/**
+ * @brief Thresholds that put the pipeline into each tier
+ *
+ * A tier is entered when either its queue fraction is reached or free space
+ * falls to its free-bytes threshold. Index 0 (Normal) is unused.
+ */
+struct DegradationConfig {
+    std::array<double, DEGRADATION_TIER_COUNT> queue_fraction = {0.0, 0.50, 0.75, 0.90};
+    std::array<uint64_t, DEGRADATION_TIER_COUNT> free_bytes = {
+        0, 2ull << 30, 1ull << 30, 512ull << 20};
+
+    // Step down only once pressure is this comfortably below the current
+    // tier: queue under fraction * margin and free space over bytes / margin
+    double recovery_margin = 0.8;
+
+    // Minimum time in a tier before stepping down, to avoid flapping
+    std::chrono::milliseconds min_dwell{5000};
+
+    std::string primary_camera_id = "front";
+};
+
+/**
+ * @brief Instantaneous load on the storage stage
+ */
+struct StoragePressure {
+    uint32_t queue_depth = 0;       // Items waiting in the storage stage
+    uint32_t queue_capacity = 0;    // Capacity of that queue, > 0
+    uint64_t free_bytes = 0;        // Free space on the recording volume
+};
+
+/**
+ * @brief Counters for monitoring degradation
+ */
+struct DegradationStats {
+    std::array<uint64_t, DEGRADATION_TIER_COUNT> tier_entries = {};
+    uint64_t escalations = 0;
+    uint64_t recoveries = 0;
+    uint64_t preview_frames_shed = 0;
+    uint64_t camera_frames_shed = 0;    // Secondary camera non-keyframes
+};
+
+/**
+ * @brief Picks the degradation tier and answers per-frame admission queries
+ *
+ * Threading: update() is called from the storage thread, which also runs the
+ * event sink. The query methods and stats() are lock-free and may be called
+ * from capture and encode threads.
+ *
+ * Escalation is immediate and may skip tiers; recovery steps down one tier at
+ * a time, after min_dwell and only with the recovery margin satisfied.
+ */
+class DegradationController {
+public:
+    using Clock = std::chrono::steady_clock;
+    using EventSink = std::function<void(const LogEvent&)>;
+
+    /**
+     * @param config Tier thresholds
+     * @param sink Receives one LogEvent per tier transition; may be empty
+     *
+     * @pre Thresholds increase in severity with the tier
+     */
+    DegradationController(const DegradationConfig& config, EventSink sink);
+
+    // Tiger Style: No copy/move, shared by reference between pipeline stages
+    DegradationController(const DegradationController&) = delete;
+    DegradationController& operator=(const DegradationController&) = delete;
+    DegradationController(DegradationController&&) = delete;
+    DegradationController& operator=(DegradationController&&) = delete;
+
+    /**
+     * @brief Re-evaluate the tier from current pressure
+     *
+     * @return The tier in force after this update
+     */
+    DegradationTier update(const StoragePressure& pressure, Clock::time_point now);
+
+    DegradationTier tier() const;
+
+    /**
+     * @brief Whether a preview frame should be produced; counts shed frames
+     */
+    bool admit_preview_frame();
+
+    /**
+     * @brief Whether an encoded frame from a camera should be stored
+     *
+     * The primary camera and keyframes are always admitted.
+     */
+    bool admit_camera_frame(std::string_view camera_id, bool keyframe);
+
+    /**
+     * @brief Bytes retention should free right away, 0 outside EmergencyEvict
+     *
+     * The target is getting back above the DropPreview free-space threshold.
+     */
+    uint64_t emergency_eviction_bytes(const StoragePressure& pressure) const;
+
+    DegradationStats stats() const;
+
+private:
+    DegradationTier target_tier(const StoragePressure& pressure) const;
+    bool can_recover_from(DegradationTier tier, const StoragePressure& pressure) const;
+    void transition(DegradationTier to, const StoragePressure& pressure, Clock::time_point now);
+
+    const DegradationConfig config_;
+    const EventSink sink_;
+
+    std::atomic<DegradationTier> tier_{DegradationTier::Normal};
+    Clock::time_point entered_at_{};
+
+    std::array<std::atomic<uint64_t>, DEGRADATION_TIER_COUNT> tier_entries_{};
+    std::atomic<uint64_t> escalations_{0};
+    std::atomic<uint64_t> recoveries_{0};
+    std::atomic<uint64_t> preview_frames_shed_{0};
+    std::atomic<uint64_t> camera_frames_shed_{0};
+};
+
+} // namespace dashcam
@@ -0,0 +1,265 @@
+#pragma once
+
+/**
+ * @file event_log.h
+ * @brief Persistent, time-partitioned columnar log of LogEvents
+ *
+ * The in-memory event ring holds minutes to hours; investigations need weeks,
+ * across reboots. Events are therefore also written to one append-only file
+ * per time partition (a day by default), each a sequence of blocks:
+ *
+ *   file header (64 B) | block | block | ...
+ *   block: header (160 B) | time | event_type | camera_id | message | metadata
+ *
+ * Inside a block, rows are sorted by time and every column is stored and
+ * checksummed separately: timestamps as varint deltas, event_type and
+ * camera_id as a dictionary plus varint codes, message and metadata as
+ * length-prefixed bytes. The block header carries the min/max timestamp and
+ * bloom filters of its event types and cameras, and every header is kept in
+ * memory. A query skips whole blocks on time and on the blooms, reads only
+ * the time and filter columns of the blocks left, and reads message and
+ * metadata only for blocks that contribute to the page.
+ *
+ * Each event goes to the partition of its own timestamp, so a partition
+ * holds exactly its time span and retention deletes whole files.
+ */
+
+#include "dashcam.pb.h"
+#include "dashcam/utils/scoped_fd.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dashcam {
+
+/**
+ * @brief Where and how events are persisted
+ */
+struct EventLogConfig {
+    std::string directory;                           // One file per partition
+    std::chrono::hours partition{24};
+    std::chrono::hours retention{24 * 28};           // Partitions entirely older are deleted
+    uint32_t block_events = 4096;                    // Rows per block
+    std::chrono::milliseconds flush_interval{1000};  // Longest an event waits in memory
+    uint32_t max_sealed_blocks = 16;                 // Full blocks awaiting the writer, then drop
+    bool sync_blocks = true;                         // fdatasync() every block written
+    uint32_t default_max_events = 100;               // Page size when max_events is 0
+    uint32_t max_events_limit = 1000;
+};
+
+/**
+ * @brief Counters for monitoring the log
+ */
+struct EventLogStats {
+    uint64_t events_appended = 0;
+    uint64_t events_dropped = 0;                     // Writer too far behind, or a write failed
+    uint64_t blocks_written = 0;
+    uint64_t bytes_written = 0;                      // Block bytes on disk
+    uint64_t raw_bytes = 0;                          // The same events as serialized protobuf
+    uint64_t write_errors = 0;
+    uint64_t partitions = 0;
+    uint64_t partitions_removed = 0;
+    uint64_t repaired_files = 0;                     // Torn tail truncated at open
+    uint64_t queries = 0;
+    uint64_t blocks_skipped = 0;                     // Ruled out by time or a bloom filter
+    uint64_t blocks_read = 0;                        // At least one column read
+    uint64_t columns_read = 0;
+    uint64_t column_bytes_read = 0;
+    uint64_t corrupt_blocks = 0;                     // A column failed to read, verify or decode
+};
+
+/**
+ * @brief Position after which a query resumes
+ *
+ * Rows are ordered by (timestamp, block, rank), rank counting the rows of
+ * that block with the same timestamp. block 0 means "from the start".
+ */
+struct EventLogCursor {
+    int64_t timestamp_ms = 0;
+    uint64_t block = 0;
+    uint32_t rank = 0;
+};
+
+struct EventLogQuery {
+    int64_t start_ms = 0;                            // Inclusive
+    int64_t end_ms = 0;                              // Exclusive; 0: no upper bound
+    std::vector<std::string> event_types;            // Any of these; empty: every type
+    std::string camera_id;                           // Empty: every camera
+    uint32_t max_events = 0;                         // 0: default; capped at max_events_limit
+    EventLogCursor resume;                           // next of the previous page
+};
+
+struct EventLogPage {
+    std::vector<LogEvent> events;                    // In time order
+    bool has_more = false;
+    EventLogCursor next;                             // First row of the next page, when has_more
+};
+
+/**
+ * @brief Append-only columnar event files with filter pushdown
+ *
+ * Threading: append(), query(), flush() and stats() from any thread.
+ * append() only buffers; full blocks are encoded and written by the log's
+ * own writer thread, which also writes a partial block once its oldest
+ * event is flush_interval old. Queries see buffered events too.
+ */
+class EventLog {
+public:
+    /**
+     * @pre config.directory is not empty, config.block_events > 0,
+     *      0 < config.default_max_events <= config.max_events_limit
+     */
+    explicit EventLog(const EventLogConfig& config);
+
+    /**
+     * @brief Destructor writes buffered events, then joins the writer
+     */
+    ~EventLog();
+
+    // Tiger Style: No copy/move, owns a thread that captures this
+    EventLog(const EventLog&) = delete;
+    EventLog& operator=(const EventLog&) = delete;
+    EventLog(EventLog&&) = delete;
+    EventLog& operator=(EventLog&&) = delete;
+
+    /**
+     * @brief Create the directory, load every block header and start the writer
+     *
+     * A block torn by a crash is cut off its file. Files that are not event
+     * logs are left alone.
+     *
+     * @return false if the directory cannot be created or listed
+     * @pre Not already open
+     */
+    bool open();
+
+    /**
+     * @brief Write buffered events, then stop the writer
+     *
+     * Safe to call more than once.
+     */
+    void close();
+
+    /**
+     * @brief Buffer an event for the partition of its timestamp
+     *
+     * Never does I/O. @return false if the log is closed or the writer is
+     * max_sealed_blocks behind (the event is dropped and counted)
+     */
+    bool append(const LogEvent& event);
+
+    /**
+     * @brief Write every buffered event now and wait for it
+     *
+     * @return false if a write failed
+     */
+    bool flush();
+
+    /**
+     * @brief Events in [start_ms, end_ms) matching the filters, one page
+     *
+     * Reads from disk on the calling thread.
+     *
+     * @pre query.end_ms == 0 || query.end_ms >= query.start_ms
+     */
+    EventLogPage query(const EventLogQuery& query) const;
+
+    EventLogStats stats() const;
+
+    static constexpr size_t BLOOM_BYTES = 32;
+
+private:
+    using Bloom = std::array<uint8_t, BLOOM_BYTES>;
+    static constexpr size_t COLUMN_COUNT = 5;
+
+    struct BlockMeta {
+        uint64_t sequence = 0;
+        uint64_t offset = 0;                         // In the partition file
+        int64_t min_ms = 0;
+        int64_t max_ms = 0;
+        uint32_t events = 0;
+        Bloom types{};
+        Bloom cameras{};
+        std::array<uint32_t, COLUMN_COUNT> column_bytes{};
+        std::array<uint32_t, COLUMN_COUNT> column_crcs{};
+    };
+
+    struct Partition {
+        int64_t start_ms = 0;
+        std::string path;
+        ScopedFd fd;
+        uint64_t size = 0;
+        std::vector<BlockMeta> blocks;               // In file order
+    };
+
+    // Rows of a block not yet on disk, sorted by time
+    struct MemoryBlock {
+        uint64_t sequence = 0;
+        int64_t partition_ms = 0;
+        std::chrono::steady_clock::time_point opened{};
+        std::vector<LogEvent> rows;
+    };
+
+    struct DiskBlock {
+        std::shared_ptr<const Partition> partition;
+        BlockMeta meta;
+    };
+
+    struct DecodedBlock;
+
+    int64_t partition_of(int64_t timestamp_ms) const;
+    std::string partition_path(int64_t partition_ms) const;
+
+    bool load_partition(const std::string& path);
+    std::shared_ptr<Partition> open_partition_locked(int64_t partition_ms);
+    void remove_expired_locked();
+
+    void seal_locked();
+    void run();
+    bool write_block(const MemoryBlock& block);
+
+    bool read_column(const DiskBlock& block, size_t column, std::vector<uint8_t>* bytes) const;
+
+    const EventLogConfig config_;
+    const int64_t partition_ms_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable written_;
+    std::map<int64_t, std::shared_ptr<Partition>> partitions_;
+    MemoryBlock pending_;
+    std::deque<MemoryBlock> sealed_;                 // Full blocks; the writer owns the front
+    bool flush_requested_ = false;
+    bool write_failed_ = false;
+    bool open_ = false;
+    bool stop_requested_ = false;
+    uint64_t next_sequence_ = 1;
+    std::thread thread_;
+
+    std::atomic<uint64_t> events_appended_{0};
+    std::atomic<uint64_t> events_dropped_{0};
+    std::atomic<uint64_t> blocks_written_{0};
+    std::atomic<uint64_t> bytes_written_{0};
+    std::atomic<uint64_t> raw_bytes_{0};
+    std::atomic<uint64_t> write_errors_{0};
+    std::atomic<uint64_t> partitions_removed_{0};
+    std::atomic<uint64_t> repaired_files_{0};
+    mutable std::atomic<uint64_t> queries_{0};
+    mutable std::atomic<uint64_t> blocks_skipped_{0};
+    mutable std::atomic<uint64_t> blocks_read_{0};
+    mutable std::atomic<uint64_t> columns_read_{0};
+    mutable std::atomic<uint64_t> column_bytes_read_{0};
+    mutable std::atomic<uint64_t> corrupt_blocks_{0};
+};
+
+} // namespace dashcam
@@ -0,0 +1,173 @@
+#pragma once
+
+/**
+ * @file fragment_cipher.h
+ * @brief AES-256-GCM encryption at rest for fMP4 fragments
+ *
+ * Each segment gets its own key, derived from the device master key and a
+ * random per-segment salt stored in the segment's initialization data. Each
+ * fragment's mdat payload is split into fixed-size chunks, and every chunk is
+ * a separate GCM message. Its nonce is (fragment sequence, chunk index) and
+ * its 16-byte tag is stored in the fragment's moof. A fragment therefore
+ * decrypts and authenticates on its own, and chunks of one fragment are
+ * encrypted in parallel.
+ *
+ * OpenSSL's EVP layer selects AES-NI/PCLMULQDQ on x86 and the ARMv8 crypto
+ * extensions at run time, so no platform-specific code lives here.
+ */
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "dashcam/storage/segment_writer.h"
+
+namespace dashcam {
+
+constexpr size_t ENCRYPTION_KEY_BYTES = 32;
+constexpr size_t ENCRYPTION_SALT_BYTES = 16;
+constexpr size_t ENCRYPTION_TAG_BYTES = 16;
+
+/**
+ * @brief Encryption parameters
+ */
+struct FragmentCipherConfig {
+    std::array<uint8_t, ENCRYPTION_KEY_BYTES> master_key{};
+    uint32_t chunk_bytes = 256 * 1024;    // Unit of parallelism, one tag each
+    uint32_t worker_threads = 1;          // Helpers besides the calling thread
+};
+
+/**
+ * @brief What a reader needs, besides the master key, to decrypt a segment
+ */
+struct SegmentEncryption {
+    std::array<uint8_t, ENCRYPTION_SALT_BYTES> salt{};
+    uint32_t chunk_bytes = 0;
+};
+
+/**
+ * @brief Counters for monitoring encryption cost
+ */
+struct FragmentCipherStats {
+    uint64_t fragments = 0;
+    uint64_t chunks = 0;
+    uint64_t bytes = 0;
+    uint64_t authentication_failures = 0;
+};
+
+/**
+ * @brief Per-segment AES-256-GCM with a small pool of chunk workers
+ *
+ * Threading: the public methods are called from one storage thread. The
+ * worker threads only run chunk jobs handed out by encrypt_fragment() and
+ * decrypt_fragment(). Every thread, the caller included, owns one cipher
+ * context, which is allocated once.
+ */
+class FragmentCipher {
+public:
+    // Bounds the tag table in each moof: 64 MiB fragments at 16 KiB chunks
+    static constexpr uint32_t MAX_CHUNKS_PER_FRAGMENT = 4096;
+
+    static constexpr uint32_t MAX_WORKER_THREADS = 8;
+
+    /**
+     * @pre config.chunk_bytes > 0 and worker_threads <= MAX_WORKER_THREADS
+     */
+    explicit FragmentCipher(const FragmentCipherConfig& config);
+
+    /**
+     * @brief Stops the workers and wipes key material
+     */
+    ~FragmentCipher();
+
+    // Tiger Style: No copy/move, owns threads and key material
+    FragmentCipher(const FragmentCipher&) = delete;
+    FragmentCipher& operator=(const FragmentCipher&) = delete;
+    FragmentCipher(FragmentCipher&&) = delete;
+    FragmentCipher& operator=(FragmentCipher&&) = delete;
+
+    /**
+     * @brief Draw a fresh salt and derive the key for a new segment
+     *
+     * @param out Salt and chunk size to store in the initialization segment
+     * @return false if no random salt could be generated
+     */
+    bool start_segment(SegmentEncryption* out);
+
+    /**
+     * @brief Derive the key of an existing segment, for decryption
+     */
+    bool resume_segment(const SegmentEncryption& encryption);
+
+    /**
+     * @brief Number of chunks, and so tags, a fragment of this size produces
+     */
+    uint32_t chunk_count(uint64_t fragment_bytes) const;
+
+    /**
+     * @brief Encrypt a fragment's samples, in order, into one contiguous buffer
+     *
+     * Reading the encoder buffers and writing ciphertext happen in the same
+     * pass; the samples themselves are never modified.
+     *
+     * @param fragment_sequence Sequence number from the fragment's mfhd
+     * @param samples Payloads of the fragment, in mdat order
+     * @param out Receives the ciphertext; sized to the sum of sample sizes
+     * @param tags_out Receives chunk_count() * ENCRYPTION_TAG_BYTES bytes
+     *
+     * @pre A segment was started and the fragment fits MAX_CHUNKS_PER_FRAGMENT
+     */
+    bool encrypt_fragment(uint32_t fragment_sequence,
+                          const WriteChunk* samples,
+                          uint32_t sample_count,
+                          uint8_t* out,
+                          uint8_t* tags_out);
+
+    /**
+     * @brief Decrypt and authenticate one fragment's mdat payload in place
+     *
+     * @return false if any chunk fails authentication
+     */
+    bool decrypt_fragment(uint32_t fragment_sequence,
+                          uint8_t* data,
+                          uint64_t size_bytes,
+                          const uint8_t* tags);
+
+    FragmentCipherStats stats() const;
+
+private:
+    struct Batch;
+    struct ThreadContext;
+
+    bool derive_segment_key(const SegmentEncryption& encryption);
+    bool run_batch(Batch& batch);
+    void run_chunks(Batch& batch, ThreadContext& context);
+    bool process_chunk(const Batch& batch, uint32_t chunk, ThreadContext& context) const;
+    void worker_loop(uint32_t index);
+
+    FragmentCipherConfig config_;   // Not const: the master key is wiped on destruction
+
+    std::array<uint8_t, ENCRYPTION_KEY_BYTES> segment_key_{};
+    uint32_t segment_chunk_bytes_ = 0;
+    bool has_segment_ = false;
+
+    // Index 0 is the calling thread; 1..worker_threads belong to the workers
+    std::vector<ThreadContext> contexts_;
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable work_done_;
+    Batch* batch_ = nullptr;
+    uint64_t batch_generation_ = 0;
+    uint32_t busy_workers_ = 0;
+    bool stopping_ = false;
+
+    FragmentCipherStats stats_;
+};
+
+} // namespace dashcam
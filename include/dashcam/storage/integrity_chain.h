@@ -0,0 +1,236 @@
+#pragma once
+
+/**
+ * @file integrity_chain.h
+ * @brief Tamper-evident hash chain over recorded fragments
+ *
+ * Every fMP4 fragment, exactly as written to the card (moof plus mdat, or its
+ * ciphertext when encryption is on), is folded into a SHA-256 chain:
+ *
+ *   link_0 = H(label || genesis || segment_id || init segment bytes)
+ *   link_n = H(link_n-1 || sequence_n || fragment_n bytes)
+ *
+ * where genesis is the previous segment's final link. Every
+ * checkpoint_interval fragments, and at the end of each segment, the current
+ * link is signed with the device's Ed25519 key, recorded in the SegmentIndex
+ * and appended to the segment's checkpoint file (checkpoint_file.h), which
+ * survives power loss. Editing, removing or reordering a fragment changes
+ * every later link, so the next signed checkpoint no longer matches; removing
+ * or reordering whole segments breaks the genesis links between them.
+ *
+ * Hashing runs on a dedicated worker that holds references to the writer's
+ * buffers, so the storage thread only queues pointers.
+ */
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "dashcam/storage/segment_index.h"
+#include "dashcam/storage/segment_writer.h"
+
+namespace dashcam {
+
+constexpr size_t CHAIN_HASH_BYTES = 32;
+constexpr size_t SIGNING_KEY_BYTES = 32;
+
+/**
+ * @brief Signing key and checkpoint cadence
+ */
+struct IntegrityChainConfig {
+    std::array<uint8_t, SIGNING_KEY_BYTES> signing_key{};   // Ed25519 private key seed
+    uint32_t checkpoint_interval = 30;     // Fragments between signed checkpoints
+    uint32_t max_pending_fragments = 32;   // Queue bound; overflow is counted
+};
+
+/**
+ * @brief Counters for monitoring the chain
+ */
+struct IntegrityChainStats {
+    uint64_t fragments_hashed = 0;
+    uint64_t bytes_hashed = 0;
+    uint64_t checkpoints_written = 0;
+    uint64_t fragments_dropped = 0;    // Queue was full; the chain has a gap
+    uint64_t failures = 0;             // Signing, index or checkpoint file errors
+};
+
+/**
+ * @brief Outcome of checking a segment file against its checkpoints
+ */
+struct ChainVerification {
+    bool valid = false;                  // Every checkpoint covered by the file matched
+    uint32_t checkpoints_matched = 0;
+    uint32_t verified_through = 0;       // Last fragment sequence covered by a checkpoint
+    uint32_t fragments_in_file = 0;
+    bool linked_to_previous = false;     // Genesis is the previous segment's final link
+};
+
+/**
+ * @brief One camera's hash chain and its hashing worker
+ *
+ * Threading: begin_segment(), submit() and end_segment() are called from the
+ * storage thread, in file order. start()/stop() come from one owner thread.
+ * stats() may be read from any thread.
+ */
+class IntegrityChain {
+public:
+    /**
+     * @param config Signing key and cadence
+     * @param index Receives the signed checkpoints, which are also appended
+     *        to each segment's checkpoint file; must outlive the chain
+     *
+     * @pre checkpoint_interval > 0 and max_pending_fragments > 0
+     */
+    IntegrityChain(const IntegrityChainConfig& config, SegmentIndex& index);
+
+    /**
+     * @brief Destructor stops the worker after hashing everything queued
+     */
+    ~IntegrityChain();
+
+    // Tiger Style: No copy/move, owns a thread that captures this
+    IntegrityChain(const IntegrityChain&) = delete;
+    IntegrityChain& operator=(const IntegrityChain&) = delete;
+    IntegrityChain(IntegrityChain&&) = delete;
+    IntegrityChain& operator=(IntegrityChain&&) = delete;
+
+    /**
+     * @brief Start the hashing worker
+     *
+     * @return false if the signing key is unusable
+     */
+    bool start();
+
+    /**
+     * @brief Hash everything queued, then join the worker
+     */
+    void stop();
+
+    /**
+     * @brief Continue the chain from a link recorded before a restart
+     *
+     * Pass the chain_hash of the last checkpoint of the camera's newest
+     * segment, as reloaded by SegmentLayout::rebuild_index(), so the first
+     * segment after a restart is linked to the last one before it.
+     *
+     * @pre The worker is not running
+     */
+    void resume(const std::array<uint8_t, CHAIN_HASH_BYTES>& link);
+
+    /**
+     * @brief Start chaining a new segment from the previous segment's last link
+     *
+     * @pre The segment is in the index and no segment is in progress
+     */
+    void begin_segment(uint64_t segment_id);
+
+    /**
+     * @brief Queue one unit of the segment for hashing; never blocks
+     *
+     * The bytes hashed are `head` followed by `body`, in order, and must be
+     * exactly what is written to the file. Only references are taken.
+     *
+     * @param sequence 0 for the initialization segment, else the mfhd sequence
+     * @return false if the queue is full; the fragment is counted as dropped
+     *         and the rest of the segment is left unchained
+     */
+    bool submit(uint32_t sequence, const WriteChunk& head, const WriteChunk* body,
+                uint32_t body_count);
+
+    /**
+     * @brief Sign a final checkpoint for the current segment
+     */
+    void end_segment();
+
+    /**
+     * @brief Ed25519 public key that verifies this chain's checkpoints
+     */
+    std::array<uint8_t, SIGNING_KEY_BYTES> public_key() const;
+
+    IntegrityChainStats stats() const;
+
+    /**
+     * @brief Check one checkpoint's signature
+     */
+    static bool verify_checkpoint(const std::array<uint8_t, SIGNING_KEY_BYTES>& public_key,
+                                  const IntegrityCheckpoint& checkpoint);
+
+    /**
+     * @brief Re-hash a segment file and compare it with its checkpoints
+     *
+     * Splits the file into the initialization segment and moof+mdat
+     * fragments, recomputes the chain from the sequence 0 checkpoint's genesis
+     * and requires every checkpoint whose fragment is present to match. A
+     * tail written after the last checkpoint is reported but not covered.
+     *
+     * @param previous_link chain_hash of the last checkpoint of the segment
+     *        recorded before this one, or null for the oldest segment kept.
+     *        When given, the segment is only valid if its genesis equals it,
+     *        so a deleted or reordered segment is detected.
+     */
+    static ChainVerification verify_segment(
+        const std::array<uint8_t, SIGNING_KEY_BYTES>& public_key,
+        const uint8_t* data,
+        uint64_t size_bytes,
+        const std::vector<IntegrityCheckpoint>& checkpoints,
+        const std::array<uint8_t, CHAIN_HASH_BYTES>* previous_link = nullptr);
+
+private:
+    struct Crypto;
+
+    enum class JobKind : uint8_t { Fragment, EndSegment };
+
+    struct Job {
+        JobKind kind = JobKind::Fragment;
+        uint64_t segment_id = 0;
+        uint32_t sequence = 0;
+        std::array<WriteChunk, SegmentWriter::MAX_BATCH_CHUNKS> pieces{};
+        uint32_t piece_count = 0;
+    };
+
+    Job* reserve_job();
+    void commit_job();
+    void run();
+    void hash_job(const Job& job);
+    void write_checkpoint(uint64_t segment_id, uint32_t sequence);
+
+    const IntegrityChainConfig config_;
+    SegmentIndex& index_;
+    std::unique_ptr<Crypto> crypto_;
+
+    // Storage thread only
+    uint64_t current_segment_ = 0;
+    bool in_segment_ = false;
+    bool segment_has_gap_ = false;   // A unit was dropped; stop chaining this segment
+
+    // Fixed ring of jobs: the storage thread fills the tail, the worker
+    // hashes the head in place and only then releases it
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::vector<Job> jobs_;
+    uint32_t head_ = 0;
+    uint32_t count_ = 0;
+    bool stop_requested_ = false;
+    std::thread thread_;
+
+    // Worker thread only
+    std::array<uint8_t, CHAIN_HASH_BYTES> link_{};
+    std::array<uint8_t, CHAIN_HASH_BYTES> genesis_{};
+    uint32_t last_sequence_ = 0;
+    uint32_t last_checkpoint_sequence_ = 0;
+    std::optional<uint64_t> anchored_segment_;   // Segment whose fragment 0 was hashed last
+
+    std::atomic<uint64_t> fragments_hashed_{0};
+    std::atomic<uint64_t> bytes_hashed_{0};
+    std::atomic<uint64_t> checkpoints_written_{0};
+    std::atomic<uint64_t> fragments_dropped_{0};
+    std::atomic<uint64_t> failures_{0};
+};
+
+} // namespace dashcam
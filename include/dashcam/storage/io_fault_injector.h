@@ -0,0 +1,99 @@
+#pragma once
+
+/**
+ * @file io_fault_injector.h
+ * @brief Injected latency and errors for the storage write path
+ *
+ * Backpressure and degradation only run when a card misbehaves, which is the
+ * hardest condition to reproduce on a development machine. IoFaultInjector
+ * sits in front of the writer's writev() and fdatasync() calls and can stall
+ * them or fail them with a chosen errno (ENOSPC, EIO, ...), so those paths run
+ * in unit tests and in dashcam_storage_bench against any local directory.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace dashcam {
+
+/**
+ * @brief What to inject; every field defaults to "no fault"
+ */
+struct IoFaultConfig {
+    std::chrono::microseconds write_delay{0};   // Added before every writev()
+    std::chrono::microseconds sync_delay{0};    // Added before every fdatasync()
+
+    int write_errno = 0;            // errno for failed writes, e.g. EIO; 0 disables
+    uint32_t fail_every_nth_write = 0;  // Fail write N, 2N, ...; 0 disables
+    int sync_errno = 0;             // errno for failed syncs; 0 disables
+    uint32_t fail_every_nth_sync = 0;
+
+    // Every write fails with ENOSPC once this many bytes have been let through,
+    // emulating a full card; 0 disables
+    uint64_t enospc_after_bytes = 0;
+};
+
+/**
+ * @brief Counters for checking that faults actually fired
+ */
+struct IoFaultStats {
+    uint64_t writes_seen = 0;
+    uint64_t syncs_seen = 0;
+    uint64_t writes_failed = 0;
+    uint64_t syncs_failed = 0;
+    uint64_t bytes_allowed = 0;
+};
+
+/**
+ * @brief Decides, per I/O call, whether to delay and whether to fail
+ *
+ * Threading: may be shared by several writers on different threads;
+ * configure() may be called at any time to change faults mid-run.
+ */
+class IoFaultInjector {
+public:
+    explicit IoFaultInjector(const IoFaultConfig& config = IoFaultConfig{});
+
+    // Tiger Style: No copy/move, writers hold a pointer to the injector
+    IoFaultInjector(const IoFaultInjector&) = delete;
+    IoFaultInjector& operator=(const IoFaultInjector&) = delete;
+    IoFaultInjector(IoFaultInjector&&) = delete;
+    IoFaultInjector& operator=(IoFaultInjector&&) = delete;
+
+    /**
+     * @brief Replace the active faults; counters are kept
+     */
+    void configure(const IoFaultConfig& config);
+
+    /**
+     * @brief Called before a writev() of `bytes`; sleeps for any delay
+     *
+     * @return 0 to let the write proceed, otherwise the errno to fail it with
+     */
+    int before_write(uint64_t bytes);
+
+    /**
+     * @brief Called before an fdatasync(); sleeps for any delay
+     *
+     * @return 0 to let the sync proceed, otherwise the errno to fail it with
+     */
+    int before_sync();
+
+    IoFaultStats stats() const;
+
+private:
+    IoFaultConfig current_config() const;
+
+    mutable std::mutex mutex_;
+    IoFaultConfig config_;
+
+    std::atomic<uint64_t> writes_seen_{0};
+    std::atomic<uint64_t> syncs_seen_{0};
+    std::atomic<uint64_t> writes_failed_{0};
+    std::atomic<uint64_t> syncs_failed_{0};
+    std::atomic<uint64_t> bytes_allowed_{0};
+};
+
+} // namespace dashcam
@@ -0,0 +1,161 @@
+#pragma once
+
+/**
+ * @file rollover_coordinator.h
+ * @brief Synchronized segment boundaries across cameras
+ *
+ * Left alone, every camera rolls over on its own keyframe cadence, so the
+ * front and rear segments of the same minute start at different times and
+ * review has to stitch overlapping pieces. The coordinator instead cuts all
+ * cameras at the same instants on the shared capture clock:
+ *
+ *   - Boundaries fall on multiples of segment_duration in UTC, so they line
+ *     up across cameras and across restarts.
+ *   - keyframe_due() tells each camera's encoder to force a keyframe on its
+ *     first frame at or after the boundary, so every camera can cut there.
+ *   - The first camera to reach a boundary creates the next segment for
+ *     every camera and adds them to the SegmentIndex in one batch, all with
+ *     the boundary as their start time. Each camera then claims its segment
+ *     from on_keyframe() when its own forced keyframe arrives.
+ *
+ * A camera that stalls through a whole segment does not hold the others
+ * back. Its unclaimed entry is replaced by a fresh one when it resumes.
+ */
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "dashcam/storage/segment_index.h"
+#include "dashcam/storage/segment_layout.h"
+
+namespace dashcam {
+
+/**
+ * @brief Boundary cadence and segment numbering
+ */
+struct RolloverConfig {
+    std::chrono::microseconds segment_duration = std::chrono::minutes(1);
+    uint64_t first_segment_id = 1;     // Past the highest id found at startup
+};
+
+/**
+ * @brief Counters for monitoring rollovers
+ */
+struct RolloverStats {
+    uint64_t rollovers = 0;            // Batches added to the index
+    uint64_t segments_created = 0;
+    uint64_t forced_keyframes = 0;
+    uint64_t late_segments = 0;        // Camera missed a whole segment; entry replaced
+    uint64_t index_failures = 0;
+};
+
+/**
+ * @brief Shared rollover schedule for all cameras of one recorder
+ *
+ * Threading: add_camera() and start() from the owner before recording.
+ * keyframe_due() from each camera's encode thread and on_keyframe() from its
+ * storage thread, for that camera only. stats() from any thread.
+ */
+class RolloverCoordinator {
+public:
+    static constexpr uint32_t MAX_CAMERAS = 8;
+
+    /**
+     * @param config Boundary cadence and first segment id
+     * @param layout Names the segment files; must outlive the coordinator
+     * @param index Receives the segment batches; must outlive the coordinator
+     *
+     * @pre config.segment_duration > 0
+     */
+    RolloverCoordinator(const RolloverConfig& config,
+                        const SegmentLayout& layout,
+                        SegmentIndex& index);
+
+    // Tiger Style: No copy/move, camera threads hold references
+    RolloverCoordinator(const RolloverCoordinator&) = delete;
+    RolloverCoordinator& operator=(const RolloverCoordinator&) = delete;
+    RolloverCoordinator(RolloverCoordinator&&) = delete;
+    RolloverCoordinator& operator=(RolloverCoordinator&&) = delete;
+
+    /**
+     * @brief Register a camera
+     *
+     * @return Slot to pass to the per-camera methods
+     *
+     * @pre start() not called yet, fewer than MAX_CAMERAS cameras, camera_id unique
+     */
+    uint32_t add_camera(std::string_view camera_id);
+
+    /**
+     * @brief Create every camera's first segment, starting at `now_us`
+     *
+     * @return false if the index rejected the batch
+     *
+     * @pre at least one camera was added
+     */
+    bool start(int64_t now_us);
+
+    /**
+     * @brief Whether the encoder must make this frame a keyframe
+     *
+     * True once per boundary, for the camera's first frame at or after it.
+     *
+     * @param capture_us Frame time on the shared capture clock
+     */
+    bool keyframe_due(uint32_t camera, int64_t capture_us);
+
+    /**
+     * @brief Report an encoded keyframe; returns the segment to cut to, if any
+     *
+     * On a value the caller finishes its current segment and starts the
+     * returned one with this keyframe. If the index rejects the next batch,
+     * the camera keeps its segment and the boundary stays where it is, so
+     * the next keyframe retries.
+     */
+    std::optional<SegmentInfo> on_keyframe(uint32_t camera, int64_t capture_us);
+
+    /**
+     * @brief Next boundary no camera has reached yet
+     */
+    int64_t next_boundary_us() const;
+
+    RolloverStats stats() const;
+
+private:
+    static constexpr int64_t NO_PENDING = INT64_MAX;
+
+    struct CameraState {
+        std::string camera_id;
+        std::optional<SegmentInfo> pending;          // Created, not yet claimed
+        std::atomic<int64_t> pending_start_us{NO_PENDING};
+        int64_t forced_for_us = NO_PENDING;          // Encode thread only
+    };
+
+    bool open_batch(int64_t start_us);
+    int64_t align_up(int64_t time_us) const;
+    SegmentInfo make_segment(const CameraState& camera, int64_t start_us);
+
+    const RolloverConfig config_;
+    const SegmentLayout& layout_;
+    SegmentIndex& index_;
+
+    mutable std::mutex mutex_;
+    std::array<CameraState, MAX_CAMERAS> cameras_{};
+    uint32_t camera_count_ = 0;
+    uint64_t next_segment_id_;
+    std::atomic<int64_t> next_boundary_us_{NO_PENDING};
+
+    std::atomic<uint64_t> rollovers_{0};
+    std::atomic<uint64_t> segments_created_{0};
+    std::atomic<uint64_t> forced_keyframes_{0};
+    std::atomic<uint64_t> late_segments_{0};
+    std::atomic<uint64_t> index_failures_{0};
+};
+
+} // namespace dashcam
@@ -0,0 +1,159 @@
+#pragma once
+
+/**
+ * @file segment_index.h
+ * @brief In-memory catalogue of recorded segment files
+ *
+ * The index is the single source of truth for which segments exist, which
+ * camera and time range each covers, and which are protected from loop
+ * deletion. Retention asks it for eviction candidates instead of walking the
+ * recording directory.
+ */
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dashcam {
+
+/**
+ * @brief Catalogue entry for one segment file
+ */
+struct SegmentInfo {
+    uint64_t segment_id = 0;     // Monotonic, assigned by the recorder
+    std::string camera_id;
+    std::string path;
+    int64_t start_time_us = 0;
+    int64_t end_time_us = 0;     // Inclusive; equals start_time_us while recording
+    uint64_t size_bytes = 0;
+    uint32_t pin_count = 0;      // Pinned segments are never evicted
+};
+
+/**
+ * @brief Signed state of a segment's integrity hash chain after one fragment
+ *
+ * Produced by IntegrityChain. Sequence 0 anchors the segment: it covers the
+ * initialization segment and records the previous segment's final link as
+ * `genesis`, so consecutive segments are chained too.
+ */
+struct IntegrityCheckpoint {
+    uint64_t segment_id = 0;
+    uint32_t fragment_sequence = 0;         // mfhd sequence; 0 is the init segment
+    std::array<uint8_t, 32> genesis{};      // SHA-256 link the segment chains from
+    std::array<uint8_t, 32> chain_hash{};   // SHA-256 link after this fragment
+    std::array<uint8_t, 64> signature{};    // Ed25519 over all of the above
+};
+
+/**
+ * @brief Thread-safe index of segments keyed by segment id
+ *
+ * Every method takes a short internal lock, so the index can be shared by the
+ * recorder, retention and RPC threads.
+ */
+class SegmentIndex {
+public:
+    SegmentIndex() = default;
+
+    // Tiger Style: No copy/move, the index is shared by reference
+    SegmentIndex(const SegmentIndex&) = delete;
+    SegmentIndex& operator=(const SegmentIndex&) = delete;
+    SegmentIndex(SegmentIndex&&) = delete;
+    SegmentIndex& operator=(SegmentIndex&&) = delete;
+
+    /**
+     * @brief Add a new segment
+     *
+     * @return false if a segment with the same id already exists
+     *
+     * @pre segment.end_time_us >= segment.start_time_us
+     */
+    bool add(const SegmentInfo& segment);
+
+    /**
+     * @brief Add several segments under one lock, all or none
+     *
+     * Readers see either none of the batch or all of it, so segments that
+     * start together (one per camera at a rollover) appear together.
+     *
+     * @return false if any id is already present or repeated in the batch;
+     *         nothing is added
+     */
+    bool add_batch(const std::vector<SegmentInfo>& segments);
+
+    /**
+     * @brief Extend a segment as more data is written to it
+     *
+     * @return false if the segment is unknown
+     */
+    bool update(uint64_t segment_id, int64_t end_time_us, uint64_t size_bytes);
+
+    /**
+     * @brief Remove a segment from the index
+     *
+     * @return false if the segment is unknown or pinned
+     */
+    bool remove(uint64_t segment_id);
+
+    std::optional<SegmentInfo> find(uint64_t segment_id) const;
+
+    /**
+     * @brief Segments intersecting [start_us, end_us], ordered by segment id
+     *
+     * @param camera_id Restrict to one camera, or empty for all cameras
+     */
+    std::vector<SegmentInfo> overlapping(std::string_view camera_id,
+                                         int64_t start_us,
+                                         int64_t end_us) const;
+
+    /**
+     * @brief Protect a segment from eviction; pins nest
+     *
+     * @return false if the segment is unknown
+     */
+    bool pin(uint64_t segment_id);
+
+    /**
+     * @brief Undo one pin()
+     *
+     * @return false if the segment is unknown or not pinned
+     */
+    bool unpin(uint64_t segment_id);
+
+    /**
+     * @brief Oldest segment that may be evicted, skipping pinned ones
+     *
+     * @param exclude_segment_id A segment that must not be returned, typically
+     *        the one currently being written
+     */
+    std::optional<SegmentInfo> oldest_unpinned(uint64_t exclude_segment_id) const;
+
+    /**
+     * @brief Record a signed integrity checkpoint for a segment
+     *
+     * Checkpoints are dropped along with their segment in remove().
+     *
+     * @return false if the segment is unknown
+     */
+    bool add_checkpoint(const IntegrityCheckpoint& checkpoint);
+
+    /**
+     * @brief A segment's checkpoints in the order they were added
+     */
+    std::vector<IntegrityCheckpoint> checkpoints(uint64_t segment_id) const;
+
+    size_t size() const;
+    uint64_t total_bytes() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::map<uint64_t, SegmentInfo> segments_;
+    std::map<uint64_t, std::vector<IntegrityCheckpoint>> checkpoints_;
+    uint64_t total_bytes_ = 0;
+};
+
+} // namespace dashcam
@@ -0,0 +1,107 @@
+#pragma once
+
+/**
+ * @file segment_layout.h
+ * @brief Time- and camera-sharded placement of segment files
+ *
+ * A single flat directory with tens of thousands of segments makes every
+ * create, unlink and lookup pay for a huge directory, and a startup scan is
+ * one long serial readdir(). Segments are instead placed at
+ *
+ *   <root>/<camera>/<YYYYMMDD>/<HH>/<segment_id>_<start_us>.mp4
+ *
+ * (UTC), which keeps each directory to about an hour of one camera and gives
+ * the index rebuild independent shards to scan in parallel.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "dashcam/storage/segment_index.h"
+
+namespace dashcam {
+
+/**
+ * @brief Identity recovered from a segment file name
+ */
+struct SegmentFileName {
+    uint64_t segment_id = 0;
+    int64_t start_time_us = 0;
+};
+
+/**
+ * @brief Result of a parallel index rebuild
+ */
+struct IndexRebuildStats {
+    uint64_t shards_scanned = 0;
+    uint64_t segments_indexed = 0;
+    uint64_t files_skipped = 0;      // Sidecars, temporaries, foreign files
+    uint64_t duplicate_ids = 0;
+    uint64_t checkpoints_loaded = 0; // Signed integrity checkpoints from .chain files
+    std::chrono::milliseconds elapsed{0};
+};
+
+/**
+ * @brief Maps segments to sharded paths and rebuilds the index from disk
+ *
+ * Threading: all methods are const and safe to call from any thread, except
+ * that ensure_directory() races benignly with itself (mkdir is idempotent).
+ */
+class SegmentLayout {
+public:
+    static constexpr std::string_view SEGMENT_EXTENSION = ".mp4";
+
+    /**
+     * @param root Recording root directory
+     *
+     * @pre root is not empty
+     */
+    explicit SegmentLayout(std::string_view root);
+
+    const std::string& root() const;
+
+    /**
+     * @brief Shard directory for a camera at a point in time
+     *
+     * @pre camera_id is not empty and contains no path separators
+     */
+    std::string directory_for(std::string_view camera_id, int64_t start_time_us) const;
+
+    /**
+     * @brief Full path of a segment file
+     */
+    std::string path_for(std::string_view camera_id,
+                         uint64_t segment_id,
+                         int64_t start_time_us) const;
+
+    /**
+     * @brief Create a shard directory and its parents if missing
+     */
+    bool ensure_directory(const std::string& directory) const;
+
+    /**
+     * @brief Parse "<segment_id>_<start_us>.mp4"
+     */
+    static std::optional<SegmentFileName> parse_file_name(std::string_view file_name);
+
+    /**
+     * @brief Scan every shard on a pool of threads and add what is found
+     *
+     * Each segment's end time is taken from its modification time, which is
+     * when the recorder last appended to it. Segments already in the index
+     * are counted as duplicates and left alone. Each new segment's signed
+     * integrity checkpoints are reloaded from its checkpoint file.
+     *
+     * @param index Index to populate
+     * @param threads Worker threads, at least 1
+     */
+    IndexRebuildStats rebuild_index(SegmentIndex& index, uint32_t threads) const;
+
+private:
+    const std::string root_;
+};
+
+} // namespace dashcam
@@ -0,0 +1,138 @@
+#pragma once
+
+/**
+ * @file segment_reader.h
+ * @brief Export-path reader that stays out of the recorder's way
+ *
+ * Pulling clips off the device must not evict the recorder's dirty pages from
+ * the page cache or queue ahead of its writes. SegmentReader maps a segment in
+ * fixed windows and hands out spans that point straight into the mapping, so
+ * the network layer sends file pages without a user-space copy. It declares
+ * sequential access up front, drops pages it has finished with, and can move
+ * its thread to the idle I/O class.
+ */
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "dashcam/utils/scoped_fd.h"
+
+namespace dashcam {
+
+/**
+ * @brief Read pacing and cache policy
+ */
+struct SegmentReaderConfig {
+    size_t chunk_bytes = 1024 * 1024;        // Size of each span handed out
+    size_t window_bytes = 64 * 1024 * 1024;  // Size of each mmap() window
+    bool idle_io_priority = true;            // Applies to the thread calling open()
+};
+
+/**
+ * @brief A zero-copy view of part of a segment
+ *
+ * `owner` keeps the mapping alive; the span stays valid after the reader
+ * moves on or is closed, until every copy of the span is destroyed.
+ */
+struct ReadSpan {
+    std::shared_ptr<const void> owner;
+    const uint8_t* data = nullptr;
+    size_t size_bytes = 0;
+    uint64_t offset = 0;    // Position of data within the segment file
+};
+
+/**
+ * @brief Counters for monitoring export impact
+ */
+struct SegmentReaderStats {
+    uint64_t bytes_read = 0;
+    uint64_t windows_mapped = 0;
+    uint64_t bytes_dropped = 0;   // Released from the page cache after use
+};
+
+/**
+ * @brief Sequential, windowed mmap reader for one segment
+ *
+ * Threading: a reader is used by one thread. Run exports on dedicated
+ * threads: with idle_io_priority the calling thread stays in the idle I/O
+ * class after the reader is closed.
+ *
+ * Drop-behind lags by one window: when window N+1 is mapped, window N-1 is
+ * released with madvise(MADV_DONTNEED) and posix_fadvise(DONTNEED). Spans
+ * still held from it remain readable (they fault the pages back in).
+ */
+class SegmentReader {
+public:
+    explicit SegmentReader(const SegmentReaderConfig& config);
+
+    ~SegmentReader();
+
+    // Tiger Style: No copy/move, owns a descriptor and mappings
+    SegmentReader(const SegmentReader&) = delete;
+    SegmentReader& operator=(const SegmentReader&) = delete;
+    SegmentReader(SegmentReader&&) = delete;
+    SegmentReader& operator=(SegmentReader&&) = delete;
+
+    /**
+     * @brief Open a byte range of a segment for reading
+     *
+     * The range is clamped to the file size at open time; data appended
+     * afterwards is not visible.
+     *
+     * @param path Segment file
+     * @param offset First byte to read, for resumed transfers
+     * @param length Maximum bytes to read
+     * @return false if the file cannot be opened or offset is past its end
+     *
+     * @pre No file is currently open
+     */
+    bool open(std::string_view path, uint64_t offset = 0, uint64_t length = UINT64_MAX);
+
+    /**
+     * @brief The next span of at most chunk_bytes, or std::nullopt at the end
+     *
+     * Also returns std::nullopt if a window cannot be mapped; check
+     * position() against end_offset() to tell the two apart.
+     *
+     * @param max_bytes Tighter cap than chunk_bytes for this span, for
+     *        callers that size spans to their consumer
+     * @pre max_bytes > 0
+     */
+    std::optional<ReadSpan> next(size_t max_bytes = SIZE_MAX);
+
+    /**
+     * @brief Release the file and drop every page this reader touched
+     */
+    void close();
+
+    bool is_open() const;
+    uint64_t position() const;
+    uint64_t end_offset() const;
+    uint64_t file_size_bytes() const;
+    SegmentReaderStats stats() const;
+
+private:
+    struct Window;
+
+    bool map_window(uint64_t offset);
+    void drop(const std::shared_ptr<Window>& window);
+
+    const SegmentReaderConfig config_;
+    const size_t page_size_;
+
+    ScopedFd fd_;
+    std::string path_;
+    uint64_t file_size_ = 0;
+    uint64_t position_ = 0;
+    uint64_t end_ = 0;
+
+    std::shared_ptr<Window> window_;
+    std::shared_ptr<Window> behind_;
+
+    SegmentReaderStats stats_;
+};
+
+} // namespace dashcam
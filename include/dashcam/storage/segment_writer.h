@@ -0,0 +1,241 @@
+#pragma once
+
+/**
+ * @file segment_writer.h
+ * @brief Storage stage writer that coalesces encoded data into large batches
+ *
+ * Flash media punishes small writes and frequent syncs: every write() of a
+ * single encoded frame followed by fsync() turns into a read-modify-write of
+ * a whole erase block. SegmentWriter instead queues references to encoder
+ * buffers and hands them to the kernel with one writev() per batch, where a
+ * batch is bounded both by size and by how long its oldest chunk has waited.
+ *
+ * Durability is an explicit policy. The data-loss window after a power cut is
+ * bounded by max_batch_latency plus the sync interval (or one GOP when syncing
+ * on keyframes), which is the price paid for throughput.
+ */
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/uio.h>
+
+#include "dashcam/storage/io_fault_injector.h"
+#include "dashcam/storage/storage_accounting.h"
+#include "dashcam/utils/latency_histogram.h"
+
+namespace dashcam {
+
+/**
+ * @brief When the writer forces written data onto stable storage
+ */
+enum class DurabilityMode : uint8_t {
+    None = 0,       // Never sync explicitly; the kernel writes back on its own schedule
+    Periodic = 1,   // fdatasync() at most every sync_interval while data is unsynced
+    OnKeyframe = 2  // fdatasync() the previous GOP before each keyframe is queued
+};
+
+/**
+ * @brief Durability policy for a SegmentWriter
+ */
+struct DurabilityPolicy {
+    DurabilityMode mode = DurabilityMode::Periodic;
+    std::chrono::milliseconds sync_interval{1000}; // Only used by DurabilityMode::Periodic
+};
+
+/**
+ * @brief Configuration for a SegmentWriter
+ */
+struct SegmentWriterConfig {
+    size_t max_batch_bytes = 4 * 1024 * 1024;           // Flush once this much is pending
+    std::chrono::milliseconds max_batch_latency{250};   // Flush once the oldest chunk is this old
+    DurabilityPolicy durability;
+};
+
+/**
+ * @brief A reference to bytes that should be appended to the current segment
+ *
+ * The writer never copies payloads. `owner` keeps `data` alive until the batch
+ * containing the chunk has been handed to the kernel, after which the
+ * reference is dropped so pooled encoder buffers can be recycled.
+ */
+struct WriteChunk {
+    std::shared_ptr<const void> owner;
+    const uint8_t* data = nullptr;
+    size_t size_bytes = 0;
+    bool keyframe = false;
+};
+
+/**
+ * @brief Wrap a whole shared buffer as a WriteChunk
+ *
+ * @pre buffer must not be null or empty
+ */
+WriteChunk make_write_chunk(std::shared_ptr<const std::vector<uint8_t>> buffer, bool keyframe);
+
+/**
+ * @brief Point-in-time view of writer throughput counters
+ */
+struct SegmentWriterStats {
+    uint64_t bytes_written = 0;
+    uint64_t write_syscalls = 0;
+    uint64_t sync_syscalls = 0;
+    uint64_t batches_flushed = 0;
+    uint64_t batches_failed = 0;
+    uint64_t bytes_dropped = 0;
+    double bytes_per_syscall = 0.0;   // Average writev() size
+    double syscalls_per_second = 0.0; // writev() plus fdatasync() since construction
+};
+
+/**
+ * @brief Coalescing, policy-driven writer for one segment file at a time
+ *
+ * Threading: all mutating calls must come from a single storage thread.
+ * stats(), write_latency() and sync_latency() may be read from any thread.
+ *
+ * Tiger Style: the batch has a fixed capacity of MAX_BATCH_CHUNKS iovecs that
+ * is allocated once, so the steady state performs no heap allocation.
+ */
+class SegmentWriter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Well below IOV_MAX (1024 on Linux) so a batch is always one writev()
+    static constexpr uint32_t MAX_BATCH_CHUNKS = 256;
+
+    /**
+     * @param config Batching and durability policy
+     * @param accounting Optional volume counters credited with every byte written
+     * @param faults Optional fault injection for tests and benchmarks
+     */
+    explicit SegmentWriter(const SegmentWriterConfig& config,
+                           StorageAccounting* accounting = nullptr,
+                           IoFaultInjector* faults = nullptr);
+
+    /**
+     * @brief Destructor flushes and closes any open segment
+     */
+    ~SegmentWriter();
+
+    // Tiger Style: No copy/move, the writer owns a file descriptor and live buffers
+    SegmentWriter(const SegmentWriter&) = delete;
+    SegmentWriter& operator=(const SegmentWriter&) = delete;
+    SegmentWriter(SegmentWriter&&) = delete;
+    SegmentWriter& operator=(SegmentWriter&&) = delete;
+
+    /**
+     * @brief Create (or truncate) a segment file and make it current
+     *
+     * @param path Path of the segment file
+     * @return true if the file was opened
+     *
+     * @pre No segment is currently open
+     */
+    bool open(std::string_view path);
+
+    /**
+     * @brief Queue a chunk for writing, flushing and syncing as the policy requires
+     *
+     * @param chunk Bytes to append, kept alive by chunk.owner until written
+     * @param now Current time, used for latency bounds and the sync schedule
+     * @return false if a flush or sync triggered by this call failed
+     *
+     * @pre A segment is open
+     * @pre chunk.data is not null and chunk.size_bytes > 0
+     */
+    bool append(WriteChunk chunk, Clock::time_point now);
+
+    /**
+     * @brief Enforce the latency bound and the periodic sync schedule
+     *
+     * The storage thread should call this at least every max_batch_latency
+     * even when no new data arrives, otherwise a quiet camera could leave its
+     * last batch pending indefinitely.
+     *
+     * @return false if a triggered flush or sync failed
+     */
+    bool poll(Clock::time_point now);
+
+    /**
+     * @brief Write the pending batch without syncing
+     *
+     * On failure the rest of the batch is dropped and counted in
+     * bytes_dropped (bytes a partial write already stored are not); the
+     * caller decides whether to degrade, retry with new data, or stop.
+     */
+    bool flush();
+
+    /**
+     * @brief fdatasync() the segment if anything written is not yet durable
+     */
+    bool sync(Clock::time_point now);
+
+    /**
+     * @brief Flush, sync (unless DurabilityMode::None) and close the segment
+     *
+     * @return true if all data reached the kernel and, if required, the disk
+     */
+    bool close(Clock::time_point now);
+
+    bool is_open() const;
+
+    /**
+     * @brief Logical size of the current segment, including pending bytes
+     *
+     * This is the offset at which the next appended chunk will land.
+     */
+    uint64_t segment_size_bytes() const;
+
+    size_t pending_bytes() const;
+    uint32_t pending_chunks() const;
+
+    SegmentWriterStats stats(Clock::time_point now) const;
+
+    /**
+     * @brief Latency of each writev() call
+     */
+    const LatencyHistogram& write_latency() const;
+
+    /**
+     * @brief Latency of each fdatasync() call
+     */
+    const LatencyHistogram& sync_latency() const;
+
+private:
+    bool write_batch();
+    void release_batch();
+
+    const SegmentWriterConfig config_;
+    StorageAccounting* const accounting_;
+    IoFaultInjector* const faults_;
+    const Clock::time_point created_at_;
+
+    int fd_ = -1;
+    std::string path_;
+    uint64_t written_bytes_ = 0;   // Bytes of the current segment handed to the kernel
+    uint64_t unsynced_bytes_ = 0;  // Bytes written since the last successful sync
+    Clock::time_point last_sync_at_;
+
+    std::array<WriteChunk, MAX_BATCH_CHUNKS> pending_{};
+    std::array<iovec, MAX_BATCH_CHUNKS> iovecs_{};
+    uint32_t pending_count_ = 0;
+    size_t pending_bytes_ = 0;
+    Clock::time_point batch_started_at_;
+
+    std::atomic<uint64_t> bytes_written_{0};
+    std::atomic<uint64_t> write_syscalls_{0};
+    std::atomic<uint64_t> sync_syscalls_{0};
+    std::atomic<uint64_t> batches_flushed_{0};
+    std::atomic<uint64_t> batches_failed_{0};
+    std::atomic<uint64_t> bytes_dropped_{0};
+    LatencyHistogram write_latency_;
+    LatencyHistogram sync_latency_;
+};
+
+} // namespace dashcam
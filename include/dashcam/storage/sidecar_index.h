@@ -0,0 +1,204 @@
+#pragma once
+
+/**
+ * @file sidecar_index.h
+ * @brief Per-segment keyframe and thumbnail index for scrubbing without decode
+ *
+ * Review tools scrub through hours of footage. Finding the frame at a given
+ * time by parsing the container, or showing a preview by decoding video, does
+ * not scale to a day of recordings. Each segment therefore gets a small
+ * sidecar file next to it:
+ *
+ *   header (64 B) | keyframe table | thumbnail table | JPEG thumbnails
+ *
+ * Tables are fixed-size little-endian entries sorted by time, so a reader
+ * maps the file once and binary-searches it in place.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "dashcam/utils/mapped_file.h"
+
+namespace dashcam {
+
+/**
+ * @brief Seek point for one keyframe
+ */
+struct KeyframeEntry {
+    int64_t media_time_us = 0;       // Presentation time relative to segment start
+    uint64_t fragment_offset = 0;    // File offset of the moof that starts with it
+    uint64_t sample_offset = 0;      // File offset of the keyframe payload
+    uint32_t size_bytes = 0;
+};
+
+/**
+ * @brief One thumbnail as stored in (or mapped from) a sidecar
+ *
+ * `jpeg` points into the builder's buffer or the reader's mapping and is only
+ * valid as long as that object.
+ */
+struct ThumbnailView {
+    int64_t media_time_us = 0;
+    uint16_t width = 0;
+    uint16_t height = 0;
+    const uint8_t* jpeg = nullptr;
+    uint32_t size_bytes = 0;
+};
+
+/**
+ * @brief Limits for one segment's sidecar
+ */
+struct SidecarIndexConfig {
+    std::chrono::microseconds thumbnail_interval{std::chrono::seconds(10)};
+    uint32_t max_keyframes = 8192;               // Two hours at one GOP per second
+    uint32_t max_thumbnails = 1024;
+    uint32_t max_thumbnail_bytes = 64 * 1024;    // Per thumbnail
+};
+
+/**
+ * @brief Collects seek points and thumbnails while a segment is recorded
+ *
+ * Threading: single storage thread. The tables are reserved at construction
+ * and every buffer is reused across segments via reset().
+ *
+ * The muxer reports keyframes; the recorder asks wants_thumbnail() on each
+ * keyframe and, if so, passes a JPEG from its preview branch, which is
+ * already downscaled, so no video is decoded here.
+ */
+class SidecarIndexBuilder {
+public:
+    explicit SidecarIndexBuilder(const SidecarIndexConfig& config);
+
+    // Tiger Style: No copy/move, owns large preallocated buffers
+    SidecarIndexBuilder(const SidecarIndexBuilder&) = delete;
+    SidecarIndexBuilder& operator=(const SidecarIndexBuilder&) = delete;
+    SidecarIndexBuilder(SidecarIndexBuilder&&) = delete;
+    SidecarIndexBuilder& operator=(SidecarIndexBuilder&&) = delete;
+
+    /**
+     * @brief Start collecting for a new segment, discarding previous entries
+     *
+     * @param segment_id Segment the sidecar belongs to
+     * @param segment_start_us Wall-clock start of the segment
+     */
+    void reset(uint64_t segment_id, int64_t segment_start_us);
+
+    /**
+     * @brief Record a keyframe seek point
+     *
+     * @return false if the table is full or time went backwards
+     */
+    bool add_keyframe(const KeyframeEntry& entry);
+
+    /**
+     * @brief Whether a thumbnail is due at this media time
+     */
+    bool wants_thumbnail(int64_t media_time_us) const;
+
+    /**
+     * @brief Store a thumbnail (the JPEG bytes are copied into the sidecar)
+     *
+     * @return false if it is too large, the table is full or time went backwards
+     */
+    bool add_thumbnail(int64_t media_time_us,
+                       uint16_t width,
+                       uint16_t height,
+                       const uint8_t* jpeg,
+                       uint32_t size_bytes);
+
+    /**
+     * @brief Write the sidecar atomically (temporary file, then rename)
+     *
+     * The sidecar is not synced: after a crash it may be missing, in which
+     * case tools fall back to parsing the segment.
+     */
+    bool write(std::string_view path) const;
+
+    uint32_t keyframe_count() const;
+    uint32_t thumbnail_count() const;
+
+private:
+    struct ThumbnailEntry {
+        int64_t media_time_us;
+        uint64_t data_offset;
+        uint32_t size_bytes;
+        uint16_t width;
+        uint16_t height;
+        uint32_t crc;
+    };
+
+    const SidecarIndexConfig config_;
+    uint64_t segment_id_ = 0;
+    int64_t segment_start_us_ = 0;
+    std::vector<KeyframeEntry> keyframes_;
+    std::vector<ThumbnailEntry> thumbnails_;
+    std::vector<uint8_t> thumbnail_data_;
+    std::optional<int64_t> last_thumbnail_us_;
+};
+
+/**
+ * @brief Memory-mapped, validated view of a sidecar file
+ *
+ * Opening maps the file and checks the header and table checksums; lookups
+ * then touch only the pages they read. Thumbnails carry their own checksum
+ * so they are verified individually instead of all at open.
+ */
+class SidecarIndexReader {
+public:
+    SidecarIndexReader() = default;
+
+    SidecarIndexReader(const SidecarIndexReader&) = delete;
+    SidecarIndexReader& operator=(const SidecarIndexReader&) = delete;
+
+    /**
+     * @return false if the file is missing, truncated or fails validation
+     */
+    bool open(std::string_view path);
+
+    uint64_t segment_id() const;
+    int64_t segment_start_us() const;
+    uint32_t keyframe_count() const;
+    uint32_t thumbnail_count() const;
+
+    /**
+     * @pre index < keyframe_count()
+     */
+    KeyframeEntry keyframe(uint32_t index) const;
+
+    /**
+     * @brief Last keyframe at or before a media time, for seeking
+     */
+    std::optional<KeyframeEntry> keyframe_at_or_before(int64_t media_time_us) const;
+
+    /**
+     * @brief A thumbnail, checked against its own CRC on every read
+     *
+     * @return std::nullopt if the JPEG bytes are corrupt
+     *
+     * @pre index < thumbnail_count()
+     */
+    std::optional<ThumbnailView> thumbnail(uint32_t index) const;
+
+    /**
+     * @brief Thumbnail closest to a media time
+     */
+    std::optional<ThumbnailView> nearest_thumbnail(int64_t media_time_us) const;
+
+private:
+    MappedFile file_;
+    uint64_t segment_id_ = 0;
+    int64_t segment_start_us_ = 0;
+    uint32_t keyframe_count_ = 0;
+    uint32_t thumbnail_count_ = 0;
+    const uint8_t* keyframe_table_ = nullptr;
+    const uint8_t* thumbnail_table_ = nullptr;
+    const uint8_t* thumbnail_data_ = nullptr;
+    uint64_t thumbnail_data_size_ = 0;
+};
+
+} // namespace dashcam
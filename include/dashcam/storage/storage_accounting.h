@@ -0,0 +1,114 @@
+#pragma once
+
+/**
+ * @file storage_accounting.h
+ * @brief Lock-free running totals of recording volume usage
+ *
+ * Status RPCs are polled by dashboards and streamed to every subscriber, so
+ * they must not call statvfs() or walk the recording directory per request.
+ * StorageAccounting keeps atomic counters that the storage stage adjusts on
+ * every write and eviction, and reconciles them with statvfs() on a slow
+ * background timer to absorb drift (filesystem overhead, other writers, logs).
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace dashcam {
+
+/**
+ * @brief Usage of the recording volume as seen by the accounting counters
+ */
+struct StorageUsage {
+    uint64_t used_bytes = 0;
+    uint64_t available_bytes = 0;
+};
+
+/**
+ * @brief Running storage counters with periodic statvfs() reconciliation
+ *
+ * Threading: on_write(), on_evict() and usage() are wait-free and may be
+ * called from any thread. start()/stop() must be called from one owner thread.
+ */
+class StorageAccounting {
+public:
+    /**
+     * @param volume_path Any path on the recording volume
+     */
+    explicit StorageAccounting(std::string_view volume_path);
+
+    /**
+     * @brief Destructor stops the reconciliation thread
+     */
+    ~StorageAccounting();
+
+    // Tiger Style: No copy/move, shared by pointer between stages
+    StorageAccounting(const StorageAccounting&) = delete;
+    StorageAccounting& operator=(const StorageAccounting&) = delete;
+    StorageAccounting(StorageAccounting&&) = delete;
+    StorageAccounting& operator=(StorageAccounting&&) = delete;
+
+    /**
+     * @brief Reconcile once, then keep reconciling every interval
+     *
+     * @return false if the initial statvfs() failed
+     *
+     * @pre Not already started
+     * @pre interval > 0
+     */
+    bool start(std::chrono::milliseconds interval);
+
+    /**
+     * @brief Stop the reconciliation thread; counters remain readable
+     */
+    void stop();
+
+    /**
+     * @brief Replace the running counters with a fresh statvfs() reading
+     *
+     * This is the only method that performs I/O.
+     */
+    bool reconcile();
+
+    /**
+     * @brief Account bytes handed to the filesystem
+     */
+    void on_write(uint64_t bytes);
+
+    /**
+     * @brief Account bytes released by deleting or truncating a file
+     */
+    void on_evict(uint64_t bytes);
+
+    /**
+     * @brief Current usage without any I/O
+     *
+     * The two fields are read independently, so a concurrent write may be
+     * reflected in one but not yet the other; both are off by at most one
+     * batch.
+     */
+    StorageUsage usage() const;
+
+    uint64_t reconcile_count() const;
+
+private:
+    void reconcile_loop(std::chrono::milliseconds interval);
+
+    const std::string volume_path_;
+    std::atomic<uint64_t> used_bytes_{0};
+    std::atomic<uint64_t> available_bytes_{0};
+    std::atomic<uint64_t> reconcile_count_{0};
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_requested_ = false;
+    std::thread reconcile_thread_;
+};
+
+} // namespace dashcam
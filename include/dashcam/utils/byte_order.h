@@ -0,0 +1,91 @@
+#pragma once
+
+/**
+ * @file byte_order.h
+ * @brief Explicit byte order encoding for on-disk formats
+ *
+ * On-disk structures are encoded field by field instead of memcpy'ing packed
+ * structs, so files written on one target can be read on another and struct
+ * padding never leaks onto the card. Our own formats are little-endian; the
+ * big-endian helpers exist for ISO BMFF (MP4) boxes.
+ */
+
+#include <cstdint>
+
+namespace dashcam {
+
+inline void store_le16(uint8_t* out, uint16_t value) {
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+inline void store_le32(uint8_t* out, uint32_t value) {
+    for (uint32_t i = 0; i < 4; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+inline void store_le64(uint8_t* out, uint64_t value) {
+    for (uint32_t i = 0; i < 8; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+inline uint16_t load_le16(const uint8_t* in) {
+    return static_cast<uint16_t>(in[0] | (in[1] << 8));
+}
+
+inline uint32_t load_le32(const uint8_t* in) {
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+inline uint64_t load_le64(const uint8_t* in) {
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+inline void store_be16(uint8_t* out, uint16_t value) {
+    out[0] = static_cast<uint8_t>(value >> 8);
+    out[1] = static_cast<uint8_t>(value);
+}
+
+inline void store_be32(uint8_t* out, uint32_t value) {
+    for (uint32_t i = 0; i < 4; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * (3 - i)));
+    }
+}
+
+inline void store_be64(uint8_t* out, uint64_t value) {
+    for (uint32_t i = 0; i < 8; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * (7 - i)));
+    }
+}
+
+inline uint16_t load_be16(const uint8_t* in) {
+    return static_cast<uint16_t>((in[0] << 8) | in[1]);
+}
+
+inline uint32_t load_be32(const uint8_t* in) {
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < 4; ++i) {
+        value = (value << 8) | in[i];
+    }
+    return value;
+}
+
+inline uint64_t load_be64(const uint8_t* in) {
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < 8; ++i) {
+        value = (value << 8) | in[i];
+    }
+    return value;
+}
+
+} // namespace dashcam
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace dashcam {
+
+/**
+ * @brief CRC-32 (IEEE 802.3, reflected, polynomial 0xEDB88320)
+ *
+ * Used to make on-disk records self-validating. Pass the previous return value
+ * as `crc` to checksum data that is split across several buffers.
+ *
+ * @param data Bytes to checksum, may be null only if size is zero
+ * @param size Number of bytes
+ * @param crc Running checksum from a previous call, 0 to start
+ * @return Updated checksum
+ */
+uint32_t crc32(const void* data, size_t size, uint32_t crc = 0);
+
+} // namespace dashcam
@@ -0,0 +1,18 @@
+#pragma once
+
+namespace dashcam {
+
+/**
+ * @brief Move the calling thread to the idle I/O scheduling class
+ *
+ * Idle-class I/O is only dispatched when no other process has requests
+ * queued on the device, so housekeeping threads cannot delay the recorder.
+ * Only schedulers that honour I/O priorities (BFQ, CFQ) act on it; with
+ * mq-deadline or none the call succeeds and has no effect.
+ *
+ * @return false if the platform does not support I/O priorities or the
+ *         syscall failed
+ */
+bool set_thread_idle_io_priority();
+
+} // namespace dashcam
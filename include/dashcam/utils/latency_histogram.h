@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace dashcam {
+
+/**
+ * @brief Lock-free latency histogram with power-of-two nanosecond buckets
+ *
+ * Recording is a handful of relaxed atomic increments so it can sit on the
+ * storage hot path. Bucket i holds samples in [2^i, 2^(i+1)) nanoseconds;
+ * percentiles therefore resolve to the upper bound of a bucket, which is
+ * precise enough to tell a 200us sync from a 20ms one.
+ */
+class LatencyHistogram {
+public:
+    // 2^40 ns is ~18 minutes; anything slower lands in the last bucket.
+    static constexpr uint32_t BUCKET_COUNT = 40;
+
+    using BucketCounts = std::array<uint64_t, BUCKET_COUNT>;
+
+    LatencyHistogram() = default;
+
+    // Tiger Style: atomics are neither copyable nor movable; neither is this
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    /**
+     * @brief Record a single latency sample
+     *
+     * @param latency Observed latency, negative values are clamped to zero
+     */
+    void record(std::chrono::nanoseconds latency);
+
+    /**
+     * @brief Number of samples recorded since construction or reset()
+     */
+    uint64_t count() const;
+
+    /**
+     * @brief Largest sample recorded since construction or reset()
+     */
+    std::chrono::nanoseconds max() const;
+
+    /**
+     * @brief Mean of all samples, zero if nothing was recorded
+     */
+    std::chrono::nanoseconds mean() const;
+
+    /**
+     * @brief Upper bound of the bucket containing the given percentile
+     *
+     * @param percentile Percentile in the range [0, 100]
+     * @return Latency bound, zero if nothing was recorded
+     *
+     * @pre percentile must be within [0, 100]
+     */
+    std::chrono::nanoseconds percentile(double percentile) const;
+
+    /**
+     * @brief Copy of the per-bucket sample counts
+     *
+     * Subtracting two snapshots gives the distribution of the samples recorded
+     * in between, which lets a reader track a recent percentile without
+     * resetting a histogram other threads also report from.
+     */
+    BucketCounts bucket_counts() const;
+
+    /**
+     * @brief Upper bound of the bucket containing a percentile of given counts
+     *
+     * @return Latency bound, zero if the counts are all zero
+     *
+     * @pre percentile must be within [0, 100]
+     */
+    static std::chrono::nanoseconds percentile_of(const BucketCounts& counts, double percentile);
+
+    /**
+     * @brief Clear all samples
+     *
+     * Not linearizable with concurrent record() calls; a sample racing with
+     * reset() may be partially counted.
+     */
+    void reset();
+
+private:
+    static uint32_t bucket_for(uint64_t nanoseconds);
+
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_ns_{0};
+    std::atomic<uint64_t> max_ns_{0};
+};
+
+} // namespace dashcam
@@ -0,0 +1,113 @@
+#pragma once
+
+/**
+ * @file live_status.h
+ * @brief Pipeline status published by hot threads, read lock-free by RPCs
+ *
+ * Capture threads report frame counts and frame rate many times a second,
+ * while GetStatus and the status publisher read them on gRPC threads. A mutex
+ * would let a burst of status polls stall a capture thread. Instead each
+ * writer owns a slot guarded by its own Seqlock: publishing is a few plain
+ * stores and never waits, and readers copy each slot without taking a lock,
+ * retrying only if they overlapped that slot's write.
+ */
+
+#include "dashcam/utils/seqlock.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace dashcam {
+
+/**
+ * @brief Slot layout
+ */
+struct LiveStatusConfig {
+    uint32_t writers = 1;                    // One slot per publishing thread, typically per camera
+};
+
+/**
+ * @brief What one writer reports; published as a whole
+ */
+struct CaptureStatus {
+    uint64_t frames_captured = 0;
+    uint32_t current_fps = 0;
+    bool recording = false;
+    bool audio = false;                      // An AudioCapture feeds this writer's segments
+};
+
+/**
+ * @brief Status across all writers at one moment per writer
+ */
+struct LiveStatusSnapshot {
+    bool recording = false;                  // Any writer recording
+    uint64_t frames_captured = 0;            // Sum over writers
+    uint32_t current_fps = 0;                // Slowest recording writer, 0 when none record
+    uint32_t recording_writers = 0;
+    bool audio_enabled = false;              // Any writer captures audio
+    int64_t uptime_seconds = 0;
+};
+
+/**
+ * @brief Counters for monitoring contention
+ */
+struct LiveStatusStats {
+    uint64_t publishes = 0;
+    uint64_t read_retries = 0;               // Slot reads that overlapped a publish
+};
+
+/**
+ * @brief Per-writer seqlocked status slots
+ *
+ * Threading: publish(writer, ...) from that writer's own thread only.
+ * snapshot() and stats() from any thread.
+ */
+class LiveStatus {
+public:
+    /**
+     * @pre config.writers > 0
+     */
+    explicit LiveStatus(const LiveStatusConfig& config = LiveStatusConfig{});
+
+    // Tiger Style: No copy/move, shared by pointer between writers and readers
+    LiveStatus(const LiveStatus&) = delete;
+    LiveStatus& operator=(const LiveStatus&) = delete;
+    LiveStatus(LiveStatus&&) = delete;
+    LiveStatus& operator=(LiveStatus&&) = delete;
+
+    /**
+     * @brief Replace a writer's status; wait-free
+     *
+     * @pre writer < writers()
+     */
+    void publish(uint32_t writer, const CaptureStatus& status);
+
+    /**
+     * @brief Combine every slot without taking a lock
+     *
+     * Each slot is read consistently; slots are read one after another, so
+     * two writers' values may be a publish apart.
+     */
+    LiveStatusSnapshot snapshot() const;
+
+    LiveStatusStats stats() const;
+
+    uint32_t writers() const;
+
+private:
+    static constexpr size_t CACHE_LINE_BYTES = 64;
+
+    // Own cache line each, so writers do not false-share
+    struct alignas(CACHE_LINE_BYTES) Slot {
+        Seqlock<CaptureStatus> status;
+    };
+
+    const uint32_t writers_;
+    const std::chrono::steady_clock::time_point started_;
+    const std::unique_ptr<Slot[]> slots_;
+    alignas(CACHE_LINE_BYTES) mutable std::atomic<uint64_t> read_retries_{0};
+};
+
+} // namespace dashcam
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace dashcam {
+
+/**
+ * @brief RAII read-only memory mapping of a whole file
+ *
+ * Readers that only look at a few pages of a file (index lookups, scrubbing)
+ * pay for exactly those pages instead of read()ing the file into a buffer.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    ~MappedFile() {
+        close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    /**
+     * @brief Map a file read-only
+     *
+     * An empty file opens successfully with a null data() pointer.
+     *
+     * @return false if the file cannot be opened, stat'ed or mapped
+     *
+     * @pre Nothing is currently mapped
+     */
+    bool open(std::string_view path);
+
+    /**
+     * @brief Unmap the file; safe to call when nothing is mapped
+     */
+    void close();
+
+    bool is_open() const {
+        return open_;
+    }
+
+    const uint8_t* data() const {
+        return data_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    bool open_ = false;
+};
+
+} // namespace dashcam
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <unistd.h>
+
+namespace dashcam {
+
+/**
+ * @brief RAII owner of a POSIX file descriptor
+ *
+ * Tiger Style: resources are released on every path, including early returns
+ * in error handling.
+ */
+class ScopedFd {
+public:
+    ScopedFd() = default;
+    explicit ScopedFd(int fd) : fd_(fd) {}
+
+    ~ScopedFd() {
+        reset();
+    }
+
+    ScopedFd(const ScopedFd&) = delete;
+    ScopedFd& operator=(const ScopedFd&) = delete;
+
+    ScopedFd(ScopedFd&& other) noexcept : fd_(other.release()) {}
+
+    ScopedFd& operator=(ScopedFd&& other) noexcept {
+        if (this != &other) {
+            reset(other.release());
+        }
+        return *this;
+    }
+
+    int get() const {
+        return fd_;
+    }
+
+    bool is_valid() const {
+        return fd_ >= 0;
+    }
+
+    /**
+     * @brief Give up ownership without closing
+     */
+    int release() {
+        const int fd = fd_;
+        fd_ = -1;
+        return fd;
+    }
+
+    /**
+     * @brief Close the current descriptor (if any) and take ownership of another
+     */
+    void reset(int fd = -1) {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+        fd_ = fd;
+    }
+
+private:
+    int fd_ = -1;
+};
+
+} // namespace dashcam
@@ -0,0 +1,117 @@
+#pragma once
+
+/**
+ * @file seqlock.h
+ * @brief Single-writer sequence lock for small trivially copyable values
+ *
+ * The writer bumps a sequence number to odd, stores the value and bumps it
+ * back to even; it never waits for readers. A reader copies the value between
+ * two reads of the sequence and retries if a write overlapped. The value is
+ * held in relaxed atomic words, so a torn copy is discarded rather than
+ * being a data race.
+ */
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+namespace dashcam {
+
+/**
+ * @brief Latest value of T, written by one thread and read by any
+ *
+ * Threading: store() from exactly one writer thread at a time. load(),
+ * version() from any thread.
+ */
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable_v<T>, "Seqlock copies T byte-wise");
+
+public:
+    Seqlock() {
+        const T initial{};
+        std::array<uint64_t, WORDS> buffer{};
+        std::memcpy(buffer.data(), &initial, sizeof(T));
+        for (size_t i = 0; i < WORDS; ++i) {
+            words_[i].store(buffer[i], std::memory_order_relaxed);
+        }
+    }
+
+    // Tiger Style: No copy/move, readers hold references
+    Seqlock(const Seqlock&) = delete;
+    Seqlock& operator=(const Seqlock&) = delete;
+    Seqlock(Seqlock&&) = delete;
+    Seqlock& operator=(Seqlock&&) = delete;
+
+    /**
+     * @brief Publish a new value; wait-free
+     */
+    void store(const T& value) {
+        std::array<uint64_t, WORDS> buffer{};
+        std::memcpy(buffer.data(), &value, sizeof(T));
+
+        const uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);
+        // Orders the odd sequence before any of the new words
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; ++i) {
+            words_[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        sequence_.store(sequence + 2, std::memory_order_release);
+    }
+
+    /**
+     * @brief Copy of the latest complete value
+     *
+     * @param retries If given, receives how many overlapping writes forced a
+     *        retry
+     */
+    T load(uint32_t* retries = nullptr) const {
+        uint32_t attempts = 0;
+        std::array<uint64_t, WORDS> buffer{};
+        for (;;) {
+            const uint64_t before = sequence_.load(std::memory_order_acquire);
+            if ((before & 1) == 0) {
+                for (size_t i = 0; i < WORDS; ++i) {
+                    buffer[i] = words_[i].load(std::memory_order_relaxed);
+                }
+                // Orders the word loads before the second sequence read
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence_.load(std::memory_order_relaxed) == before) {
+                    break;
+                }
+            }
+            // A preempted writer cannot finish while we spin on its core
+            if (++attempts % SPINS_BEFORE_YIELD == 0) {
+                std::this_thread::yield();
+            }
+        }
+        if (retries != nullptr) {
+            *retries = attempts;
+        }
+        // Trivially copyable; the cast only quiets -Wclass-memaccess for T
+        // with default member initializers
+        T value{};
+        std::memcpy(static_cast<void*>(&value), buffer.data(), sizeof(T));
+        return value;
+    }
+
+    /**
+     * @brief Number of completed store() calls
+     */
+    uint64_t version() const {
+        return sequence_.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    static constexpr uint32_t SPINS_BEFORE_YIELD = 64;
+
+    std::atomic<uint64_t> sequence_{0};
+    std::array<std::atomic<uint64_t>, WORDS> words_;
+};
+
+} // namespace dashcam
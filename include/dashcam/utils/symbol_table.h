@@ -0,0 +1,131 @@
+#pragma once
+
+/**
+ * @file symbol_table.h
+ * @brief Process-wide string interning for event types, cameras and metadata keys
+ *
+ * Event streams repeat a small vocabulary (a few dozen event types, a camera
+ * or two, a handful of metadata keys) millions of times. Interning maps each
+ * distinct string to a dense 32-bit Symbol once; after that an event holds
+ * four bytes per name and a filter compares integers.
+ *
+ * Names live in fixed-size chunks that are never moved or freed, so name()
+ * is a lock-free array lookup and the returned reference stays valid for
+ * the table's lifetime. Symbols are handed out in order, which lets a
+ * caller tell whether a symbol was interned after some earlier point.
+ */
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace dashcam {
+
+/**
+ * @brief An interned string; only meaningful with the table that issued it
+ */
+enum class Symbol : uint32_t {
+    EMPTY = 0,                                       // ""; interned in every table
+};
+
+/**
+ * @brief Counters for monitoring the table
+ */
+struct SymbolTableStats {
+    uint64_t symbols = 0;                            // Including EMPTY
+    uint64_t bytes = 0;                              // Characters held
+    uint64_t overflowed = 0;                         // intern() calls refused because the table was full
+};
+
+/**
+ * @brief Append-only string to Symbol map
+ *
+ * Threading: every method from any thread. intern() of a known string and
+ * find() take a shared lock; only a new string takes the exclusive lock.
+ * name() takes no lock.
+ */
+class SymbolTable {
+public:
+    static constexpr uint32_t CHUNK_SYMBOLS = 4096;
+    static constexpr uint32_t MAX_CHUNKS = 4096;
+    static constexpr uint32_t MAX_SYMBOLS = CHUNK_SYMBOLS * MAX_CHUNKS;
+
+    /**
+     * @param max_symbols Strings held before intern() refuses new ones,
+     *        including EMPTY; lower than MAX_SYMBOLS only for tests
+     *
+     * @pre 1 < max_symbols <= MAX_SYMBOLS
+     */
+    explicit SymbolTable(uint32_t max_symbols = MAX_SYMBOLS);
+    ~SymbolTable();
+
+    // Tiger Style: No copy/move, symbols and name references point into it
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+    SymbolTable(SymbolTable&&) = delete;
+    SymbolTable& operator=(SymbolTable&&) = delete;
+
+    /**
+     * @brief The table shared by the event pipeline
+     */
+    static SymbolTable& global();
+
+    /**
+     * @brief The symbol of `value`, adding it if new
+     *
+     * Strings are never removed, so only intern closed vocabularies (names
+     * chosen by code), not free text.
+     *
+     * @return std::nullopt for a new string once max_symbols are held; the
+     *         refusal is counted in `overflowed` and logged. Callers must
+     *         reject whatever carried the name rather than file it under a
+     *         wrong one.
+     */
+    std::optional<Symbol> intern(std::string_view value);
+
+    /**
+     * @brief The symbol of `value` if it was interned; never adds
+     */
+    std::optional<Symbol> find(std::string_view value) const;
+
+    /**
+     * @brief The string a symbol stands for; lock-free
+     *
+     * @pre symbol was returned by this table
+     */
+    const std::string& name(Symbol symbol) const {
+        const uint32_t index = static_cast<uint32_t>(symbol);
+        assert(index < size()); // Tiger Style: assert preconditions
+        return chunks_[index / CHUNK_SYMBOLS].load(std::memory_order_acquire)[index % CHUNK_SYMBOLS];
+    }
+
+    /**
+     * @brief Symbols issued so far; every symbol issued later is >= this
+     */
+    uint32_t size() const {
+        return size_.load(std::memory_order_acquire);
+    }
+
+    SymbolTableStats stats() const;
+
+private:
+    const uint32_t max_symbols_;
+
+    // Keys view the strings in chunks_, which never move
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string_view, Symbol> symbols_;
+    std::array<std::atomic<std::string*>, MAX_CHUNKS> chunks_{};
+
+    std::atomic<uint32_t> size_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> overflowed_{0};
+};
+
+} // namespace dashcam
@@ -0,0 +1,517 @@
+#include "clip_downloader.h"
+#include "dashcam/storage/segment_reader.h"
+#include "dashcam/utils/logger.h"
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include <thread>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dashcam {
+
+namespace {
+
+/**
+ * @brief Index pins held for one download
+ *
+ * Retention truncates a segment's file before unlinking it, and a mapped
+ * page past the new end raises SIGBUS. The pins keep retention away until
+ * the reader is done and gRPC has released the last chunk it sent.
+ */
+class SegmentPins {
+public:
+    explicit SegmentPins(std::shared_ptr<SegmentIndex> index) : index_(std::move(index)) {}
+
+    ~SegmentPins() {
+        for (const uint64_t segment_id : pinned_) {
+            index_->unpin(segment_id);
+        }
+    }
+
+    // Tiger Style: No copy/move, each pin is undone exactly once
+    SegmentPins(const SegmentPins&) = delete;
+    SegmentPins& operator=(const SegmentPins&) = delete;
+    SegmentPins(SegmentPins&&) = delete;
+    SegmentPins& operator=(SegmentPins&&) = delete;
+
+    /**
+     * @return false if the segment has left the index
+     */
+    bool pin(uint64_t segment_id) {
+        if (!index_->pin(segment_id)) {
+            return false;
+        }
+        pinned_.push_back(segment_id);
+        return true;
+    }
+
+private:
+    const std::shared_ptr<SegmentIndex> index_;
+    std::vector<uint64_t> pinned_;
+};
+
+/**
+ * @brief What a sent chunk keeps alive: its mapping and the download's pins
+ */
+struct SpanOwner {
+    std::shared_ptr<const void> mapping;
+    std::shared_ptr<const SegmentPins> pins;
+};
+
+/**
+ * @brief Slice destructor: drops the span's references
+ */
+void release_span(void* owner) {
+    delete static_cast<SpanOwner*>(owner);
+}
+
+/**
+ * @brief Fault a span's pages in on the calling thread
+ *
+ * The reader thread is in the idle I/O class; gRPC's threads are not.
+ */
+void prefault(const ReadSpan& span, size_t page_size) {
+    volatile uint8_t sink = 0;
+    for (size_t i = 0; i < span.size_bytes; i += page_size) {
+        sink = static_cast<uint8_t>(sink ^ span.data[i]);
+    }
+    sink = static_cast<uint8_t>(sink ^ span.data[span.size_bytes - 1]);
+    (void)sink;
+}
+
+grpc::Status segment_gone(uint64_t segment_id) {
+    return grpc::Status(grpc::StatusCode::NOT_FOUND,
+                        "Segment " + std::to_string(segment_id) + " is no longer available");
+}
+
+} // namespace
+
+ClipDownloader::ClipDownloader(std::shared_ptr<SegmentIndex> segments,
+                               const ClipDownloaderConfig& config)
+    : segments_(std::move(segments)),
+      config_(config),
+      page_size_(static_cast<size_t>(::sysconf(_SC_PAGESIZE))) {
+    // Tiger Style: assert preconditions
+    assert(config_.max_downloads > 0);
+    assert(config_.min_chunk_bytes > 0);
+    assert(config_.min_chunk_bytes <= config_.max_chunk_bytes);
+    assert(config_.max_chunk_bytes <= SegmentReaderConfig{}.window_bytes);
+    assert(config_.queue_chunks > 0);
+    assert(config_.target_write_time.count() > 0);
+    assert(config_.max_write_stall.count() > 0);
+
+    if (!segments_) {
+        return;
+    }
+    threads_.reserve(config_.max_downloads);
+    for (uint32_t i = 0; i < config_.max_downloads; ++i) {
+        threads_.emplace_back(&ClipDownloader::run, this);
+    }
+}
+
+ClipDownloader::~ClipDownloader() {
+    stop();
+}
+
+grpc::ServerWriteReactor<grpc::ByteBuffer>* ClipDownloader::download(
+    grpc::CallbackServerContext* context,
+    const DownloadClipRequest& request) {
+    if (!segments_) {
+        return new RejectedStream(grpc::Status(grpc::StatusCode::FAILED_PRECONDITION,
+                                               "No recordings available for download"));
+    }
+    if (request.segment_ids_size() == 0) {
+        if (request.camera_id().empty()) {
+            return new RejectedStream(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                                   "segment_ids or camera_id is required"));
+        }
+        if (request.end_time_us() < request.start_time_us()) {
+            return new RejectedStream(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                                   "end_time_us is before start_time_us"));
+        }
+    }
+
+    auto* stream = new ClipStream(*this, context, request);
+    grpc::Status refused;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_) {
+            refused = grpc::Status(grpc::StatusCode::UNAVAILABLE, "Server is shutting down");
+        } else if (busy_ >= config_.max_downloads) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            refused = grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                                   "Too many downloads in progress");
+        } else {
+            busy_++;
+            streams_.push_back(stream);
+            stream->ref(); // The reader thread's, released when it is done with the stream
+            pending_.push_back(stream);
+            work_.notify_one();
+            return stream;
+        }
+    }
+    stream->finish(refused);
+    return stream;
+}
+
+void ClipDownloader::stop() {
+    std::vector<ClipStream*> open;
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_) {
+            return;
+        }
+        stopped_ = true;
+        open.swap(streams_);
+        for (ClipStream* stream : open) {
+            stream->ref();
+        }
+        threads.swap(threads_);
+        work_.notify_all();
+    }
+
+    for (ClipStream* stream : open) {
+        stream->end(grpc::Status(grpc::StatusCode::UNAVAILABLE,
+                                 "Server is shutting down; resume from the last offset"));
+        stream->unref();
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+ClipDownloaderStats ClipDownloader::stats() const {
+    ClipDownloaderStats stats;
+    stats.started = started_.load(std::memory_order_relaxed);
+    stats.resumed = resumed_.load(std::memory_order_relaxed);
+    stats.completed = completed_.load(std::memory_order_relaxed);
+    stats.failed = failed_.load(std::memory_order_relaxed);
+    stats.rejected = rejected_.load(std::memory_order_relaxed);
+    stats.chunks = counters_.writes_started.load(std::memory_order_relaxed);
+    stats.bytes_sent = counters_.bytes_written.load(std::memory_order_relaxed);
+    stats.disconnected = counters_.disconnected.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.active = busy_;
+    return stats;
+}
+
+std::vector<SubscriberStats> ClipDownloader::download_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<SubscriberStats> stats;
+    stats.reserve(streams_.size());
+    for (const ClipStream* stream : streams_) {
+        stats.push_back(stream->stats());
+    }
+    return stats;
+}
+
+void ClipDownloader::run() {
+    while (true) {
+        ClipStream* stream = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            // Pending streams are served even after stop(): they end at once,
+            // and drop their reference
+            work_.wait(lock, [this] { return stopped_ || !pending_.empty(); });
+            if (pending_.empty()) {
+                return;
+            }
+            stream = pending_.front();
+            pending_.pop_front();
+        }
+
+        serve(stream);
+        stream->unref();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        assert(busy_ > 0);
+        busy_--;
+    }
+}
+
+void ClipDownloader::serve(ClipStream* stream) {
+    assert(stream != nullptr); // Tiger Style: assert preconditions
+
+    const DownloadClipRequest& request = stream->request_;
+    started_.fetch_add(1, std::memory_order_relaxed);
+    if (request.offset() > 0) {
+        resumed_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::vector<Part> parts;
+    grpc::Status status = resolve(request, &parts);
+    uint64_t clip_size = 0;
+    for (const Part& part : parts) {
+        clip_size += part.size;
+    }
+    if (status.ok() && request.offset() > clip_size) {
+        status = grpc::Status(grpc::StatusCode::OUT_OF_RANGE,
+                              "offset " + std::to_string(request.offset()) +
+                                  " is past the end of the clip (" + std::to_string(clip_size) +
+                                  " bytes)");
+    }
+    // Before any file is opened: a segment evicted after resolve() fails
+    // here instead of being truncated under the mapping
+    auto pins = std::make_shared<SegmentPins>(segments_);
+    for (size_t i = 0; status.ok() && i < parts.size(); ++i) {
+        if (!pins->pin(parts[i].segment_id)) {
+            status = segment_gone(parts[i].segment_id);
+        }
+    }
+    if (!status.ok()) {
+        failed_.fetch_add(1, std::memory_order_relaxed);
+        stream->finish(status);
+        return;
+    }
+
+    // Segment the resume offset falls in
+    size_t index = 0;
+    uint64_t base = 0;
+    while (index < parts.size() && request.offset() >= base + parts[index].size) {
+        base += parts[index].size;
+        index++;
+    }
+
+    bool first = true;
+    const auto chunk = [&](const Part* part, uint64_t position, uint64_t segment_offset) {
+        ClipChunk header;
+        header.set_offset(position);
+        if (part != nullptr) {
+            header.set_segment_id(part->segment_id);
+            header.set_segment_offset(segment_offset);
+        }
+        if (first) {
+            header.set_clip_size(clip_size);
+            for (const Part& listed : parts) {
+                header.add_segment_ids(listed.segment_id);
+                header.add_segment_sizes(listed.size);
+            }
+            first = false;
+        }
+        return header;
+    };
+
+    SegmentReaderConfig reader_config;
+    reader_config.chunk_bytes = config_.max_chunk_bytes;
+    SegmentReader reader(reader_config);
+
+    uint64_t position = request.offset();
+    const auto paced_from = std::chrono::steady_clock::now();
+    uint64_t paced_bytes = 0;
+    bool ended = false;
+    for (; index < parts.size() && !ended; ++index) {
+        const Part& part = parts[index];
+        const uint64_t segment_offset = position - base;
+        if (!reader.open(part.path, segment_offset, part.size - segment_offset)) {
+            status = segment_gone(part.segment_id);
+            break;
+        }
+        if (reader.end_offset() != part.size) {
+            status = grpc::Status(grpc::StatusCode::ABORTED,
+                                  "Segment " + std::to_string(part.segment_id) +
+                                      " changed during the download");
+            break;
+        }
+
+        while (auto span = reader.next(stream->chunk_bytes())) {
+            prefault(*span, page_size_);
+            const ClipChunk header = chunk(&part, position, span->offset);
+            const size_t size = span->size_bytes;
+            // The slice owns references to the mapping and the pins from here;
+            // gRPC drops them once sent
+            grpc::Slice data(const_cast<uint8_t*>(span->data),
+                             size,
+                             &release_span,
+                             new SpanOwner{std::move(span->owner), pins});
+            grpc::ByteBuffer message =
+                serialize_with_bytes(header, ClipChunk::kDataFieldNumber, std::move(data));
+            if (!stream->push(std::move(message))) {
+                ended = true;
+                break;
+            }
+            position += size;
+
+            if (config_.max_bytes_per_second > 0) {
+                paced_bytes += size;
+                const auto due = paced_from + std::chrono::microseconds(
+                                                  paced_bytes * 1000000 /
+                                                  config_.max_bytes_per_second);
+                if (!stream->hold_until(due)) {
+                    ended = true;
+                    break;
+                }
+            }
+        }
+        if (!ended && reader.position() != reader.end_offset()) {
+            status = grpc::Status(grpc::StatusCode::INTERNAL,
+                                  "Failed to read segment " + std::to_string(part.segment_id));
+            break;
+        }
+        reader.close();
+        base += part.size;
+    }
+
+    if (status.ok() && !ended && first) {
+        // Resumed at the very end: the client still learns the clip's layout
+        ended = !stream->push(serialize_with_bytes(chunk(nullptr, position, 0),
+                                                   ClipChunk::kDataFieldNumber,
+                                                   grpc::Slice()));
+    }
+    if (status.ok() && !ended && stream->drain()) {
+        completed_.fetch_add(1, std::memory_order_relaxed);
+        stream->finish(grpc::Status::OK);
+        return;
+    }
+    failed_.fetch_add(1, std::memory_order_relaxed);
+    // Whatever ended the stream already set its status; otherwise this one stands
+    stream->finish(status.ok() ? grpc::Status(grpc::StatusCode::CANCELLED, "Download ended")
+                               : status);
+}
+
+grpc::Status ClipDownloader::resolve(const DownloadClipRequest& request,
+                                     std::vector<Part>* parts) const {
+    assert(parts != nullptr); // Tiger Style: assert preconditions
+
+    std::vector<SegmentInfo> found;
+    if (request.segment_ids_size() > 0) {
+        found.reserve(static_cast<size_t>(request.segment_ids_size()));
+        for (const uint64_t segment_id : request.segment_ids()) {
+            auto segment = segments_->find(segment_id);
+            if (!segment) {
+                return grpc::Status(grpc::StatusCode::NOT_FOUND,
+                                    "Unknown segment " + std::to_string(segment_id));
+            }
+            found.push_back(std::move(*segment));
+        }
+    } else {
+        found = segments_->overlapping(
+            request.camera_id(), request.start_time_us(), request.end_time_us());
+        if (found.empty()) {
+            return grpc::Status(grpc::StatusCode::NOT_FOUND,
+                                "No recordings of the camera in that time range");
+        }
+    }
+
+    // The file, not the index, is authoritative: the index lags the recorder
+    parts->reserve(found.size());
+    for (SegmentInfo& segment : found) {
+        struct stat info {};
+        if (::stat(segment.path.c_str(), &info) != 0) {
+            return segment_gone(segment.segment_id);
+        }
+        Part part;
+        part.segment_id = segment.segment_id;
+        part.path = std::move(segment.path);
+        part.size = static_cast<uint64_t>(info.st_size);
+        parts->push_back(std::move(part));
+    }
+    return grpc::Status::OK;
+}
+
+void ClipDownloader::remove(ClipStream* stream) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = std::find(streams_.begin(), streams_.end(), stream);
+    if (it != streams_.end()) {
+        // Order does not matter; swap-and-pop keeps removal O(1) after the find
+        *it = streams_.back();
+        streams_.pop_back();
+    }
+}
+
+ClipStream::ClipStream(ClipDownloader& downloader,
+                       grpc::CallbackServerContext* context,
+                       const DownloadClipRequest& request)
+    : StreamSubscriber(context, downloader.config_.max_write_stall, downloader.counters_),
+      downloader_(downloader),
+      request_(request),
+      chunk_bytes_(downloader.config_.min_chunk_bytes) {}
+
+bool ClipStream::push(grpc::ByteBuffer chunk) {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!finishing_locked() && queue_.size() >= downloader_.config_.queue_chunks) {
+            wait_locked(lock);
+        }
+        if (finishing_locked()) {
+            return false;
+        }
+        queue_.push_back(std::move(chunk));
+    }
+    pump();
+    return true;
+}
+
+bool ClipStream::drain() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!finishing_locked() && (!queue_.empty() || writing_)) {
+        wait_locked(lock);
+    }
+    return !finishing_locked();
+}
+
+bool ClipStream::hold_until(std::chrono::steady_clock::time_point due) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    room_.wait_until(lock, due, [this] { return finishing_locked(); });
+    return !finishing_locked();
+}
+
+void ClipStream::end(const grpc::Status& status) {
+    finish(status);
+    std::lock_guard<std::mutex> lock(mutex_);
+    room_.notify_all();
+}
+
+size_t ClipStream::chunk_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return chunk_bytes_;
+}
+
+void ClipStream::wait_locked(std::unique_lock<std::mutex>& lock) {
+    // Wake now and then to check the write in flight: a client that stopped
+    // reading completes nothing that would wake us
+    const auto poll = std::min<std::chrono::milliseconds>(downloader_.config_.max_write_stall / 4,
+                                                          std::chrono::milliseconds(100));
+    if (room_.wait_for(lock, poll) == std::cv_status::timeout) {
+        lock.unlock();
+        pump();
+        lock.lock();
+    }
+}
+
+bool ClipStream::pop_locked(grpc::ByteBuffer* next) {
+    if (queue_.empty()) {
+        return false;
+    }
+    *next = std::move(queue_.front());
+    queue_.pop_front();
+    writing_ = true;
+    room_.notify_all();
+    return true;
+}
+
+size_t ClipStream::queued_locked() const {
+    return queue_.size();
+}
+
+void ClipStream::detach() {
+    downloader_.remove(this);
+    std::lock_guard<std::mutex> lock(mutex_);
+    room_.notify_all();
+}
+
+void ClipStream::write_done_locked(std::chrono::steady_clock::duration elapsed) {
+    writing_ = false;
+    const ClipDownloaderConfig& config = downloader_.config_;
+    if (elapsed <= config.target_write_time) {
+        chunk_bytes_ = std::min(chunk_bytes_ * 2, config.max_chunk_bytes);
+    } else if (elapsed > config.target_write_time * 4) {
+        chunk_bytes_ = std::max(chunk_bytes_ / 2, config.min_chunk_bytes);
+    }
+    room_.notify_all();
+}
+
+} // namespace dashcam
@@ -0,0 +1,242 @@
+#pragma once
+
+/**
+ * @file clip_downloader.h
+ * @brief DownloadClip: recorded segments streamed in chunks, resumable at any byte
+ *
+ * A clip is the concatenation of its segment files, in request order (or
+ * segment id order for a time range). Every ClipChunk carries its offset in
+ * the clip; the first also lists the clip's segments and sizes, so a client
+ * whose connection drops asks again for the same segment ids from the last
+ * offset it received.
+ *
+ * Reading stays off gRPC's threads and out of the recorder's way. Each
+ * download runs on one of `max_downloads` reader threads, which read through
+ * SegmentReader: mmap windows, sequential hints, drop-behind, and the idle
+ * I/O class. A chunk's pages are touched on that thread before the chunk is
+ * queued, so any disk read happens at idle priority rather than inside
+ * gRPC's send; the chunk itself is a slice of the mapping, never copied.
+ *
+ * Every segment of a clip is pinned in the index before its file is opened
+ * and stays pinned until gRPC releases the last chunk sent from it. Retention
+ * truncates a file before unlinking it, which would fault the mapping; a
+ * pinned segment cannot be evicted, so a slow client holds back retention of
+ * the segments it downloads instead.
+ *
+ * The client's flow control paces the reader: a stream holds at most
+ * `queue_chunks` chunks behind its write in flight, and the reader waits for
+ * room. Chunk size follows the connection. It starts at HTTP/2's initial
+ * window (64 KiB), doubles while writes drain within `target_write_time`, and
+ * halves when one takes four times that, so a chunk settles near what the
+ * connection's flow-control window lets through per write.
+ */
+
+#include "dashcam.pb.h"
+#include "dashcam/storage/segment_index.h"
+#include "stream_subscriber.h"
+
+#include <grpcpp/grpcpp.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dashcam {
+
+class ClipStream;
+
+/**
+ * @brief Download concurrency, chunking and pacing
+ */
+struct ClipDownloaderConfig {
+    uint32_t max_downloads = 2;                      // Reader threads; further requests are refused
+    size_t min_chunk_bytes = 64 * 1024;              // HTTP/2's initial flow-control window
+    size_t max_chunk_bytes = 1024 * 1024;
+    std::chrono::milliseconds target_write_time{50}; // Chunks grow while writes drain faster
+    size_t queue_chunks = 2;                         // Chunks read ahead of the write in flight
+    // Per download; 0: no cap. For I/O schedulers without an idle class
+    uint64_t max_bytes_per_second = 0;
+    std::chrono::milliseconds max_write_stall{10000}; // Then a stalled reader is cancelled
+};
+
+/**
+ * @brief Counters for monitoring downloads
+ */
+struct ClipDownloaderStats {
+    uint64_t started = 0;
+    uint64_t resumed = 0;              // Started at a non-zero offset
+    uint64_t completed = 0;            // Every byte queued and sent
+    uint64_t failed = 0;               // Ended by an error, the client, or shutdown
+    uint64_t rejected = 0;             // Every reader thread busy
+    uint64_t active = 0;
+    uint64_t chunks = 0;               // Writes started
+    uint64_t bytes_sent = 0;           // Message payloads, before gRPC framing
+    uint64_t disconnected = 0;
+};
+
+/**
+ * @brief Serves DownloadClip calls from the segment index
+ *
+ * Threading: download(), stop() and the accessors from any thread. Reading
+ * happens on the downloader's own threads, which are started by the
+ * constructor and enter the idle I/O class on their first read.
+ */
+class ClipDownloader {
+public:
+    /**
+     * @param segments Catalogue of recorded segments, which are pinned while
+     *        they download; when null, every download fails with
+     *        FAILED_PRECONDITION and no thread is started
+     *
+     * @pre config.max_downloads > 0, 0 < config.min_chunk_bytes <=
+     *      config.max_chunk_bytes, config.queue_chunks > 0,
+     *      config.target_write_time > 0, config.max_write_stall > 0
+     */
+    ClipDownloader(std::shared_ptr<SegmentIndex> segments,
+                   const ClipDownloaderConfig& config = ClipDownloaderConfig{});
+
+    /**
+     * @brief Destructor stops every download and joins the reader threads
+     */
+    ~ClipDownloader();
+
+    // Tiger Style: No copy/move, owns threads and streams hold references
+    ClipDownloader(const ClipDownloader&) = delete;
+    ClipDownloader& operator=(const ClipDownloader&) = delete;
+    ClipDownloader(ClipDownloader&&) = delete;
+    ClipDownloader& operator=(ClipDownloader&&) = delete;
+
+    /**
+     * @brief Open a stream for one DownloadClip call
+     *
+     * Requests that name no segment and no camera, or whose time range ends
+     * before it starts, finish at once with INVALID_ARGUMENT; requests made
+     * while every reader thread is busy with RESOURCE_EXHAUSTED. Segments
+     * are resolved on the reader thread. gRPC owns the reactor.
+     */
+    grpc::ServerWriteReactor<grpc::ByteBuffer>* download(grpc::CallbackServerContext* context,
+                                                         const DownloadClipRequest& request);
+
+    /**
+     * @brief End every download with UNAVAILABLE and join the reader threads
+     *
+     * Clients resume from the last offset they received. Safe to call more
+     * than once; downloads requested afterwards finish at once.
+     */
+    void stop();
+
+    ClipDownloaderStats stats() const;
+
+    /**
+     * @brief Lag and byte counters of every open download
+     */
+    std::vector<SubscriberStats> download_stats() const;
+
+private:
+    friend class ClipStream;
+
+    struct Part {
+        uint64_t segment_id = 0;
+        std::string path;
+        uint64_t size = 0;
+    };
+
+    void run();
+    void serve(ClipStream* stream);
+
+    /**
+     * @brief The clip's segments and their sizes now
+     */
+    grpc::Status resolve(const DownloadClipRequest& request, std::vector<Part>* parts) const;
+
+    void remove(ClipStream* stream);
+
+    const std::shared_ptr<SegmentIndex> segments_;
+    const ClipDownloaderConfig config_;
+    const size_t page_size_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_;
+    std::deque<ClipStream*> pending_;                // Referenced; a reader thread takes each
+    std::vector<ClipStream*> streams_;               // Every open download
+    uint32_t busy_ = 0;                              // Reader threads serving or about to
+    bool stopped_ = false;
+    std::vector<std::thread> threads_;
+
+    std::atomic<uint64_t> started_{0};
+    std::atomic<uint64_t> resumed_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> failed_{0};
+    std::atomic<uint64_t> rejected_{0};
+    StreamCounters counters_;
+};
+
+/**
+ * @brief Server side of one DownloadClip call
+ */
+class ClipStream final : public StreamSubscriber {
+public:
+    ClipStream(ClipDownloader& downloader,
+               grpc::CallbackServerContext* context,
+               const DownloadClipRequest& request);
+
+private:
+    friend class ClipDownloader;
+
+    /**
+     * @brief Queue a chunk once there is room; called by the reader thread
+     *
+     * @return false if the stream ended first
+     */
+    bool push(grpc::ByteBuffer chunk);
+
+    /**
+     * @brief Wait until every queued chunk is written
+     *
+     * @return false if the stream ended first
+     */
+    bool drain();
+
+    /**
+     * @brief Wait until `due`, for the byte rate cap
+     *
+     * @return false if the stream ended first
+     */
+    bool hold_until(std::chrono::steady_clock::time_point due);
+
+    /**
+     * @brief finish(), and wake the reader thread if it is waiting
+     */
+    void end(const grpc::Status& status);
+
+    /**
+     * @brief Size for the next chunk, from how fast recent writes drained
+     */
+    size_t chunk_bytes() const;
+
+    /**
+     * @brief Wait for a change to the queue, or for the next stall check
+     */
+    void wait_locked(std::unique_lock<std::mutex>& lock);
+
+    bool pop_locked(grpc::ByteBuffer* next) override;
+    size_t queued_locked() const override;
+    void detach() override;
+    void write_done_locked(std::chrono::steady_clock::duration elapsed) override;
+
+    ClipDownloader& downloader_;
+    const DownloadClipRequest request_;
+
+    // Guarded by StreamSubscriber::mutex_
+    std::condition_variable room_;
+    std::deque<grpc::ByteBuffer> queue_;
+    bool writing_ = false;                       // A dequeued chunk's write has not completed
+    size_t chunk_bytes_;
+};
+
+} // namespace dashcam
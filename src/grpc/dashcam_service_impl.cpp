@@ -1,59 +1,134 @@
 #include "dashcam_service_impl.h"
 #include "dashcam/utils/logger.h"
 
+#include <cassert>
+
 namespace dashcam {
 
-grpc::Status DashcamServiceImpl::GetStatus(grpc::ServerContext* context,
-                                          const dashcam::GetStatusRequest* request,
-                                          dashcam::GetStatusResponse* response) {
-    (void)context;  // Suppress unused parameter warning
+DashcamServiceImpl::DashcamServiceImpl(std::shared_ptr<const StorageAccounting> storage_accounting,
+                                       std::shared_ptr<const LiveStatus> live_status,
+                                       std::shared_ptr<SegmentIndex> segments,
+                                       const DashcamServiceConfig& config)
+    : storage_accounting_(std::move(storage_accounting)),
+      live_status_(std::move(live_status)),
+      status_publisher_(config.status, [this](DashcamStatus* status) { fill_status(status); }),
+      preview_publisher_(config.preview),
+      clip_downloader_(std::move(segments), config.downloads) {
+    status_publisher_.start();
+}
+
+DashcamServiceImpl::~DashcamServiceImpl() {
+    status_publisher_.stop();
+}
+
+void DashcamServiceImpl::begin_shutdown() {
+    status_publisher_.stop();
+    preview_publisher_.stop();
+    clip_downloader_.stop();
+}
+
+void DashcamServiceImpl::publish_preview(const PreviewFrameInfo& info, FrameBuffer frame) {
+    preview_publisher_.publish(info, std::move(frame));
+}
+
+bool DashcamServiceImpl::take_preview_keyframe_request(std::string_view camera_id) {
+    return preview_publisher_.take_keyframe_request(camera_id);
+}
+
+StatusPublisherStats DashcamServiceImpl::status_stats() const {
+    return status_publisher_.stats();
+}
+
+std::vector<SubscriberStats> DashcamServiceImpl::status_subscriber_stats() const {
+    return status_publisher_.subscriber_stats();
+}
+
+PreviewPublisherStats DashcamServiceImpl::preview_stats() const {
+    return preview_publisher_.stats();
+}
+
+ClipDownloaderStats DashcamServiceImpl::download_stats() const {
+    return clip_downloader_.stats();
+}
+
+void DashcamServiceImpl::fill_status(DashcamStatus* status) const {
+    assert(status != nullptr);
+    if (live_status_) {
+        // Lock-free: a status poll never makes a capture thread wait
+        const LiveStatusSnapshot live = live_status_->snapshot();
+        status->set_recording(live.recording);
+        status->set_frames_captured(live.frames_captured);
+        status->set_current_fps(live.current_fps);
+        status->set_uptime_seconds(live.uptime_seconds);
+    } else {
+        // Placeholder values until the pipeline reports real status
+        status->set_recording(false);
+        status->set_frames_captured(0);
+        status->set_current_fps(30);
+        status->set_uptime_seconds(0);
+    }
+    fill_storage_usage(status);
+    status->set_current_resolution("1920x1080");
+}
+
+void DashcamServiceImpl::fill_storage_usage(DashcamStatus* status) const {
+    assert(status != nullptr);
+    if (!storage_accounting_) {
+        // Placeholder values until storage is attached; zero free would read as a full card
+        status->set_storage_used_bytes(0);
+        status->set_storage_available_bytes(1000000000); // 1GB
+        return;
+    }
+    const StorageUsage usage = storage_accounting_->usage();
+    status->set_storage_used_bytes(usage.used_bytes);
+    status->set_storage_available_bytes(usage.available_bytes);
+}
+
+grpc::ServerUnaryReactor* DashcamServiceImpl::GetStatus(grpc::CallbackServerContext* context,
+                                                        const dashcam::GetStatusRequest* request,
+                                                        dashcam::GetStatusResponse* response) {
     (void)request;  // Suppress unused parameter warning
     
     LOG_DEBUG("GetStatus called via gRPC");
     
-    // Create a dummy status for testing
-    auto* status = response->mutable_status();
-    status->set_recording(false);
-    status->set_frames_captured(0);
-    status->set_storage_used_bytes(0);
-    status->set_storage_available_bytes(1000000000); // 1GB
-    status->set_current_fps(30);
-    status->set_current_resolution("1920x1080");
-    status->set_uptime_seconds(0);
+    fill_status(response->mutable_status());
     
     response->set_success(true);
     response->set_error_message("");
     
-    return grpc::Status::OK;
+    auto* reactor = context->DefaultReactor();
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
 }
 
-grpc::Status DashcamServiceImpl::GetConfig(grpc::ServerContext* context,
-                                          const dashcam::GetConfigRequest* request,
-                                          dashcam::GetConfigResponse* response) {
-    (void)context;
+grpc::ServerUnaryReactor* DashcamServiceImpl::GetConfig(grpc::CallbackServerContext* context,
+                                                        const dashcam::GetConfigRequest* request,
+                                                        dashcam::GetConfigResponse* response) {
     (void)request;
     
     LOG_DEBUG("GetConfig called via gRPC");
     
-    // Create a dummy config for testing
+    // Placeholders until capture settings are plumbed through, except audio,
+    // which the pipeline reports
     auto* config = response->mutable_config();
     config->set_target_fps(30);
     config->set_resolution("1920x1080");
     config->set_quality(95);
-    config->set_audio_enabled(true);
+    config->set_audio_enabled(live_status_ && live_status_->snapshot().audio_enabled);
     config->set_max_file_size_mb(100);
     config->set_retention_days(7);
     
     response->set_success(true);
     response->set_error_message("");
     
-    return grpc::Status::OK;
+    auto* reactor = context->DefaultReactor();
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
 }
 
-grpc::Status DashcamServiceImpl::UpdateConfig(grpc::ServerContext* context,
-                                             const dashcam::UpdateConfigRequest* request,
-                                             dashcam::UpdateConfigResponse* response) {
-    (void)context;
+grpc::ServerUnaryReactor* DashcamServiceImpl::UpdateConfig(grpc::CallbackServerContext* context,
+                                                           const dashcam::UpdateConfigRequest* request,
+                                                           dashcam::UpdateConfigResponse* response) {
     (void)request;
     
     LOG_DEBUG("UpdateConfig called via gRPC");
@@ -62,13 +137,16 @@ grpc::Status DashcamServiceImpl::UpdateConfig(grpc::ServerContext* context,
     response->set_success(true);
     response->set_error_message("");
     
-    return grpc::Status::OK;
+    status_publisher_.notify(); // Config changes show in the status; push them to viewers now
+
+    auto* reactor = context->DefaultReactor();
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
 }
 
-grpc::Status DashcamServiceImpl::StartRecording(grpc::ServerContext* context,
-                                               const dashcam::StartRecordingRequest* request,
-                                               dashcam::StartRecordingResponse* response) {
-    (void)context;
+grpc::ServerUnaryReactor* DashcamServiceImpl::StartRecording(grpc::CallbackServerContext* context,
+                                                             const dashcam::StartRecordingRequest* request,
+                                                             dashcam::StartRecordingResponse* response) {
     (void)request;
     
     LOG_DEBUG("StartRecording called via gRPC");
@@ -76,62 +154,88 @@ grpc::Status DashcamServiceImpl::StartRecording(grpc::ServerContext* context,
     response->set_success(true);
     response->set_error_message("");
     
-    return grpc::Status::OK;
+    status_publisher_.notify(); // Recording state changed; push it to viewers now
+
+    auto* reactor = context->DefaultReactor();
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
 }
 
-grpc::Status DashcamServiceImpl::StopRecording(grpc::ServerContext* context,
-                                              const dashcam::StopRecordingRequest* request,
-                                              dashcam::StopRecordingResponse* response) {
-    (void)context;
+grpc::ServerUnaryReactor* DashcamServiceImpl::StopRecording(grpc::CallbackServerContext* context,
+                                                            const dashcam::StopRecordingRequest* request,
+                                                            dashcam::StopRecordingResponse* response) {
     (void)request;
     
     LOG_DEBUG("StopRecording called via gRPC");
     
-    // Create a dummy final status
+    // Same counters a status poll reports; only the recording flag is final already
     auto* status = response->mutable_final_status();
+    fill_status(status);
     status->set_recording(false);
-    status->set_frames_captured(100);
-    status->set_storage_used_bytes(50000000); // 50MB
-    status->set_storage_available_bytes(950000000); // 950MB
-    status->set_current_fps(0);
-    status->set_current_resolution("");
-    status->set_uptime_seconds(300); // 5 minutes
     
     response->set_success(true);
     response->set_error_message("");
     
-    return grpc::Status::OK;
+    status_publisher_.notify(); // Recording state changed; push it to viewers now
+
+    auto* reactor = context->DefaultReactor();
+    reactor->Finish(grpc::Status::OK);
+    return reactor;
 }
 
-grpc::Status DashcamServiceImpl::StreamStatus(grpc::ServerContext* context,
-                                             const dashcam::GetStatusRequest* request,
-                                             grpc::ServerWriter<dashcam::DashcamStatus>* writer) {
-    (void)context;
-    (void)request;
-    
-    LOG_DEBUG("StreamStatus called via gRPC");
-    
-    // For testing, send a few status updates then exit
-    for (int i = 0; i < 3; ++i) {
-        dashcam::DashcamStatus status;
-        status.set_recording(true);
-        status.set_frames_captured(i * 10);
-        status.set_storage_used_bytes(i * 1000000);
-        status.set_storage_available_bytes(1000000000 - (i * 1000000));
-        status.set_current_fps(30);
-        status.set_current_resolution("1920x1080");
-        status.set_uptime_seconds(i * 60);
-        
-        if (!writer->Write(status)) {
-            // Client disconnected
-            break;
-        }
-        
-        // Small delay to simulate real-time updates
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+grpc::ServerWriteReactor<grpc::ByteBuffer>* DashcamServiceImpl::StreamStatus(
+    grpc::CallbackServerContext* context,
+    const grpc::ByteBuffer* request) {
+    assert(request != nullptr); // Tiger Style: assert preconditions
+
+    // Raw method: the request arrives as bytes
+    GetStatusRequest parsed;
+    if (!parse_request(*request, &parsed)) {
+        return new RejectedStream(
+            grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Malformed GetStatusRequest"));
     }
-    
-    return grpc::Status::OK;
+
+    LOG_DEBUG("StreamStatus called via gRPC (delta updates: {})", parsed.delta_updates());
+    return status_publisher_.subscribe(context, parsed.delta_updates());
+}
+
+grpc::ServerWriteReactor<grpc::ByteBuffer>* DashcamServiceImpl::StreamPreview(
+    grpc::CallbackServerContext* context,
+    const grpc::ByteBuffer* request) {
+    assert(request != nullptr); // Tiger Style: assert preconditions
+
+    StreamPreviewRequest parsed;
+    if (!parse_request(*request, &parsed)) {
+        return new RejectedStream(
+            grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Malformed StreamPreviewRequest"));
+    }
+    if (parsed.camera_id().empty()) {
+        return new RejectedStream(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "camera_id is required"));
+    }
+
+    LOG_DEBUG("StreamPreview called via gRPC (camera: {}, max_fps: {}, max_width: {})",
+              parsed.camera_id(), parsed.max_fps(), parsed.max_width());
+    PreviewRequest preview;
+    preview.camera_id = parsed.camera_id();
+    preview.max_fps = parsed.max_fps();
+    preview.max_width = parsed.max_width();
+    return preview_publisher_.subscribe(context, preview);
+}
+
+grpc::ServerWriteReactor<grpc::ByteBuffer>* DashcamServiceImpl::DownloadClip(
+    grpc::CallbackServerContext* context,
+    const grpc::ByteBuffer* request) {
+    assert(request != nullptr); // Tiger Style: assert preconditions
+
+    DownloadClipRequest parsed;
+    if (!parse_request(*request, &parsed)) {
+        return new RejectedStream(
+            grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Malformed DownloadClipRequest"));
+    }
+
+    LOG_DEBUG("DownloadClip called via gRPC (segments: {}, camera: {}, offset: {})",
+              parsed.segment_ids_size(), parsed.camera_id(), parsed.offset());
+    return clip_downloader_.download(context, parsed);
 }
 
 } // namespace dashcam
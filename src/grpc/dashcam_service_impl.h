@@ -3,69 +3,213 @@
 /**
  * @file dashcam_service_impl.h
  * @brief Implementation of the DashcamService gRPC interface
- * 
+ *
  * This file provides concrete implementations of the gRPC services defined
  * in dashcam.proto. These implementations handle the actual business logic
  * for the dashcam system.
+ *
+ * The service uses the gRPC callback API. A handler returns a reactor
+ * instead of blocking a server thread, so an open StreamStatus stream
+ * costs memory, not a thread; thousands of monitoring clients are served
+ * by gRPC's small fixed pool of polling threads. StreamStatus and
+ * StreamPreview are raw methods: every stream is sent its publisher's
+ * pre-serialized bytes. DownloadClip is raw too, so its chunks reference
+ * mapped segment pages instead of copying them into a message.
  */
 
 #include "dashcam.grpc.pb.h"
+#include "clip_downloader.h"
+#include "dashcam/storage/segment_index.h"
+#include "dashcam/storage/storage_accounting.h"
+#include "dashcam/utils/live_status.h"
+#include "preview_publisher.h"
+#include "status_publisher.h"
 #include <grpcpp/grpcpp.h>
-#include <thread>
-#include <chrono>
+#include <atomic>
+#include <memory>
+#include <string_view>
+#include <vector>
 
 namespace dashcam {
 
+/**
+ * @brief Service behaviour that is not part of the RPC contract
+ */
+struct DashcamServiceConfig {
+    StatusPublisherConfig status;            // StreamStatus cadence
+    PreviewPublisherConfig preview;          // StreamPreview limits
+    ClipDownloaderConfig downloads;          // DownloadClip concurrency and pacing
+};
+
+/**
+ * @brief Unary methods on the callback API, the streaming methods on raw bytes
+ */
+using DashcamCallbackBase = DashcamService::WithCallbackMethod_GetStatus<
+    DashcamService::WithCallbackMethod_GetConfig<
+        DashcamService::WithCallbackMethod_UpdateConfig<
+            DashcamService::WithCallbackMethod_StartRecording<
+                DashcamService::WithCallbackMethod_StopRecording<
+                    DashcamService::WithRawCallbackMethod_StreamStatus<
+                        DashcamService::WithRawCallbackMethod_StreamPreview<
+                            DashcamService::WithRawCallbackMethod_DownloadClip<
+                                DashcamService::Service>>>>>>>>;
+
 /**
  * @brief Implementation of the main DashcamService
- * 
+ *
  * This class provides concrete implementations for all RPC methods
  * defined in the DashcamService proto service. Each method handles
  * the corresponding dashcam functionality.
+ *
+ * Threading: handlers and reactors run on gRPC's callback threads and must
+ * never block. begin_shutdown(), publish_preview() and the stats accessors
+ * may be called from any thread.
  */
-class DashcamServiceImpl final : public DashcamService::Service {
+class DashcamServiceImpl final : public DashcamCallbackBase {
 public:
+    /**
+     * @brief Construct the service
+     *
+     * @param storage_accounting Running storage counters; status replies read
+     *        them without any filesystem I/O. When null, placeholder values
+     *        are reported (1 GB available).
+     * @param live_status Capture status published by the pipeline; read
+     *        without a lock. When null, placeholder values are reported and
+     *        GetConfig reports audio as disabled.
+     * @param segments Recorded segments served by DownloadClip, pinned while
+     *        they download. When null, DownloadClip fails with
+     *        FAILED_PRECONDITION.
+     * @param config Stream cadence, preview and download limits
+     *
+     * @pre config.status.interval > 0
+     */
+    explicit DashcamServiceImpl(
+        std::shared_ptr<const StorageAccounting> storage_accounting = nullptr,
+        std::shared_ptr<const LiveStatus> live_status = nullptr,
+        std::shared_ptr<SegmentIndex> segments = nullptr,
+        const DashcamServiceConfig& config = DashcamServiceConfig{});
+
+    ~DashcamServiceImpl() override;
+
+    // Tiger Style: No copy/move, open streams hold references
+    DashcamServiceImpl(const DashcamServiceImpl&) = delete;
+    DashcamServiceImpl& operator=(const DashcamServiceImpl&) = delete;
+    DashcamServiceImpl(DashcamServiceImpl&&) = delete;
+    DashcamServiceImpl& operator=(DashcamServiceImpl&&) = delete;
+
     /**
      * @brief Get current system status
      */
-    grpc::Status GetStatus(grpc::ServerContext* context,
-                          const GetStatusRequest* request,
-                          GetStatusResponse* response) override;
-    
+    grpc::ServerUnaryReactor* GetStatus(grpc::CallbackServerContext* context,
+                                        const GetStatusRequest* request,
+                                        GetStatusResponse* response) override;
+
     /**
      * @brief Get current configuration
      */
-    grpc::Status GetConfig(grpc::ServerContext* context,
-                          const GetConfigRequest* request,
-                          GetConfigResponse* response) override;
-    
+    grpc::ServerUnaryReactor* GetConfig(grpc::CallbackServerContext* context,
+                                        const GetConfigRequest* request,
+                                        GetConfigResponse* response) override;
+
     /**
      * @brief Update system configuration
      */
-    grpc::Status UpdateConfig(grpc::ServerContext* context,
-                             const UpdateConfigRequest* request,
-                             UpdateConfigResponse* response) override;
-    
+    grpc::ServerUnaryReactor* UpdateConfig(grpc::CallbackServerContext* context,
+                                           const UpdateConfigRequest* request,
+                                           UpdateConfigResponse* response) override;
+
     /**
      * @brief Start recording with current or provided config
      */
-    grpc::Status StartRecording(grpc::ServerContext* context,
-                               const StartRecordingRequest* request,
-                               StartRecordingResponse* response) override;
-    
+    grpc::ServerUnaryReactor* StartRecording(grpc::CallbackServerContext* context,
+                                             const StartRecordingRequest* request,
+                                             StartRecordingResponse* response) override;
+
     /**
      * @brief Stop recording
      */
-    grpc::Status StopRecording(grpc::ServerContext* context,
-                              const StopRecordingRequest* request,
-                              StopRecordingResponse* response) override;
-    
+    grpc::ServerUnaryReactor* StopRecording(grpc::CallbackServerContext* context,
+                                            const StopRecordingRequest* request,
+                                            StopRecordingResponse* response) override;
+
     /**
      * @brief Stream status updates for real-time monitoring
+     *
+     * Subscribes the call to the shared StatusPublisher: the latest snapshot
+     * is sent at once, then every published one until the client cancels
+     * or the service shuts down. With delta_updates set in the request, the
+     * stream sends only changed fields after its first snapshot.
+     */
+    grpc::ServerWriteReactor<grpc::ByteBuffer>* StreamStatus(
+        grpc::CallbackServerContext* context,
+        const grpc::ByteBuffer* request) override;
+
+    /**
+     * @brief Stream one camera's live preview
+     *
+     * Subscribes the call to the shared PreviewPublisher; frames start at
+     * the camera's next keyframe. An empty camera_id is INVALID_ARGUMENT.
+     */
+    grpc::ServerWriteReactor<grpc::ByteBuffer>* StreamPreview(
+        grpc::CallbackServerContext* context,
+        const grpc::ByteBuffer* request) override;
+
+    /**
+     * @brief Download recorded segments as one resumable byte stream
+     *
+     * Segments are named by id or by camera and time range. Chunks are read
+     * on the downloader's own threads; a request while every one is busy is
+     * RESOURCE_EXHAUSTED.
      */
-    grpc::Status StreamStatus(grpc::ServerContext* context,
-                             const GetStatusRequest* request,
-                             grpc::ServerWriter<DashcamStatus>* writer) override;
+    grpc::ServerWriteReactor<grpc::ByteBuffer>* DownloadClip(
+        grpc::CallbackServerContext* context,
+        const grpc::ByteBuffer* request) override;
+
+    /**
+     * @brief Hand an encoded preview frame to every StreamPreview viewer
+     */
+    void publish_preview(const PreviewFrameInfo& info, FrameBuffer frame);
+
+    /**
+     * @brief Whether the preview encoder should force a keyframe for a new viewer
+     */
+    bool take_preview_keyframe_request(std::string_view camera_id);
+
+    /**
+     * @brief Finish every open stream now
+     *
+     * Call before grpc::Server::Shutdown() so open streams end cleanly
+     * instead of waiting for the shutdown deadline to cancel them.
+     */
+    void begin_shutdown();
+
+    StatusPublisherStats status_stats() const;
+
+    /**
+     * @brief Lag and drop counters of every open StreamStatus stream
+     */
+    std::vector<SubscriberStats> status_subscriber_stats() const;
+
+    PreviewPublisherStats preview_stats() const;
+
+    ClipDownloaderStats download_stats() const;
+
+private:
+    /**
+     * @brief Fill the current status; shared by GetStatus and the publisher
+     */
+    void fill_status(DashcamStatus* status) const;
+
+    /**
+     * @brief Fill storage fields from the accounting counters (no I/O)
+     */
+    void fill_storage_usage(DashcamStatus* status) const;
+
+    const std::shared_ptr<const StorageAccounting> storage_accounting_;
+    const std::shared_ptr<const LiveStatus> live_status_;
+    StatusPublisher status_publisher_;
+    PreviewPublisher preview_publisher_;
+    ClipDownloader clip_downloader_;
 };
 
 } // namespace dashcam
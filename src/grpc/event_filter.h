@@ -0,0 +1,133 @@
+#pragma once
+
+/**
+ * @file event_filter.h
+ * @brief The event_types / camera_id filter of a GetEventsRequest
+ *
+ * Shared by GetEvents queries against the EventStore and by StreamEvents
+ * streams, so both RPCs select events the same way. Internally the filter
+ * is resolved to symbols once (SymbolFilter), and each event is then
+ * checked with integer compares.
+ */
+
+#include "dashcam.pb.h"
+#include "dashcam/utils/symbol_table.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace dashcam {
+
+/**
+ * @brief Which events a caller wants; empty fields match everything
+ */
+struct EventFilter {
+    std::vector<std::string> event_types;    // Any of these; empty: every type
+    std::string camera_id;                   // Only this camera; empty: every camera
+
+    static EventFilter from_request(const GetEventsRequest& request) {
+        EventFilter filter;
+        filter.event_types.assign(request.event_types().begin(), request.event_types().end());
+        filter.camera_id = request.camera_id();
+        return filter;
+    }
+
+    bool matches(const LogEvent& event) const {
+        if (!camera_id.empty() && event.camera_id() != camera_id) {
+            return false;
+        }
+        return event_types.empty() ||
+               std::find(event_types.begin(), event_types.end(), event.event_type()) !=
+                   event_types.end();
+    }
+};
+
+/**
+ * @brief An EventFilter resolved against a SymbolTable
+ *
+ * Names the table did not hold at resolution are kept as strings. Every
+ * symbol issued before then is known not to match them, so only events
+ * with a newer symbol pay a string compare; a stream filtering on a type
+ * that appears later still sees it.
+ */
+class SymbolFilter {
+public:
+    /**
+     * @brief Matches every event
+     */
+    SymbolFilter() = default;
+
+    /**
+     * @brief Resolve without adding names to the table
+     *
+     * @pre symbols outlives this filter
+     */
+    SymbolFilter(const EventFilter& filter, const SymbolTable& symbols)
+        : symbols_(&symbols), watermark_(symbols.size()), any_type_(filter.event_types.empty()) {
+        for (const std::string& type : filter.event_types) {
+            const std::optional<Symbol> symbol = symbols.find(type);
+            if (!symbol) {
+                unresolved_types_.push_back(type);
+            } else if (std::find(types_.begin(), types_.end(), *symbol) == types_.end()) {
+                types_.push_back(*symbol);
+            }
+        }
+        if (!filter.camera_id.empty()) {
+            any_camera_ = false;
+            const std::optional<Symbol> symbol = symbols.find(filter.camera_id);
+            if (symbol) {
+                camera_ = *symbol;
+            } else {
+                unresolved_camera_ = filter.camera_id;
+            }
+        }
+    }
+
+    bool matches(Symbol event_type, Symbol camera_id) const {
+        if (!any_camera_) {
+            if (unresolved_camera_.empty() ? camera_id != camera_ : !is_named(camera_id, unresolved_camera_)) {
+                return false;
+            }
+        }
+        if (any_type_ || std::find(types_.begin(), types_.end(), event_type) != types_.end()) {
+            return true;
+        }
+        return std::any_of(unresolved_types_.begin(), unresolved_types_.end(),
+                           [&](const std::string& type) { return is_named(event_type, type); });
+    }
+
+    bool any_type() const { return any_type_; }
+    bool any_camera() const { return any_camera_; }
+
+    /**
+     * @brief The filter's types that were interned, each once
+     */
+    const std::vector<Symbol>& types() const { return types_; }
+
+    /**
+     * @brief The camera, if the filter names one that was interned
+     */
+    std::optional<Symbol> camera() const {
+        if (any_camera_ || !unresolved_camera_.empty()) {
+            return std::nullopt;
+        }
+        return camera_;
+    }
+
+private:
+    bool is_named(Symbol symbol, const std::string& name) const {
+        return static_cast<uint32_t>(symbol) >= watermark_ && symbols_->name(symbol) == name;
+    }
+
+    const SymbolTable* symbols_ = nullptr;
+    uint32_t watermark_ = 0;                 // Table size at resolution
+    bool any_type_ = true;
+    bool any_camera_ = true;
+    std::vector<Symbol> types_;
+    std::vector<std::string> unresolved_types_;
+    Symbol camera_ = Symbol::EMPTY;
+    std::string unresolved_camera_;
+};
+
+} // namespace dashcam
@@ -0,0 +1,187 @@
+#include "event_publisher.h"
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+
+namespace dashcam {
+
+namespace {
+
+grpc::ByteBuffer to_buffer(const std::string& bytes) {
+    grpc::Slice slice(bytes);
+    return grpc::ByteBuffer(&slice, 1);
+}
+
+} // namespace
+
+EventPublisher::EventPublisher(const EventPublisherConfig& config) : config_(config) {
+    // Tiger Style: assert preconditions
+    assert(config_.queue_capacity >= 2);
+    assert(config_.max_write_stall.count() > 0);
+}
+
+EventPublisher::~EventPublisher() {
+    stop();
+}
+
+void EventPublisher::publish(const LogEvent& event) {
+    SymbolTable& symbols = SymbolTable::global();
+    const std::optional<Symbol> event_type = symbols.intern(event.event_type());
+    const std::optional<Symbol> camera_id = symbols.intern(event.camera_id());
+    if (!event_type || !camera_id) {
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    const grpc::ByteBuffer buffer = to_buffer(event.SerializeAsString());
+
+    std::vector<EventSubscriber*> targets;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        published_.fetch_add(1, std::memory_order_relaxed);
+        // Queueing under the lock keeps every stream in publish order
+        targets.reserve(subscribers_.size());
+        for (EventSubscriber* subscriber : subscribers_) {
+            if (subscriber->filter_.matches(*event_type, *camera_id)) {
+                subscriber->enqueue(buffer, event.timestamp_ms());
+                subscriber->ref();
+                targets.push_back(subscriber);
+            }
+        }
+    }
+
+    // Without the lock: a write may complete inline and end the stream
+    for (EventSubscriber* subscriber : targets) {
+        subscriber->pump();
+        subscriber->unref();
+    }
+}
+
+grpc::ServerWriteReactor<grpc::ByteBuffer>* EventPublisher::subscribe(
+    grpc::CallbackServerContext* context,
+    const EventFilter& filter) {
+    auto* subscriber = new EventSubscriber(*this, context, filter);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!stopped_) {
+            subscribers_.push_back(subscriber);
+            return subscriber;
+        }
+    }
+    subscriber->finish(grpc::Status::OK);
+    return subscriber;
+}
+
+void EventPublisher::stop() {
+    std::vector<EventSubscriber*> open;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_) {
+            return;
+        }
+        stopped_ = true;
+        open.swap(subscribers_);
+        for (EventSubscriber* subscriber : open) {
+            subscriber->ref();
+        }
+    }
+
+    for (EventSubscriber* subscriber : open) {
+        subscriber->finish(grpc::Status::OK);
+        subscriber->unref();
+    }
+}
+
+EventPublisherStats EventPublisher::stats() const {
+    EventPublisherStats stats;
+    stats.published = published_.load(std::memory_order_relaxed);
+    stats.rejected = rejected_.load(std::memory_order_relaxed);
+    stats.writes_started = streams_.writes_started.load(std::memory_order_relaxed);
+    stats.dropped = streams_.dropped.load(std::memory_order_relaxed);
+    stats.gaps = gaps_.load(std::memory_order_relaxed);
+    stats.disconnected = streams_.disconnected.load(std::memory_order_relaxed);
+    stats.bytes_written = streams_.bytes_written.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.subscribers = subscribers_.size();
+    return stats;
+}
+
+std::vector<SubscriberStats> EventPublisher::subscriber_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<SubscriberStats> stats;
+    stats.reserve(subscribers_.size());
+    for (const EventSubscriber* subscriber : subscribers_) {
+        stats.push_back(subscriber->stats());
+    }
+    return stats;
+}
+
+void EventPublisher::remove(EventSubscriber* subscriber) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = std::find(subscribers_.begin(), subscribers_.end(), subscriber);
+    if (it != subscribers_.end()) {
+        // Order does not matter; swap-and-pop keeps removal O(1) after the find
+        *it = subscribers_.back();
+        subscribers_.pop_back();
+    }
+}
+
+EventSubscriber::EventSubscriber(EventPublisher& publisher,
+                                 grpc::CallbackServerContext* context,
+                                 const EventFilter& filter)
+    : StreamSubscriber(context, publisher.config_.max_write_stall, publisher.streams_),
+      publisher_(publisher),
+      filter_(filter, SymbolTable::global()) {}
+
+void EventSubscriber::enqueue(const grpc::ByteBuffer& event, int64_t timestamp_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (finishing_locked()) {
+        return;
+    }
+    const size_t capacity = publisher_.config_.queue_capacity;
+
+    // After a loss, the marker must go in ahead of the next event kept
+    const size_t needed = gap_dropped_ > 0 ? 2 : 1;
+    if (queue_.size() + needed > capacity) {
+        if (gap_dropped_ == 0) {
+            gap_first_ms_ = timestamp_ms;
+        }
+        ++gap_dropped_;
+        count_dropped(1);
+        return;
+    }
+    if (gap_dropped_ > 0) {
+        queue_.push_back(gap_marker_locked());
+        publisher_.gaps_.fetch_add(1, std::memory_order_relaxed);
+        gap_dropped_ = 0;
+    }
+    queue_.push_back(event);
+}
+
+grpc::ByteBuffer EventSubscriber::gap_marker_locked() const {
+    LogEvent marker;
+    marker.set_timestamp_ms(gap_first_ms_);
+    marker.set_event_type(EVENTS_DROPPED_EVENT_TYPE);
+    marker.set_message(std::to_string(gap_dropped_) + " events dropped: stream fell behind");
+    (*marker.mutable_metadata())["dropped"] = std::to_string(gap_dropped_);
+    return to_buffer(marker.SerializeAsString());
+}
+
+bool EventSubscriber::pop_locked(grpc::ByteBuffer* next) {
+    if (queue_.empty()) {
+        return false;
+    }
+    *next = std::move(queue_.front());
+    queue_.pop_front();
+    return true;
+}
+
+size_t EventSubscriber::queued_locked() const {
+    return queue_.size();
+}
+
+void EventSubscriber::detach() {
+    publisher_.remove(this);
+}
+
+} // namespace dashcam
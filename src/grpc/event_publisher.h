@@ -0,0 +1,166 @@
+#pragma once
+
+/**
+ * @file event_publisher.h
+ * @brief Live LogEvent fan-out to StreamEvents streams with bounded queues
+ *
+ * Every event matters to a viewer, so unlike status updates they cannot be
+ * coalesced to the newest one. Each stream instead queues up to
+ * `queue_capacity` events behind its write in flight. When a slow client
+ * fills that queue, further events for it are dropped and counted. As soon
+ * as there is room again, a gap marker event ("events_dropped", with the
+ * count) is queued ahead of the next event, so the client knows exactly
+ * where its view is incomplete. A client that stops reading altogether is
+ * cancelled once its write has stalled for `max_write_stall`.
+ *
+ * Events are serialized once and the same buffer is queued to every stream
+ * whose filter it matches. Filters are resolved to symbols when a stream
+ * opens, and an event's type and camera are interned once per publish(),
+ * so matching it against every stream compares integers.
+ */
+
+#include "dashcam.pb.h"
+#include "event_filter.h"
+#include "stream_subscriber.h"
+
+#include <grpcpp/grpcpp.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace dashcam {
+
+class EventSubscriber;
+
+// event_type of the marker queued where a stream lost events
+inline constexpr const char* EVENTS_DROPPED_EVENT_TYPE = "events_dropped";
+
+/**
+ * @brief Per-stream limits
+ */
+struct EventPublisherConfig {
+    size_t queue_capacity = 256;                     // Events a stream holds behind its write in flight
+    std::chrono::milliseconds max_write_stall{10000}; // Then a stream that stopped reading is cancelled
+};
+
+/**
+ * @brief Counters for monitoring the fan-out
+ */
+struct EventPublisherStats {
+    uint64_t published = 0;
+    uint64_t rejected = 0;             // A name could not be interned; sent to no stream
+    uint64_t subscribers = 0;
+    uint64_t writes_started = 0;
+    uint64_t dropped = 0;              // Events a stream's full queue could not take
+    uint64_t gaps = 0;                 // Gap markers queued
+    uint64_t disconnected = 0;
+    uint64_t bytes_written = 0;        // Message payloads, before gRPC framing
+};
+
+/**
+ * @brief Fan-out of live events to every StreamEvents stream
+ *
+ * Threading: publish(), stop() and the accessors from any thread. Streams
+ * are gRPC reactors and run on gRPC's callback threads. Concurrent
+ * publish() calls queue events in the same order on every stream.
+ */
+class EventPublisher {
+public:
+    /**
+     * @pre config.queue_capacity >= 2 (an event and a gap marker),
+     *      config.max_write_stall > 0
+     */
+    explicit EventPublisher(const EventPublisherConfig& config = EventPublisherConfig{});
+
+    ~EventPublisher();
+
+    // Tiger Style: No copy/move, subscribers hold references
+    EventPublisher(const EventPublisher&) = delete;
+    EventPublisher& operator=(const EventPublisher&) = delete;
+    EventPublisher(EventPublisher&&) = delete;
+    EventPublisher& operator=(EventPublisher&&) = delete;
+
+    /**
+     * @brief Queue an event to every open stream; never waits for a client
+     *
+     * An event whose type or camera cannot be interned is rejected.
+     */
+    void publish(const LogEvent& event);
+
+    /**
+     * @brief Open a stream for one StreamEvents call
+     *
+     * The stream gets every event published from now on that matches
+     * `filter`, until the client cancels or stop() is called. Gap markers
+     * are sent whatever the filter. gRPC owns the reactor.
+     */
+    grpc::ServerWriteReactor<grpc::ByteBuffer>* subscribe(grpc::CallbackServerContext* context,
+                                                          const EventFilter& filter = EventFilter{});
+
+    /**
+     * @brief Finish every open stream with OK
+     *
+     * Safe to call more than once. Streams opened afterwards finish at once.
+     */
+    void stop();
+
+    EventPublisherStats stats() const;
+
+    /**
+     * @brief Lag and drop counters of every open stream
+     */
+    std::vector<SubscriberStats> subscriber_stats() const;
+
+private:
+    friend class EventSubscriber;
+
+    void remove(EventSubscriber* subscriber);
+
+    const EventPublisherConfig config_;
+
+    mutable std::mutex mutex_;
+    std::vector<EventSubscriber*> subscribers_;
+    bool stopped_ = false;
+
+    std::atomic<uint64_t> published_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> gaps_{0};
+    StreamCounters streams_;
+};
+
+/**
+ * @brief Server side of one StreamEvents call
+ */
+class EventSubscriber final : public StreamSubscriber {
+public:
+    EventSubscriber(EventPublisher& publisher, grpc::CallbackServerContext* context, const EventFilter& filter);
+
+private:
+    friend class EventPublisher;
+
+    /**
+     * @brief Queue an event, or drop it if the queue is full
+     *
+     * Called with the publisher lock held; does not start a write.
+     */
+    void enqueue(const grpc::ByteBuffer& event, int64_t timestamp_ms);
+
+    bool pop_locked(grpc::ByteBuffer* next) override;
+    size_t queued_locked() const override;
+    void detach() override;
+
+    grpc::ByteBuffer gap_marker_locked() const;
+
+    EventPublisher& publisher_;
+    const SymbolFilter filter_;
+
+    // Guarded by StreamSubscriber::mutex_
+    std::deque<grpc::ByteBuffer> queue_;
+    uint64_t gap_dropped_ = 0;               // Dropped since the last event queued
+    int64_t gap_first_ms_ = 0;               // Timestamp of the first of them
+};
+
+} // namespace dashcam
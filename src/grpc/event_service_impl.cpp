@@ -0,0 +1,182 @@
+#include "event_service_impl.h"
+#include "dashcam/utils/logger.h"
+
+#include <cassert>
+#include <charconv>
+#include <string>
+
+namespace dashcam {
+
+namespace {
+
+// Log page tokens start with this; ring tokens are a bare sequence
+constexpr char LOG_TOKEN_PREFIX = 'L';
+
+/**
+ * @brief Read a ring page token: the decimal sequence of the page's first event
+ */
+bool parse_page_token(const std::string& token, uint64_t* sequence) {
+    const char* end = token.data() + token.size();
+    const auto result = std::from_chars(token.data(), end, *sequence);
+    return result.ec == std::errc() && result.ptr == end && *sequence > 0;
+}
+
+/**
+ * @brief A log page token: "L<timestamp_ms>.<block>.<rank>"
+ */
+std::string format_log_token(const EventLogCursor& cursor) {
+    return LOG_TOKEN_PREFIX + std::to_string(cursor.timestamp_ms) + '.' +
+           std::to_string(cursor.block) + '.' + std::to_string(cursor.rank);
+}
+
+bool parse_log_token(const std::string& token, EventLogCursor* cursor) {
+    const char* at = token.data() + 1;
+    const char* end = token.data() + token.size();
+    auto result = std::from_chars(at, end, cursor->timestamp_ms);
+    if (result.ec != std::errc() || result.ptr == end || *result.ptr != '.') {
+        return false;
+    }
+    result = std::from_chars(result.ptr + 1, end, cursor->block);
+    if (result.ec != std::errc() || result.ptr == end || *result.ptr != '.') {
+        return false;
+    }
+    result = std::from_chars(result.ptr + 1, end, cursor->rank);
+    return result.ec == std::errc() && result.ptr == end && cursor->block > 0;
+}
+
+bool is_log_token(const std::string& token) {
+    return !token.empty() && token.front() == LOG_TOKEN_PREFIX;
+}
+
+} // namespace
+
+DashcamEventServiceImpl::DashcamEventServiceImpl(std::shared_ptr<EventLog> log,
+                                                 const DashcamEventServiceConfig& config)
+    : log_(std::move(log)), store_(config.store), publisher_(config.stream) {}
+
+DashcamEventServiceImpl::~DashcamEventServiceImpl() {
+    publisher_.stop();
+}
+
+void DashcamEventServiceImpl::record(const LogEvent& event) {
+    if (store_.append(event) == 0) {
+        // Its names could not be interned: keep it out of the log and streams too
+        return;
+    }
+    if (log_) {
+        log_->append(event);
+    }
+    publisher_.publish(event);
+}
+
+void DashcamEventServiceImpl::begin_shutdown() {
+    publisher_.stop();
+}
+
+EventStoreStats DashcamEventServiceImpl::store_stats() const {
+    return store_.stats();
+}
+
+EventPublisherStats DashcamEventServiceImpl::stream_stats() const {
+    return publisher_.stats();
+}
+
+std::vector<SubscriberStats> DashcamEventServiceImpl::stream_subscriber_stats() const {
+    return publisher_.subscriber_stats();
+}
+
+grpc::ServerUnaryReactor* DashcamEventServiceImpl::GetEvents(grpc::CallbackServerContext* context,
+                                                             const GetEventsRequest* request,
+                                                             GetEventsResponse* response) {
+    LOG_DEBUG("GetEvents called via gRPC");
+
+    auto* reactor = context->DefaultReactor();
+    if (request->end_timestamp_ms() != 0 &&
+        request->end_timestamp_ms() < request->start_timestamp_ms()) {
+        reactor->Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                     "end_timestamp_ms is before start_timestamp_ms"));
+        return reactor;
+    }
+
+    // A first page goes to the log only if the ring no longer reaches back
+    // to its start; later pages follow their token
+    const std::string& token = request->page_token();
+    const bool from_log =
+        log_ && (token.empty() ? request->start_timestamp_ms() < store_.oldest_ms()
+                               : is_log_token(token));
+    reactor->Finish(from_log ? query_log(*request, response) : query_store(*request, response));
+    return reactor;
+}
+
+grpc::Status DashcamEventServiceImpl::query_store(const GetEventsRequest& request,
+                                                  GetEventsResponse* response) const {
+    EventQuery query;
+    query.start_ms = request.start_timestamp_ms();
+    query.end_ms = request.end_timestamp_ms();
+    query.filter = EventFilter::from_request(request);
+    query.max_events = request.max_events();
+    if (!request.page_token().empty() &&
+        !parse_page_token(request.page_token(), &query.resume_sequence)) {
+        return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Malformed page_token");
+    }
+
+    EventPage page = store_.query(query);
+    response->mutable_events()->Reserve(static_cast<int>(page.events.size()));
+    for (LogEvent& event : page.events) {
+        *response->add_events() = std::move(event);
+    }
+    response->set_has_more(page.has_more);
+    if (page.has_more) {
+        response->set_next_page_token(std::to_string(page.next_sequence));
+    }
+    response->set_success(true);
+    response->set_error_message("");
+    return grpc::Status::OK;
+}
+
+grpc::Status DashcamEventServiceImpl::query_log(const GetEventsRequest& request,
+                                                GetEventsResponse* response) const {
+    assert(log_ != nullptr); // Tiger Style: assert preconditions
+
+    EventLogQuery query;
+    query.start_ms = request.start_timestamp_ms();
+    query.end_ms = request.end_timestamp_ms();
+    EventFilter filter = EventFilter::from_request(request);
+    query.event_types = std::move(filter.event_types);
+    query.camera_id = std::move(filter.camera_id);
+    query.max_events = request.max_events();
+    if (!request.page_token().empty() && !parse_log_token(request.page_token(), &query.resume)) {
+        return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Malformed page_token");
+    }
+
+    EventLogPage page = log_->query(query);
+    response->mutable_events()->Reserve(static_cast<int>(page.events.size()));
+    for (LogEvent& event : page.events) {
+        *response->add_events() = std::move(event);
+    }
+    response->set_has_more(page.has_more);
+    if (page.has_more) {
+        response->set_next_page_token(format_log_token(page.next));
+    }
+    response->set_success(true);
+    response->set_error_message("");
+    return grpc::Status::OK;
+}
+
+grpc::ServerWriteReactor<grpc::ByteBuffer>* DashcamEventServiceImpl::StreamEvents(
+    grpc::CallbackServerContext* context,
+    const grpc::ByteBuffer* request) {
+    assert(request != nullptr); // Tiger Style: assert preconditions
+
+    // Raw method: the request arrives as bytes
+    GetEventsRequest parsed;
+    if (!parse_request(*request, &parsed)) {
+        return new RejectedStream(
+            grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Malformed GetEventsRequest"));
+    }
+
+    LOG_DEBUG("StreamEvents called via gRPC");
+    return publisher_.subscribe(context, EventFilter::from_request(parsed));
+}
+
+} // namespace dashcam
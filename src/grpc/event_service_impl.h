@@ -0,0 +1,124 @@
+#pragma once
+
+/**
+ * @file event_service_impl.h
+ * @brief Implementation of the DashcamEventService gRPC interface
+ *
+ * Every recorded event goes into the EventStore, which answers GetEvents
+ * from its ring and indexes, and to the EventPublisher, which streams it to
+ * every StreamEvents call whose filter it matches. Like DashcamService, the
+ * service runs on the callback API, and StreamEvents is a raw method that
+ * sends each event's bytes serialized once.
+ *
+ * With an EventLog, events are also persisted, and a GetEvents range that
+ * starts before the oldest event in the ring is answered from the log
+ * instead. Page tokens name their source, so every page of a query comes
+ * from the one it started on.
+ */
+
+#include "dashcam.grpc.pb.h"
+#include "dashcam/storage/event_log.h"
+#include "event_publisher.h"
+#include "event_store.h"
+#include <grpcpp/grpcpp.h>
+#include <memory>
+#include <vector>
+
+namespace dashcam {
+
+/**
+ * @brief Ring size, page limits and per-stream limits
+ */
+struct DashcamEventServiceConfig {
+    EventStoreConfig store;                  // GetEvents history
+    EventPublisherConfig stream;             // StreamEvents queues
+};
+
+/**
+ * @brief GetEvents on the callback API, StreamEvents on raw bytes
+ */
+using DashcamEventCallbackBase = DashcamEventService::WithCallbackMethod_GetEvents<
+    DashcamEventService::WithRawCallbackMethod_StreamEvents<DashcamEventService::Service>>;
+
+/**
+ * @brief Implementation of the DashcamEventService
+ *
+ * Threading: handlers and reactors run on gRPC's callback threads. Only a
+ * GetEvents answered from the log reads from disk, at most the blocks of
+ * one page. record(), begin_shutdown() and the stats accessors may be
+ * called from any thread.
+ */
+class DashcamEventServiceImpl final : public DashcamEventCallbackBase {
+public:
+    /**
+     * @param log Optional open EventLog: recorded events are persisted there
+     *            and older ranges are read back from it
+     */
+    explicit DashcamEventServiceImpl(
+        std::shared_ptr<EventLog> log = nullptr,
+        const DashcamEventServiceConfig& config = DashcamEventServiceConfig{});
+
+    ~DashcamEventServiceImpl() override;
+
+    // Tiger Style: No copy/move, open streams hold references
+    DashcamEventServiceImpl(const DashcamEventServiceImpl&) = delete;
+    DashcamEventServiceImpl& operator=(const DashcamEventServiceImpl&) = delete;
+    DashcamEventServiceImpl(DashcamEventServiceImpl&&) = delete;
+    DashcamEventServiceImpl& operator=(DashcamEventServiceImpl&&) = delete;
+
+    /**
+     * @brief Store an event and send it to the matching live streams
+     *
+     * With a log, the event is also buffered for it. Suitable as a
+     * DegradationController::EventSink; never waits for a client. An event
+     * the store rejects because the symbol table is full is dropped
+     * everywhere.
+     */
+    void record(const LogEvent& event);
+
+    /**
+     * @brief Get historical events, one page at a time
+     *
+     * Events in [start_timestamp_ms, end_timestamp_ms) matching the filters,
+     * oldest first. When has_more is set, next_page_token resumes after the
+     * last event returned.
+     */
+    grpc::ServerUnaryReactor* GetEvents(grpc::CallbackServerContext* context,
+                                        const GetEventsRequest* request,
+                                        GetEventsResponse* response) override;
+
+    /**
+     * @brief Stream live events matching the request's filters
+     *
+     * The time range and paging fields are ignored: the stream starts with
+     * the next event recorded.
+     */
+    grpc::ServerWriteReactor<grpc::ByteBuffer>* StreamEvents(
+        grpc::CallbackServerContext* context,
+        const grpc::ByteBuffer* request) override;
+
+    /**
+     * @brief Finish every open stream now
+     *
+     * Call before grpc::Server::Shutdown().
+     */
+    void begin_shutdown();
+
+    EventStoreStats store_stats() const;
+    EventPublisherStats stream_stats() const;
+
+    /**
+     * @brief Lag and drop counters of every open StreamEvents stream
+     */
+    std::vector<SubscriberStats> stream_subscriber_stats() const;
+
+private:
+    grpc::Status query_store(const GetEventsRequest& request, GetEventsResponse* response) const;
+    grpc::Status query_log(const GetEventsRequest& request, GetEventsResponse* response) const;
+
+    const std::shared_ptr<EventLog> log_;
+    EventStore store_;
+    EventPublisher publisher_;
+};
+
+} // namespace dashcam
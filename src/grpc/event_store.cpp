@@ -0,0 +1,265 @@
+#include "event_store.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace dashcam {
+
+namespace {
+
+/**
+ * @brief The part of one index list that falls in a sequence range
+ */
+struct ListRange {
+    std::deque<uint64_t>::const_iterator begin;
+    std::deque<uint64_t>::const_iterator end;
+};
+
+} // namespace
+
+EventStore::EventStore(const EventStoreConfig& config)
+    : config_(config),
+      symbols_(SymbolTable::global()),
+      slots_(config.capacity),
+      latest_ms_(std::numeric_limits<int64_t>::min()) {
+    // Tiger Style: assert preconditions
+    assert(config_.capacity > 0);
+    assert(config_.default_max_events > 0);
+    assert(config_.default_max_events <= config_.max_events_limit);
+}
+
+uint64_t EventStore::append(const LogEvent& event) {
+    // Interned before the lock; a query resolving its filter under the lock
+    // then finds every name stored
+    const std::optional<Symbol> event_type = symbols_.intern(event.event_type());
+    const std::optional<Symbol> camera_id = symbols_.intern(event.camera_id());
+    bool keys_interned = true;
+    for (const auto& entry : event.metadata()) {
+        keys_interned = keys_interned && symbols_.intern(entry.first).has_value();
+    }
+    if (!event_type || !camera_id || !keys_interned) {
+        // Filed under EMPTY it would match the wrong filters
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint64_t sequence = next_sequence_;
+    if (sequence > config_.capacity) {
+        evict_locked(sequence - config_.capacity);
+    }
+
+    // Filing a late event at the newest time keeps the ring sorted
+    if (event.timestamp_ms() < latest_ms_) {
+        reordered_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        latest_ms_ = event.timestamp_ms();
+    }
+
+    Slot& slot = slots_[sequence % config_.capacity];
+    slot.time_ms = latest_ms_;
+    slot.timestamp_ms = event.timestamp_ms();
+    slot.event_type = *event_type;
+    slot.camera_id = *camera_id;
+    slot.message.assign(event.message());
+    // In place: entries still there reuse the evicted event's buffers
+    slot.metadata.resize(static_cast<size_t>(event.metadata().size()));
+    size_t entry = 0;
+    for (const auto& [key, value] : event.metadata()) {
+        // Interned above; names are never removed
+        slot.metadata[entry].first = *symbols_.find(key);
+        slot.metadata[entry].second.assign(value);
+        ++entry;
+    }
+    by_type_[*event_type].push_back(sequence);
+    if (*camera_id != Symbol::EMPTY) {
+        by_camera_[*camera_id].push_back(sequence);
+    }
+
+    ++next_sequence_;
+    appended_.fetch_add(1, std::memory_order_relaxed);
+    return sequence;
+}
+
+EventPage EventStore::query(const EventQuery& query) const {
+    // Tiger Style: assert preconditions
+    assert(query.end_ms == 0 || query.end_ms >= query.start_ms);
+
+    const uint32_t requested =
+        query.max_events == 0 ? config_.default_max_events : query.max_events;
+    const size_t limit = std::min(requested, config_.max_events_limit);
+    queries_.fetch_add(1, std::memory_order_relaxed);
+
+    EventPage page;
+    uint64_t scanned = 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Under the lock: a name the table does not hold now is on no stored event
+    const SymbolFilter filter(query.filter, symbols_);
+    if ((!filter.any_type() && filter.types().empty()) ||
+        (!filter.any_camera() && !filter.camera())) {
+        return page;
+    }
+
+    // The time range as a sequence range: two binary searches over the ring
+    const uint64_t first =
+        std::max(first_at_or_after_locked(query.start_ms), query.resume_sequence);
+    const uint64_t last =
+        query.end_ms == 0 ? next_sequence_ : first_at_or_after_locked(query.end_ms);
+
+    // Returns false once the page is full and the next match is known
+    const auto visit = [&](uint64_t sequence) {
+        ++scanned;
+        const Slot& slot = slot_locked(sequence);
+        if (!filter.matches(slot.event_type, slot.camera_id)) {
+            return true;
+        }
+        if (page.events.size() == limit) {
+            page.has_more = true;
+            page.next_sequence = sequence;
+            return false;
+        }
+        page.events.push_back(materialize(slot));
+        return true;
+    };
+
+    const auto in_range = [first, last](const SequenceList& list) {
+        return ListRange{std::lower_bound(list.begin(), list.end(), first),
+                         std::lower_bound(list.begin(), list.end(), last)};
+    };
+
+    std::vector<ListRange> type_ranges;
+    size_t type_candidates = 0;
+    if (first < last) {
+        for (const Symbol type : filter.types()) {
+            const auto it = by_type_.find(type);
+            if (it == by_type_.end()) {
+                continue; // No such events
+            }
+            const ListRange range = in_range(it->second);
+            type_candidates += static_cast<size_t>(range.end - range.begin);
+            type_ranges.push_back(range);
+        }
+    }
+
+    ListRange camera_range{};
+    bool use_camera = false;
+    if (first < last && !filter.any_camera()) {
+        const auto it = by_camera_.find(*filter.camera());
+        if (it != by_camera_.end()) {
+            camera_range = in_range(it->second);
+        }
+        // With both filters, walk whichever index has fewer candidates
+        const size_t camera_candidates = static_cast<size_t>(camera_range.end - camera_range.begin);
+        use_camera = filter.any_type() || camera_candidates < type_candidates;
+    }
+
+    if (first >= last) {
+        // Empty range
+    } else if (use_camera) {
+        for (auto it = camera_range.begin; it != camera_range.end && visit(*it); ++it) {
+        }
+    } else if (!filter.any_type()) {
+        // Merge the per-type lists back into sequence (time) order
+        while (true) {
+            ListRange* next = nullptr;
+            for (ListRange& range : type_ranges) {
+                if (range.begin != range.end && (next == nullptr || *range.begin < *next->begin)) {
+                    next = &range;
+                }
+            }
+            if (next == nullptr || !visit(*next->begin)) {
+                break;
+            }
+            ++next->begin;
+        }
+    } else {
+        for (uint64_t sequence = first; sequence < last && visit(sequence); ++sequence) {
+        }
+    }
+
+    scanned_.fetch_add(scanned, std::memory_order_relaxed);
+    returned_.fetch_add(page.events.size(), std::memory_order_relaxed);
+    return page;
+}
+
+int64_t EventStore::oldest_ms() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (next_sequence_ == 1) {
+        return std::numeric_limits<int64_t>::max();
+    }
+    return slot_locked(oldest_locked()).time_ms;
+}
+
+EventStoreStats EventStore::stats() const {
+    EventStoreStats stats;
+    stats.appended = appended_.load(std::memory_order_relaxed);
+    stats.evicted = evicted_.load(std::memory_order_relaxed);
+    stats.reordered = reordered_.load(std::memory_order_relaxed);
+    stats.rejected = rejected_.load(std::memory_order_relaxed);
+    stats.queries = queries_.load(std::memory_order_relaxed);
+    stats.scanned = scanned_.load(std::memory_order_relaxed);
+    stats.returned = returned_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.stored = next_sequence_ - oldest_locked();
+    return stats;
+}
+
+const EventStore::Slot& EventStore::slot_locked(uint64_t sequence) const {
+    assert(sequence >= oldest_locked() && sequence < next_sequence_);
+    return slots_[sequence % config_.capacity];
+}
+
+uint64_t EventStore::oldest_locked() const {
+    return next_sequence_ > config_.capacity ? next_sequence_ - config_.capacity : 1;
+}
+
+uint64_t EventStore::first_at_or_after_locked(int64_t time_ms) const {
+    uint64_t low = oldest_locked();
+    uint64_t high = next_sequence_;
+    while (low < high) {
+        const uint64_t middle = low + (high - low) / 2;
+        if (slots_[middle % config_.capacity].time_ms < time_ms) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+void EventStore::evict_locked(uint64_t sequence) {
+    const Slot& slot = slots_[sequence % config_.capacity];
+    unindex(by_type_, slot.event_type, sequence);
+    if (slot.camera_id != Symbol::EMPTY) {
+        unindex(by_camera_, slot.camera_id, sequence);
+    }
+    evicted_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void EventStore::unindex(Index& index, Symbol key, uint64_t sequence) {
+    const auto it = index.find(key);
+    assert(it != index.end());
+    // The oldest event is at the front of every list it is on
+    assert(!it->second.empty() && it->second.front() == sequence);
+    (void)sequence;
+    it->second.pop_front();
+    if (it->second.empty()) {
+        // A type or camera that stops appearing must not keep its entry forever
+        index.erase(it);
+    }
+}
+
+LogEvent EventStore::materialize(const Slot& slot) const {
+    LogEvent event;
+    event.set_timestamp_ms(slot.timestamp_ms);
+    event.set_event_type(symbols_.name(slot.event_type));
+    event.set_camera_id(symbols_.name(slot.camera_id));
+    event.set_message(slot.message);
+    for (const auto& [key, value] : slot.metadata) {
+        (*event.mutable_metadata())[symbols_.name(key)] = value;
+    }
+    return event;
+}
+
+} // namespace dashcam
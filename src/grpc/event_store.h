@@ -0,0 +1,174 @@
+#pragma once
+
+/**
+ * @file event_store.h
+ * @brief Fixed-capacity in-memory event ring behind GetEvents
+ *
+ * Events are kept in arrival order in a preallocated ring; once it is full
+ * the oldest is overwritten. Every event gets a sequence number, and its
+ * slot is `sequence % capacity`, so the ring is also sorted by time: a time
+ * range becomes a sequence range with two binary searches. An event that
+ * arrives older than one already stored is filed at the newest time seen
+ * so far, which keeps that order intact; its own timestamp is unchanged.
+ *
+ * Two secondary indexes map each event_type and camera_id to the ascending
+ * sequences of its events. A filtered query binary-searches the smallest
+ * index covering its filter and walks only those events, so its cost is
+ * the page it returns, not the size of the ring. Eviction pops the front of
+ * the evicted event's lists, which is always that event.
+ *
+ * Slots hold events in interned form: event_type, camera_id and metadata
+ * keys as Symbols of SymbolTable::global(), and the indexes are keyed by
+ * symbol. Filters compare integers, and a LogEvent is built again only for
+ * the events a page returns. Slots are reused in place, so a full ring
+ * mostly reuses the message and metadata buffers of the event it evicts.
+ */
+
+#include "dashcam.pb.h"
+#include "dashcam/utils/symbol_table.h"
+#include "event_filter.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dashcam {
+
+/**
+ * @brief Ring size and page limits
+ */
+struct EventStoreConfig {
+    size_t capacity = 65536;                 // Events kept; the oldest is overwritten
+    uint32_t default_max_events = 100;       // Page size when a query leaves max_events at 0
+    uint32_t max_events_limit = 1000;        // Largest page; bounds how long a query holds the lock
+};
+
+/**
+ * @brief Counters for monitoring the store
+ */
+struct EventStoreStats {
+    uint64_t appended = 0;
+    uint64_t evicted = 0;
+    uint64_t reordered = 0;                  // Older than a stored event; filed at the newer time
+    uint64_t rejected = 0;                   // A name could not be interned; not stored
+    uint64_t stored = 0;
+    uint64_t queries = 0;
+    uint64_t scanned = 0;                    // Events queries examined, including non-matches
+    uint64_t returned = 0;
+};
+
+/**
+ * @brief One page of a GetEvents query
+ */
+struct EventQuery {
+    int64_t start_ms = 0;                    // Inclusive
+    int64_t end_ms = 0;                      // Exclusive; 0: no upper bound
+    EventFilter filter;
+    uint32_t max_events = 0;                 // 0: default_max_events; capped at max_events_limit
+    uint64_t resume_sequence = 0;            // next_sequence of the previous page; 0: first page
+};
+
+struct EventPage {
+    std::vector<LogEvent> events;            // In time order
+    bool has_more = false;
+    uint64_t next_sequence = 0;              // First event of the next page, when has_more
+};
+
+/**
+ * @brief Indexed ring of recent events
+ *
+ * Threading: append(), query() and stats() from any thread. One mutex
+ * guards the ring; an append holds it for one copy and two index pushes,
+ * a query for its binary searches and the events of one page.
+ */
+class EventStore {
+public:
+    /**
+     * @pre config.capacity > 0, 0 < config.default_max_events <= config.max_events_limit
+     */
+    explicit EventStore(const EventStoreConfig& config = EventStoreConfig{});
+
+    // Tiger Style: No copy/move, the ring is preallocated once
+    EventStore(const EventStore&) = delete;
+    EventStore& operator=(const EventStore&) = delete;
+    EventStore(EventStore&&) = delete;
+    EventStore& operator=(EventStore&&) = delete;
+
+    /**
+     * @brief Store an event, evicting the oldest if the ring is full
+     *
+     * @return The event's sequence number, starting at 1, or 0 if the event
+     *         was rejected because the symbol table is full
+     */
+    uint64_t append(const LogEvent& event);
+
+    /**
+     * @brief Events in [start_ms, end_ms) that match the filter, one page
+     *
+     * A page resumed from a sequence that has since been evicted continues
+     * at the oldest event still stored.
+     *
+     * @pre query.end_ms == 0 || query.end_ms >= query.start_ms
+     */
+    EventPage query(const EventQuery& query) const;
+
+    /**
+     * @brief Filed time of the oldest event stored
+     *
+     * A query starting at or after it sees every event the ring was given
+     * in its range. @return INT64_MAX while the ring is empty
+     */
+    int64_t oldest_ms() const;
+
+    EventStoreStats stats() const;
+
+private:
+    struct Slot {
+        int64_t time_ms = 0;                 // Sort key: never below an earlier slot's
+        int64_t timestamp_ms = 0;            // The event's own
+        Symbol event_type = Symbol::EMPTY;
+        Symbol camera_id = Symbol::EMPTY;
+        std::string message;
+        std::vector<std::pair<Symbol, std::string>> metadata;
+    };
+
+    // Ascending sequences of the events with one event_type or camera_id
+    using SequenceList = std::deque<uint64_t>;
+    using Index = std::unordered_map<Symbol, SequenceList>;
+
+    const Slot& slot_locked(uint64_t sequence) const;
+    uint64_t oldest_locked() const;
+
+    /**
+     * @brief First stored sequence filed at or after time_ms
+     */
+    uint64_t first_at_or_after_locked(int64_t time_ms) const;
+
+    void evict_locked(uint64_t sequence);
+    static void unindex(Index& index, Symbol key, uint64_t sequence);
+    LogEvent materialize(const Slot& slot) const;
+
+    const EventStoreConfig config_;
+    SymbolTable& symbols_;
+
+    mutable std::mutex mutex_;
+    std::vector<Slot> slots_;
+    uint64_t next_sequence_ = 1;
+    int64_t latest_ms_;
+    Index by_type_;
+    Index by_camera_;                        // Events without a camera_id are not indexed here
+
+    std::atomic<uint64_t> appended_{0};
+    std::atomic<uint64_t> evicted_{0};
+    std::atomic<uint64_t> reordered_{0};
+    std::atomic<uint64_t> rejected_{0};
+    mutable std::atomic<uint64_t> queries_{0};
+    mutable std::atomic<uint64_t> scanned_{0};
+    mutable std::atomic<uint64_t> returned_{0};
+};
+
+} // namespace dashcam
@@ -1,15 +1,77 @@
 #include "dashcam/grpc_service.h"
+#include "dashcam/storage/event_log.h"
 #include "dashcam/utils/logger.h"
 #include "dashcam_service_impl.h"
+#include "event_service_impl.h"
 
 #include <grpcpp/grpcpp.h>
 #include <cassert>
 
 namespace dashcam {
 
-GrpcServer::GrpcServer(std::string_view address) 
-    : server_address_(address), running_(false), dashcam_service_(std::make_unique<DashcamServiceImpl>()) {
-    assert(!address.empty()); // Tiger Style: assert preconditions
+namespace {
+
+DashcamServiceConfig service_config(const GrpcServerConfig& config) {
+    DashcamServiceConfig service;
+    service.status.interval = config.status_interval;
+    service.status.publish_unchanged = config.status_publish_unchanged;
+    service.status.full_resync_updates = config.status_full_resync_updates;
+    service.status.max_write_stall = config.stream_max_write_stall;
+    service.preview.max_fps_limit = config.preview_max_fps;
+    service.preview.max_write_stall = config.stream_max_write_stall;
+    service.downloads.max_downloads = config.download_max_concurrent;
+    service.downloads.max_bytes_per_second = config.download_max_bytes_per_second;
+    service.downloads.max_write_stall = config.stream_max_write_stall;
+    return service;
+}
+
+DashcamEventServiceConfig event_service_config(const GrpcServerConfig& config) {
+    DashcamEventServiceConfig service;
+    service.store.capacity = config.event_capacity;
+    service.stream.max_write_stall = config.stream_max_write_stall;
+    return service;
+}
+
+/**
+ * @brief The persistent event log, or nullptr if none is configured or it fails to open
+ */
+std::shared_ptr<EventLog> open_event_log(const GrpcServerConfig& config) {
+    if (config.event_log_directory.empty()) {
+        return nullptr;
+    }
+    EventLogConfig log_config;
+    log_config.directory = config.event_log_directory;
+    log_config.retention = config.event_log_retention;
+    auto log = std::make_shared<EventLog>(log_config);
+    if (!log->open()) {
+        LOG_ERROR("Event log '{}' unavailable; GetEvents serves recent events only", config.event_log_directory);
+        return nullptr;
+    }
+    return log;
+}
+
+} // namespace
+
+GrpcServer::GrpcServer(std::string_view address,
+                       std::shared_ptr<const StorageAccounting> storage_accounting,
+                       std::shared_ptr<const LiveStatus> live_status,
+                       std::shared_ptr<SegmentIndex> segments,
+                       const GrpcServerConfig& config)
+    : server_address_(address),
+      config_(config),
+      running_(false),
+      dashcam_service_(std::make_unique<DashcamServiceImpl>(std::move(storage_accounting),
+                                                            std::move(live_status),
+                                                            std::move(segments),
+                                                            service_config(config))),
+      event_service_(std::make_unique<DashcamEventServiceImpl>(open_event_log(config),
+                                                               event_service_config(config))) {
+    // Tiger Style: assert preconditions
+    assert(!address.empty());
+    assert(config_.max_threads > 0);
+    assert(config_.event_capacity > 0);
+    assert(config_.preview_max_fps > 0);
+    assert(config_.download_max_concurrent > 0);
 }
 
 GrpcServer::~GrpcServer() {
@@ -26,9 +88,15 @@ bool GrpcServer::start() {
         
         // Listen on the given address without any authentication mechanism
         builder.AddListeningPort(server_address_, grpc::InsecureServerCredentials());
+
+        // Callback services need no thread per call; cap whatever gRPC may spawn
+        grpc::ResourceQuota quota("dashcam");
+        quota.SetMaxThreads(config_.max_threads);
+        builder.SetResourceQuota(quota);
         
         // Register services
         builder.RegisterService(dashcam_service_.get());
+        builder.RegisterService(event_service_.get());
         
         // Build and start the server
         server_ = builder.BuildAndStart();
@@ -50,7 +118,9 @@ bool GrpcServer::start() {
 void GrpcServer::stop() {
     if (server_ && running_) {
         LOG_INFO("Stopping gRPC server...");
-        server_->Shutdown();
+        dashcam_service_->begin_shutdown();
+        event_service_->begin_shutdown();
+        server_->Shutdown(std::chrono::system_clock::now() + config_.shutdown_grace);
         running_ = false;
         LOG_INFO("gRPC server stopped");
     }
@@ -67,6 +137,18 @@ void GrpcServer::wait_for_shutdown() {
     }
 }
 
+void GrpcServer::record_event(const LogEvent& event) {
+    event_service_->record(event);
+}
+
+void GrpcServer::publish_preview(const PreviewFrameInfo& info, FrameBuffer frame) {
+    dashcam_service_->publish_preview(info, std::move(frame));
+}
+
+bool GrpcServer::take_preview_keyframe_request(std::string_view camera_id) {
+    return dashcam_service_->take_preview_keyframe_request(camera_id);
+}
+
 // GrpcClient implementation
 GrpcClient::GrpcClient(std::string_view address) 
     : server_address_(address), connected_(false) {
@@ -0,0 +1,297 @@
+#include "preview_publisher.h"
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+
+namespace dashcam {
+
+namespace {
+
+/**
+ * @brief A PreviewFrame whose data slice is the pooled frame itself
+ */
+grpc::ByteBuffer to_buffer(const PreviewFrameInfo& info, uint64_t sequence, FrameBuffer frame) {
+    PreviewFrame header;
+    header.set_camera_id(info.camera_id);
+    header.set_timestamp_ms(info.timestamp_ms);
+    header.set_keyframe(info.keyframe);
+    header.set_width(info.width);
+    header.set_height(info.height);
+    header.set_sequence(sequence);
+
+    const size_t size = frame.size();
+    uint8_t* const data = frame.data();
+    // The slice owns the reference from here; gRPC releases it when the last
+    // stream has sent the frame
+    return serialize_with_bytes(header,
+                                PreviewFrame::kDataFieldNumber,
+                                grpc::Slice(data,
+                                            size,
+                                            &FrameBuffer::release_token,
+                                            frame.into_token()));
+}
+
+} // namespace
+
+PreviewPublisher::PreviewPublisher(const PreviewPublisherConfig& config) : config_(config) {
+    // Tiger Style: assert preconditions
+    assert(config_.queue_frames > 0);
+    assert(config_.max_fps_limit > 0);
+    assert(config_.max_write_stall.count() > 0);
+}
+
+PreviewPublisher::~PreviewPublisher() {
+    stop();
+}
+
+void PreviewPublisher::publish(const PreviewFrameInfo& info, FrameBuffer frame) {
+    // Tiger Style: assert preconditions
+    assert(frame && frame.size() > 0);
+    assert(!info.camera_id.empty());
+    assert(info.width > 0);
+
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<PreviewSubscriber*> targets;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        published_.fetch_add(1, std::memory_order_relaxed);
+        auto camera_it = cameras_.find(info.camera_id);
+        if (camera_it == cameras_.end()) {
+            camera_it = cameras_.emplace(info.camera_id, Camera{}).first;
+        }
+        Camera& camera = camera_it->second;
+        Rendition& rendition = camera.renditions[info.width];
+        rendition.last_seen = now;
+        const grpc::ByteBuffer buffer = to_buffer(info, rendition.next_sequence++, std::move(frame));
+        if (info.keyframe) {
+            camera.keyframe_wanted = false;
+        }
+
+        for (PreviewSubscriber* subscriber : subscribers_) {
+            if (subscriber->camera_id_ != info.camera_id ||
+                select_width_locked(camera, subscriber->max_width_, now) != info.width) {
+                continue;
+            }
+            const bool restart = subscriber->width_ != info.width;
+            subscriber->width_ = info.width;
+            switch (subscriber->offer(buffer, info, restart)) {
+                case PreviewSubscriber::Offer::Queued:
+                    subscriber->ref();
+                    targets.push_back(subscriber);
+                    break;
+                case PreviewSubscriber::Offer::NeedKeyframe:
+                    camera.keyframe_wanted = true;
+                    break;
+                case PreviewSubscriber::Offer::Skipped:
+                    break;
+            }
+        }
+    }
+
+    // Without the lock: a write may complete inline and end the stream
+    for (PreviewSubscriber* subscriber : targets) {
+        subscriber->pump();
+        subscriber->unref();
+    }
+}
+
+bool PreviewPublisher::take_keyframe_request(std::string_view camera_id) {
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = cameras_.find(camera_id);
+    if (it == cameras_.end() || !it->second.keyframe_wanted) {
+        return false;
+    }
+    Camera& camera = it->second;
+    const bool first = camera.last_keyframe_request == std::chrono::steady_clock::time_point{};
+    if (!first && now - camera.last_keyframe_request < config_.min_keyframe_interval) {
+        return false;
+    }
+    camera.keyframe_wanted = false;
+    camera.last_keyframe_request = now;
+    keyframes_requested_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+grpc::ServerWriteReactor<grpc::ByteBuffer>* PreviewPublisher::subscribe(grpc::CallbackServerContext* context,
+                                                                        const PreviewRequest& request) {
+    assert(!request.camera_id.empty()); // Tiger Style: assert preconditions
+
+    auto* subscriber = new PreviewSubscriber(*this, context, request);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!stopped_) {
+            subscribers_.push_back(subscriber);
+            // Only cameras that publish are tracked; any other starts on its first keyframe
+            const auto it = cameras_.find(request.camera_id);
+            if (it != cameras_.end()) {
+                it->second.keyframe_wanted = true;
+            }
+            return subscriber;
+        }
+    }
+    subscriber->finish(grpc::Status::OK);
+    return subscriber;
+}
+
+void PreviewPublisher::stop() {
+    std::vector<PreviewSubscriber*> open;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_) {
+            return;
+        }
+        stopped_ = true;
+        open.swap(subscribers_);
+        for (PreviewSubscriber* subscriber : open) {
+            subscriber->ref();
+        }
+    }
+
+    for (PreviewSubscriber* subscriber : open) {
+        subscriber->finish(grpc::Status::OK);
+        subscriber->unref();
+    }
+}
+
+PreviewPublisherStats PreviewPublisher::stats() const {
+    PreviewPublisherStats stats;
+    stats.published = published_.load(std::memory_order_relaxed);
+    stats.writes_started = streams_.writes_started.load(std::memory_order_relaxed);
+    stats.dropped = streams_.dropped.load(std::memory_order_relaxed);
+    stats.rate_limited = rate_limited_.load(std::memory_order_relaxed);
+    stats.keyframe_waits = keyframe_waits_.load(std::memory_order_relaxed);
+    stats.keyframes_requested = keyframes_requested_.load(std::memory_order_relaxed);
+    stats.disconnected = streams_.disconnected.load(std::memory_order_relaxed);
+    stats.bytes_written = streams_.bytes_written.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.subscribers = subscribers_.size();
+    return stats;
+}
+
+std::vector<SubscriberStats> PreviewPublisher::subscriber_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<SubscriberStats> stats;
+    stats.reserve(subscribers_.size());
+    for (const PreviewSubscriber* subscriber : subscribers_) {
+        stats.push_back(subscriber->stats());
+    }
+    return stats;
+}
+
+uint32_t PreviewPublisher::select_width_locked(Camera& camera,
+                                               uint32_t max_width,
+                                               std::chrono::steady_clock::time_point now) {
+    uint32_t widest_fitting = 0;
+    uint32_t narrowest = 0;
+    for (auto it = camera.renditions.begin(); it != camera.renditions.end();) {
+        if (now - it->second.last_seen > config_.rendition_timeout) {
+            it = camera.renditions.erase(it);
+            continue;
+        }
+        const uint32_t width = it->first;
+        if (narrowest == 0) {
+            narrowest = width; // Ascending order
+        }
+        if (max_width == 0 || width <= max_width) {
+            widest_fitting = width;
+        }
+        ++it;
+    }
+    return widest_fitting != 0 ? widest_fitting : narrowest;
+}
+
+void PreviewPublisher::remove(PreviewSubscriber* subscriber) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = std::find(subscribers_.begin(), subscribers_.end(), subscriber);
+    if (it != subscribers_.end()) {
+        // Order does not matter; swap-and-pop keeps removal O(1) after the find
+        *it = subscribers_.back();
+        subscribers_.pop_back();
+    }
+}
+
+PreviewSubscriber::PreviewSubscriber(PreviewPublisher& publisher,
+                                     grpc::CallbackServerContext* context,
+                                     const PreviewRequest& request)
+    : StreamSubscriber(context, publisher.config_.max_write_stall, publisher.streams_),
+      publisher_(publisher),
+      camera_id_(request.camera_id),
+      max_width_(request.max_width),
+      interval_ms_(1000 / (request.max_fps == 0 ? publisher.config_.max_fps_limit
+                                                : std::min(request.max_fps, publisher.config_.max_fps_limit))) {}
+
+PreviewSubscriber::Offer PreviewSubscriber::offer(const grpc::ByteBuffer& frame,
+                                                  const PreviewFrameInfo& info,
+                                                  bool restart) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (finishing_locked()) {
+        return Offer::Skipped;
+    }
+    if (restart) {
+        // Frames of another width do not decode against this one's references
+        wait_ = KeyframeWait::Requested;
+    }
+
+    if (wait_ != KeyframeWait::None) {
+        if (!info.keyframe) {
+            publisher_.keyframe_waits_.fetch_add(1, std::memory_order_relaxed);
+            return wait_ == KeyframeWait::Requested ? Offer::NeedKeyframe : Offer::Skipped;
+        }
+        // Starting matters more than the rate; the schedule restarts here
+        next_due_ms_ = info.timestamp_ms;
+    } else if (info.timestamp_ms < next_due_ms_) {
+        publisher_.rate_limited_.fetch_add(1, std::memory_order_relaxed);
+        if (!info.discardable) {
+            // A skipped reference frame breaks what follows; no need to force a
+            // keyframe just to honour a lower rate
+            wait_ = KeyframeWait::Natural;
+        }
+        return Offer::Skipped;
+    }
+
+    if (queue_.size() >= publisher_.config_.queue_frames) {
+        if (info.keyframe) {
+            // Nothing queued is needed to decode what follows a keyframe
+            count_dropped(queue_.size());
+            queue_.clear();
+        } else {
+            count_dropped(1);
+            if (info.discardable) {
+                return Offer::Skipped;
+            }
+            wait_ = KeyframeWait::Requested;
+            return Offer::NeedKeyframe;
+        }
+    }
+
+    queue_.push_back(frame);
+    wait_ = KeyframeWait::None;
+    // Fixed schedule, so a rate that does not divide the source's still averages
+    // out; a stream far behind (a paused camera) starts a new one
+    if (info.timestamp_ms >= next_due_ms_ + interval_ms_) {
+        next_due_ms_ = info.timestamp_ms;
+    }
+    next_due_ms_ += interval_ms_;
+    return Offer::Queued;
+}
+
+bool PreviewSubscriber::pop_locked(grpc::ByteBuffer* next) {
+    if (queue_.empty()) {
+        return false;
+    }
+    *next = std::move(queue_.front());
+    queue_.pop_front();
+    return true;
+}
+
+size_t PreviewSubscriber::queued_locked() const {
+    return queue_.size();
+}
+
+void PreviewSubscriber::detach() {
+    publisher_.remove(this);
+}
+
+} // namespace dashcam
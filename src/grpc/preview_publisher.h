@@ -0,0 +1,240 @@
+#pragma once
+
+/**
+ * @file preview_publisher.h
+ * @brief Live preview frames to StreamPreview streams, without copying them
+ *
+ * The preview encoder encodes each frame into a FrameBuffer from a pool.
+ * publish() serializes the frame's few header fields once and appends the
+ * length of the `data` field (the last field on the wire), so the message
+ * is two slices: the small header, and the frame bytes referencing the
+ * pooled buffer. Every viewer is queued the same ByteBuffer; the frame is
+ * never copied into a protobuf `bytes` field, and its buffer returns to the
+ * pool once gRPC has sent it to the last viewer.
+ *
+ * Each stream has its own limits:
+ *  - Camera and rendition: a stream gets the frames of one camera at the
+ *    widest rendition no wider than its max_width (the narrowest if none is).
+ *  - Frame rate: a frame arriving before the stream's next frame is due is
+ *    skipped. Only frames nothing references (`discardable`) can be skipped
+ *    without breaking decoding; skipping any other frame makes the stream
+ *    wait for a keyframe.
+ *  - Queue: at most `queue_frames` frames wait behind the write in flight.
+ *    A keyframe that finds the queue full replaces everything queued; any
+ *    other frame is dropped, and a dropped reference frame makes the stream
+ *    wait for a keyframe.
+ *
+ * A stream starts, and restarts after a loss, on a keyframe. Rather than
+ * wait out the encoder's GOP, it asks for one: take_keyframe_request() tells
+ * the encoder to force one, at most once per `min_keyframe_interval` per
+ * camera, so many viewers joining at once cost one keyframe.
+ */
+
+#include "dashcam.pb.h"
+#include "dashcam/media/frame_buffer_pool.h"
+#include "dashcam/media/preview_frame.h"
+#include "stream_subscriber.h"
+
+#include <grpcpp/grpcpp.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dashcam {
+
+class PreviewSubscriber;
+
+/**
+ * @brief Per-stream limits
+ */
+struct PreviewPublisherConfig {
+    size_t queue_frames = 4;                         // Frames a stream holds behind its write in flight
+    uint32_t max_fps_limit = 30;                     // Cap on, and default for, a request's max_fps
+    std::chrono::milliseconds max_write_stall{10000}; // Then a stream that stopped reading is cancelled
+    std::chrono::milliseconds min_keyframe_interval{500}; // Per camera, between keyframes forced for viewers
+    std::chrono::milliseconds rendition_timeout{2000}; // A width not published for this long is gone
+};
+
+/**
+ * @brief Counters for monitoring the fan-out
+ */
+struct PreviewPublisherStats {
+    uint64_t published = 0;
+    uint64_t subscribers = 0;
+    uint64_t writes_started = 0;
+    uint64_t dropped = 0;              // Frames a stream's full queue could not take, or flushed by a keyframe
+    uint64_t rate_limited = 0;         // Frames skipped by a stream's max_fps
+    uint64_t keyframe_waits = 0;       // Frames skipped while a stream waited for a keyframe
+    uint64_t keyframes_requested = 0;  // Forced keyframes handed to the encoder
+    uint64_t disconnected = 0;
+    uint64_t bytes_written = 0;        // Message payloads, before gRPC framing
+};
+
+/**
+ * @brief What one StreamPreview call asked for
+ */
+struct PreviewRequest {
+    std::string camera_id;
+    uint32_t max_fps = 0;                            // 0: max_fps_limit
+    uint32_t max_width = 0;                          // 0: the widest rendition
+};
+
+/**
+ * @brief Fan-out of encoded preview frames to every StreamPreview stream
+ *
+ * Threading: publish(), take_keyframe_request(), stop() and the accessors
+ * from any thread. Streams are gRPC reactors and run on gRPC's callback
+ * threads.
+ */
+class PreviewPublisher {
+public:
+    /**
+     * @pre config.queue_frames > 0, config.max_fps_limit > 0,
+     *      config.max_write_stall > 0
+     */
+    explicit PreviewPublisher(const PreviewPublisherConfig& config = PreviewPublisherConfig{});
+
+    ~PreviewPublisher();
+
+    // Tiger Style: No copy/move, subscribers hold references
+    PreviewPublisher(const PreviewPublisher&) = delete;
+    PreviewPublisher& operator=(const PreviewPublisher&) = delete;
+    PreviewPublisher(PreviewPublisher&&) = delete;
+    PreviewPublisher& operator=(PreviewPublisher&&) = delete;
+
+    /**
+     * @brief Queue a frame to every stream that wants it; never waits for a client
+     *
+     * Takes the frame's reference; streams share it. Frames of one camera
+     * and width must be published in capture order.
+     *
+     * @pre frame holds at least one byte, !info.camera_id.empty(), info.width > 0
+     */
+    void publish(const PreviewFrameInfo& info, FrameBuffer frame);
+
+    /**
+     * @brief Whether the encoder should make the next frame of `camera_id` a keyframe
+     *
+     * Polled by the encoder before each frame. Returns true at most once per
+     * min_keyframe_interval, and only while a stream of the camera waits.
+     */
+    bool take_keyframe_request(std::string_view camera_id);
+
+    /**
+     * @brief Open a stream for one StreamPreview call
+     *
+     * The stream gets frames from the next keyframe on, until the client
+     * cancels or stop() is called. gRPC owns the reactor.
+     *
+     * @pre !request.camera_id.empty()
+     */
+    grpc::ServerWriteReactor<grpc::ByteBuffer>* subscribe(grpc::CallbackServerContext* context,
+                                                          const PreviewRequest& request);
+
+    /**
+     * @brief Finish every open stream with OK
+     *
+     * Safe to call more than once. Streams opened afterwards finish at once.
+     */
+    void stop();
+
+    PreviewPublisherStats stats() const;
+
+    /**
+     * @brief Lag and drop counters of every open stream
+     */
+    std::vector<SubscriberStats> subscriber_stats() const;
+
+private:
+    friend class PreviewSubscriber;
+
+    struct Rendition {
+        uint64_t next_sequence = 0;
+        std::chrono::steady_clock::time_point last_seen{};
+    };
+
+    struct Camera {
+        std::map<uint32_t, Rendition> renditions;    // By width
+        bool keyframe_wanted = false;
+        std::chrono::steady_clock::time_point last_keyframe_request{};
+    };
+
+    /**
+     * @brief The width a stream of `camera` should get; mutex_ is held
+     */
+    uint32_t select_width_locked(Camera& camera, uint32_t max_width, std::chrono::steady_clock::time_point now);
+
+    void remove(PreviewSubscriber* subscriber);
+
+    const PreviewPublisherConfig config_;
+
+    mutable std::mutex mutex_;
+    std::vector<PreviewSubscriber*> subscribers_;
+    std::map<std::string, Camera, std::less<>> cameras_;
+    bool stopped_ = false;
+
+    std::atomic<uint64_t> published_{0};
+    std::atomic<uint64_t> rate_limited_{0};
+    std::atomic<uint64_t> keyframe_waits_{0};
+    std::atomic<uint64_t> keyframes_requested_{0};
+    StreamCounters streams_;
+};
+
+/**
+ * @brief Server side of one StreamPreview call
+ */
+class PreviewSubscriber final : public StreamSubscriber {
+public:
+    PreviewSubscriber(PreviewPublisher& publisher,
+                      grpc::CallbackServerContext* context,
+                      const PreviewRequest& request);
+
+private:
+    friend class PreviewPublisher;
+
+    enum class Offer {
+        Queued,
+        Skipped,
+        NeedKeyframe,                                // Skipped; only a keyframe can restart the stream
+    };
+
+    enum class KeyframeWait {
+        None,
+        Natural,                                     // Skipped a frame for the rate limit; the next GOP will do
+        Requested,                                   // New, switched or lost frames; ask the encoder
+    };
+
+    /**
+     * @brief Queue a frame of the stream's width, or skip it
+     *
+     * Called with the publisher lock held; does not start a write.
+     *
+     * @param restart The stream switched to this frame's width
+     */
+    Offer offer(const grpc::ByteBuffer& frame, const PreviewFrameInfo& info, bool restart);
+
+    bool pop_locked(grpc::ByteBuffer* next) override;
+    size_t queued_locked() const override;
+    void detach() override;
+
+    PreviewPublisher& publisher_;
+    const std::string camera_id_;
+    const uint32_t max_width_;
+    const int64_t interval_ms_;                      // Between frames at max_fps
+
+    // Guarded by PreviewPublisher::mutex_
+    uint32_t width_ = 0;                             // Rendition last sent; 0 before the first frame
+
+    // Guarded by StreamSubscriber::mutex_
+    std::deque<grpc::ByteBuffer> queue_;
+    KeyframeWait wait_ = KeyframeWait::Requested;
+    int64_t next_due_ms_ = 0;
+};
+
+} // namespace dashcam
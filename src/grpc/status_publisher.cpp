@@ -0,0 +1,339 @@
+#include "status_publisher.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace dashcam {
+
+namespace {
+
+// Set on every delta so that changed_fields == 0 always means a snapshot
+constexpr uint32_t DELTA_MARKER = 1u;
+
+// changed_fields(), make_delta() and apply_status_update() list every field
+constexpr int STATUS_FIELD_COUNT = 9;
+
+constexpr uint32_t field_bit(int number) {
+    return 1u << number;
+}
+
+uint32_t changed_fields(const DashcamStatus& before, const DashcamStatus& after) {
+    uint32_t changed = 0;
+    const auto mark = [&changed](bool same, int number) {
+        if (!same) {
+            changed |= field_bit(number);
+        }
+    };
+    mark(before.recording() == after.recording(), DashcamStatus::kRecordingFieldNumber);
+    mark(before.frames_captured() == after.frames_captured(), DashcamStatus::kFramesCapturedFieldNumber);
+    mark(before.storage_used_bytes() == after.storage_used_bytes(),
+         DashcamStatus::kStorageUsedBytesFieldNumber);
+    mark(before.storage_available_bytes() == after.storage_available_bytes(),
+         DashcamStatus::kStorageAvailableBytesFieldNumber);
+    mark(before.current_fps() == after.current_fps(), DashcamStatus::kCurrentFpsFieldNumber);
+    mark(before.current_resolution() == after.current_resolution(),
+         DashcamStatus::kCurrentResolutionFieldNumber);
+    mark(before.uptime_seconds() == after.uptime_seconds(), DashcamStatus::kUptimeSecondsFieldNumber);
+    mark(std::equal(before.active_cameras().begin(), before.active_cameras().end(),
+                    after.active_cameras().begin(), after.active_cameras().end()),
+         DashcamStatus::kActiveCamerasFieldNumber);
+    return changed;
+}
+
+/**
+ * @brief Copy the fields marked in `changed` from `from` into `to`
+ */
+void copy_fields(const DashcamStatus& from, uint32_t changed, DashcamStatus* to) {
+    if (changed & field_bit(DashcamStatus::kRecordingFieldNumber)) {
+        to->set_recording(from.recording());
+    }
+    if (changed & field_bit(DashcamStatus::kFramesCapturedFieldNumber)) {
+        to->set_frames_captured(from.frames_captured());
+    }
+    if (changed & field_bit(DashcamStatus::kStorageUsedBytesFieldNumber)) {
+        to->set_storage_used_bytes(from.storage_used_bytes());
+    }
+    if (changed & field_bit(DashcamStatus::kStorageAvailableBytesFieldNumber)) {
+        to->set_storage_available_bytes(from.storage_available_bytes());
+    }
+    if (changed & field_bit(DashcamStatus::kCurrentFpsFieldNumber)) {
+        to->set_current_fps(from.current_fps());
+    }
+    if (changed & field_bit(DashcamStatus::kCurrentResolutionFieldNumber)) {
+        to->set_current_resolution(from.current_resolution());
+    }
+    if (changed & field_bit(DashcamStatus::kUptimeSecondsFieldNumber)) {
+        to->set_uptime_seconds(from.uptime_seconds());
+    }
+    if (changed & field_bit(DashcamStatus::kActiveCamerasFieldNumber)) {
+        *to->mutable_active_cameras() = from.active_cameras();
+    }
+}
+
+grpc::ByteBuffer to_buffer(const std::string& bytes) {
+    grpc::Slice slice(bytes);
+    return grpc::ByteBuffer(&slice, 1);
+}
+
+} // namespace
+
+void apply_status_update(DashcamStatus* state, const DashcamStatus& update) {
+    assert(state != nullptr); // Tiger Style: assert preconditions
+    if (update.changed_fields() == 0) {
+        *state = update;
+    } else {
+        copy_fields(update, update.changed_fields(), state);
+    }
+    state->clear_changed_fields();
+}
+
+StatusPublisher::StatusPublisher(const StatusPublisherConfig& config, Snapshot snapshot)
+    : config_(config), snapshot_(std::move(snapshot)) {
+    // Tiger Style: assert preconditions
+    assert(config_.interval.count() > 0);
+    assert(config_.full_resync_updates > 0);
+    assert(config_.max_write_stall.count() > 0);
+    assert(snapshot_);
+    assert(DashcamStatus::descriptor()->field_count() == STATUS_FIELD_COUNT);
+}
+
+StatusPublisher::~StatusPublisher() {
+    stop();
+}
+
+void StatusPublisher::start() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        assert(!thread_.joinable() && !stopped_); // Tiger Style: assert preconditions
+    }
+    publish();
+    thread_ = std::thread(&StatusPublisher::run, this);
+}
+
+void StatusPublisher::stop() {
+    std::vector<StatusSubscriber*> open;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!stopped_) {
+            stopped_ = true;
+            open.swap(subscribers_);
+            for (StatusSubscriber* subscriber : open) {
+                subscriber->ref();
+            }
+        }
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    for (StatusSubscriber* subscriber : open) {
+        subscriber->finish(grpc::Status::OK);
+        subscriber->unref();
+    }
+}
+
+void StatusPublisher::notify() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        notified_ = true;
+    }
+    cv_.notify_all();
+}
+
+grpc::ServerWriteReactor<grpc::ByteBuffer>* StatusPublisher::subscribe(grpc::CallbackServerContext* context,
+                                                                       bool delta_updates) {
+    auto* subscriber = new StatusSubscriber(*this, context, delta_updates);
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (stopped_) {
+        lock.unlock();
+        subscriber->finish(grpc::Status::OK);
+        return subscriber;
+    }
+
+    subscribers_.push_back(subscriber);
+    // Not yet bound to the call, so the write is only queued and nothing
+    // runs inline; doing it under the lock keeps it ahead of the next tick
+    if (has_latest_) {
+        subscriber->deliver(latest_, nullptr);
+    }
+    return subscriber;
+}
+
+StatusPublisherStats StatusPublisher::stats() const {
+    StatusPublisherStats stats;
+    stats.ticks = ticks_.load(std::memory_order_relaxed);
+    stats.serializations = serializations_.load(std::memory_order_relaxed);
+    stats.unchanged_skipped = unchanged_skipped_.load(std::memory_order_relaxed);
+    stats.writes_started = streams_.writes_started.load(std::memory_order_relaxed);
+    stats.coalesced = streams_.dropped.load(std::memory_order_relaxed);
+    stats.disconnected = streams_.disconnected.load(std::memory_order_relaxed);
+    stats.delta_writes = delta_writes_.load(std::memory_order_relaxed);
+    stats.resyncs = resyncs_.load(std::memory_order_relaxed);
+    stats.bytes_written = streams_.bytes_written.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.subscribers = subscribers_.size();
+    return stats;
+}
+
+std::vector<SubscriberStats> StatusPublisher::subscriber_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<SubscriberStats> stats;
+    stats.reserve(subscribers_.size());
+    for (const StatusSubscriber* subscriber : subscribers_) {
+        stats.push_back(subscriber->stats());
+    }
+    return stats;
+}
+
+void StatusPublisher::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopped_) {
+        cv_.wait_for(lock, config_.interval, [this] { return stopped_ || notified_; });
+        if (stopped_) {
+            break;
+        }
+        notified_ = false;
+
+        lock.unlock();
+        publish();
+        lock.lock();
+    }
+}
+
+void StatusPublisher::publish() {
+    ticks_.fetch_add(1, std::memory_order_relaxed);
+
+    DashcamStatus status;
+    snapshot_(&status);
+    std::string bytes;
+    status.SerializeToString(&bytes);
+    serializations_.fetch_add(1, std::memory_order_relaxed);
+
+    // Delta against the previous tick, which is what every delta stream
+    // holds once its queued writes land
+    grpc::ByteBuffer delta;
+    bool has_delta = false;
+    if (has_last_status_) {
+        const uint32_t changed = changed_fields(last_status_, status);
+        if (changed != 0) {
+            DashcamStatus update;
+            copy_fields(status, changed, &update);
+            update.set_changed_fields(changed | DELTA_MARKER);
+            delta = to_buffer(update.SerializeAsString());
+            has_delta = true;
+        }
+    }
+
+    std::vector<StatusSubscriber*> targets;
+    grpc::ByteBuffer buffer;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!config_.publish_unchanged && has_latest_ && bytes == latest_bytes_) {
+            unchanged_skipped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        latest_ = to_buffer(bytes);
+        latest_bytes_ = std::move(bytes);
+        has_latest_ = true;
+        buffer = latest_;
+
+        // References keep each subscriber alive while it is written to unlocked
+        targets = subscribers_;
+        for (StatusSubscriber* subscriber : targets) {
+            subscriber->ref();
+        }
+    }
+
+    last_status_ = std::move(status);
+    has_last_status_ = true;
+
+    // Without the lock: a write may complete inline and end the stream
+    for (StatusSubscriber* subscriber : targets) {
+        subscriber->deliver(buffer, has_delta ? &delta : nullptr);
+        subscriber->unref();
+    }
+}
+
+void StatusPublisher::remove(StatusSubscriber* subscriber) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = std::find(subscribers_.begin(), subscribers_.end(), subscriber);
+    if (it != subscribers_.end()) {
+        // Order does not matter; swap-and-pop keeps removal O(1) after the find
+        *it = subscribers_.back();
+        subscribers_.pop_back();
+    }
+}
+
+StatusSubscriber::StatusSubscriber(StatusPublisher& publisher,
+                                   grpc::CallbackServerContext* context,
+                                   bool delta_updates)
+    : StreamSubscriber(context, publisher.config_.max_write_stall, publisher.streams_),
+      publisher_(publisher),
+      delta_updates_(delta_updates) {}
+
+void StatusSubscriber::deliver(const grpc::ByteBuffer& full, const grpc::ByteBuffer* delta) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (finishing_locked()) {
+            return;
+        }
+        // Unless nothing changed for a delta stream, whose client already
+        // has, or is about to have, this state
+        if (!delta_updates_ || delta != nullptr || needs_full_) {
+            const bool superseding = has_pending_;
+            if (superseding) {
+                count_dropped(1);
+            }
+
+            const grpc::ByteBuffer* next = &full;
+            bool is_delta = false;
+            if (delta_updates_) {
+                // A skipped delta breaks the chain; regular snapshots bound any other drift
+                const bool resync =
+                    superseding || deltas_since_full_ >= publisher_.config_.full_resync_updates;
+                if (resync && !needs_full_) {
+                    needs_full_ = true;
+                    publisher_.resyncs_.fetch_add(1, std::memory_order_relaxed);
+                }
+                if (needs_full_) {
+                    needs_full_ = false;
+                    deltas_since_full_ = 0;
+                } else {
+                    next = delta;
+                    is_delta = true;
+                    ++deltas_since_full_;
+                }
+            }
+
+            pending_ = *next;
+            pending_is_delta_ = is_delta;
+            has_pending_ = true;
+        }
+    }
+    // Also checks for a stalled write when there was nothing to queue
+    pump();
+}
+
+bool StatusSubscriber::pop_locked(grpc::ByteBuffer* next) {
+    if (!has_pending_) {
+        return false;
+    }
+    *next = std::move(pending_);
+    pending_.Clear();
+    has_pending_ = false;
+    if (pending_is_delta_) {
+        publisher_.delta_writes_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+size_t StatusSubscriber::queued_locked() const {
+    return has_pending_ ? 1 : 0;
+}
+
+void StatusSubscriber::detach() {
+    publisher_.remove(this);
+}
+
+} // namespace dashcam
@@ -0,0 +1,214 @@
+#pragma once
+
+/**
+ * @file status_publisher.h
+ * @brief One status snapshot per tick, fanned out to every StreamStatus stream
+ *
+ * Building and serializing a DashcamStatus per stream makes the CPU cost of
+ * monitoring grow with the number of viewers. The publisher instead takes
+ * one snapshot per tick, serializes it once into a grpc::ByteBuffer and hands
+ * every subscriber the same buffer. Copying a ByteBuffer only takes a
+ * reference to its slices, so the per-subscriber cost is the send itself.
+ *
+ * Ticks happen every `interval`, or earlier when notify() reports a change.
+ * With `publish_unchanged` off, a tick whose bytes equal the last published
+ * ones is skipped, so an idle recorder sends nothing.
+ *
+ * Streams that ask for delta updates get a full snapshot first, then only the
+ * fields that changed since the previous tick, also serialized once per tick.
+ * Deltas chain tick to tick, so a stream that had to skip one because it fell
+ * behind, or has gone `full_resync_updates` deltas without a snapshot, is sent
+ * the full snapshot instead.
+ */
+
+#include "dashcam.pb.h"
+#include "stream_subscriber.h"
+
+#include <grpcpp/grpcpp.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dashcam {
+
+class StatusSubscriber;
+
+/**
+ * @brief Publication cadence
+ */
+struct StatusPublisherConfig {
+    std::chrono::milliseconds interval{100};         // Longest time between ticks
+    bool publish_unchanged = true;                   // Send ticks whose bytes did not change
+    uint32_t full_resync_updates = 100;              // Delta streams: most deltas between full snapshots
+    std::chrono::milliseconds max_write_stall{10000}; // Then a stream that stopped reading is cancelled
+};
+
+/**
+ * @brief Counters for monitoring the fan-out
+ */
+struct StatusPublisherStats {
+    uint64_t ticks = 0;
+    uint64_t serializations = 0;       // One per tick, whatever the subscriber count
+    uint64_t unchanged_skipped = 0;
+    uint64_t subscribers = 0;
+    uint64_t writes_started = 0;
+    uint64_t coalesced = 0;            // Superseded while the subscriber's previous write was in flight
+    uint64_t disconnected = 0;         // Cancelled after a write stalled past max_write_stall
+    uint64_t delta_writes = 0;
+    uint64_t resyncs = 0;              // Full snapshots sent to delta streams after their first
+    uint64_t bytes_written = 0;        // Message payloads, before gRPC framing
+};
+
+/**
+ * @brief Apply one StreamStatus message to the client's copy of the status
+ *
+ * A full snapshot (changed_fields == 0) replaces the state; a delta replaces
+ * only the fields it marks. The result has changed_fields cleared.
+ */
+void apply_status_update(DashcamStatus* state, const DashcamStatus& update);
+
+/**
+ * @brief Periodic status snapshot shared by all StreamStatus streams
+ *
+ * Threading: start(), stop() and notify() from any thread. The snapshot
+ * callback runs on the publisher thread only. Subscribers are gRPC reactors
+ * and run on gRPC's callback threads.
+ */
+class StatusPublisher {
+public:
+    using Snapshot = std::function<void(DashcamStatus*)>;
+
+    /**
+     * @param config Tick cadence
+     * @param snapshot Fills the status for one tick; must not block
+     *
+     * @pre config.interval > 0, config.full_resync_updates > 0,
+     *      config.max_write_stall > 0, snapshot is callable
+     */
+    StatusPublisher(const StatusPublisherConfig& config, Snapshot snapshot);
+
+    ~StatusPublisher();
+
+    // Tiger Style: No copy/move, subscribers hold references
+    StatusPublisher(const StatusPublisher&) = delete;
+    StatusPublisher& operator=(const StatusPublisher&) = delete;
+    StatusPublisher(StatusPublisher&&) = delete;
+    StatusPublisher& operator=(StatusPublisher&&) = delete;
+
+    /**
+     * @brief Publish a first snapshot and start the publisher thread
+     *
+     * @pre not running
+     */
+    void start();
+
+    /**
+     * @brief Stop ticking and finish every open stream with OK
+     *
+     * Safe to call more than once. Streams opened afterwards finish at once.
+     */
+    void stop();
+
+    /**
+     * @brief Tick now instead of at the end of the interval
+     */
+    void notify();
+
+    /**
+     * @brief Open a stream for one StreamStatus call
+     *
+     * The stream gets the latest snapshot immediately and every later one
+     * until the client cancels or stop() is called. gRPC owns the reactor.
+     *
+     * @param context The call, used to cancel it if it stalls
+     * @param delta_updates Send changed fields only after the first snapshot
+     */
+    grpc::ServerWriteReactor<grpc::ByteBuffer>* subscribe(grpc::CallbackServerContext* context,
+                                                          bool delta_updates = false);
+
+    StatusPublisherStats stats() const;
+
+    /**
+     * @brief Lag and drop counters of every open stream
+     */
+    std::vector<SubscriberStats> subscriber_stats() const;
+
+private:
+    friend class StatusSubscriber;
+
+    void run();
+    void publish();
+    void remove(StatusSubscriber* subscriber);
+
+    const StatusPublisherConfig config_;
+    const Snapshot snapshot_;
+
+    // Publisher thread only: what delta streams hold after the last tick
+    DashcamStatus last_status_;
+    bool has_last_status_ = false;
+
+    // Guards everything below up to the thread
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<StatusSubscriber*> subscribers_;
+    grpc::ByteBuffer latest_;
+    std::string latest_bytes_;
+    bool has_latest_ = false;
+    bool notified_ = false;
+    bool stopped_ = false;
+    std::thread thread_;
+
+    std::atomic<uint64_t> ticks_{0};
+    std::atomic<uint64_t> serializations_{0};
+    std::atomic<uint64_t> unchanged_skipped_{0};
+    std::atomic<uint64_t> delta_writes_{0};
+    std::atomic<uint64_t> resyncs_{0};
+    StreamCounters streams_;
+};
+
+/**
+ * @brief Server side of one StreamStatus call
+ *
+ * Its queue is a single slot holding the newest buffer published since the
+ * write in flight started; older ones are superseded, so a slow client gets
+ * the current status when it catches up instead of a backlog. A delta
+ * stream that supersedes a buffer queues the full snapshot instead, since
+ * the next delta would not apply to what the client holds.
+ */
+class StatusSubscriber final : public StreamSubscriber {
+public:
+    StatusSubscriber(StatusPublisher& publisher, grpc::CallbackServerContext* context, bool delta_updates);
+
+private:
+    friend class StatusPublisher;
+
+    /**
+     * @brief Queue this tick's update and push it if the stream is idle
+     *
+     * @param full The tick's snapshot
+     * @param delta Changes since the previous tick, or null if none
+     */
+    void deliver(const grpc::ByteBuffer& full, const grpc::ByteBuffer* delta);
+
+    bool pop_locked(grpc::ByteBuffer* next) override;
+    size_t queued_locked() const override;
+    void detach() override;
+
+    StatusPublisher& publisher_;
+    const bool delta_updates_;
+
+    // Guarded by StreamSubscriber::mutex_
+    grpc::ByteBuffer pending_;
+    bool has_pending_ = false;
+    bool pending_is_delta_ = false;
+    bool needs_full_ = true;                 // Delta streams: next update must be a snapshot
+    uint32_t deltas_since_full_ = 0;
+};
+
+} // namespace dashcam
@@ -0,0 +1,216 @@
+#include "stream_subscriber.h"
+
+#include <grpcpp/support/proto_buffer_reader.h>
+#include <cassert>
+
+namespace dashcam {
+
+StreamSubscriber::StreamSubscriber(grpc::CallbackServerContext* context,
+                                   std::chrono::milliseconds max_write_stall,
+                                   StreamCounters& counters)
+    : context_(context),
+      max_write_stall_(max_write_stall),
+      peer_(context != nullptr ? context->peer() : std::string()),
+      counters_(counters) {
+    // Tiger Style: assert preconditions
+    assert(max_write_stall_.count() > 0);
+}
+
+void StreamSubscriber::pump() {
+    bool write = false;
+    bool cancel = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (finishing_) {
+            return;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (write_in_flight_) {
+            // The client stopped draining its connection; more queueing cannot help
+            if (context_ != nullptr && now - write_started_ > max_write_stall_) {
+                finishing_ = true;
+                cancelling_ = true;
+                finish_status_ =
+                    grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED, "Subscriber fell too far behind");
+                counters_.disconnected.fetch_add(1, std::memory_order_relaxed);
+                cancel = true;
+            }
+        } else if (pop_locked(&in_flight_)) {
+            begin_write_locked(now);
+            write = true;
+        }
+    }
+
+    if (write) {
+        StartWrite(&in_flight_);
+        return;
+    }
+    if (!cancel) {
+        return;
+    }
+
+    // Fails the write in flight. Until TryCancel() returns, OnWriteDone()
+    // defers Finish(), so the call and its context cannot end under us.
+    context_->TryCancel();
+    bool finish_now = false;
+    grpc::Status status;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancelling_ = false;
+        if (finish_deferred_) {
+            finish_deferred_ = false;
+            finish_called_ = true;
+            finish_now = true;
+            status = finish_status_;
+        }
+    }
+    if (finish_now) {
+        Finish(status);
+    }
+}
+
+void StreamSubscriber::OnWriteDone(bool ok) {
+    bool finish_now = false;
+    bool write_next = false;
+    grpc::Status status;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        write_in_flight_ = false;
+        // Release the message now; it may hold a pooled buffer an idle stream must not pin
+        in_flight_.Clear();
+        const auto now = std::chrono::steady_clock::now();
+        if (ok) {
+            write_done_locked(now - write_started_);
+        }
+        if (!ok && !finishing_) {
+            // Client went away mid-write
+            finishing_ = true;
+            finish_status_ = grpc::Status(grpc::StatusCode::CANCELLED, "Stream closed by client");
+        }
+        if (finishing_) {
+            if (cancelling_) {
+                finish_deferred_ = true;
+            } else if (!finish_called_) {
+                finish_called_ = true;
+                finish_now = true;
+                status = finish_status_;
+            }
+        } else if (pop_locked(&in_flight_)) {
+            begin_write_locked(now);
+            write_next = true;
+        }
+    }
+
+    if (finish_now) {
+        Finish(status);
+    } else if (write_next) {
+        StartWrite(&in_flight_);
+    }
+}
+
+void StreamSubscriber::OnCancel() {
+    finish(grpc::Status(grpc::StatusCode::CANCELLED, "Stream cancelled"));
+}
+
+void StreamSubscriber::OnDone() {
+    detach();
+    unref();
+}
+
+void StreamSubscriber::finish(const grpc::Status& status) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (finishing_) {
+            return;
+        }
+        finishing_ = true;
+        finish_status_ = status;
+        if (write_in_flight_) {
+            // OnWriteDone() finishes once the write completes
+            return;
+        }
+        finish_called_ = true;
+    }
+    Finish(status);
+}
+
+SubscriberStats StreamSubscriber::stats() const {
+    SubscriberStats stats;
+    stats.peer = peer_;
+    stats.dropped = dropped_.load(std::memory_order_relaxed);
+    stats.writes = writes_.load(std::memory_order_relaxed);
+    stats.bytes_written = bytes_written_.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.queued = queued_locked();
+    if (write_in_flight_) {
+        stats.lag = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - write_started_);
+    }
+    return stats;
+}
+
+void StreamSubscriber::begin_write_locked(std::chrono::steady_clock::time_point now) {
+    write_in_flight_ = true;
+    write_started_ = now;
+    writes_.fetch_add(1, std::memory_order_relaxed);
+    bytes_written_.fetch_add(in_flight_.Length(), std::memory_order_relaxed);
+    counters_.writes_started.fetch_add(1, std::memory_order_relaxed);
+    counters_.bytes_written.fetch_add(in_flight_.Length(), std::memory_order_relaxed);
+}
+
+void StreamSubscriber::count_dropped(uint64_t messages) {
+    dropped_.fetch_add(messages, std::memory_order_relaxed);
+    counters_.dropped.fetch_add(messages, std::memory_order_relaxed);
+}
+
+bool StreamSubscriber::finishing_locked() const {
+    return finishing_;
+}
+
+void StreamSubscriber::ref() {
+    refs_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void StreamSubscriber::unref() {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete this;
+    }
+}
+
+RejectedStream::RejectedStream(const grpc::Status& status) {
+    Finish(status);
+}
+
+void RejectedStream::OnDone() {
+    delete this;
+}
+
+bool parse_request(const grpc::ByteBuffer& request, google::protobuf::Message* message) {
+    assert(message != nullptr); // Tiger Style: assert preconditions
+
+    // Copying the buffer only references its slices
+    grpc::ByteBuffer bytes(request);
+    grpc::ProtoBufferReader reader(&bytes);
+    return message->ParseFromZeroCopyStream(&reader);
+}
+
+grpc::ByteBuffer serialize_with_bytes(const google::protobuf::Message& header,
+                                      uint32_t field,
+                                      grpc::Slice data) {
+    std::string prefix = header.SerializeAsString();
+    const auto append_varint = [&prefix](uint64_t value) {
+        while (value >= 0x80) {
+            prefix.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        prefix.push_back(static_cast<char>(value));
+    };
+    append_varint((static_cast<uint64_t>(field) << 3) | 2); // Length-delimited
+    append_varint(data.size());
+
+    grpc::Slice slices[2] = {grpc::Slice(prefix), std::move(data)};
+    return grpc::ByteBuffer(slices, 2);
+}
+
+} // namespace dashcam
@@ -0,0 +1,197 @@
+#pragma once
+
+/**
+ * @file stream_subscriber.h
+ * @brief Server side of one fan-out stream, with a bounded queue
+ *
+ * Publishers hand every stream the same pre-serialized buffers. A client
+ * that reads slowly must not make the server buffer without limit or hold
+ * up the publisher, so each stream keeps at most one write in flight plus a
+ * small queue whose overflow policy the subclass decides (status streams
+ * keep only the newest value, event streams drop and mark the gap). A write
+ * left outstanding longer than `max_write_stall` means the client stopped
+ * draining its connection; the call is then cancelled.
+ */
+
+#include <google/protobuf/message.h>
+#include <grpcpp/grpcpp.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace dashcam {
+
+/**
+ * @brief Totals across every stream of one publisher
+ */
+struct StreamCounters {
+    std::atomic<uint64_t> writes_started{0};
+    std::atomic<uint64_t> bytes_written{0};      // Message payloads, before gRPC framing
+    std::atomic<uint64_t> dropped{0};            // Queued, then discarded or superseded
+    std::atomic<uint64_t> disconnected{0};       // Cancelled for falling too far behind
+};
+
+/**
+ * @brief One stream, as reported for monitoring
+ */
+struct SubscriberStats {
+    std::string peer;
+    uint64_t queued = 0;                         // Waiting behind the write in flight
+    std::chrono::milliseconds lag{0};            // Age of the write in flight, 0 when idle
+    uint64_t dropped = 0;
+    uint64_t writes = 0;
+    uint64_t bytes_written = 0;
+};
+
+/**
+ * @brief Write reactor shared by the status and event streams
+ *
+ * Lifetime: reference counted. The stream's own reference is dropped in
+ * OnDone(); publishers take one while they call into the stream without
+ * their lock, because gRPC may complete a write inline and end the stream
+ * inside StartWrite().
+ *
+ * Lock order: publisher, then stream.
+ */
+class StreamSubscriber : public grpc::ServerWriteReactor<grpc::ByteBuffer> {
+public:
+    // Tiger Style: No copy/move, gRPC holds a pointer
+    StreamSubscriber(const StreamSubscriber&) = delete;
+    StreamSubscriber& operator=(const StreamSubscriber&) = delete;
+    StreamSubscriber(StreamSubscriber&&) = delete;
+    StreamSubscriber& operator=(StreamSubscriber&&) = delete;
+
+    void OnWriteDone(bool ok) final;
+    void OnCancel() final;
+    void OnDone() final;
+
+    void ref();
+    void unref();
+
+    /**
+     * @brief End the stream once the write in flight, if any, completes
+     *
+     * Messages still queued are discarded. Safe to call more than once; the
+     * first status wins.
+     */
+    void finish(const grpc::Status& status);
+
+    /**
+     * @brief Start the next queued write, or disconnect a stalled stream
+     *
+     * Publishers call this after queueing, without their lock.
+     */
+    void pump();
+
+    SubscriberStats stats() const;
+
+protected:
+    /**
+     * @param context The call; null when the stream is finished at once
+     * @param max_write_stall Cancel the call when a write is outstanding longer
+     * @param counters Publisher totals, must outlive the stream
+     *
+     * @pre max_write_stall > 0
+     */
+    StreamSubscriber(grpc::CallbackServerContext* context,
+                     std::chrono::milliseconds max_write_stall,
+                     StreamCounters& counters);
+
+    virtual ~StreamSubscriber() = default;
+
+    /**
+     * @brief Move the next queued message into `next`; mutex_ is held
+     *
+     * @return false if nothing is queued
+     */
+    virtual bool pop_locked(grpc::ByteBuffer* next) = 0;
+
+    /**
+     * @brief Messages waiting; mutex_ is held
+     */
+    virtual size_t queued_locked() const = 0;
+
+    /**
+     * @brief Unlink from the publisher; called once, from OnDone()
+     */
+    virtual void detach() = 0;
+
+    /**
+     * @brief A write the client accepted took `elapsed`; mutex_ is held
+     *
+     * Called before the next queued message is popped.
+     */
+    virtual void write_done_locked(std::chrono::steady_clock::duration elapsed) {
+        (void)elapsed;
+    }
+
+    /**
+     * @brief Count messages the subclass discarded
+     */
+    void count_dropped(uint64_t messages);
+
+    bool finishing_locked() const;
+
+    // Guards the state below and the subclass queue
+    mutable std::mutex mutex_;
+
+private:
+    /**
+     * @brief Account the write just moved into in_flight_; mutex_ is held
+     */
+    void begin_write_locked(std::chrono::steady_clock::time_point now);
+
+    grpc::CallbackServerContext* const context_;
+    const std::chrono::milliseconds max_write_stall_;
+    const std::string peer_;
+    StreamCounters& counters_;
+    std::atomic<uint32_t> refs_{1};              // gRPC's, until OnDone()
+
+    grpc::ByteBuffer in_flight_;                 // Must outlive its write
+    std::chrono::steady_clock::time_point write_started_{};
+    bool write_in_flight_ = false;
+    bool finishing_ = false;
+    bool finish_called_ = false;
+    bool cancelling_ = false;                    // TryCancel() running; Finish() must wait
+    bool finish_deferred_ = false;
+    grpc::Status finish_status_;
+
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> writes_{0};
+    std::atomic<uint64_t> bytes_written_{0};
+};
+
+/**
+ * @brief A stream refused before it started; finishes at once with `status`
+ */
+class RejectedStream final : public grpc::ServerWriteReactor<grpc::ByteBuffer> {
+public:
+    explicit RejectedStream(const grpc::Status& status);
+
+    void OnDone() override;
+};
+
+/**
+ * @brief Parse the request of a raw streaming method
+ *
+ * @return false if the bytes are not a valid `message`
+ */
+bool parse_request(const grpc::ByteBuffer& request, google::protobuf::Message* message);
+
+/**
+ * @brief Serialize `header` with `data` appended as bytes field `field`
+ *
+ * The result is two slices: the serialized header with the field's tag and
+ * length, then `data` itself, referenced rather than copied. Large payloads
+ * (frames, file pages) reach the transport without a copy into a `bytes`
+ * field.
+ *
+ * @pre `field` is not set in `header`
+ */
+grpc::ByteBuffer serialize_with_bytes(const google::protobuf::Message& header,
+                                      uint32_t field,
+                                      grpc::Slice data);
+
+} // namespace dashcam
@@ -0,0 +1,327 @@
+#include "dashcam/media/audio_capture.h"
+#include "dashcam/utils/byte_order.h"
+#include "dashcam/utils/logger.h"
+#include "dashcam/utils/mapped_file.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace dashcam {
+
+namespace {
+
+// The ring holds native samples and the muxer declares them little-endian
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "PCM passthrough assumes little-endian");
+
+constexpr uint16_t WAV_FORMAT_PCM = 1;
+constexpr uint16_t WAV_FORMAT_EXTENSIBLE = 0xFFFE;
+constexpr uint16_t WAV_BITS_PER_SAMPLE = 16;
+constexpr size_t WAV_HEADER_BYTES = 12;
+constexpr size_t WAV_CHUNK_HEADER_BYTES = 8;
+constexpr size_t WAV_FMT_BYTES = 16;
+
+// Enough for fmt, data and the LIST/fact chunks editors add
+constexpr uint32_t MAX_WAV_CHUNKS = 64;
+
+// Quarter of full scale: audible, and far from clipping
+constexpr double TONE_AMPLITUDE = 8192.0;
+
+constexpr double PI = 3.14159265358979323846;
+
+} // namespace
+
+void AudioSource::generate_tone(const AudioFormat& format, uint32_t tone_hz) {
+    // Tiger Style: assert preconditions
+    assert(format.sample_rate > 0);
+    assert(format.channels > 0 && format.channels <= 2);
+    assert(tone_hz > 0 && tone_hz < format.sample_rate / 2);
+
+    // A whole number of cycles per second, so the loop point is seamless
+    format_ = format;
+    pcm_.resize(static_cast<size_t>(format.sample_rate) * format.channels);
+    for (uint32_t frame = 0; frame < format.sample_rate; ++frame) {
+        const double phase = 2.0 * PI * tone_hz * frame / format.sample_rate;
+        const auto sample = static_cast<int16_t>(std::lround(TONE_AMPLITUDE * std::sin(phase)));
+        for (uint16_t channel = 0; channel < format.channels; ++channel) {
+            pcm_[static_cast<size_t>(frame) * format.channels + channel] = sample;
+        }
+    }
+    position_frames_ = 0;
+    loop_ = true;
+}
+
+bool AudioSource::open_wav(std::string_view path, bool loop) {
+    MappedFile file;
+    if (!file.open(path)) {
+        return false;
+    }
+    const uint8_t* data = file.data();
+    const size_t size = file.size();
+    if (size < WAV_HEADER_BYTES || std::memcmp(data, "RIFF", 4) != 0 ||
+        std::memcmp(data + 8, "WAVE", 4) != 0) {
+        LOG_ERROR("{} is not a WAV file", path);
+        return false;
+    }
+
+    AudioFormat format;
+    bool have_format = false;
+    const uint8_t* samples = nullptr;
+    size_t sample_bytes = 0;
+
+    size_t offset = WAV_HEADER_BYTES;
+    for (uint32_t i = 0; i < MAX_WAV_CHUNKS && offset + WAV_CHUNK_HEADER_BYTES <= size; ++i) {
+        const uint8_t* chunk = data + offset;
+        const size_t chunk_bytes = load_le32(chunk + 4);
+        const size_t available = size - offset - WAV_CHUNK_HEADER_BYTES;
+        const uint8_t* body = chunk + WAV_CHUNK_HEADER_BYTES;
+
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && chunk_bytes >= WAV_FMT_BYTES &&
+            chunk_bytes <= available) {
+            const uint16_t tag = load_le16(body);
+            format.channels = load_le16(body + 2);
+            format.sample_rate = load_le32(body + 4);
+            const uint16_t bits = load_le16(body + 14);
+            if ((tag != WAV_FORMAT_PCM && tag != WAV_FORMAT_EXTENSIBLE) ||
+                bits != WAV_BITS_PER_SAMPLE || format.channels == 0 || format.channels > 2 ||
+                format.sample_rate == 0 || format.sample_rate > UINT16_MAX) {
+                LOG_ERROR("{} is not 16-bit mono or stereo PCM", path);
+                return false;
+            }
+            have_format = true;
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            // Recorders killed mid-write leave a data size past the end
+            samples = body;
+            sample_bytes = std::min(chunk_bytes, available);
+            break;
+        }
+        offset += WAV_CHUNK_HEADER_BYTES + chunk_bytes + (chunk_bytes & 1);
+    }
+
+    const size_t frame_bytes = have_format ? format.channels * sizeof(int16_t) : 0;
+    if (!have_format || samples == nullptr || sample_bytes < frame_bytes) {
+        LOG_ERROR("{} has no PCM samples", path);
+        return false;
+    }
+
+    const size_t frames = sample_bytes / frame_bytes;
+    pcm_.resize(frames * format.channels);
+    for (size_t i = 0; i < pcm_.size(); ++i) {
+        pcm_[i] = static_cast<int16_t>(load_le16(samples + i * sizeof(int16_t)));
+    }
+    format_ = format;
+    position_frames_ = 0;
+    loop_ = loop;
+    return true;
+}
+
+bool AudioSource::is_open() const {
+    return !pcm_.empty();
+}
+
+const AudioFormat& AudioSource::format() const {
+    return format_;
+}
+
+uint32_t AudioSource::read(int16_t* out, uint32_t frames) {
+    assert(out != nullptr);
+    if (pcm_.empty()) {
+        return 0;
+    }
+
+    const size_t total_frames = pcm_.size() / format_.channels;
+    uint32_t copied = 0;
+    while (copied < frames) {
+        if (position_frames_ == total_frames) {
+            if (!loop_) {
+                break;
+            }
+            position_frames_ = 0;
+        }
+        const auto count =
+            static_cast<uint32_t>(std::min<size_t>(frames - copied, total_frames - position_frames_));
+        std::memcpy(out + static_cast<size_t>(copied) * format_.channels,
+                    pcm_.data() + position_frames_ * format_.channels,
+                    static_cast<size_t>(count) * format_.channels * sizeof(int16_t));
+        copied += count;
+        position_frames_ += count;
+    }
+    return copied;
+}
+
+AudioTimeline::AudioTimeline(uint32_t sample_rate,
+                             Clock::time_point epoch,
+                             std::chrono::microseconds resync_threshold)
+    : sample_rate_(sample_rate),
+      epoch_(epoch),
+      resync_threshold_frames_(resync_threshold.count() * sample_rate / 1000000) {
+    assert(sample_rate_ > 0); // Tiger Style: assert preconditions
+}
+
+int64_t AudioTimeline::place(const PcmPeriodInfo& period) {
+    assert(period.frames > 0);
+
+    const int64_t elapsed_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(period.capture_time - epoch_)
+            .count();
+    const int64_t captured = elapsed_us * sample_rate_ / 1000000;
+
+    int64_t decode_time = next_decode_time_;
+    const int64_t drift = captured - next_decode_time_;
+    if (!started_ || period.discontinuity || drift > resync_threshold_frames_ ||
+        drift < -resync_threshold_frames_) {
+        if (started_) {
+            resyncs_++;
+        }
+        decode_time = captured;
+        started_ = true;
+    }
+    next_decode_time_ = decode_time + period.frames;
+    return decode_time;
+}
+
+uint64_t AudioTimeline::resyncs() const {
+    return resyncs_;
+}
+
+AudioCapture::AudioCapture(const AudioCaptureConfig& config, AudioSource& source)
+    : config_(config),
+      source_(source),
+      ring_(config.period_frames, source.format().channels, config.ring_periods),
+      timeline_(source.format().sample_rate, Clock::time_point{}, config.resync_threshold),
+      scratch_(static_cast<size_t>(config.period_frames) * source.format().channels) {
+    // Tiger Style: assert preconditions
+    assert(source_.is_open());
+    assert(config_.period_frames > 0);
+    assert(config_.ring_periods > 0);
+}
+
+AudioCapture::~AudioCapture() {
+    stop();
+}
+
+void AudioCapture::start(Clock::time_point epoch) {
+    assert(!thread_.joinable());
+
+    timeline_ = AudioTimeline(source_.format().sample_rate, epoch, config_.resync_threshold);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_requested_ = false;
+    }
+    const Clock::time_point first_frame_time = Clock::now();
+    thread_ = std::thread([this, first_frame_time] { run(first_frame_time); });
+}
+
+void AudioCapture::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_requested_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+uint32_t AudioCapture::drain(Fmp4Muxer& muxer, Clock::time_point until, Clock::time_point now) {
+    assert(muxer.has_audio());
+    const size_t frame_bytes = static_cast<size_t>(ring_.channels()) * sizeof(int16_t);
+
+    // Bounded by the ring: the capture thread may refill it while we drain
+    uint32_t drained = 0;
+    PcmPeriodInfo period;
+    for (uint32_t i = 0; i < ring_.capacity(); ++i) {
+        const int16_t* pcm = ring_.front(&period);
+        if (pcm == nullptr || period.capture_time > until) {
+            break;
+        }
+
+        // Placed even when discarded, so the timeline stays continuous
+        SampleTiming timing;
+        timing.decode_time = timeline_.place(period);
+        timing.duration = period.frames;
+        if (muxer.in_segment() &&
+            muxer.add_audio_sample(reinterpret_cast<const uint8_t*>(pcm),
+                                   period.frames * frame_bytes,
+                                   timing,
+                                   now)) {
+            periods_muxed_++;
+        }
+        ring_.pop();
+        drained++;
+    }
+    periods_drained_ += drained;
+    return drained;
+}
+
+AudioCaptureStats AudioCapture::stats() const {
+    AudioCaptureStats stats;
+    stats.periods_captured = periods_captured_.load(std::memory_order_relaxed);
+    stats.frames_captured = frames_captured_.load(std::memory_order_relaxed);
+    stats.periods_dropped = periods_dropped_.load(std::memory_order_relaxed);
+    stats.periods_drained = periods_drained_;
+    stats.periods_muxed = periods_muxed_;
+    stats.resyncs = timeline_.resyncs();
+    return stats;
+}
+
+void AudioCapture::run(Clock::time_point first_frame_time) {
+    const uint32_t sample_rate = source_.format().sample_rate;
+    const Clock::duration period = frames_to_duration(config_.period_frames, sample_rate);
+    uint64_t frames_read = 0;
+    bool dropped = false;
+
+    // Tiger Style: runs until stop() is requested or the source ends
+    while (true) {
+        // Stamped from the frame count: the source's own clock
+        const Clock::time_point capture_time =
+            first_frame_time + frames_to_duration(frames_read, sample_rate);
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (config_.realtime) {
+                // A period is available once its last frame has been captured
+                wake_.wait_until(lock, capture_time + period, [this] { return stop_requested_; });
+            }
+            if (stop_requested_) {
+                return;
+            }
+        }
+
+        int16_t* slot = ring_.begin_write();
+        const uint32_t frames =
+            source_.read(slot != nullptr ? slot : scratch_.data(), config_.period_frames);
+        if (frames == 0) {
+            LOG_INFO("Audio source ended after {} frames", frames_read);
+            return;
+        }
+        frames_read += frames;
+
+        if (slot == nullptr) {
+            // Never wait for the consumer; the timeline resyncs on the next period
+            periods_dropped_.fetch_add(1, std::memory_order_relaxed);
+            dropped = true;
+            continue;
+        }
+
+        PcmPeriodInfo info;
+        info.capture_time = capture_time;
+        info.frames = frames;
+        info.discontinuity = dropped;
+        ring_.commit_write(info);
+        dropped = false;
+        periods_captured_.fetch_add(1, std::memory_order_relaxed);
+        frames_captured_.fetch_add(frames, std::memory_order_relaxed);
+    }
+}
+
+AudioCapture::Clock::duration AudioCapture::frames_to_duration(uint64_t frames,
+                                                              uint32_t sample_rate) {
+    assert(sample_rate > 0); // Tiger Style: assert preconditions
+    // frames * 1e9 would wrap after 2^64 / 1e9 frames, about 4.4 days at 48 kHz
+    const std::chrono::seconds whole(frames / sample_rate);
+    const std::chrono::nanoseconds rest((frames % sample_rate) * 1000000000ull / sample_rate);
+    return std::chrono::duration_cast<Clock::duration>(whole + rest);
+}
+
+} // namespace dashcam
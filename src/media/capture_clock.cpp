@@ -0,0 +1,68 @@
+#include "dashcam/media/capture_clock.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace dashcam {
+
+CaptureClock::CaptureClock()
+    : CaptureClock(Clock::now(),
+                   std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count()) {}
+
+CaptureClock::CaptureClock(Clock::time_point steady_anchor, int64_t utc_anchor_us)
+    : steady_anchor_(steady_anchor), utc_anchor_us_(utc_anchor_us) {}
+
+int64_t CaptureClock::to_us(Clock::time_point time) const {
+    return utc_anchor_us_ +
+           std::chrono::duration_cast<std::chrono::microseconds>(time - steady_anchor_).count();
+}
+
+CaptureClock::Clock::time_point CaptureClock::from_us(int64_t utc_us) const {
+    return steady_anchor_ + std::chrono::microseconds(utc_us - utc_anchor_us_);
+}
+
+int64_t CaptureClock::now_us() const {
+    return to_us(Clock::now());
+}
+
+CameraClockTracker::CameraClockTracker(int64_t window_us) : window_us_(window_us) {
+    assert(window_us_ > 0); // Tiger Style: assert preconditions
+}
+
+int64_t CameraClockTracker::observe(int64_t device_us, int64_t arrival_us) {
+    const int64_t sample = arrival_us - device_us;
+
+    if (!has_estimate_) {
+        has_estimate_ = true;
+        window_start_us_ = arrival_us;
+        current_min_ = sample;
+        previous_min_ = sample;
+    } else if (arrival_us - window_start_us_ >= window_us_) {
+        // The previous window drops out; samples older than two windows are forgotten
+        window_start_us_ = arrival_us;
+        previous_min_ = current_min_;
+        current_min_ = sample;
+    } else {
+        current_min_ = std::min(current_min_, sample);
+    }
+
+    last_jitter_us_ = sample - offset_us();
+    return to_capture_us(device_us);
+}
+
+int64_t CameraClockTracker::to_capture_us(int64_t device_us) const {
+    assert(has_estimate_);
+    return device_us + offset_us();
+}
+
+int64_t CameraClockTracker::offset_us() const {
+    return std::min(current_min_, previous_min_);
+}
+
+int64_t CameraClockTracker::last_jitter_us() const {
+    return last_jitter_us_;
+}
+
+} // namespace dashcam
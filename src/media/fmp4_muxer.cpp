@@ -0,0 +1,793 @@
+#include "dashcam/media/fmp4_muxer.h"
+#include "dashcam/utils/logger.h"
+#include "mp4_box_writer.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace dashcam {
+
+namespace {
+
+constexpr uint32_t TRACK_ID = 1;
+constexpr uint32_t AUDIO_TRACK_ID = 2;
+
+// ISO/IEC 14496-12 sample_flags: depends_on and is_non_sync_sample
+constexpr uint32_t SAMPLE_FLAGS_SYNC = 0x02000000;
+constexpr uint32_t SAMPLE_FLAGS_NON_SYNC = 0x01010000;
+
+// tfhd: base data offset is the start of the enclosing moof
+constexpr uint32_t TFHD_DEFAULT_BASE_IS_MOOF = 0x020000;
+
+// trun: data offset plus per-sample duration, size, flags and cts offset
+constexpr uint32_t TRUN_FLAGS = 0x000001 | 0x000100 | 0x000200 | 0x000400 | 0x000800;
+
+// Audio trun: data offset plus per-sample duration and size; every sample is a sync sample
+constexpr uint32_t TRUN_AUDIO_FLAGS = 0x000001 | 0x000100 | 0x000200;
+
+constexpr uint32_t PCM_SAMPLE_BITS = 16;
+
+// pcmC format_flags: samples are little-endian
+constexpr uint8_t PCMC_LITTLE_ENDIAN = 0x01;
+
+constexpr size_t MDAT_HEADER_BYTES = 8;
+
+// moof with MAX_SAMPLES_PER_FRAGMENT trun entries stays well below this
+constexpr size_t HEADER_BUFFER_RESERVE_BYTES = 8 * 1024;
+
+// One second of 48 kHz stereo; audio buffers only grow past this on long GOPs
+constexpr size_t AUDIO_BUFFER_RESERVE_BYTES = 192 * 1024;
+
+// Upper bound on top-level boxes walked during recovery: a one-hour segment
+// at one fragment per second, with headroom
+constexpr uint32_t MAX_RECOVERY_BOXES = 1u << 16;
+
+// Vendor boxes for encryption at rest: segment salt in moov, tags in moof
+constexpr const char* ENCRYPTION_KEY_BOX = "dcek";
+constexpr const char* ENCRYPTION_TAGS_BOX = "dcet";
+constexpr size_t FULL_BOX_HEADER_BYTES = 12;
+
+/**
+ * @brief Locate a direct child box of a container's body
+ *
+ * @return Offset of the child within [body, body + size), or size if absent
+ */
+size_t find_child_box(const uint8_t* body, size_t size, const char* type) {
+    size_t offset = 0;
+    for (uint32_t i = 0; i < MAX_RECOVERY_BOXES && offset + 8 <= size; ++i) {
+        const uint32_t box_size = load_be32(body + offset);
+        if (box_size < 8 || box_size > size - offset) {
+            break;
+        }
+        if (std::memcmp(body + offset + 4, type, 4) == 0) {
+            return offset;
+        }
+        offset += box_size;
+    }
+    return size;
+}
+
+/**
+ * @brief Reuse a pooled buffer the writer has released, or replace the oldest
+ */
+template <size_t N>
+std::shared_ptr<std::vector<uint8_t>> acquire_pooled(
+    std::array<std::shared_ptr<std::vector<uint8_t>>, N>& pool,
+    uint32_t* next_slot,
+    size_t reserve_bytes) {
+    // A buffer whose only owner is the pool has been written and released
+    for (std::shared_ptr<std::vector<uint8_t>>& slot : pool) {
+        if (slot && slot.use_count() == 1) {
+            slot->clear();
+            return slot;
+        }
+    }
+
+    // All buffers are still queued in the writer: replace the oldest slot
+    auto buffer = std::make_shared<std::vector<uint8_t>>();
+    buffer->reserve(reserve_bytes);
+    pool[*next_slot] = buffer;
+    *next_slot = (*next_slot + 1) % N;
+    return buffer;
+}
+
+} // namespace
+
+Fmp4Muxer::Fmp4Muxer(const Fmp4MuxerConfig& config,
+                     SegmentWriter& writer,
+                     SidecarIndexBuilder* sidecar,
+                     FragmentCipher* cipher,
+                     IntegrityChain* chain)
+    : config_(config), writer_(writer), sidecar_(sidecar), cipher_(cipher), chain_(chain) {
+    assert(!config_.decoder_config.empty()); // Tiger Style: assert preconditions
+    assert(config_.max_samples_per_fragment > 0);
+    assert(config_.max_samples_per_fragment <= MAX_SAMPLES_PER_FRAGMENT);
+    assert(config_.max_fragment_bytes > 0);
+    assert(config_.max_fragment_bytes < UINT32_MAX - MDAT_HEADER_BYTES);
+    assert(config_.timescale > 0);
+    assert(cipher_ == nullptr || cipher_->chunk_count(config_.max_fragment_bytes) <=
+                                     FragmentCipher::MAX_CHUNKS_PER_FRAGMENT);
+    if (has_audio()) {
+        assert(config_.max_samples_per_fragment < MAX_SAMPLES_PER_FRAGMENT);
+        assert(config_.audio.sample_rate <= UINT16_MAX); // 16.16 rate in the sample entry
+        assert(config_.audio.channels == 1 || config_.audio.channels == 2);
+        assert(config_.audio.max_samples_per_fragment > 0);
+        assert(config_.audio.max_samples_per_fragment <= MAX_AUDIO_SAMPLES_PER_FRAGMENT);
+    }
+
+    if (cipher_ != nullptr) {
+        tags_.resize(static_cast<size_t>(FragmentCipher::MAX_CHUNKS_PER_FRAGMENT) *
+                     ENCRYPTION_TAG_BYTES);
+    }
+}
+
+bool Fmp4Muxer::begin_segment(Clock::time_point now) {
+    assert(!in_segment_);
+    assert(writer_.is_open());
+    assert(writer_.segment_size_bytes() == 0);
+
+    if (cipher_ != nullptr && !cipher_->start_segment(&encryption_)) {
+        return false;
+    }
+
+    auto init = std::make_shared<std::vector<uint8_t>>();
+    init->reserve(1024 + config_.decoder_config.size());
+    write_init_segment(init.get());
+    stats_.header_bytes += init->size();
+
+    in_segment_ = true;
+    fragment_sequence_ = 0;
+    sample_count_ = 0;
+    fragment_bytes_ = 0;
+    audio_count_ = 0;
+    audio_started_ = false;
+    WriteChunk init_chunk = make_write_chunk(std::move(init), false);
+    if (chain_ != nullptr) {
+        chain_->submit(0, init_chunk, nullptr, 0);
+    }
+    return writer_.append(std::move(init_chunk), now);
+}
+
+bool Fmp4Muxer::add_sample(WriteChunk payload, const SampleTiming& timing, Clock::time_point now) {
+    assert(in_segment_);
+    assert(payload.data != nullptr);
+    assert(payload.size_bytes > 0);
+
+    const bool first_in_segment = fragment_sequence_ == 0 && sample_count_ == 0;
+    if (first_in_segment && !payload.keyframe) {
+        LOG_WARNING("Dropping non-keyframe at the start of an fMP4 segment");
+        return false;
+    }
+    if (!first_in_segment && timing.decode_time < last_decode_time_) {
+        LOG_ERROR("Decode time went backwards ({} < {})", timing.decode_time, last_decode_time_);
+        return false;
+    }
+    if (payload.size_bytes > config_.max_fragment_bytes) {
+        LOG_ERROR("Sample of {} bytes exceeds the fragment limit", payload.size_bytes);
+        return false;
+    }
+
+    bool ok = true;
+    const uint64_t audio_bytes = audio_buffer_ ? audio_buffer_->size() : 0;
+    const bool fragment_full =
+        sample_count_ == config_.max_samples_per_fragment ||
+        fragment_bytes_ + audio_bytes + payload.size_bytes > config_.max_fragment_bytes;
+    if (sample_count_ > 0 && (payload.keyframe || fragment_full)) {
+        ok = flush_fragment(now);
+    }
+
+    if (first_in_segment) {
+        segment_base_decode_time_ = timing.decode_time;
+    }
+    if (sample_count_ == 0) {
+        fragment_decode_time_ = timing.decode_time;
+    }
+    last_decode_time_ = timing.decode_time;
+
+    SampleEntry& entry = samples_[sample_count_];
+    entry.size_bytes = static_cast<uint32_t>(payload.size_bytes);
+    entry.duration = timing.duration;
+    entry.flags = payload.keyframe ? SAMPLE_FLAGS_SYNC : SAMPLE_FLAGS_NON_SYNC;
+    entry.composition_offset = timing.composition_offset;
+
+    // Only the fragment header marks a durability point
+    payload.keyframe = false;
+    fragment_bytes_ += payload.size_bytes;
+    payloads_[sample_count_] = std::move(payload);
+    sample_count_++;
+    assert(sample_count_ <= config_.max_samples_per_fragment);
+    return ok;
+}
+
+bool Fmp4Muxer::add_audio_sample(const uint8_t* data,
+                                 size_t size_bytes,
+                                 const SampleTiming& timing,
+                                 Clock::time_point now) {
+    assert(in_segment_);
+    assert(has_audio());
+    assert(data != nullptr);
+    assert(size_bytes > 0);
+    assert(timing.duration > 0);
+
+    // Segments start at a video keyframe; earlier audio has nothing to sync to
+    if (fragment_sequence_ == 0 && sample_count_ == 0) {
+        stats_.audio_samples_dropped++;
+        return false;
+    }
+
+    const int64_t rate = config_.audio.sample_rate;
+    const int64_t timescale = config_.timescale;
+    const int64_t skew = static_cast<int64_t>(config_.audio.max_skew_us) * timescale / 1000000;
+    const int64_t video_time = timing.decode_time * timescale / rate;
+    const bool overlaps = timing.decode_time < audio_segment_base() ||
+                          (audio_started_ && timing.decode_time < audio_next_decode_time_);
+    const bool skewed = video_time < last_decode_time_ - skew || video_time > last_decode_time_ + skew;
+    if (overlaps || skewed || size_bytes > config_.max_fragment_bytes) {
+        stats_.audio_samples_dropped++;
+        return false;
+    }
+
+    bool ok = true;
+    const uint64_t audio_bytes = audio_buffer_ ? audio_buffer_->size() : 0;
+    const bool gap = audio_count_ > 0 && timing.decode_time != audio_next_decode_time_;
+    const bool fragment_full =
+        audio_count_ == config_.audio.max_samples_per_fragment ||
+        fragment_bytes_ + audio_bytes + size_bytes > config_.max_fragment_bytes;
+    if (gap || fragment_full) {
+        // A trun is contiguous in time: restate the audio start in a new fragment
+        ok = flush_fragment(now);
+    }
+
+    if (audio_count_ == 0) {
+        audio_buffer_ = acquire_audio_buffer();
+        audio_fragment_decode_time_ = timing.decode_time;
+    }
+    audio_buffer_->insert(audio_buffer_->end(), data, data + size_bytes);
+
+    AudioEntry& entry = audio_samples_[audio_count_];
+    entry.size_bytes = static_cast<uint32_t>(size_bytes);
+    entry.duration = timing.duration;
+    audio_count_++;
+    audio_next_decode_time_ = timing.decode_time + timing.duration;
+    audio_started_ = true;
+    assert(audio_count_ <= config_.audio.max_samples_per_fragment);
+    return ok;
+}
+
+bool Fmp4Muxer::flush_fragment(Clock::time_point now) {
+    assert(in_segment_);
+    if (sample_count_ == 0 && audio_count_ == 0) {
+        return true;
+    }
+
+    // Video payloads first, then the fragment's audio as one more chunk
+    uint32_t payload_count = sample_count_;
+    uint64_t payload_bytes = fragment_bytes_;
+    if (audio_count_ > 0) {
+        WriteChunk& audio = payloads_[payload_count++];
+        audio.data = audio_buffer_->data();
+        audio.size_bytes = audio_buffer_->size();
+        audio.keyframe = false;
+        audio.owner = std::move(audio_buffer_);
+        payload_bytes += audio.size_bytes;
+    }
+
+    std::shared_ptr<std::vector<uint8_t>> header = acquire_header_buffer();
+    Mp4BoxWriter box(header.get());
+    const uint32_t sequence = ++fragment_sequence_;
+    WriteChunk ciphertext;
+
+    const size_t moof = box.begin_box("moof");
+    {
+        const size_t mfhd = box.begin_full_box("mfhd", 0, 0);
+        box.u32(sequence);
+        box.end_box(mfhd);
+
+        size_t data_offset_at = 0;
+        if (sample_count_ > 0) {
+            const size_t traf = box.begin_box("traf");
+            const size_t tfhd = box.begin_full_box("tfhd", 0, TFHD_DEFAULT_BASE_IS_MOOF);
+            box.u32(TRACK_ID);
+            box.end_box(tfhd);
+
+            const size_t tfdt = box.begin_full_box("tfdt", 1, 0);
+            box.u64(static_cast<uint64_t>(fragment_decode_time_ - segment_base_decode_time_));
+            box.end_box(tfdt);
+
+            const size_t trun = box.begin_full_box("trun", 1, TRUN_FLAGS);
+            box.u32(sample_count_);
+            data_offset_at = box.size();
+            box.u32(0); // Patched once the moof size is known
+            for (uint32_t i = 0; i < sample_count_; ++i) {
+                const SampleEntry& entry = samples_[i];
+                box.u32(entry.duration);
+                box.u32(entry.size_bytes);
+                box.u32(entry.flags);
+                box.i32(entry.composition_offset);
+            }
+            box.end_box(trun);
+            box.end_box(traf);
+        }
+
+        size_t audio_offset_at = 0;
+        if (audio_count_ > 0) {
+            const size_t traf = box.begin_box("traf");
+            const size_t tfhd = box.begin_full_box("tfhd", 0, TFHD_DEFAULT_BASE_IS_MOOF);
+            box.u32(AUDIO_TRACK_ID);
+            box.end_box(tfhd);
+
+            const size_t tfdt = box.begin_full_box("tfdt", 1, 0);
+            box.u64(static_cast<uint64_t>(audio_fragment_decode_time_ - audio_segment_base()));
+            box.end_box(tfdt);
+
+            const size_t trun = box.begin_full_box("trun", 0, TRUN_AUDIO_FLAGS);
+            box.u32(audio_count_);
+            audio_offset_at = box.size();
+            box.u32(0); // Patched once the moof size is known
+            for (uint32_t i = 0; i < audio_count_; ++i) {
+                box.u32(audio_samples_[i].duration);
+                box.u32(audio_samples_[i].size_bytes);
+            }
+            box.end_box(trun);
+            box.end_box(traf);
+        }
+
+        if (cipher_ != nullptr &&
+            !encrypt_fragment(sequence, payload_count, payload_bytes, box, &ciphertext)) {
+            // Never write plaintext in place of a fragment that failed to encrypt
+            for (uint32_t i = 0; i < payload_count; ++i) {
+                payloads_[i] = WriteChunk{};
+            }
+            drop_fragment();
+            return false;
+        }
+        box.end_box(moof);
+
+        // Video begins right after the mdat header that follows this moof,
+        // and the fragment's audio right after the video
+        const size_t video_offset = box.size() + MDAT_HEADER_BYTES;
+        if (sample_count_ > 0) {
+            box.patch_u32(data_offset_at, static_cast<uint32_t>(video_offset));
+        }
+        if (audio_count_ > 0) {
+            box.patch_u32(audio_offset_at, static_cast<uint32_t>(video_offset + fragment_bytes_));
+        }
+    }
+
+    assert(payload_bytes + MDAT_HEADER_BYTES <= UINT32_MAX);
+    box.u32(static_cast<uint32_t>(payload_bytes + MDAT_HEADER_BYTES));
+    box.fourcc("mdat");
+
+    // A keyframe can only be the first sample of a fragment
+    if (sidecar_ != nullptr && sample_count_ > 0 && samples_[0].flags == SAMPLE_FLAGS_SYNC) {
+        const int64_t presentation =
+            fragment_decode_time_ + samples_[0].composition_offset - segment_base_decode_time_;
+        KeyframeEntry keyframe;
+        keyframe.media_time_us = presentation * 1000000 / config_.timescale;
+        keyframe.fragment_offset = writer_.segment_size_bytes();
+        keyframe.sample_offset = keyframe.fragment_offset + header->size();
+        keyframe.size_bytes = samples_[0].size_bytes;
+        if (!sidecar_->add_keyframe(keyframe)) {
+            LOG_WARNING("Sidecar index full, keyframe at {} us not indexed",
+                        keyframe.media_time_us);
+        }
+    }
+
+    stats_.header_bytes += header->size();
+    stats_.payload_bytes += payload_bytes;
+    stats_.samples_written += sample_count_;
+    stats_.audio_samples_written += audio_count_;
+    stats_.fragments_written++;
+
+    WriteChunk header_chunk;
+    header_chunk.data = header->data();
+    header_chunk.size_bytes = header->size();
+    header_chunk.keyframe = true;
+    header_chunk.owner = std::move(header);
+
+    // The chain hashes exactly what reaches the file: ciphertext when encrypting
+    if (chain_ != nullptr) {
+        const bool encrypted = cipher_ != nullptr;
+        chain_->submit(sequence,
+                       header_chunk,
+                       encrypted ? &ciphertext : payloads_.data(),
+                       encrypted ? 1 : payload_count);
+    }
+
+    bool ok = writer_.append(std::move(header_chunk), now);
+    if (cipher_ != nullptr) {
+        ok = writer_.append(std::move(ciphertext), now) && ok;
+    }
+    for (uint32_t i = 0; i < payload_count; ++i) {
+        if (cipher_ == nullptr) {
+            ok = writer_.append(std::move(payloads_[i]), now) && ok;
+        }
+        payloads_[i] = WriteChunk{};
+    }
+    sample_count_ = 0;
+    fragment_bytes_ = 0;
+    audio_count_ = 0;
+    return ok;
+}
+
+void Fmp4Muxer::drop_fragment() {
+    stats_.samples_dropped += sample_count_;
+    stats_.audio_samples_dropped += audio_count_;
+    sample_count_ = 0;
+    fragment_bytes_ = 0;
+    audio_count_ = 0;
+    audio_buffer_.reset();
+}
+
+int64_t Fmp4Muxer::audio_segment_base() const {
+    // Both tracks start at the segment's first video decode time
+    return segment_base_decode_time_ * config_.audio.sample_rate / config_.timescale;
+}
+
+bool Fmp4Muxer::end_segment(Clock::time_point now) {
+    assert(in_segment_);
+    const bool ok = flush_fragment(now);
+    in_segment_ = false;
+    return ok;
+}
+
+bool Fmp4Muxer::in_segment() const {
+    return in_segment_;
+}
+
+uint32_t Fmp4Muxer::pending_samples() const {
+    return sample_count_;
+}
+
+uint32_t Fmp4Muxer::pending_audio_samples() const {
+    return audio_count_;
+}
+
+bool Fmp4Muxer::has_audio() const {
+    return config_.audio.sample_rate > 0;
+}
+
+Fmp4MuxerStats Fmp4Muxer::stats() const {
+    return stats_;
+}
+
+std::shared_ptr<std::vector<uint8_t>> Fmp4Muxer::acquire_header_buffer() {
+    return acquire_pooled(header_pool_, &next_header_slot_, HEADER_BUFFER_RESERVE_BYTES);
+}
+
+std::shared_ptr<std::vector<uint8_t>> Fmp4Muxer::acquire_audio_buffer() {
+    return acquire_pooled(audio_pool_, &next_audio_slot_, AUDIO_BUFFER_RESERVE_BYTES);
+}
+
+std::shared_ptr<std::vector<uint8_t>> Fmp4Muxer::acquire_staging_buffer(size_t size_bytes) {
+    std::shared_ptr<std::vector<uint8_t>>* chosen = nullptr;
+    for (uint32_t i = 0; i < STAGING_POOL_SIZE; ++i) {
+        if (staging_pool_[i] && staging_pool_[i].use_count() == 1) {
+            chosen = &staging_pool_[i];
+            break;
+        }
+    }
+    if (chosen == nullptr) {
+        chosen = &staging_pool_[next_staging_slot_];
+        next_staging_slot_ = (next_staging_slot_ + 1) % STAGING_POOL_SIZE;
+        *chosen = std::make_shared<std::vector<uint8_t>>();
+    }
+
+    // Buffers only grow, so steady-state fragments never touch the allocator
+    if ((*chosen)->size() < size_bytes) {
+        (*chosen)->resize(size_bytes);
+    }
+    return *chosen;
+}
+
+bool Fmp4Muxer::encrypt_fragment(uint32_t sequence,
+                                 uint32_t payload_count,
+                                 uint64_t payload_bytes,
+                                 Mp4BoxWriter& box,
+                                 WriteChunk* ciphertext) {
+    assert(cipher_ != nullptr);
+    assert(payload_count > 0);
+
+    std::shared_ptr<std::vector<uint8_t>> staging = acquire_staging_buffer(payload_bytes);
+    const uint32_t chunks = cipher_->chunk_count(payload_bytes);
+    if (!cipher_->encrypt_fragment(
+            sequence, payloads_.data(), payload_count, staging->data(), tags_.data())) {
+        LOG_ERROR("Failed to encrypt fragment {}, dropping {} payloads", sequence, payload_count);
+        return false;
+    }
+
+    // Vendor box: one GCM tag per chunk of this fragment's mdat
+    const size_t dcet = box.begin_full_box(ENCRYPTION_TAGS_BOX, 0, 0);
+    box.u32(chunks);
+    box.bytes(tags_.data(), static_cast<size_t>(chunks) * ENCRYPTION_TAG_BYTES);
+    box.end_box(dcet);
+
+    ciphertext->data = staging->data();
+    ciphertext->size_bytes = static_cast<size_t>(payload_bytes);
+    ciphertext->keyframe = false;
+    ciphertext->owner = std::move(staging);
+    return true;
+}
+
+void Fmp4Muxer::write_init_segment(std::vector<uint8_t>* out) const {
+    Mp4BoxWriter box(out);
+
+    const size_t ftyp = box.begin_box("ftyp");
+    box.fourcc("iso6");
+    box.u32(0);
+    box.fourcc("iso6");
+    box.fourcc("cmfc");
+    box.fourcc("mp41");
+    box.end_box(ftyp);
+
+    const size_t moov = box.begin_box("moov");
+
+    const size_t mvhd = box.begin_full_box("mvhd", 0, 0);
+    box.u32(0);                     // creation_time
+    box.u32(0);                     // modification_time
+    box.u32(1000);                  // timescale
+    box.u32(0);                     // duration: unknown, fragments follow
+    box.u32(0x00010000);            // rate 1.0
+    box.u16(0x0100);                // volume 1.0
+    box.zeros(10);
+    box.unity_matrix();
+    box.zeros(24);                  // pre_defined
+    box.u32((has_audio() ? AUDIO_TRACK_ID : TRACK_ID) + 1);  // next_track_ID
+    box.end_box(mvhd);
+
+    write_track(box, false);
+    if (has_audio()) {
+        write_track(box, true);
+    }
+
+    const size_t mvex = box.begin_box("mvex");
+    const uint32_t last_track_id = has_audio() ? AUDIO_TRACK_ID : TRACK_ID;
+    for (uint32_t track_id = TRACK_ID; track_id <= last_track_id; ++track_id) {
+        const size_t trex = box.begin_full_box("trex", 0, 0);
+        box.u32(track_id);
+        box.u32(1);                 // default_sample_description_index
+        box.u32(0);
+        box.u32(0);
+        box.u32(0);
+        box.end_box(trex);
+    }
+    box.end_box(mvex);
+
+    if (cipher_ != nullptr) {
+        // Vendor box, skipped by players: how to derive this segment's key
+        const size_t dcek = box.begin_full_box(ENCRYPTION_KEY_BOX, 0, 0);
+        box.bytes(encryption_.salt.data(), encryption_.salt.size());
+        box.u32(encryption_.chunk_bytes);
+        box.end_box(dcek);
+    }
+
+    box.end_box(moov);
+}
+
+void Fmp4Muxer::write_track(Mp4BoxWriter& box, bool audio) const {
+    const size_t trak = box.begin_box("trak");
+    const size_t tkhd = box.begin_full_box("tkhd", 0, 0x000003); // enabled, in movie
+    box.u32(0);
+    box.u32(0);
+    box.u32(audio ? AUDIO_TRACK_ID : TRACK_ID);
+    box.u32(0);
+    box.u32(0);                     // duration
+    box.zeros(8);
+    box.u16(0);                     // layer
+    box.u16(audio ? 1 : 0);         // alternate_group
+    box.u16(audio ? 0x0100 : 0);    // volume: 1.0 for audio, 0 for video
+    box.u16(0);
+    box.unity_matrix();
+    box.u32(audio ? 0 : static_cast<uint32_t>(config_.width) << 16);
+    box.u32(audio ? 0 : static_cast<uint32_t>(config_.height) << 16);
+    box.end_box(tkhd);
+
+    const size_t mdia = box.begin_box("mdia");
+    const size_t mdhd = box.begin_full_box("mdhd", 0, 0);
+    box.u32(0);
+    box.u32(0);
+    box.u32(audio ? config_.audio.sample_rate : config_.timescale);
+    box.u32(0);
+    box.u16(0x55C4);                // language "und"
+    box.u16(0);
+    box.end_box(mdhd);
+
+    const size_t hdlr = box.begin_full_box("hdlr", 0, 0);
+    box.u32(0);
+    if (audio) {
+        box.fourcc("soun");
+        box.zeros(12);
+        box.bytes("SoundHandler", sizeof("SoundHandler"));
+    } else {
+        box.fourcc("vide");
+        box.zeros(12);
+        box.bytes("VideoHandler", sizeof("VideoHandler"));
+    }
+    box.end_box(hdlr);
+
+    const size_t minf = box.begin_box("minf");
+    if (audio) {
+        const size_t smhd = box.begin_full_box("smhd", 0, 0);
+        box.zeros(4);               // balance, reserved
+        box.end_box(smhd);
+    } else {
+        const size_t vmhd = box.begin_full_box("vmhd", 0, 1);
+        box.zeros(8);               // graphicsmode, opcolor
+        box.end_box(vmhd);
+    }
+
+    const size_t dinf = box.begin_box("dinf");
+    const size_t dref = box.begin_full_box("dref", 0, 0);
+    box.u32(1);
+    const size_t url = box.begin_full_box("url ", 0, 1); // Data is in this file
+    box.end_box(url);
+    box.end_box(dref);
+    box.end_box(dinf);
+
+    const size_t stbl = box.begin_box("stbl");
+    const size_t stsd = box.begin_full_box("stsd", 0, 0);
+    box.u32(1);
+    if (audio) {
+        write_audio_sample_entry(box);
+    } else {
+        write_sample_entry(box);
+    }
+    box.end_box(stsd);
+
+    // Sample tables are empty: every sample is described by a moof
+    for (const char* table : {"stts", "stsc", "stco"}) {
+        const size_t empty = box.begin_full_box(table, 0, 0);
+        box.u32(0);
+        box.end_box(empty);
+    }
+    const size_t stsz = box.begin_full_box("stsz", 0, 0);
+    box.u32(0);
+    box.u32(0);
+    box.end_box(stsz);
+    box.end_box(stbl);
+    box.end_box(minf);
+    box.end_box(mdia);
+    box.end_box(trak);
+}
+
+void Fmp4Muxer::write_sample_entry(Mp4BoxWriter& box) const {
+    const bool hevc = config_.codec == VideoCodec::H265;
+
+    const size_t entry = box.begin_box(hevc ? "hvc1" : "avc1");
+    box.zeros(6);
+    box.u16(1);                     // data_reference_index
+    box.zeros(16);                  // pre_defined, reserved
+    box.u16(config_.width);
+    box.u16(config_.height);
+    box.u32(0x00480000);            // 72 dpi
+    box.u32(0x00480000);
+    box.u32(0);
+    box.u16(1);                     // frame_count
+    box.zeros(32);                  // compressorname
+    box.u16(0x0018);                // depth
+    box.u16(0xFFFF);                // pre_defined = -1
+
+    const size_t config = box.begin_box(hevc ? "hvcC" : "avcC");
+    box.bytes(config_.decoder_config.data(), config_.decoder_config.size());
+    box.end_box(config);
+    box.end_box(entry);
+}
+
+void Fmp4Muxer::write_audio_sample_entry(Mp4BoxWriter& box) const {
+    assert(config_.audio.codec == AudioCodec::PcmS16);
+
+    // ISO/IEC 23003-5 uncompressed audio
+    const size_t entry = box.begin_box("ipcm");
+    box.zeros(6);
+    box.u16(1);                     // data_reference_index
+    box.zeros(8);                   // reserved
+    box.u16(config_.audio.channels);
+    box.u16(PCM_SAMPLE_BITS);       // samplesize
+    box.u16(0);                     // pre_defined
+    box.u16(0);
+    box.u32(config_.audio.sample_rate << 16);
+
+    const size_t pcmc = box.begin_full_box("pcmC", 0, 0);
+    box.u8(PCMC_LITTLE_ENDIAN);
+    box.u8(PCM_SAMPLE_BITS);
+    box.end_box(pcmc);
+    box.end_box(entry);
+}
+
+uint64_t fmp4_playable_prefix(const uint8_t* data, uint64_t size_bytes) {
+    assert(data != nullptr || size_bytes == 0);
+
+    uint64_t offset = 0;
+    uint64_t playable = 0;
+    bool have_moov = false;
+    bool after_moof = false;
+
+    for (uint32_t i = 0; i < MAX_RECOVERY_BOXES && offset + 8 <= size_bytes; ++i) {
+        uint64_t box_size = load_be32(data + offset);
+        char type[4];
+        std::memcpy(type, data + offset + 4, 4);
+        if (box_size == 1) {
+            if (offset + 16 > size_bytes) {
+                break;
+            }
+            box_size = load_be64(data + offset + 8);
+        }
+        if (box_size < 8 || box_size > size_bytes - offset) {
+            break; // Truncated or torn box
+        }
+        offset += box_size;
+
+        if (std::memcmp(type, "moov", 4) == 0) {
+            have_moov = true;
+            playable = offset;
+        } else if (std::memcmp(type, "moof", 4) == 0) {
+            after_moof = true;
+        } else if (std::memcmp(type, "mdat", 4) == 0 && after_moof && have_moov) {
+            after_moof = false;
+            playable = offset;
+        }
+    }
+    return have_moov ? playable : 0;
+}
+
+bool fmp4_decrypt_segment(uint8_t* data, uint64_t size_bytes, FragmentCipher& cipher) {
+    assert(data != nullptr || size_bytes == 0);
+
+    bool have_key = false;
+    uint32_t sequence = 0;
+    const uint8_t* tags = nullptr;     // Tags of the last moof, awaiting its mdat
+    uint32_t tag_count = 0;
+    uint64_t offset = 0;
+
+    for (uint32_t i = 0; i < MAX_RECOVERY_BOXES && offset + 8 <= size_bytes; ++i) {
+        const uint64_t box_size = load_be32(data + offset);
+        if (box_size < 8 || box_size > size_bytes - offset) {
+            break; // The muxer never writes 64-bit sizes; stop at a torn tail
+        }
+        uint8_t* body = data + offset + 8;
+        const auto body_size = static_cast<size_t>(box_size - 8);
+
+        if (std::memcmp(data + offset + 4, "moov", 4) == 0) {
+            const size_t at = find_child_box(body, body_size, ENCRYPTION_KEY_BOX);
+            if (at + FULL_BOX_HEADER_BYTES + ENCRYPTION_SALT_BYTES + 4 > body_size) {
+                LOG_ERROR("Segment has no encryption key box");
+                return false;
+            }
+            SegmentEncryption encryption;
+            const uint8_t* fields = body + at + FULL_BOX_HEADER_BYTES;
+            std::memcpy(encryption.salt.data(), fields, ENCRYPTION_SALT_BYTES);
+            encryption.chunk_bytes = load_be32(fields + ENCRYPTION_SALT_BYTES);
+            have_key = cipher.resume_segment(encryption);
+            if (!have_key) {
+                return false;
+            }
+        } else if (std::memcmp(data + offset + 4, "moof", 4) == 0) {
+            const size_t mfhd = find_child_box(body, body_size, "mfhd");
+            const size_t dcet = find_child_box(body, body_size, ENCRYPTION_TAGS_BOX);
+            if (mfhd + FULL_BOX_HEADER_BYTES + 4 > body_size ||
+                dcet + FULL_BOX_HEADER_BYTES + 4 > body_size) {
+                LOG_ERROR("Fragment at offset {} has no encryption tags", offset);
+                return false;
+            }
+            sequence = load_be32(body + mfhd + FULL_BOX_HEADER_BYTES);
+            tag_count = load_be32(body + dcet + FULL_BOX_HEADER_BYTES);
+            tags = body + dcet + FULL_BOX_HEADER_BYTES + 4;
+            if (dcet + FULL_BOX_HEADER_BYTES + 4 +
+                    static_cast<uint64_t>(tag_count) * ENCRYPTION_TAG_BYTES >
+                body_size) {
+                LOG_ERROR("Fragment {} has a truncated tag table", sequence);
+                return false;
+            }
+        } else if (std::memcmp(data + offset + 4, "mdat", 4) == 0 && tags != nullptr) {
+            if (!have_key || body_size == 0 || cipher.chunk_count(body_size) != tag_count ||
+                !cipher.decrypt_fragment(sequence, body, body_size, tags)) {
+                return false;
+            }
+            tags = nullptr;
+        }
+        offset += box_size;
+    }
+    return have_key;
+}
+
+} // namespace dashcam
@@ -0,0 +1,142 @@
+#include "dashcam/media/frame_buffer_pool.h"
+
+#include <cassert>
+#include <utility>
+
+namespace dashcam {
+
+struct FrameBuffer::Slot {
+    FrameBufferPool* pool = nullptr;
+    uint8_t* data = nullptr;
+    size_t capacity = 0;
+    uint32_t index = 0;
+    size_t size = 0;
+    std::atomic<uint32_t> refs{0};
+    std::shared_ptr<FrameBufferPool> keep_alive;     // Set while the buffer is in use; guarded by the pool mutex
+};
+
+FrameBuffer::~FrameBuffer() {
+    unref(slot_);
+}
+
+FrameBuffer::FrameBuffer(FrameBuffer&& other) noexcept : slot_(std::exchange(other.slot_, nullptr)) {}
+
+FrameBuffer& FrameBuffer::operator=(FrameBuffer&& other) noexcept {
+    if (this != &other) {
+        unref(slot_);
+        slot_ = std::exchange(other.slot_, nullptr);
+    }
+    return *this;
+}
+
+uint8_t* FrameBuffer::data() {
+    assert(slot_ != nullptr); // Tiger Style: assert preconditions
+    return slot_->data;
+}
+
+const uint8_t* FrameBuffer::data() const {
+    assert(slot_ != nullptr); // Tiger Style: assert preconditions
+    return slot_->data;
+}
+
+size_t FrameBuffer::size() const {
+    return slot_ != nullptr ? slot_->size : 0;
+}
+
+size_t FrameBuffer::capacity() const {
+    return slot_ != nullptr ? slot_->capacity : 0;
+}
+
+void FrameBuffer::resize(size_t size) {
+    // Tiger Style: assert preconditions
+    assert(slot_ != nullptr);
+    assert(size <= slot_->capacity);
+    slot_->size = size;
+}
+
+FrameBuffer FrameBuffer::share() const {
+    assert(slot_ != nullptr); // Tiger Style: assert preconditions
+    slot_->refs.fetch_add(1, std::memory_order_relaxed);
+    return FrameBuffer(slot_);
+}
+
+void* FrameBuffer::into_token() {
+    assert(slot_ != nullptr); // Tiger Style: assert preconditions
+    return std::exchange(slot_, nullptr);
+}
+
+void FrameBuffer::release_token(void* token) {
+    unref(static_cast<Slot*>(token));
+}
+
+void FrameBuffer::unref(Slot* slot) {
+    if (slot != nullptr && slot->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        slot->pool->release(slot);
+    }
+}
+
+std::shared_ptr<FrameBufferPool> FrameBufferPool::create(const FrameBufferPoolConfig& config) {
+    // Constructor is private; make_shared cannot reach it
+    return std::shared_ptr<FrameBufferPool>(new FrameBufferPool(config));
+}
+
+FrameBufferPool::FrameBufferPool(const FrameBufferPoolConfig& config)
+    : config_(config),
+      storage_(new uint8_t[static_cast<size_t>(config.buffers) * config.buffer_bytes]),
+      slots_(config.buffers) {
+    // Tiger Style: assert preconditions
+    assert(config_.buffers > 0);
+    assert(config_.buffer_bytes > 0);
+
+    free_.reserve(config_.buffers);
+    for (uint32_t i = 0; i < config_.buffers; ++i) {
+        FrameBuffer::Slot& slot = slots_[i];
+        slot.pool = this;
+        slot.data = storage_.get() + static_cast<size_t>(i) * config_.buffer_bytes;
+        slot.capacity = config_.buffer_bytes;
+        slot.index = i;
+        // Hand out low indexes first; their pages are the ones already touched
+        free_.push_back(config_.buffers - 1 - i);
+    }
+}
+
+FrameBufferPool::~FrameBufferPool() {
+    // Every buffer in use holds the pool, so none can be left
+    assert(free_.size() == config_.buffers);
+}
+
+FrameBuffer FrameBufferPool::acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.empty()) {
+        exhausted_.fetch_add(1, std::memory_order_relaxed);
+        return FrameBuffer();
+    }
+    FrameBuffer::Slot& slot = slots_[free_.back()];
+    free_.pop_back();
+    slot.size = 0;
+    slot.refs.store(1, std::memory_order_relaxed);
+    slot.keep_alive = shared_from_this();
+    acquired_.fetch_add(1, std::memory_order_relaxed);
+    return FrameBuffer(&slot);
+}
+
+FrameBufferPoolStats FrameBufferPool::stats() const {
+    FrameBufferPoolStats stats;
+    stats.acquired = acquired_.load(std::memory_order_relaxed);
+    stats.exhausted = exhausted_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.in_use = config_.buffers - free_.size();
+    return stats;
+}
+
+void FrameBufferPool::release(FrameBuffer::Slot* slot) {
+    std::shared_ptr<FrameBufferPool> self;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        self = std::move(slot->keep_alive);
+        free_.push_back(slot->index);
+    }
+    // `self` may be the last owner; the pool must not be touched after this
+}
+
+} // namespace dashcam
@@ -0,0 +1,129 @@
+#pragma once
+
+/**
+ * @file mp4_box_writer.h
+ * @brief Minimal ISO BMFF box serializer used by the MP4 muxers
+ *
+ * Boxes are written into a caller-owned byte vector. begin_box() reserves the
+ * 32-bit size field and end_box() patches it once the box body is complete,
+ * so nested boxes need no size precomputation. Reserve the vector's capacity
+ * up front to keep serialization free of reallocations.
+ */
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "dashcam/utils/byte_order.h"
+
+namespace dashcam {
+
+class Mp4BoxWriter {
+public:
+    explicit Mp4BoxWriter(std::vector<uint8_t>* out) : out_(out) {
+        assert(out_ != nullptr);
+    }
+
+    size_t size() const { return out_->size(); }
+
+    void u8(uint8_t value) { out_->push_back(value); }
+
+    void u16(uint16_t value) {
+        uint8_t* at = grow(2);
+        store_be16(at, value);
+    }
+
+    void u24(uint32_t value) {
+        assert(value <= 0xFFFFFF);
+        u8(static_cast<uint8_t>(value >> 16));
+        u16(static_cast<uint16_t>(value));
+    }
+
+    void u32(uint32_t value) {
+        uint8_t* at = grow(4);
+        store_be32(at, value);
+    }
+
+    void i32(int32_t value) { u32(static_cast<uint32_t>(value)); }
+
+    void u64(uint64_t value) {
+        uint8_t* at = grow(8);
+        store_be64(at, value);
+    }
+
+    void fourcc(const char* code) {
+        assert(std::strlen(code) == 4);
+        bytes(code, 4);
+    }
+
+    void bytes(const void* data, size_t size) {
+        if (size == 0) {
+            return;
+        }
+        uint8_t* at = grow(size);
+        std::memcpy(at, data, size);
+    }
+
+    void zeros(size_t count) {
+        uint8_t* at = grow(count);
+        std::memset(at, 0, count);
+    }
+
+    /**
+     * @brief Start a box; returns the offset to pass to end_box()
+     */
+    size_t begin_box(const char* type) {
+        const size_t start = size();
+        u32(0); // Patched by end_box()
+        fourcc(type);
+        return start;
+    }
+
+    /**
+     * @brief Start a full box (box header plus version and 24-bit flags)
+     */
+    size_t begin_full_box(const char* type, uint8_t version, uint32_t flags) {
+        const size_t start = begin_box(type);
+        u8(version);
+        u24(flags);
+        return start;
+    }
+
+    void end_box(size_t start) {
+        assert(start + 8 <= size());
+        const size_t box_size = size() - start;
+        assert(box_size <= UINT32_MAX);
+        store_be32(out_->data() + start, static_cast<uint32_t>(box_size));
+    }
+
+    /**
+     * @brief Overwrite a previously written 32-bit field
+     */
+    void patch_u32(size_t offset, uint32_t value) {
+        assert(offset + 4 <= size());
+        store_be32(out_->data() + offset, value);
+    }
+
+    /**
+     * @brief The identity matrix used by mvhd and tkhd
+     */
+    void unity_matrix() {
+        static constexpr uint32_t MATRIX[9] = {
+            0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+        for (const uint32_t value : MATRIX) {
+            u32(value);
+        }
+    }
+
+private:
+    uint8_t* grow(size_t count) {
+        const size_t at = out_->size();
+        out_->resize(at + count);
+        return out_->data() + at;
+    }
+
+    std::vector<uint8_t>* out_;
+};
+
+} // namespace dashcam
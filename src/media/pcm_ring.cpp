@@ -0,0 +1,75 @@
+#include "dashcam/media/pcm_ring.h"
+
+#include <cassert>
+
+namespace dashcam {
+
+PcmRing::PcmRing(uint32_t period_frames, uint16_t channels, uint32_t capacity_periods)
+    : period_frames_(period_frames),
+      channels_(channels),
+      capacity_(capacity_periods),
+      samples_(static_cast<size_t>(period_frames) * channels * capacity_periods),
+      infos_(capacity_periods) {
+    // Tiger Style: assert preconditions
+    assert(period_frames_ > 0);
+    assert(channels_ > 0);
+    assert(capacity_ > 0);
+}
+
+int16_t* PcmRing::begin_write() {
+    const uint64_t written = write_count_.load(std::memory_order_relaxed);
+    const uint64_t read = read_count_.load(std::memory_order_acquire);
+    if (written - read == capacity_) {
+        return nullptr;
+    }
+    const size_t slot = static_cast<size_t>(written % capacity_);
+    return samples_.data() + slot * period_frames_ * channels_;
+}
+
+void PcmRing::commit_write(const PcmPeriodInfo& info) {
+    assert(info.frames > 0 && info.frames <= period_frames_);
+    const uint64_t written = write_count_.load(std::memory_order_relaxed);
+    assert(written - read_count_.load(std::memory_order_relaxed) < capacity_);
+
+    infos_[static_cast<size_t>(written % capacity_)] = info;
+    // Release: the slot's samples and info are visible before the count
+    write_count_.store(written + 1, std::memory_order_release);
+}
+
+const int16_t* PcmRing::front(PcmPeriodInfo* info) const {
+    assert(info != nullptr);
+    const uint64_t read = read_count_.load(std::memory_order_relaxed);
+    if (write_count_.load(std::memory_order_acquire) == read) {
+        return nullptr;
+    }
+    const size_t slot = static_cast<size_t>(read % capacity_);
+    *info = infos_[slot];
+    return samples_.data() + slot * period_frames_ * channels_;
+}
+
+void PcmRing::pop() {
+    const uint64_t read = read_count_.load(std::memory_order_relaxed);
+    assert(write_count_.load(std::memory_order_relaxed) != read);
+    // Release: we are done reading the slot before the producer may reuse it
+    read_count_.store(read + 1, std::memory_order_release);
+}
+
+uint32_t PcmRing::size() const {
+    const uint64_t read = read_count_.load(std::memory_order_acquire);
+    const uint64_t written = write_count_.load(std::memory_order_acquire);
+    return static_cast<uint32_t>(written - read);
+}
+
+uint32_t PcmRing::capacity() const {
+    return capacity_;
+}
+
+uint32_t PcmRing::period_frames() const {
+    return period_frames_;
+}
+
+uint16_t PcmRing::channels() const {
+    return channels_;
+}
+
+} // namespace dashcam
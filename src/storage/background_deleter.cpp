@@ -0,0 +1,243 @@
+#include "dashcam/storage/background_deleter.h"
+#include "dashcam/storage/checkpoint_file.h"
+#include "dashcam/storage/segment_layout.h"
+#include "dashcam/utils/io_priority.h"
+#include "dashcam/utils/logger.h"
+#include "dashcam/utils/scoped_fd.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dashcam {
+
+BackgroundDeleter::BackgroundDeleter(const BackgroundDeleterConfig& config,
+                                     const LatencyHistogram* write_latency,
+                                     StorageAccounting* accounting,
+                                     const SegmentIndex* segments)
+    : config_(config), write_latency_(write_latency), accounting_(accounting), segments_(segments) {
+    assert(config_.truncate_step_bytes > 0); // Tiger Style: assert preconditions
+    assert(config_.max_pending_files > 0);
+    assert(config_.step_interval.count() >= 0);
+    assert(config_.throttle_backoff.count() >= 0);
+}
+
+BackgroundDeleter::~BackgroundDeleter() {
+    stop();
+}
+
+void BackgroundDeleter::start() {
+    assert(!thread_.joinable());
+
+    if (write_latency_ != nullptr) {
+        last_write_counts_ = write_latency_->bucket_counts();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_requested_ = false;
+    }
+    thread_ = std::thread([this] { run(); });
+}
+
+void BackgroundDeleter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_requested_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool BackgroundDeleter::enqueue(std::string_view path) {
+    assert(!path.empty());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_.size() >= config_.max_pending_files) {
+            files_rejected_.fetch_add(1, std::memory_order_relaxed);
+            LOG_WARNING("Deletion queue full, rejecting '{}'", path);
+            return false;
+        }
+        pending_.emplace_back(path);
+    }
+    wake_.notify_one();
+    return true;
+}
+
+BackgroundDeleterStats BackgroundDeleter::stats() const {
+    BackgroundDeleterStats stats;
+    stats.files_deleted = files_deleted_.load(std::memory_order_relaxed);
+    stats.files_failed = files_failed_.load(std::memory_order_relaxed);
+    stats.files_rejected = files_rejected_.load(std::memory_order_relaxed);
+    stats.files_deferred = files_deferred_.load(std::memory_order_relaxed);
+    stats.bytes_freed = bytes_freed_.load(std::memory_order_relaxed);
+    stats.truncate_steps = truncate_steps_.load(std::memory_order_relaxed);
+    stats.throttle_pauses = throttle_pauses_.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.pending_files = pending_.size();
+    return stats;
+}
+
+void BackgroundDeleter::run() {
+    if (config_.idle_io_priority) {
+        set_thread_idle_io_priority();
+    }
+
+    // Tiger Style: this loop is intentionally unbounded; it ends on stop()
+    while (true) {
+        std::string path;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return stop_requested_ || !pending_.empty(); });
+            if (pending_.empty()) {
+                return; // Stop requested and nothing left to delete
+            }
+            path = std::move(pending_.front());
+            pending_.pop_front();
+        }
+
+        if (segment_pinned(path)) {
+            files_deferred_.fetch_add(1, std::memory_order_relaxed);
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (stop_requested_) {
+                LOG_WARNING("Leaving '{}' in place: its segment is still pinned", path);
+                continue;
+            }
+            pending_.push_back(std::move(path));
+            // Give the pin holder time before this file comes round again
+            wake_.wait_for(lock, config_.throttle_backoff, [this] { return stop_requested_; });
+            continue;
+        }
+        delete_file(path);
+    }
+}
+
+bool BackgroundDeleter::segment_pinned(const std::string& path) const {
+    if (segments_ == nullptr) {
+        return false;
+    }
+    const size_t slash = path.find_last_of('/');
+    const std::string_view file_name = slash == std::string::npos
+                                           ? std::string_view(path)
+                                           : std::string_view(path).substr(slash + 1);
+    const auto name = SegmentLayout::parse_file_name(file_name);
+    if (!name) {
+        return false;
+    }
+    const std::optional<SegmentInfo> segment = segments_->find(name->segment_id);
+    return segment && segment->path == path && segment->pin_count > 0;
+}
+
+void BackgroundDeleter::delete_file(const std::string& path) {
+    ScopedFd fd(::open(path.c_str(), O_WRONLY | O_CLOEXEC));
+    struct stat info {};
+    if (!fd.is_valid() || ::fstat(fd.get(), &info) != 0) {
+        if (errno == ENOENT) {
+            LOG_WARNING("Segment '{}' already gone", path);
+        } else {
+            LOG_ERROR("Cannot open '{}' for deletion: {}", path, std::strerror(errno));
+        }
+        files_failed_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // A second link is a protected clip sharing this inode: leave its data alone
+    const bool shared_inode = info.st_nlink > 1;
+    const auto size_bytes = static_cast<uint64_t>(info.st_size);
+    if (!shared_inode && !truncate_in_steps(fd.get(), path, size_bytes)) {
+        files_failed_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    fd.reset();
+
+    if (::unlink(path.c_str()) != 0) {
+        LOG_ERROR("Failed to unlink '{}': {}", path, std::strerror(errno));
+        files_failed_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    files_deleted_.fetch_add(1, std::memory_order_relaxed);
+
+    // Its signed checkpoints go with it; a protected copy has its own
+    const std::string checkpoints = checkpoint_file_path(path);
+    if (::unlink(checkpoints.c_str()) != 0 && errno != ENOENT) {
+        LOG_WARNING("Failed to unlink '{}': {}", checkpoints, std::strerror(errno));
+    }
+    LOG_DEBUG("Deleted segment '{}' ({} bytes{})",
+              path,
+              size_bytes,
+              shared_inode ? ", data kept by another link" : "");
+}
+
+bool BackgroundDeleter::truncate_in_steps(int fd, const std::string& path, uint64_t size_bytes) {
+    uint64_t remaining = size_bytes;
+    // Bounded by the number of steps in the file; each step shrinks it
+    const uint64_t max_steps = size_bytes / config_.truncate_step_bytes + 1;
+    for (uint64_t step = 0; step < max_steps && remaining > 0; ++step) {
+        pace();
+
+        const uint64_t next_size =
+            remaining > config_.truncate_step_bytes ? remaining - config_.truncate_step_bytes : 0;
+        if (::ftruncate(fd, static_cast<off_t>(next_size)) != 0) {
+            LOG_ERROR("ftruncate of '{}' failed: {}", path, std::strerror(errno));
+            return false;
+        }
+
+        const uint64_t freed = remaining - next_size;
+        remaining = next_size;
+        truncate_steps_.fetch_add(1, std::memory_order_relaxed);
+        bytes_freed_.fetch_add(freed, std::memory_order_relaxed);
+        if (accounting_ != nullptr) {
+            accounting_->on_evict(freed);
+        }
+    }
+    return remaining == 0;
+}
+
+void BackgroundDeleter::pace() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (stop_requested_) {
+        return; // Shutting down: recording is over, delete at full speed
+    }
+    wake_.wait_for(lock, config_.step_interval, [this] { return stop_requested_; });
+
+    for (uint32_t i = 0; i < config_.max_consecutive_throttles && !stop_requested_; ++i) {
+        lock.unlock();
+        const bool high = write_latency_high();
+        lock.lock();
+        if (!high) {
+            return;
+        }
+        throttle_pauses_.fetch_add(1, std::memory_order_relaxed);
+        wake_.wait_for(lock, config_.throttle_backoff, [this] { return stop_requested_; });
+    }
+}
+
+bool BackgroundDeleter::write_latency_high() {
+    if (write_latency_ == nullptr) {
+        return false;
+    }
+
+    // p99 over the writes recorded since the previous check only
+    const LatencyHistogram::BucketCounts current = write_latency_->bucket_counts();
+    LatencyHistogram::BucketCounts window{};
+    uint64_t samples = 0;
+    for (uint32_t i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i) {
+        window[i] = current[i] >= last_write_counts_[i] ? current[i] - last_write_counts_[i] : 0;
+        samples += window[i];
+    }
+    last_write_counts_ = current;
+
+    if (samples < config_.min_window_samples) {
+        return false;
+    }
+    return LatencyHistogram::percentile_of(window, 99.0) > config_.max_write_p99;
+}
+
+} // namespace dashcam
@@ -0,0 +1,160 @@
+#include "dashcam/storage/checkpoint_file.h"
+#include "dashcam/utils/byte_order.h"
+#include "dashcam/utils/crc32.h"
+#include "dashcam/utils/logger.h"
+#include "dashcam/utils/scoped_fd.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dashcam {
+
+namespace {
+
+constexpr std::string_view SEGMENT_SUFFIX = ".mp4";
+constexpr std::string_view CHECKPOINT_SUFFIX = ".chain";
+
+constexpr size_t CRC_OFFSET = CHECKPOINT_RECORD_BYTES - 4;
+
+// A segment is at most an hour at one checkpoint per fragment, with headroom
+constexpr uint64_t MAX_CHECKPOINT_FILE_BYTES = (1u << 16) * CHECKPOINT_RECORD_BYTES;
+
+// Same bound as the event log: short writes and EINTR retry this often
+constexpr uint32_t MAX_IO_ATTEMPTS = 64;
+
+void encode(const IntegrityCheckpoint& checkpoint, uint8_t* out) {
+    store_le64(out, checkpoint.segment_id);
+    store_le32(out + 8, checkpoint.fragment_sequence);
+    std::memcpy(out + 12, checkpoint.genesis.data(), checkpoint.genesis.size());
+    std::memcpy(out + 44, checkpoint.chain_hash.data(), checkpoint.chain_hash.size());
+    std::memcpy(out + 76, checkpoint.signature.data(), checkpoint.signature.size());
+    store_le32(out + CRC_OFFSET, crc32(out, CRC_OFFSET));
+}
+
+bool decode(const uint8_t* in, IntegrityCheckpoint* checkpoint) {
+    if (load_le32(in + CRC_OFFSET) != crc32(in, CRC_OFFSET)) {
+        return false;
+    }
+    checkpoint->segment_id = load_le64(in);
+    checkpoint->fragment_sequence = load_le32(in + 8);
+    std::memcpy(checkpoint->genesis.data(), in + 12, checkpoint->genesis.size());
+    std::memcpy(checkpoint->chain_hash.data(), in + 44, checkpoint->chain_hash.size());
+    std::memcpy(checkpoint->signature.data(), in + 76, checkpoint->signature.size());
+    return true;
+}
+
+void sync_parent_directory(const std::string& path) {
+    const size_t slash = path.find_last_of('/');
+    const std::string directory = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+    ScopedFd fd(::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (fd.is_valid()) {
+        ::fsync(fd.get());
+    }
+}
+
+} // namespace
+
+static_assert(CHECKPOINT_RECORD_BYTES == 76 + 64 + 4, "record layout");
+
+std::string checkpoint_file_path(std::string_view segment_path) {
+    assert(!segment_path.empty()); // Tiger Style: assert preconditions
+    if (segment_path.size() > SEGMENT_SUFFIX.size() &&
+        segment_path.substr(segment_path.size() - SEGMENT_SUFFIX.size()) == SEGMENT_SUFFIX) {
+        segment_path.remove_suffix(SEGMENT_SUFFIX.size());
+    }
+    return std::string(segment_path) + std::string(CHECKPOINT_SUFFIX);
+}
+
+bool append_checkpoint_file(std::string_view path, const IntegrityCheckpoint& checkpoint) {
+    const std::string file(path);
+    ScopedFd fd(::open(file.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644));
+    struct stat info {};
+    if (!fd.is_valid() || ::fstat(fd.get(), &info) != 0) {
+        LOG_ERROR("Cannot open checkpoint file '{}': {}", file, std::strerror(errno));
+        return false;
+    }
+
+    // Cut off a record torn by a crash, or every later record would be unreadable
+    const auto size = static_cast<uint64_t>(info.st_size);
+    const uint64_t end = size - size % CHECKPOINT_RECORD_BYTES;
+    if (end != size && ::ftruncate(fd.get(), static_cast<off_t>(end)) != 0) {
+        LOG_ERROR("Cannot trim checkpoint file '{}': {}", file, std::strerror(errno));
+        return false;
+    }
+
+    uint8_t record[CHECKPOINT_RECORD_BYTES];
+    encode(checkpoint, record);
+    size_t written = 0;
+    for (uint32_t attempt = 0; attempt < MAX_IO_ATTEMPTS && written < sizeof(record); ++attempt) {
+        const ssize_t result = ::pwrite(fd.get(),
+                                        record + written,
+                                        sizeof(record) - written,
+                                        static_cast<off_t>(end + written));
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            break;
+        }
+        written += static_cast<size_t>(result);
+    }
+    if (written != sizeof(record) || ::fdatasync(fd.get()) != 0) {
+        LOG_ERROR("Cannot write checkpoint to '{}': {}", file, std::strerror(errno));
+        return false;
+    }
+
+    if (size == 0) {
+        // The new name must survive a power loss along with the record
+        sync_parent_directory(file);
+    }
+    return true;
+}
+
+std::vector<IntegrityCheckpoint> load_checkpoint_file(std::string_view path) {
+    std::vector<IntegrityCheckpoint> checkpoints;
+    const std::string file(path);
+    ScopedFd fd(::open(file.c_str(), O_RDONLY | O_CLOEXEC));
+    struct stat info {};
+    if (!fd.is_valid() || ::fstat(fd.get(), &info) != 0) {
+        if (errno != ENOENT) {
+            LOG_WARNING("Cannot open checkpoint file '{}': {}", file, std::strerror(errno));
+        }
+        return checkpoints;
+    }
+
+    const uint64_t size = std::min<uint64_t>(static_cast<uint64_t>(info.st_size), MAX_CHECKPOINT_FILE_BYTES);
+    const uint64_t records = size / CHECKPOINT_RECORD_BYTES;
+    std::vector<uint8_t> data(static_cast<size_t>(records * CHECKPOINT_RECORD_BYTES));
+    size_t done = 0;
+    for (uint32_t attempt = 0; attempt < MAX_IO_ATTEMPTS && done < data.size(); ++attempt) {
+        const ssize_t result = ::pread(fd.get(), data.data() + done, data.size() - done, static_cast<off_t>(done));
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            break;
+        }
+        done += static_cast<size_t>(result);
+    }
+
+    checkpoints.reserve(done / CHECKPOINT_RECORD_BYTES);
+    for (size_t offset = 0; offset + CHECKPOINT_RECORD_BYTES <= done; offset += CHECKPOINT_RECORD_BYTES) {
+        IntegrityCheckpoint checkpoint;
+        if (!decode(data.data() + offset, &checkpoint)) {
+            LOG_WARNING("Checkpoint file '{}' is corrupt at record {}; ignoring the rest",
+                        file,
+                        offset / CHECKPOINT_RECORD_BYTES);
+            break;
+        }
+        checkpoints.push_back(checkpoint);
+    }
+    return checkpoints;
+}
+
+} // namespace dashcam
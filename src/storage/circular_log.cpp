@@ -0,0 +1,694 @@
+#include "dashcam/storage/circular_log.h"
+#include "dashcam/utils/byte_order.h"
+#include "dashcam/utils/crc32.h"
+#include "dashcam/utils/logger.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dashcam {
+
+namespace {
+
+constexpr uint64_t SUPERBLOCK_MAGIC = 0x3130474E49524344ull; // "DCRING01" little-endian
+constexpr uint32_t SUPERBLOCK_VERSION = 1;
+constexpr uint32_t SUPERBLOCK_ENCODED_SIZE = 104;
+constexpr uint32_t RECORD_MAGIC = 0x43455244u; // "DREC" little-endian
+constexpr uint16_t RECORD_TYPE_DATA = 1;
+constexpr uint16_t RECORD_TYPE_PAD = 2;
+constexpr uint16_t RECORD_FLAG_KEYFRAME = 1;
+constexpr uint32_t MAX_WRITE_ATTEMPTS_PER_BATCH = 64;
+
+// Smallest ring worth running: room for a handful of maximum-size batches
+constexpr uint64_t MIN_DATA_CAPACITY = 64 * 1024;
+
+constexpr std::array<uint8_t, CircularRecordLog::RECORD_ALIGNMENT> ZERO_PADDING{};
+
+uint64_t record_span(uint64_t payload_size) {
+    const uint64_t raw = CircularRecordLog::RECORD_HEADER_SIZE + payload_size;
+    const uint64_t alignment = CircularRecordLog::RECORD_ALIGNMENT;
+    return (raw + alignment - 1) / alignment * alignment;
+}
+
+struct RecordHeader {
+    uint16_t type = 0;
+    uint16_t flags = 0;
+    uint64_t sequence = 0;
+    int64_t timestamp_us = 0;
+    uint32_t payload_size = 0;
+    uint32_t payload_crc = 0;
+};
+
+void encode_record_header(const RecordHeader& header, uint8_t* out) {
+    std::memset(out, 0, CircularRecordLog::RECORD_HEADER_SIZE);
+    store_le32(out + 0, RECORD_MAGIC);
+    store_le16(out + 4, header.type);
+    store_le16(out + 6, header.flags);
+    store_le64(out + 8, header.sequence);
+    store_le64(out + 16, static_cast<uint64_t>(header.timestamp_us));
+    store_le32(out + 24, header.payload_size);
+    store_le32(out + 28, header.payload_crc);
+    store_le32(out + 32, crc32(out, 32));
+}
+
+bool decode_record_header(const uint8_t* in, RecordHeader* header) {
+    if (load_le32(in + 0) != RECORD_MAGIC) {
+        return false;
+    }
+    if (load_le32(in + 32) != crc32(in, 32)) {
+        return false;
+    }
+    header->type = load_le16(in + 4);
+    header->flags = load_le16(in + 6);
+    header->sequence = load_le64(in + 8);
+    header->timestamp_us = static_cast<int64_t>(load_le64(in + 16));
+    header->payload_size = load_le32(in + 24);
+    header->payload_crc = load_le32(in + 28);
+    return header->type == RECORD_TYPE_DATA || header->type == RECORD_TYPE_PAD;
+}
+
+bool read_exact(int fd, uint8_t* out, size_t size, uint64_t offset) {
+    size_t done = 0;
+    while (done < size) {
+        const ssize_t result =
+            ::pread(fd, out + done, size - done, static_cast<off_t>(offset + done));
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            return false;
+        }
+        done += static_cast<size_t>(result);
+    }
+    return true;
+}
+
+bool preallocate(int fd, uint64_t size) {
+#if defined(__linux__)
+    // Reserve real blocks up front: the ring must never hit ENOSPC mid-lap
+    return ::posix_fallocate(fd, 0, static_cast<off_t>(size)) == 0;
+#else
+    return ::ftruncate(fd, static_cast<off_t>(size)) == 0;
+#endif
+}
+
+} // namespace
+
+CircularRecordLog::~CircularRecordLog() {
+    if (is_open()) {
+        close(Clock::now());
+    }
+}
+
+bool CircularRecordLog::open(std::string_view path, const CircularLogConfig& config) {
+    assert(!is_open()); // Tiger Style: assert preconditions
+    assert(!path.empty());
+    assert(config.label.size() <= MAX_LABEL_LENGTH);
+    assert(config.max_batch_bytes > 0);
+
+    path_ = std::string(path);
+    config_ = config;
+
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        LOG_ERROR("Failed to open circular log '{}': {}", path_, std::strerror(errno));
+        return false;
+    }
+
+    struct stat info {};
+    if (::fstat(fd_, &info) != 0) {
+        LOG_ERROR("Failed to stat circular log '{}': {}", path_, std::strerror(errno));
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    uint64_t file_size = static_cast<uint64_t>(info.st_size);
+    if (S_ISBLK(info.st_mode)) {
+        const off_t device_size = ::lseek(fd_, 0, SEEK_END);
+        file_size = device_size > 0 ? static_cast<uint64_t>(device_size) : 0;
+    } else if (file_size == 0) {
+        file_size = config_.file_size_bytes;
+        if (file_size < DATA_OFFSET + MIN_DATA_CAPACITY || !preallocate(fd_, file_size)) {
+            LOG_ERROR("Failed to preallocate {} bytes for circular log '{}'", file_size, path_);
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+    }
+
+    if (file_size < DATA_OFFSET + MIN_DATA_CAPACITY) {
+        LOG_ERROR("Circular log '{}' is too small ({} bytes)", path_, file_size);
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    data_capacity_ = (file_size - DATA_OFFSET) / RECORD_ALIGNMENT * RECORD_ALIGNMENT;
+
+    Superblock superblock;
+    const bool ok = load_superblock(&superblock) ? recover(superblock) : format(file_size);
+    if (!ok) {
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    const auto now = Clock::now();
+    last_sync_at_ = now;
+    last_checkpoint_at_ = now;
+    LOG_INFO("Circular log '{}' open: {} bytes of ring, {} live records",
+             path_,
+             data_capacity_,
+             index_.size());
+    return true;
+}
+
+bool CircularRecordLog::append(WriteChunk chunk, int64_t timestamp_us, Clock::time_point now) {
+    assert(is_open());
+    assert(chunk.data != nullptr);
+    assert(chunk.size_bytes > 0);
+
+    if (timestamp_us < last_timestamp_us_) {
+        LOG_ERROR("Circular log '{}' rejected record: timestamp {} precedes {}",
+                  path_,
+                  timestamp_us,
+                  last_timestamp_us_);
+        return false;
+    }
+    const uint64_t span = record_span(chunk.size_bytes);
+    if (span > data_capacity_ / 2 || chunk.size_bytes > UINT32_MAX) {
+        LOG_ERROR("Circular log '{}' rejected {} byte record: ring too small",
+                  path_,
+                  chunk.size_bytes);
+        return false;
+    }
+
+    bool ok = true;
+    if (chunk.keyframe && config_.durability.mode == DurabilityMode::OnKeyframe) {
+        ok = flush() && ok;
+        ok = sync_data(now) && ok;
+    }
+    if (batch_records_ == MAX_BATCH_RECORDS) {
+        ok = flush() && ok;
+    }
+    if (head_offset_ + span > data_capacity_) {
+        ok = queue_padding() && ok;
+    }
+    if (!reserve(head_offset_, head_offset_ + span)) {
+        return false;
+    }
+
+    RecordHeader header;
+    header.type = RECORD_TYPE_DATA;
+    header.flags = chunk.keyframe ? RECORD_FLAG_KEYFRAME : 0;
+    header.sequence = next_sequence_;
+    header.timestamp_us = timestamp_us;
+    header.payload_size = static_cast<uint32_t>(chunk.size_bytes);
+    header.payload_crc = crc32(chunk.data, chunk.size_bytes);
+
+    if (batch_records_ == 0) {
+        batch_offset_ = head_offset_;
+        batch_started_at_ = now;
+    }
+    assert(batch_offset_ + batch_bytes_ == head_offset_);
+
+    uint8_t* encoded = batch_headers_[batch_records_].data();
+    encode_record_header(header, encoded);
+    iovecs_[batch_iovecs_++] = iovec{encoded, RECORD_HEADER_SIZE};
+    iovecs_[batch_iovecs_++] = iovec{const_cast<uint8_t*>(chunk.data), chunk.size_bytes};
+    const uint64_t padding = span - RECORD_HEADER_SIZE - chunk.size_bytes;
+    if (padding > 0) {
+        iovecs_[batch_iovecs_++] = iovec{const_cast<uint8_t*>(ZERO_PADDING.data()), padding};
+    }
+    assert(batch_iovecs_ <= iovecs_.size());
+
+    RingRecordInfo info;
+    info.sequence = next_sequence_;
+    info.offset = head_offset_;
+    info.timestamp_us = timestamp_us;
+    info.size_bytes = header.payload_size;
+    info.keyframe = chunk.keyframe;
+    index_.push_back(info);
+
+    stats_.records_appended++;
+    stats_.payload_bytes_written += chunk.size_bytes;
+    batch_payloads_[batch_records_] = std::move(chunk);
+    batch_records_++;
+    batch_bytes_ += span;
+    head_offset_ += span;
+    next_sequence_++;
+    last_timestamp_us_ = timestamp_us;
+
+    if (batch_bytes_ >= config_.max_batch_bytes) {
+        ok = flush() && ok;
+    }
+    return poll(now) && ok;
+}
+
+bool CircularRecordLog::poll(Clock::time_point now) {
+    if (!is_open()) {
+        return true;
+    }
+
+    bool ok = true;
+    if (batch_records_ > 0 && now - batch_started_at_ >= config_.max_batch_latency) {
+        ok = flush() && ok;
+    }
+    if (config_.durability.mode == DurabilityMode::Periodic && unsynced_ &&
+        now - last_sync_at_ >= config_.durability.sync_interval) {
+        ok = sync_data(now) && ok;
+    }
+    if (now - last_checkpoint_at_ >= config_.checkpoint_interval) {
+        ok = checkpoint(now) && ok;
+    }
+    return ok;
+}
+
+bool CircularRecordLog::flush() {
+    if (batch_records_ == 0) {
+        return true;
+    }
+    const bool ok = write_batch();
+    release_batch();
+    return ok;
+}
+
+bool CircularRecordLog::checkpoint(Clock::time_point now) {
+    assert(is_open());
+    const bool flushed = flush();
+    const bool persisted = write_superblock();
+    last_checkpoint_at_ = now;
+    if (persisted) {
+        last_sync_at_ = now;
+    }
+    return flushed && persisted;
+}
+
+bool CircularRecordLog::close(Clock::time_point now) {
+    if (!is_open()) {
+        return true;
+    }
+    bool ok = checkpoint(now);
+    if (::close(fd_) != 0) {
+        LOG_ERROR("Failed to close circular log '{}': {}", path_, std::strerror(errno));
+        ok = false;
+    }
+    fd_ = -1;
+    index_.clear();
+    return ok;
+}
+
+bool CircularRecordLog::is_open() const {
+    return fd_ >= 0;
+}
+
+std::vector<RingRecordInfo> CircularRecordLog::records_between(int64_t start_us,
+                                                               int64_t end_us) const {
+    std::vector<RingRecordInfo> records;
+    if (start_us > end_us) {
+        return records;
+    }
+
+    auto it = std::lower_bound(index_.begin(),
+                               index_.end(),
+                               start_us,
+                               [](const RingRecordInfo& record, int64_t timestamp) {
+                                   return record.timestamp_us < timestamp;
+                               });
+    for (; it != index_.end() && it->timestamp_us <= end_us; ++it) {
+        records.push_back(*it);
+    }
+    return records;
+}
+
+bool CircularRecordLog::read_record(const RingRecordInfo& record,
+                                    std::vector<uint8_t>* payload) const {
+    assert(is_open());
+    assert(payload != nullptr);
+    assert(record.offset + RECORD_HEADER_SIZE <= data_capacity_);
+
+    std::array<uint8_t, RECORD_HEADER_SIZE> encoded{};
+    RecordHeader header;
+    if (!read_exact(fd_, encoded.data(), encoded.size(), DATA_OFFSET + record.offset) ||
+        !decode_record_header(encoded.data(), &header)) {
+        return false;
+    }
+    if (header.type != RECORD_TYPE_DATA || header.sequence != record.sequence) {
+        return false; // Overwritten since the caller looked it up
+    }
+
+    payload->resize(header.payload_size);
+    if (!read_exact(fd_,
+                    payload->data(),
+                    payload->size(),
+                    DATA_OFFSET + record.offset + RECORD_HEADER_SIZE)) {
+        return false;
+    }
+    return crc32(payload->data(), payload->size()) == header.payload_crc;
+}
+
+size_t CircularRecordLog::record_count() const {
+    return index_.size();
+}
+
+uint64_t CircularRecordLog::data_capacity_bytes() const {
+    return data_capacity_;
+}
+
+CircularLogStats CircularRecordLog::stats() const {
+    return stats_;
+}
+
+bool CircularRecordLog::format(uint64_t file_size) {
+    assert(fd_ >= 0);
+    LOG_INFO("Formatting circular log '{}' ({} bytes)", path_, file_size);
+
+    index_.clear();
+    head_offset_ = 0;
+    next_sequence_ = 1;
+    superblock_generation_ = 0;
+    persisted_tail_sequence_ = 0;
+    last_timestamp_us_ = INT64_MIN;
+
+    // Invalidate any record at the start of the ring left by an older format,
+    // otherwise recovery could follow a stale chain with matching sequences.
+    std::array<uint8_t, RECORD_HEADER_SIZE> zeros{};
+    if (::pwrite(fd_, zeros.data(), zeros.size(), static_cast<off_t>(DATA_OFFSET)) !=
+        static_cast<ssize_t>(zeros.size())) {
+        LOG_ERROR("Failed to format circular log '{}': {}", path_, std::strerror(errno));
+        return false;
+    }
+    return write_superblock();
+}
+
+bool CircularRecordLog::recover(const Superblock& superblock) {
+    superblock_generation_ = superblock.generation;
+    persisted_tail_sequence_ = superblock.tail_sequence;
+    if (superblock.label != config_.label) {
+        LOG_WARNING("Circular log '{}' belongs to '{}', not '{}'",
+                    path_,
+                    superblock.label,
+                    config_.label);
+    }
+
+    // Every payload is verified: a header can reach the card without its
+    // payload, and bad media can corrupt records the superblock covers.
+    size_t recovered = scan_from(superblock.tail_offset, superblock.tail_sequence);
+    if (recovered == 0) {
+        recovered = scan_from(superblock.head_offset, superblock.head_sequence);
+    }
+    if (recovered == 0) {
+        head_offset_ = superblock.head_offset;
+        next_sequence_ = superblock.head_sequence;
+    }
+
+    last_timestamp_us_ = index_.empty() ? INT64_MIN : index_.back().timestamp_us;
+    LOG_INFO("Recovered {} records from circular log '{}'", recovered, path_);
+    return true;
+}
+
+size_t CircularRecordLog::scan_from(uint64_t offset, uint64_t sequence) {
+    index_.clear();
+    uint64_t position = offset;
+    uint64_t expected = sequence;
+    std::array<uint8_t, RECORD_HEADER_SIZE> encoded{};
+    std::vector<uint8_t> payload;
+
+    // Every record is at least one header long, so this bounds a full lap
+    const uint64_t max_steps = data_capacity_ / RECORD_HEADER_SIZE + 2;
+    for (uint64_t step = 0; step < max_steps; ++step) {
+        if (position + RECORD_HEADER_SIZE > data_capacity_) {
+            position = 0; // Implicit wrap: too little room left for a pad record
+        }
+
+        RecordHeader header;
+        if (!read_exact(fd_, encoded.data(), encoded.size(), DATA_OFFSET + position) ||
+            !decode_record_header(encoded.data(), &header) || header.sequence != expected) {
+            break;
+        }
+        if (header.type == RECORD_TYPE_PAD) {
+            position = 0;
+            continue;
+        }
+
+        const uint64_t span = record_span(header.payload_size);
+        if (position + span > data_capacity_) {
+            break;
+        }
+        payload.resize(header.payload_size);
+        const uint64_t payload_offset = DATA_OFFSET + position + RECORD_HEADER_SIZE;
+        if (!read_exact(fd_, payload.data(), payload.size(), payload_offset) ||
+            crc32(payload.data(), payload.size()) != header.payload_crc) {
+            break; // Torn or stale payload: nothing after it is trusted
+        }
+
+        RingRecordInfo info;
+        info.sequence = header.sequence;
+        info.offset = position;
+        info.timestamp_us = header.timestamp_us;
+        info.size_bytes = header.payload_size;
+        info.keyframe = (header.flags & RECORD_FLAG_KEYFRAME) != 0;
+        index_.push_back(info);
+
+        position += span;
+        expected++;
+    }
+
+    head_offset_ = position;
+    next_sequence_ = expected;
+    return index_.size();
+}
+
+bool CircularRecordLog::load_superblock(Superblock* superblock) const {
+    assert(superblock != nullptr);
+
+    bool found = false;
+    std::array<uint8_t, SUPERBLOCK_ENCODED_SIZE> encoded{};
+    for (uint64_t slot = 0; slot < 2; ++slot) {
+        if (!read_exact(fd_, encoded.data(), encoded.size(), slot * SUPERBLOCK_SIZE)) {
+            continue;
+        }
+        if (load_le64(encoded.data()) != SUPERBLOCK_MAGIC ||
+            load_le32(encoded.data() + 8) != SUPERBLOCK_VERSION ||
+            load_le32(encoded.data() + 12) !=
+                crc32(encoded.data() + 16, SUPERBLOCK_ENCODED_SIZE - 16)) {
+            continue;
+        }
+
+        Superblock candidate;
+        candidate.generation = load_le64(encoded.data() + 16);
+        candidate.file_size = load_le64(encoded.data() + 24);
+        candidate.tail_offset = load_le64(encoded.data() + 40);
+        candidate.tail_sequence = load_le64(encoded.data() + 48);
+        candidate.head_offset = load_le64(encoded.data() + 56);
+        candidate.head_sequence = load_le64(encoded.data() + 64);
+        const auto* label = reinterpret_cast<const char*>(encoded.data() + 72);
+        candidate.label.assign(label, strnlen(label, MAX_LABEL_LENGTH));
+
+        if (candidate.tail_offset >= data_capacity_ || candidate.head_offset >= data_capacity_) {
+            continue;
+        }
+        if (!found || candidate.generation > superblock->generation) {
+            *superblock = candidate;
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool CircularRecordLog::write_superblock() {
+    assert(fd_ >= 0);
+    assert(batch_records_ == 0); // Head must describe written data only
+
+    const uint64_t tail_offset = index_.empty() ? head_offset_ : index_.front().offset;
+    const uint64_t tail_sequence = index_.empty() ? next_sequence_ : index_.front().sequence;
+
+    std::array<uint8_t, SUPERBLOCK_SIZE> block{};
+    uint8_t* out = block.data();
+    const uint64_t generation = superblock_generation_ + 1;
+    store_le64(out + 0, SUPERBLOCK_MAGIC);
+    store_le32(out + 8, SUPERBLOCK_VERSION);
+    store_le64(out + 16, generation);
+    store_le64(out + 24, DATA_OFFSET + data_capacity_);
+    store_le64(out + 32, DATA_OFFSET);
+    store_le64(out + 40, tail_offset);
+    store_le64(out + 48, tail_sequence);
+    store_le64(out + 56, head_offset_);
+    store_le64(out + 64, next_sequence_);
+    std::memcpy(out + 72, config_.label.data(), std::min(config_.label.size(), MAX_LABEL_LENGTH));
+    store_le32(out + 12, crc32(out + 16, SUPERBLOCK_ENCODED_SIZE - 16));
+
+    // The records the new head covers must be durable before the superblock
+    // is written: one fdatasync() may reach the card in any order
+    if (!sync_data(Clock::now())) {
+        return false;
+    }
+
+    // Alternate slots so a torn write always leaves the previous copy intact
+    const uint64_t slot_offset = (generation % 2) * SUPERBLOCK_SIZE;
+    if (::pwrite(fd_, block.data(), block.size(), static_cast<off_t>(slot_offset)) !=
+        static_cast<ssize_t>(block.size())) {
+        LOG_ERROR("Failed to write superblock of '{}': {}", path_, std::strerror(errno));
+        return false;
+    }
+    stats_.device_bytes_written += block.size();
+    stats_.write_syscalls++;
+
+    unsynced_ = true;
+    if (!sync_data(Clock::now())) {
+        return false;
+    }
+    superblock_generation_ = generation;
+    persisted_tail_sequence_ = tail_sequence;
+    stats_.checkpoints++;
+    return true;
+}
+
+bool CircularRecordLog::reserve(uint64_t start, uint64_t end) {
+    assert(start <= end);
+    assert(end <= data_capacity_);
+
+    // Evict ahead in large steps so the superblock is rewritten roughly every
+    // 1/64th of a lap instead of on every record, but never more than 1/8th
+    // of the ring at once, however large a batch may be.
+    const uint64_t slack = std::min<uint64_t>(
+        std::max<uint64_t>(config_.max_batch_bytes, data_capacity_ / 64), data_capacity_ / 8);
+    const uint64_t limit = std::min(end + slack, data_capacity_);
+
+    const uint64_t max_evictions = index_.size();
+    for (uint64_t i = 0; i < max_evictions && !index_.empty(); ++i) {
+        const RingRecordInfo& oldest = index_.front();
+        const uint64_t oldest_end = oldest.offset + record_span(oldest.size_bytes);
+        if (oldest.offset >= limit || oldest_end <= start) {
+            break;
+        }
+        index_.pop_front();
+        stats_.records_overwritten++;
+    }
+
+    // The durable superblock must never point at a record we are about to
+    // overwrite: move it forward first.
+    const uint64_t tail_sequence = index_.empty() ? next_sequence_ : index_.front().sequence;
+    if (tail_sequence > persisted_tail_sequence_) {
+        const bool flushed = flush();
+        if (!flushed || !write_superblock()) {
+            LOG_ERROR("Circular log '{}' could not advance its tail", path_);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CircularRecordLog::queue_padding() {
+    assert(head_offset_ <= data_capacity_);
+
+    const uint64_t remaining = data_capacity_ - head_offset_;
+    bool ok = true;
+    if (remaining >= RECORD_HEADER_SIZE) {
+        if (!reserve(head_offset_, data_capacity_)) {
+            return false;
+        }
+        if (batch_records_ == 0) {
+            batch_offset_ = head_offset_;
+        }
+
+        RecordHeader header;
+        header.type = RECORD_TYPE_PAD;
+        header.sequence = next_sequence_; // Pads do not consume a sequence number
+        header.payload_size = static_cast<uint32_t>(remaining - RECORD_HEADER_SIZE);
+        uint8_t* encoded = batch_headers_[batch_records_].data();
+        encode_record_header(header, encoded);
+        iovecs_[batch_iovecs_++] = iovec{encoded, RECORD_HEADER_SIZE};
+        batch_records_++;
+        batch_bytes_ += RECORD_HEADER_SIZE;
+    }
+    ok = flush() && ok;
+
+    head_offset_ = 0;
+    return ok;
+}
+
+bool CircularRecordLog::sync_data(Clock::time_point now) {
+    assert(fd_ >= 0);
+    if (!unsynced_) {
+        last_sync_at_ = now;
+        return true;
+    }
+#if defined(__APPLE__)
+    const int result = ::fsync(fd_);
+#else
+    const int result = ::fdatasync(fd_);
+#endif
+    if (result != 0) {
+        LOG_ERROR("fdatasync failed for circular log '{}': {}", path_, std::strerror(errno));
+        return false;
+    }
+    unsynced_ = false;
+    last_sync_at_ = now;
+    return true;
+}
+
+bool CircularRecordLog::write_batch() {
+    assert(batch_records_ > 0);
+    assert(batch_offset_ + batch_bytes_ <= data_capacity_);
+
+    iovec* next = iovecs_.data();
+    uint32_t remaining_iovecs = batch_iovecs_;
+    uint64_t remaining_bytes = batch_bytes_;
+    uint64_t offset = DATA_OFFSET + batch_offset_;
+
+    for (uint32_t attempt = 0; attempt < MAX_WRITE_ATTEMPTS_PER_BATCH; ++attempt) {
+        const ssize_t written =
+            ::pwritev(fd_, next, static_cast<int>(remaining_iovecs), static_cast<off_t>(offset));
+        stats_.write_syscalls++;
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("pwritev failed for circular log '{}': {}", path_, std::strerror(errno));
+            return false;
+        }
+
+        const auto advanced = static_cast<uint64_t>(written);
+        assert(advanced <= remaining_bytes);
+        stats_.device_bytes_written += advanced;
+        unsynced_ = true;
+        remaining_bytes -= advanced;
+        offset += advanced;
+        if (remaining_bytes == 0) {
+            return true;
+        }
+
+        uint64_t skip = advanced;
+        while (skip >= next->iov_len) {
+            skip -= next->iov_len;
+            ++next;
+            --remaining_iovecs;
+            assert(remaining_iovecs > 0);
+        }
+        next->iov_base = static_cast<uint8_t*>(next->iov_base) + skip;
+        next->iov_len -= skip;
+    }
+
+    LOG_ERROR("Gave up writing circular log '{}' after {} partial writes",
+              path_,
+              MAX_WRITE_ATTEMPTS_PER_BATCH);
+    return false;
+}
+
+void CircularRecordLog::release_batch() {
+    for (uint32_t i = 0; i < batch_records_; ++i) {
+        batch_payloads_[i] = WriteChunk{};
+    }
+    batch_records_ = 0;
+    batch_iovecs_ = 0;
+    batch_bytes_ = 0;
+}
+
+} // namespace dashcam
@@ -0,0 +1,326 @@
+#include "dashcam/storage/clip_protector.h"
+#include "dashcam/storage/checkpoint_file.h"
+#include "dashcam/utils/logger.h"
+#include "dashcam/utils/scoped_fd.h"
+
+#include <cassert>
+#include <cerrno>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+namespace dashcam {
+
+namespace {
+
+constexpr size_t BUFFERED_COPY_CHUNK_BYTES = 1024 * 1024;
+
+// Largest copy_file_range() request per call; the kernel may do less
+constexpr size_t RANGE_COPY_CHUNK_BYTES = 64 * 1024 * 1024;
+
+// A 4 GiB segment in 1 MiB steps, with headroom for short transfers
+constexpr uint64_t MAX_COPY_ITERATIONS = 1u << 16;
+
+ScopedFd open_for_copy(const std::string& source, const std::string& destination, ScopedFd* out) {
+    ScopedFd input(::open(source.c_str(), O_RDONLY | O_CLOEXEC));
+    if (!input.is_valid()) {
+        return ScopedFd();
+    }
+    out->reset(::open(destination.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644));
+    if (!out->is_valid()) {
+        return ScopedFd();
+    }
+    return input;
+}
+
+} // namespace
+
+std::string_view to_string(ProtectionMethod method) {
+    switch (method) {
+        case ProtectionMethod::Reflink:      return "reflink";
+        case ProtectionMethod::HardLink:     return "hard_link";
+        case ProtectionMethod::IndexPin:     return "index_pin";
+        case ProtectionMethod::RangeCopy:    return "range_copy";
+        case ProtectionMethod::BufferedCopy: return "buffered_copy";
+        default:
+            assert(false && "Invalid protection method");
+            return "unknown";
+    }
+}
+
+ClipProtector::ClipProtector(SegmentIndex& index, const ClipProtectorConfig& config)
+    : index_(index), config_(config) {
+    assert(!config_.protected_dir.empty()); // Tiger Style: assert preconditions
+}
+
+std::optional<ProtectedClip> ClipProtector::protect(std::string_view clip_id,
+                                                    int64_t start_us,
+                                                    int64_t end_us,
+                                                    const std::vector<uint64_t>& open_segment_ids) {
+    assert(!clip_id.empty());
+    assert(clip_id.find('/') == std::string_view::npos);
+    assert(start_us <= end_us);
+
+    ProtectedClip clip;
+    clip.clip_id = std::string(clip_id);
+    clip.start_time_us = start_us;
+    clip.end_time_us = end_us;
+
+    const std::vector<SegmentInfo> segments = index_.overlapping("", start_us, end_us);
+    if (segments.empty()) {
+        LOG_WARNING("Clip '{}' covers no recorded segments", clip.clip_id);
+        return clip;
+    }
+
+    const std::string clip_dir = config_.protected_dir + "/" + clip.clip_id;
+    std::error_code ec;
+    std::filesystem::create_directories(clip_dir, ec);
+    if (ec) {
+        LOG_ERROR("Failed to create clip directory '{}': {}", clip_dir, ec.message());
+        return std::nullopt;
+    }
+
+    for (const SegmentInfo& segment : segments) {
+        const bool open = std::find(open_segment_ids.begin(), open_segment_ids.end(),
+                                    segment.segment_id) != open_segment_ids.end();
+        if (open) {
+            // Cloned or copied now, the clip would end at the trigger
+            if (!index_.pin(segment.segment_id)) {
+                LOG_ERROR("Cannot pin open segment {} of clip '{}'",
+                          segment.segment_id,
+                          clip.clip_id);
+                release(clip);
+                return std::nullopt;
+            }
+            ProtectedSegment pinned;
+            pinned.segment_id = segment.segment_id;
+            pinned.method = ProtectionMethod::IndexPin;
+            pinned.open = true;
+            clip.segments.push_back(std::move(pinned));
+            continue;
+        }
+
+        std::optional<ProtectedSegment> result = protect_segment(segment, clip_dir);
+        if (!result) {
+            LOG_ERROR("Failed to protect segment {} of clip '{}'",
+                      segment.segment_id,
+                      clip.clip_id);
+            release(clip);
+            for (const ProtectedSegment& done : clip.segments) {
+                if (!done.protected_path.empty()) {
+                    ::unlink(done.protected_path.c_str());
+                    ::unlink(checkpoint_file_path(done.protected_path).c_str());
+                }
+            }
+            return std::nullopt;
+        }
+        stats_.segments_by_method[static_cast<uint32_t>(result->method)]++;
+        clip.segments.push_back(std::move(*result));
+    }
+
+    stats_.clips_protected++;
+    LOG_INFO("Protected clip '{}' ({} segments)", clip.clip_id, clip.segments.size());
+    return clip;
+}
+
+bool ClipProtector::segment_closed(ProtectedClip& clip, uint64_t segment_id) {
+    auto it = std::find_if(clip.segments.begin(), clip.segments.end(),
+                           [segment_id](const ProtectedSegment& segment) {
+                               return segment.segment_id == segment_id && segment.open;
+                           });
+    if (it == clip.segments.end()) {
+        return false;
+    }
+    // Our pin keeps the segment in the index until it is converted
+    const std::optional<SegmentInfo> segment = index_.find(segment_id);
+    assert(segment.has_value());
+    if (!segment) {
+        return false;
+    }
+
+    std::optional<ProtectedSegment> result =
+        protect_segment(*segment, config_.protected_dir + "/" + clip.clip_id);
+    if (!result) {
+        LOG_ERROR("Failed to protect closed segment {} of clip '{}'", segment_id, clip.clip_id);
+        return false;
+    }
+    // Pinning again nested a second pin: either way one of the two goes
+    const bool unpinned = index_.unpin(segment_id);
+    assert(unpinned);
+    (void)unpinned;
+
+    stats_.segments_by_method[static_cast<uint32_t>(result->method)]++;
+    *it = std::move(*result);
+    return true;
+}
+
+void ClipProtector::release(const ProtectedClip& clip) {
+    for (const ProtectedSegment& segment : clip.segments) {
+        if (segment.method == ProtectionMethod::IndexPin && !index_.unpin(segment.segment_id)) {
+            LOG_WARNING("Clip '{}' segment {} was not pinned", clip.clip_id, segment.segment_id);
+        }
+    }
+}
+
+ClipProtectorStats ClipProtector::stats() const {
+    return stats_;
+}
+
+std::optional<ProtectedSegment> ClipProtector::protect_segment(const SegmentInfo& segment,
+                                                               const std::string& clip_dir) {
+    const std::string destination =
+        clip_dir + "/" + std::filesystem::path(segment.path).filename().string();
+
+    ProtectedSegment result;
+    result.segment_id = segment.segment_id;
+    result.protected_path = destination;
+
+    if (config_.allow_reflink && try_reflink(segment.path, destination)) {
+        result.method = ProtectionMethod::Reflink;
+    } else if (config_.allow_hard_link && try_hard_link(segment.path, destination)) {
+        result.method = ProtectionMethod::HardLink;
+    } else if (config_.allow_pinning && index_.pin(segment.segment_id)) {
+        // The segment's own checkpoint file is kept with it
+        result.method = ProtectionMethod::IndexPin;
+        result.protected_path.clear();
+        return result;
+    } else if (config_.allow_range_copy && try_range_copy(segment.path, destination)) {
+        result.method = ProtectionMethod::RangeCopy;
+    } else if (try_buffered_copy(segment.path, destination)) {
+        result.method = ProtectionMethod::BufferedCopy;
+    } else {
+        return std::nullopt;
+    }
+    keep_checkpoints(segment.path, destination);
+    return result;
+}
+
+void ClipProtector::keep_checkpoints(const std::string& source, const std::string& destination) {
+    const std::string from = checkpoint_file_path(source);
+    const std::string to = checkpoint_file_path(destination);
+    // A link also carries checkpoints signed after protection, such as the final one
+    if (::link(from.c_str(), to.c_str()) == 0 || errno == ENOENT) {
+        return;
+    }
+    std::error_code ec;
+    std::filesystem::copy_file(from, to, std::filesystem::copy_options::overwrite_existing, ec);
+    if (ec) {
+        // The footage is protected; only its tamper evidence is missing
+        LOG_WARNING("Cannot keep checkpoints '{}' with the clip: {}", from, ec.message());
+    }
+}
+
+bool ClipProtector::try_reflink(const std::string& source, const std::string& destination) {
+#if defined(__linux__) && defined(FICLONE)
+    ScopedFd output;
+    ScopedFd input = open_for_copy(source, destination, &output);
+    if (!input.is_valid() || !output.is_valid()) {
+        return false;
+    }
+    if (::ioctl(output.get(), FICLONE, input.get()) == 0) {
+        return true;
+    }
+    // EOPNOTSUPP/EXDEV/EINVAL: filesystem cannot share extents, try the next method
+    ::unlink(destination.c_str());
+    return false;
+#else
+    (void)source;
+    (void)destination;
+    return false;
+#endif
+}
+
+bool ClipProtector::try_hard_link(const std::string& source, const std::string& destination) {
+    // FAT/exFAT return EPERM, cross-device links return EXDEV
+    return ::link(source.c_str(), destination.c_str()) == 0;
+}
+
+bool ClipProtector::try_range_copy(const std::string& source, const std::string& destination) {
+#if defined(__linux__)
+    ScopedFd output;
+    ScopedFd input = open_for_copy(source, destination, &output);
+    if (!input.is_valid() || !output.is_valid()) {
+        return false;
+    }
+
+    uint64_t copied = 0;
+    for (uint64_t i = 0; i < MAX_COPY_ITERATIONS; ++i) {
+        const ssize_t result = ::copy_file_range(
+            input.get(), nullptr, output.get(), nullptr, RANGE_COPY_CHUNK_BYTES, 0);
+        if (result == 0) {
+            stats_.bytes_copied += copied;
+            return true;
+        }
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break; // ENOSYS/EXDEV/EINVAL: fall back to a buffered copy
+        }
+        copied += static_cast<uint64_t>(result);
+    }
+    ::unlink(destination.c_str());
+    return false;
+#else
+    (void)source;
+    (void)destination;
+    return false;
+#endif
+}
+
+bool ClipProtector::try_buffered_copy(const std::string& source, const std::string& destination) {
+    ScopedFd output;
+    ScopedFd input = open_for_copy(source, destination, &output);
+    if (!input.is_valid() || !output.is_valid()) {
+        LOG_ERROR("Cannot copy '{}' to '{}': {}", source, destination, std::strerror(errno));
+        return false;
+    }
+
+    std::vector<uint8_t> buffer(BUFFERED_COPY_CHUNK_BYTES);
+    uint64_t copied = 0;
+    for (uint64_t i = 0; i < MAX_COPY_ITERATIONS; ++i) {
+        const ssize_t got = ::read(input.get(), buffer.data(), buffer.size());
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0) {
+            break;
+        }
+        if (got == 0) {
+            stats_.bytes_copied += copied;
+            return true;
+        }
+
+        size_t put = 0;
+        while (put < static_cast<size_t>(got)) {
+            const ssize_t wrote =
+                ::write(output.get(), buffer.data() + put, static_cast<size_t>(got) - put);
+            if (wrote < 0 && errno == EINTR) {
+                continue;
+            }
+            if (wrote <= 0) {
+                LOG_ERROR("Buffered copy to '{}' failed: {}", destination, std::strerror(errno));
+                ::unlink(destination.c_str());
+                return false;
+            }
+            put += static_cast<size_t>(wrote);
+        }
+        copied += static_cast<uint64_t>(got);
+    }
+
+    LOG_ERROR("Buffered copy of '{}' did not complete", source);
+    ::unlink(destination.c_str());
+    return false;
+}
+
+} // namespace dashcam
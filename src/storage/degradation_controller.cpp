@@ -0,0 +1,171 @@
+#include "dashcam/storage/degradation_controller.h"
+#include "dashcam/utils/logger.h"
+
+#include <cassert>
+
+namespace dashcam {
+
+namespace {
+
+uint32_t tier_index(DegradationTier tier) {
+    return static_cast<uint32_t>(tier);
+}
+
+double queue_fraction(const StoragePressure& pressure) {
+    assert(pressure.queue_capacity > 0);
+    return static_cast<double>(pressure.queue_depth) /
+           static_cast<double>(pressure.queue_capacity);
+}
+
+int64_t wall_clock_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace
+
+std::string_view to_string(DegradationTier tier) {
+    switch (tier) {
+        case DegradationTier::Normal:         return "normal";
+        case DegradationTier::DropPreview:    return "drop_preview";
+        case DegradationTier::KeyframesOnly:  return "keyframes_only";
+        case DegradationTier::EmergencyEvict: return "emergency_evict";
+        default:
+            assert(false && "Invalid degradation tier");
+            return "unknown";
+    }
+}
+
+DegradationController::DegradationController(const DegradationConfig& config, EventSink sink)
+    : config_(config), sink_(std::move(sink)) {
+    // Tiger Style: assert preconditions
+    for (uint32_t i = 2; i < DEGRADATION_TIER_COUNT; ++i) {
+        assert(config_.queue_fraction[i] > config_.queue_fraction[i - 1]);
+        assert(config_.free_bytes[i] < config_.free_bytes[i - 1]);
+    }
+    assert(config_.recovery_margin > 0.0 && config_.recovery_margin <= 1.0);
+    assert(!config_.primary_camera_id.empty());
+}
+
+DegradationTier DegradationController::update(const StoragePressure& pressure,
+                                              Clock::time_point now) {
+    assert(pressure.queue_capacity > 0);
+
+    const DegradationTier current = tier_.load(std::memory_order_relaxed);
+    const DegradationTier target = target_tier(pressure);
+
+    if (tier_index(target) > tier_index(current)) {
+        transition(target, pressure, now);
+    } else if (tier_index(target) < tier_index(current) &&
+               now - entered_at_ >= config_.min_dwell && can_recover_from(current, pressure)) {
+        transition(static_cast<DegradationTier>(tier_index(current) - 1), pressure, now);
+    }
+    return tier_.load(std::memory_order_relaxed);
+}
+
+DegradationTier DegradationController::tier() const {
+    return tier_.load(std::memory_order_relaxed);
+}
+
+bool DegradationController::admit_preview_frame() {
+    if (tier_index(tier()) >= tier_index(DegradationTier::DropPreview)) {
+        preview_frames_shed_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+bool DegradationController::admit_camera_frame(std::string_view camera_id, bool keyframe) {
+    if (keyframe || camera_id == config_.primary_camera_id) {
+        return true;
+    }
+    if (tier_index(tier()) >= tier_index(DegradationTier::KeyframesOnly)) {
+        camera_frames_shed_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+uint64_t DegradationController::emergency_eviction_bytes(const StoragePressure& pressure) const {
+    if (tier() != DegradationTier::EmergencyEvict) {
+        return 0;
+    }
+    const uint64_t goal = config_.free_bytes[tier_index(DegradationTier::DropPreview)];
+    return pressure.free_bytes < goal ? goal - pressure.free_bytes : 0;
+}
+
+DegradationStats DegradationController::stats() const {
+    DegradationStats stats;
+    for (uint32_t i = 0; i < DEGRADATION_TIER_COUNT; ++i) {
+        stats.tier_entries[i] = tier_entries_[i].load(std::memory_order_relaxed);
+    }
+    stats.escalations = escalations_.load(std::memory_order_relaxed);
+    stats.recoveries = recoveries_.load(std::memory_order_relaxed);
+    stats.preview_frames_shed = preview_frames_shed_.load(std::memory_order_relaxed);
+    stats.camera_frames_shed = camera_frames_shed_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+DegradationTier DegradationController::target_tier(const StoragePressure& pressure) const {
+    const double fraction = queue_fraction(pressure);
+    // Most severe tier first; bounded by the tier count
+    for (uint32_t i = DEGRADATION_TIER_COUNT - 1; i > 0; --i) {
+        if (fraction >= config_.queue_fraction[i] || pressure.free_bytes <= config_.free_bytes[i]) {
+            return static_cast<DegradationTier>(i);
+        }
+    }
+    return DegradationTier::Normal;
+}
+
+bool DegradationController::can_recover_from(DegradationTier tier,
+                                             const StoragePressure& pressure) const {
+    const uint32_t index = tier_index(tier);
+    assert(index > 0);
+    const double queue_limit = config_.queue_fraction[index] * config_.recovery_margin;
+    const auto free_floor =
+        static_cast<double>(config_.free_bytes[index]) / config_.recovery_margin;
+    return queue_fraction(pressure) < queue_limit &&
+           static_cast<double>(pressure.free_bytes) > free_floor;
+}
+
+void DegradationController::transition(DegradationTier to,
+                                       const StoragePressure& pressure,
+                                       Clock::time_point now) {
+    const DegradationTier from = tier_.exchange(to, std::memory_order_relaxed);
+    assert(from != to);
+    entered_at_ = now;
+    tier_entries_[tier_index(to)].fetch_add(1, std::memory_order_relaxed);
+
+    const bool escalating = tier_index(to) > tier_index(from);
+    if (escalating) {
+        escalations_.fetch_add(1, std::memory_order_relaxed);
+        LOG_WARNING("Storage degraded from {} to {} (queue {}/{}, {} bytes free)",
+                    to_string(from),
+                    to_string(to),
+                    pressure.queue_depth,
+                    pressure.queue_capacity,
+                    pressure.free_bytes);
+    } else {
+        recoveries_.fetch_add(1, std::memory_order_relaxed);
+        LOG_INFO("Storage recovered from {} to {}", to_string(from), to_string(to));
+    }
+
+    if (!sink_) {
+        return;
+    }
+    LogEvent event;
+    event.set_timestamp_ms(wall_clock_ms());
+    event.set_event_type(escalating ? "storage_degraded" : "storage_recovered");
+    event.set_message(std::string(escalating ? "Storage degraded to " : "Storage recovered to ") +
+                      std::string(to_string(to)));
+    auto& metadata = *event.mutable_metadata();
+    metadata["from_tier"] = std::string(to_string(from));
+    metadata["to_tier"] = std::string(to_string(to));
+    metadata["queue_depth"] = std::to_string(pressure.queue_depth);
+    metadata["queue_capacity"] = std::to_string(pressure.queue_capacity);
+    metadata["free_bytes"] = std::to_string(pressure.free_bytes);
+    sink_(event);
+}
+
+} // namespace dashcam
@@ -0,0 +1,1007 @@
+#include "dashcam/storage/event_log.h"
+#include "dashcam/utils/byte_order.h"
+#include "dashcam/utils/crc32.h"
+#include "dashcam/utils/logger.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dashcam {
+
+namespace {
+
+constexpr uint64_t FILE_MAGIC = 0x31474f4c56454344ull;  // "DCEVLOG1" little-endian
+constexpr uint32_t BLOCK_MAGIC = 0x42454344u;           // "DCEB" little-endian
+constexpr uint32_t FORMAT_VERSION = 1;
+constexpr size_t FILE_HEADER_BYTES = 64;
+constexpr size_t FILE_HEADER_CRC_OFFSET = 60;
+constexpr size_t BLOCK_HEADER_BYTES = 160;
+constexpr size_t BLOCK_HEADER_CRC_OFFSET = 156;
+constexpr size_t BLOCK_COLUMNS_OFFSET = 104;
+constexpr const char* FILE_SUFFIX = ".dcel";
+
+// Column order in a block
+constexpr size_t TIME_COLUMN = 0;
+constexpr size_t TYPE_COLUMN = 1;
+constexpr size_t CAMERA_COLUMN = 2;
+constexpr size_t MESSAGE_COLUMN = 3;
+constexpr size_t METADATA_COLUMN = 4;
+
+constexpr uint32_t BLOOM_PROBES = 4;
+
+// A block is one buffer; bound the retries on short writes and reads
+constexpr uint32_t MAX_IO_ATTEMPTS = 64;
+
+void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool get_varint(const uint8_t*& at, const uint8_t* end, uint64_t* value) {
+    uint64_t result = 0;
+    for (uint32_t shift = 0; shift < 64 && at < end; shift += 7) {
+        const uint8_t byte = *at++;
+        result |= uint64_t{byte & 0x7fu} << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void put_string(std::vector<uint8_t>& out, const std::string& value) {
+    put_varint(out, value.size());
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+bool get_string(const uint8_t*& at, const uint8_t* end, std::string* value) {
+    uint64_t length = 0;
+    if (!get_varint(at, end, &length) || length > static_cast<uint64_t>(end - at)) {
+        return false;
+    }
+    value->assign(reinterpret_cast<const char*>(at), static_cast<size_t>(length));
+    at += length;
+    return true;
+}
+
+bool skip_string(const uint8_t*& at, const uint8_t* end) {
+    uint64_t length = 0;
+    if (!get_varint(at, end, &length) || length > static_cast<uint64_t>(end - at)) {
+        return false;
+    }
+    at += length;
+    return true;
+}
+
+uint64_t fnv1a(const std::string& value) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const char c : value) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+template <typename Bloom>
+void bloom_add(Bloom& bloom, const std::string& value) {
+    const uint64_t hash = fnv1a(value);
+    const uint32_t h1 = static_cast<uint32_t>(hash);
+    const uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+    for (uint32_t i = 0; i < BLOOM_PROBES; ++i) {
+        const uint32_t bit = (h1 + i * h2) % (bloom.size() * 8);
+        bloom[bit / 8] |= static_cast<uint8_t>(1u << (bit % 8));
+    }
+}
+
+template <typename Bloom>
+bool bloom_may_contain(const Bloom& bloom, const std::string& value) {
+    const uint64_t hash = fnv1a(value);
+    const uint32_t h1 = static_cast<uint32_t>(hash);
+    const uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+    for (uint32_t i = 0; i < BLOOM_PROBES; ++i) {
+        const uint32_t bit = (h1 + i * h2) % (bloom.size() * 8);
+        if ((bloom[bit / 8] & (1u << (bit % 8))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Dictionary column: distinct values in first-seen order, then codes
+ */
+std::vector<uint8_t> encode_dictionary(const std::vector<const std::string*>& values,
+                                       std::vector<const std::string*>* distinct) {
+    std::unordered_map<std::string, uint32_t> codes;
+    std::vector<uint32_t> row_codes;
+    row_codes.reserve(values.size());
+    for (const std::string* value : values) {
+        const auto [it, inserted] = codes.emplace(*value, static_cast<uint32_t>(distinct->size()));
+        if (inserted) {
+            distinct->push_back(value);
+        }
+        row_codes.push_back(it->second);
+    }
+
+    std::vector<uint8_t> column;
+    put_varint(column, distinct->size());
+    for (const std::string* value : *distinct) {
+        put_string(column, *value);
+    }
+    for (const uint32_t code : row_codes) {
+        put_varint(column, code);
+    }
+    return column;
+}
+
+bool decode_dictionary(const std::vector<uint8_t>& column,
+                       uint32_t rows,
+                       std::vector<std::string>* dictionary,
+                       std::vector<uint32_t>* codes) {
+    const uint8_t* at = column.data();
+    const uint8_t* end = at + column.size();
+    uint64_t size = 0;
+    if (!get_varint(at, end, &size) || size > rows) {
+        return false;
+    }
+    dictionary->resize(static_cast<size_t>(size));
+    for (std::string& value : *dictionary) {
+        if (!get_string(at, end, &value)) {
+            return false;
+        }
+    }
+    codes->resize(rows);
+    for (uint32_t& code : *codes) {
+        uint64_t value = 0;
+        if (!get_varint(at, end, &value) || value >= size) {
+            return false;
+        }
+        code = static_cast<uint32_t>(value);
+    }
+    return at == end;
+}
+
+bool write_all(int fd, const uint8_t* data, size_t size) {
+    size_t written = 0;
+    for (uint32_t attempt = 0; attempt < MAX_IO_ATTEMPTS && written < size; ++attempt) {
+        const ssize_t result = ::write(fd, data + written, size - written);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            return false;
+        }
+        written += static_cast<size_t>(result);
+    }
+    return written == size;
+}
+
+bool read_all(int fd, uint8_t* data, size_t size, uint64_t offset) {
+    size_t done = 0;
+    for (uint32_t attempt = 0; attempt < MAX_IO_ATTEMPTS && done < size; ++attempt) {
+        const ssize_t result =
+            ::pread(fd, data + done, size - done, static_cast<off_t>(offset + done));
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            return false;
+        }
+        done += static_cast<size_t>(result);
+    }
+    return done == size;
+}
+
+/**
+ * @brief Sort key of a row across the whole log
+ */
+struct RowKey {
+    int64_t timestamp_ms;
+    uint64_t block;
+    uint32_t rank;
+
+    bool operator<(const RowKey& other) const {
+        return std::tie(timestamp_ms, block, rank) <
+               std::tie(other.timestamp_ms, other.block, other.rank);
+    }
+};
+
+RowKey key_of(const EventLogCursor& cursor) {
+    return RowKey{cursor.timestamp_ms, cursor.block, cursor.rank};
+}
+
+bool in_time_range(int64_t timestamp_ms, const EventLogQuery& query) {
+    return timestamp_ms >= query.start_ms && (query.end_ms == 0 || timestamp_ms < query.end_ms);
+}
+
+} // namespace
+
+/**
+ * @brief The columns of one disk block a query has read so far
+ */
+struct EventLog::DecodedBlock {
+    bool times_read = false;
+    bool types_read = false;
+    bool cameras_read = false;
+    bool payload_read = false;
+    std::vector<int64_t> times;
+    std::vector<uint32_t> ranks;
+    std::vector<std::string> types;
+    std::vector<uint32_t> type_codes;
+    std::vector<std::string> cameras;
+    std::vector<uint32_t> camera_codes;
+    // Payload columns stay encoded; rows are decoded only when on the page
+    std::vector<uint8_t> messages;
+    std::vector<uint8_t> metadata;
+    std::vector<uint32_t> message_offsets;
+    std::vector<uint32_t> metadata_offsets;
+};
+
+EventLog::EventLog(const EventLogConfig& config)
+    : config_(config),
+      partition_ms_(
+          std::chrono::duration_cast<std::chrono::milliseconds>(config.partition).count()) {
+    // Tiger Style: assert preconditions
+    assert(!config_.directory.empty());
+    assert(partition_ms_ > 0);
+    assert(config_.block_events > 0);
+    assert(config_.flush_interval.count() > 0);
+    assert(config_.default_max_events > 0);
+    assert(config_.default_max_events <= config_.max_events_limit);
+}
+
+EventLog::~EventLog() {
+    close();
+}
+
+bool EventLog::open() {
+    assert(!thread_.joinable()); // Tiger Style: assert preconditions
+
+    std::error_code ec;
+    std::filesystem::create_directories(config_.directory, ec);
+    if (ec) {
+        LOG_ERROR("Cannot create event log directory '{}': {}", config_.directory, ec.message());
+        return false;
+    }
+
+    std::vector<std::string> paths;
+    for (const auto& entry : std::filesystem::directory_iterator(config_.directory, ec)) {
+        if (entry.path().extension() == FILE_SUFFIX) {
+            paths.push_back(entry.path().string());
+        }
+    }
+    if (ec) {
+        LOG_ERROR("Cannot list event log directory '{}': {}", config_.directory, ec.message());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const std::string& path : paths) {
+        load_partition(path);
+    }
+    remove_expired_locked();
+
+    open_ = true;
+    stop_requested_ = false;
+    thread_ = std::thread([this] { run(); });
+    LOG_INFO("Event log '{}' opened: {} partitions, next block {}",
+             config_.directory,
+             partitions_.size(),
+             next_sequence_);
+    return true;
+}
+
+void EventLog::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_requested_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    open_ = false;
+}
+
+bool EventLog::append(const LogEvent& event) {
+    const int64_t partition = partition_of(event.timestamp_ms());
+    bool sealed = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!open_ || stop_requested_) {
+            events_dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (!pending_.rows.empty() &&
+            (pending_.partition_ms != partition || pending_.rows.size() >= config_.block_events)) {
+            if (sealed_.size() >= config_.max_sealed_blocks) {
+                events_dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            seal_locked();
+            sealed = true;
+        }
+        if (pending_.rows.empty()) {
+            pending_.sequence = next_sequence_++;
+            pending_.partition_ms = partition;
+            pending_.opened = std::chrono::steady_clock::now();
+        }
+
+        // Nearly always the end: events arrive in time order
+        const auto at = std::upper_bound(
+            pending_.rows.begin(), pending_.rows.end(), event.timestamp_ms(),
+            [](int64_t timestamp_ms, const LogEvent& row) {
+                return timestamp_ms < row.timestamp_ms();
+            });
+        pending_.rows.insert(at, event);
+        events_appended_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (sealed) {
+        wake_.notify_all();
+    }
+    return true;
+}
+
+bool EventLog::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!thread_.joinable()) {
+        return pending_.rows.empty() && sealed_.empty();
+    }
+    flush_requested_ = true;
+    wake_.notify_all();
+    written_.wait(lock, [this] { return pending_.rows.empty() && sealed_.empty(); });
+    const bool ok = !write_failed_;
+    write_failed_ = false;
+    return ok;
+}
+
+void EventLog::seal_locked() {
+    sealed_.push_back(std::move(pending_));
+    pending_ = MemoryBlock{};
+}
+
+void EventLog::run() {
+    // Tiger Style: this loop is intentionally unbounded; it ends on close()
+    while (true) {
+        const MemoryBlock* block = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait_for(lock, config_.flush_interval, [this] {
+                return stop_requested_ || flush_requested_ || !sealed_.empty();
+            });
+            const bool due =
+                !pending_.rows.empty() &&
+                std::chrono::steady_clock::now() - pending_.opened >= config_.flush_interval;
+            if (!pending_.rows.empty() && (due || stop_requested_ || flush_requested_)) {
+                seal_locked();
+            }
+            if (sealed_.empty()) {
+                flush_requested_ = false;
+                written_.notify_all();
+                if (stop_requested_) {
+                    return;
+                }
+                continue;
+            }
+            // Only this thread pops sealed_, so the front stays put while unlocked
+            block = &sealed_.front();
+        }
+
+        write_block(*block);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            sealed_.pop_front();
+        }
+        written_.notify_all();
+    }
+}
+
+bool EventLog::write_block(const MemoryBlock& block) {
+    assert(!block.rows.empty());
+    const uint32_t rows = static_cast<uint32_t>(block.rows.size());
+
+    std::array<std::vector<uint8_t>, COLUMN_COUNT> columns;
+    std::vector<const std::string*> types;
+    std::vector<const std::string*> cameras;
+    types.reserve(rows);
+    cameras.reserve(rows);
+    int64_t previous_ms = 0;
+    uint64_t raw_bytes = 0;
+    for (const LogEvent& row : block.rows) {
+        put_varint(columns[TIME_COLUMN], zigzag(row.timestamp_ms() - previous_ms));
+        previous_ms = row.timestamp_ms();
+        types.push_back(&row.event_type());
+        cameras.push_back(&row.camera_id());
+        put_string(columns[MESSAGE_COLUMN], row.message());
+
+        // Map order is unspecified; sort the keys so equal events encode equally
+        std::vector<const google::protobuf::Map<std::string, std::string>::value_type*> entries;
+        entries.reserve(row.metadata().size());
+        for (const auto& entry : row.metadata()) {
+            entries.push_back(&entry);
+        }
+        std::sort(entries.begin(), entries.end(),
+                  [](const auto* a, const auto* b) { return a->first < b->first; });
+        put_varint(columns[METADATA_COLUMN], entries.size());
+        for (const auto* entry : entries) {
+            put_string(columns[METADATA_COLUMN], entry->first);
+            put_string(columns[METADATA_COLUMN], entry->second);
+        }
+        raw_bytes += row.ByteSizeLong();
+    }
+
+    BlockMeta meta;
+    meta.sequence = block.sequence;
+    meta.min_ms = block.rows.front().timestamp_ms();
+    meta.max_ms = block.rows.back().timestamp_ms();
+    meta.events = rows;
+    std::vector<const std::string*> distinct_types;
+    std::vector<const std::string*> distinct_cameras;
+    columns[TYPE_COLUMN] = encode_dictionary(types, &distinct_types);
+    columns[CAMERA_COLUMN] = encode_dictionary(cameras, &distinct_cameras);
+    for (const std::string* type : distinct_types) {
+        bloom_add(meta.types, *type);
+    }
+    for (const std::string* camera : distinct_cameras) {
+        bloom_add(meta.cameras, *camera);
+    }
+
+    std::vector<uint8_t> buffer(BLOCK_HEADER_BYTES, 0);
+    for (size_t c = 0; c < COLUMN_COUNT; ++c) {
+        meta.column_bytes[c] = static_cast<uint32_t>(columns[c].size());
+        meta.column_crcs[c] = crc32(columns[c].data(), columns[c].size());
+        buffer.insert(buffer.end(), columns[c].begin(), columns[c].end());
+    }
+
+    uint8_t* header = buffer.data();
+    store_le32(header, BLOCK_MAGIC);
+    store_le16(header + 4, FORMAT_VERSION);
+    store_le16(header + 6, COLUMN_COUNT);
+    store_le64(header + 8, meta.sequence);
+    store_le64(header + 16, static_cast<uint64_t>(meta.min_ms));
+    store_le64(header + 24, static_cast<uint64_t>(meta.max_ms));
+    store_le32(header + 32, meta.events);
+    std::memcpy(header + 40, meta.types.data(), BLOOM_BYTES);
+    std::memcpy(header + 72, meta.cameras.data(), BLOOM_BYTES);
+    for (size_t c = 0; c < COLUMN_COUNT; ++c) {
+        store_le32(header + BLOCK_COLUMNS_OFFSET + c * 8, meta.column_bytes[c]);
+        store_le32(header + BLOCK_COLUMNS_OFFSET + c * 8 + 4, meta.column_crcs[c]);
+    }
+    store_le32(header + BLOCK_HEADER_CRC_OFFSET, crc32(header, BLOCK_HEADER_CRC_OFFSET));
+
+    std::shared_ptr<Partition> partition;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        partition = open_partition_locked(block.partition_ms);
+    }
+
+    // Only this thread writes, so the size cannot move under us
+    bool ok = partition != nullptr;
+    if (ok) {
+        meta.offset = partition->size;
+        ok = write_all(partition->fd.get(), buffer.data(), buffer.size()) &&
+             (!config_.sync_blocks || ::fdatasync(partition->fd.get()) == 0);
+        if (!ok) {
+            LOG_ERROR("Failed to write event block to '{}': {}",
+                      partition->path,
+                      std::strerror(errno));
+            // Cut the partial block so the file stays a sequence of whole blocks
+            if (::ftruncate(partition->fd.get(), static_cast<off_t>(meta.offset)) != 0) {
+                LOG_ERROR("Failed to cut torn event block from '{}': {}",
+                          partition->path,
+                          std::strerror(errno));
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ok) {
+        write_failed_ = true;
+        write_errors_.fetch_add(1, std::memory_order_relaxed);
+        events_dropped_.fetch_add(rows, std::memory_order_relaxed);
+        return false;
+    }
+    partition->size += buffer.size();
+    partition->blocks.push_back(meta);
+    blocks_written_.fetch_add(1, std::memory_order_relaxed);
+    bytes_written_.fetch_add(buffer.size(), std::memory_order_relaxed);
+    raw_bytes_.fetch_add(raw_bytes, std::memory_order_relaxed);
+    remove_expired_locked();
+    return true;
+}
+
+EventLogPage EventLog::query(const EventLogQuery& query) const {
+    // Tiger Style: assert preconditions
+    assert(query.end_ms == 0 || query.end_ms >= query.start_ms);
+
+    const uint32_t requested =
+        query.max_events == 0 ? config_.default_max_events : query.max_events;
+    const size_t limit = std::min(requested, config_.max_events_limit);
+    const RowKey resume = key_of(query.resume);
+    queries_.fetch_add(1, std::memory_order_relaxed);
+
+    // A row is kept in `matches`; `source` is -1 for a buffered row (index
+    // into `buffered`), else the index of its disk block.
+    struct Match {
+        RowKey key;
+        int32_t source;
+        uint32_t row;
+    };
+    std::vector<Match> matches;
+    std::vector<LogEvent> buffered;
+    std::vector<DiskBlock> blocks;
+    uint64_t skipped = 0;
+
+    const auto wanted_type = [&query](const std::string& type) {
+        return query.event_types.empty() ||
+               std::find(query.event_types.begin(), query.event_types.end(), type) !=
+                   query.event_types.end();
+    };
+    const auto wanted_camera = [&query](const std::string& camera) {
+        return query.camera_id.empty() || camera == query.camera_id;
+    };
+    const auto after_resume = [&](const RowKey& key) {
+        return query.resume.block == 0 || !(key < resume);
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        // Rows not yet on disk are filtered in place; each block's rows are
+        // in time order, so no block needs more than a page and one
+        const auto collect = [&](const MemoryBlock& block) {
+            size_t taken = 0;
+            uint32_t rank = 0;
+            for (size_t row = 0; row < block.rows.size() && taken <= limit; ++row) {
+                const LogEvent& event = block.rows[row];
+                const bool tied =
+                    row > 0 && block.rows[row - 1].timestamp_ms() == event.timestamp_ms();
+                rank = tied ? rank + 1 : 0;
+                const RowKey key{event.timestamp_ms(), block.sequence, rank};
+                if (in_time_range(key.timestamp_ms, query) && after_resume(key) &&
+                    wanted_type(event.event_type()) && wanted_camera(event.camera_id())) {
+                    matches.push_back(Match{key, -1, static_cast<uint32_t>(buffered.size())});
+                    buffered.push_back(event);
+                    ++taken;
+                }
+            }
+        };
+        for (const MemoryBlock& block : sealed_) {
+            collect(block);
+        }
+        collect(pending_);
+
+        // Partitions hold exactly their span; headers rule out most blocks
+        for (const auto& [start_ms, partition] : partitions_) {
+            if ((query.end_ms != 0 && start_ms >= query.end_ms) ||
+                start_ms + partition_ms_ <= query.start_ms) {
+                skipped += partition->blocks.size();
+                continue;
+            }
+            for (const BlockMeta& meta : partition->blocks) {
+                const bool in_range =
+                    meta.max_ms >= query.start_ms &&
+                    (query.end_ms == 0 || meta.min_ms < query.end_ms) &&
+                    (query.resume.block == 0 || meta.max_ms >= query.resume.timestamp_ms);
+                const bool has_type =
+                    query.event_types.empty() ||
+                    std::any_of(query.event_types.begin(),
+                                query.event_types.end(),
+                                [&meta](const std::string& type) {
+                                    return bloom_may_contain(meta.types, type);
+                                });
+                const bool has_camera =
+                    query.camera_id.empty() || bloom_may_contain(meta.cameras, query.camera_id);
+                if (in_range && has_type && has_camera) {
+                    blocks.push_back(DiskBlock{partition, meta});
+                } else {
+                    ++skipped;
+                }
+            }
+        }
+    }
+
+    const auto by_key = [](const Match& a, const Match& b) { return a.key < b.key; };
+    const auto trim = [&] {
+        if (matches.size() > limit + 1) {
+            std::partial_sort(matches.begin(), matches.begin() + limit + 1, matches.end(), by_key);
+            matches.resize(limit + 1);
+        }
+    };
+
+    // Oldest blocks first, so the walk can stop once no block left can beat the page
+    std::sort(blocks.begin(), blocks.end(), [](const DiskBlock& a, const DiskBlock& b) {
+        return std::tie(a.meta.min_ms, a.meta.sequence) < std::tie(b.meta.min_ms, b.meta.sequence);
+    });
+    std::vector<DecodedBlock> decoded(blocks.size());
+    std::vector<uint8_t> column;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        trim();
+        if (matches.size() > limit) {
+            std::nth_element(matches.begin(), matches.begin() + limit, matches.end(), by_key);
+            if (blocks[b].meta.min_ms > matches[limit].key.timestamp_ms) {
+                skipped += blocks.size() - b;
+                break;
+            }
+        }
+
+        const DiskBlock& block = blocks[b];
+        DecodedBlock& columns = decoded[b];
+        const uint32_t rows = block.meta.events;
+        blocks_read_.fetch_add(1, std::memory_order_relaxed);
+        if (!read_column(block, TIME_COLUMN, &column)) {
+            corrupt_blocks_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        columns.times.resize(rows);
+        columns.ranks.resize(rows);
+        const uint8_t* at = column.data();
+        const uint8_t* end = at + column.size();
+        int64_t time_ms = 0;
+        bool valid = true;
+        for (uint32_t row = 0; row < rows && valid; ++row) {
+            uint64_t delta = 0;
+            valid = get_varint(at, end, &delta);
+            time_ms += unzigzag(delta);
+            columns.times[row] = time_ms;
+            const bool tied = row > 0 && columns.times[row - 1] == time_ms;
+            columns.ranks[row] = tied ? columns.ranks[row - 1] + 1 : 0;
+        }
+        if (!valid || at != end) {
+            corrupt_blocks_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        columns.times_read = true;
+
+        std::vector<uint32_t> candidates;
+        for (uint32_t row = 0; row < rows; ++row) {
+            const RowKey key{columns.times[row], block.meta.sequence, columns.ranks[row]};
+            if (in_time_range(key.timestamp_ms, query) && after_resume(key)) {
+                candidates.push_back(row);
+            }
+        }
+
+        // Filter columns only when the filter is set and rows are left
+        if (!candidates.empty() && !query.event_types.empty()) {
+            if (!read_column(block, TYPE_COLUMN, &column) ||
+                !decode_dictionary(column, rows, &columns.types, &columns.type_codes)) {
+                corrupt_blocks_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            columns.types_read = true;
+            std::vector<bool> allowed(columns.types.size());
+            for (size_t code = 0; code < columns.types.size(); ++code) {
+                allowed[code] = wanted_type(columns.types[code]);
+            }
+            candidates.erase(std::remove_if(candidates.begin(),
+                                            candidates.end(),
+                                            [&](uint32_t row) {
+                                                return !allowed[columns.type_codes[row]];
+                                            }),
+                             candidates.end());
+        }
+        if (!candidates.empty() && !query.camera_id.empty()) {
+            if (!read_column(block, CAMERA_COLUMN, &column) ||
+                !decode_dictionary(column, rows, &columns.cameras, &columns.camera_codes)) {
+                corrupt_blocks_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            columns.cameras_read = true;
+            candidates.erase(std::remove_if(candidates.begin(),
+                                            candidates.end(),
+                                            [&](uint32_t row) {
+                                                const uint32_t code = columns.camera_codes[row];
+                                                return columns.cameras[code] != query.camera_id;
+                                            }),
+                             candidates.end());
+        }
+
+        for (const uint32_t row : candidates) {
+            const RowKey key{columns.times[row], block.meta.sequence, columns.ranks[row]};
+            matches.push_back(Match{key, static_cast<int32_t>(b), row});
+        }
+    }
+
+    trim();
+    std::sort(matches.begin(), matches.end(), by_key);
+    EventLogPage page;
+    if (matches.size() > limit) {
+        page.has_more = true;
+        const RowKey& next = matches[limit].key;
+        page.next = EventLogCursor{next.timestamp_ms, next.block, next.rank};
+        matches.resize(limit);
+    }
+
+    // Only blocks that made the page have their remaining columns read
+    page.events.reserve(matches.size());
+    for (const Match& match : matches) {
+        if (match.source < 0) {
+            page.events.push_back(std::move(buffered[match.row]));
+            continue;
+        }
+        const DiskBlock& block = blocks[static_cast<size_t>(match.source)];
+        DecodedBlock& columns = decoded[static_cast<size_t>(match.source)];
+        const uint32_t rows = block.meta.events;
+        bool ok = true;
+        if (!columns.types_read) {
+            ok = read_column(block, TYPE_COLUMN, &column) &&
+                 decode_dictionary(column, rows, &columns.types, &columns.type_codes);
+            columns.types_read = ok;
+        }
+        if (ok && !columns.cameras_read) {
+            ok = read_column(block, CAMERA_COLUMN, &column) &&
+                 decode_dictionary(column, rows, &columns.cameras, &columns.camera_codes);
+            columns.cameras_read = ok;
+        }
+        if (ok && !columns.payload_read) {
+            // Validate both columns whole and note where each row starts
+            columns.message_offsets.resize(rows);
+            columns.metadata_offsets.resize(rows);
+            ok = read_column(block, MESSAGE_COLUMN, &columns.messages);
+            const uint8_t* at = columns.messages.data();
+            const uint8_t* end = at + columns.messages.size();
+            for (uint32_t row = 0; row < rows && ok; ++row) {
+                columns.message_offsets[row] = static_cast<uint32_t>(at - columns.messages.data());
+                ok = skip_string(at, end);
+            }
+            ok = ok && at == end && read_column(block, METADATA_COLUMN, &columns.metadata);
+            at = columns.metadata.data();
+            end = at + columns.metadata.size();
+            for (uint32_t row = 0; row < rows && ok; ++row) {
+                columns.metadata_offsets[row] = static_cast<uint32_t>(at - columns.metadata.data());
+                uint64_t entries = 0;
+                ok = get_varint(at, end, &entries) && entries <= static_cast<uint64_t>(end - at);
+                for (uint64_t e = 0; e < entries && ok; ++e) {
+                    ok = skip_string(at, end) && skip_string(at, end);
+                }
+            }
+            columns.payload_read = ok && at == end;
+            ok = columns.payload_read;
+        }
+        if (!ok) {
+            // Unreadable after the filters passed: return what can be read
+            corrupt_blocks_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        LogEvent& event = page.events.emplace_back();
+        event.set_timestamp_ms(columns.times[match.row]);
+        event.set_event_type(columns.types[columns.type_codes[match.row]]);
+        event.set_camera_id(columns.cameras[columns.camera_codes[match.row]]);
+        // Already validated above
+        const uint8_t* at = columns.messages.data() + columns.message_offsets[match.row];
+        get_string(at, columns.messages.data() + columns.messages.size(), event.mutable_message());
+        at = columns.metadata.data() + columns.metadata_offsets[match.row];
+        const uint8_t* end = columns.metadata.data() + columns.metadata.size();
+        uint64_t entries = 0;
+        get_varint(at, end, &entries);
+        std::string key;
+        for (uint64_t e = 0; e < entries; ++e) {
+            get_string(at, end, &key);
+            get_string(at, end, &(*event.mutable_metadata())[key]);
+        }
+    }
+
+    blocks_skipped_.fetch_add(skipped, std::memory_order_relaxed);
+    return page;
+}
+
+EventLogStats EventLog::stats() const {
+    EventLogStats stats;
+    stats.events_appended = events_appended_.load(std::memory_order_relaxed);
+    stats.events_dropped = events_dropped_.load(std::memory_order_relaxed);
+    stats.blocks_written = blocks_written_.load(std::memory_order_relaxed);
+    stats.bytes_written = bytes_written_.load(std::memory_order_relaxed);
+    stats.raw_bytes = raw_bytes_.load(std::memory_order_relaxed);
+    stats.write_errors = write_errors_.load(std::memory_order_relaxed);
+    stats.partitions_removed = partitions_removed_.load(std::memory_order_relaxed);
+    stats.repaired_files = repaired_files_.load(std::memory_order_relaxed);
+    stats.queries = queries_.load(std::memory_order_relaxed);
+    stats.blocks_skipped = blocks_skipped_.load(std::memory_order_relaxed);
+    stats.blocks_read = blocks_read_.load(std::memory_order_relaxed);
+    stats.columns_read = columns_read_.load(std::memory_order_relaxed);
+    stats.column_bytes_read = column_bytes_read_.load(std::memory_order_relaxed);
+    stats.corrupt_blocks = corrupt_blocks_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.partitions = partitions_.size();
+    return stats;
+}
+
+int64_t EventLog::partition_of(int64_t timestamp_ms) const {
+    // Floor division: events before the epoch still get a partition
+    const int64_t quotient = timestamp_ms / partition_ms_;
+    const int64_t floor = quotient - (timestamp_ms % partition_ms_ < 0 ? 1 : 0);
+    return floor * partition_ms_;
+}
+
+std::string EventLog::partition_path(int64_t partition_ms) const {
+    const std::time_t seconds = static_cast<std::time_t>(partition_ms / 1000);
+    std::tm utc{};
+    ::gmtime_r(&seconds, &utc);
+    char name[32];
+    std::strftime(name, sizeof(name), "events-%Y%m%dT%H%M", &utc);
+    return (std::filesystem::path(config_.directory) / (std::string(name) + FILE_SUFFIX)).string();
+}
+
+bool EventLog::load_partition(const std::string& path) {
+    ScopedFd fd(::open(path.c_str(), O_RDWR | O_APPEND | O_CLOEXEC));
+    struct stat info {};
+    if (!fd.is_valid() || ::fstat(fd.get(), &info) != 0) {
+        LOG_ERROR("Cannot open event log '{}': {}", path, std::strerror(errno));
+        return false;
+    }
+
+    uint8_t header[BLOCK_HEADER_BYTES];
+    const uint64_t size = static_cast<uint64_t>(info.st_size);
+    if (size < FILE_HEADER_BYTES || !read_all(fd.get(), header, FILE_HEADER_BYTES, 0) ||
+        load_le64(header) != FILE_MAGIC || load_le32(header + 8) != FORMAT_VERSION ||
+        load_le32(header + FILE_HEADER_CRC_OFFSET) != crc32(header, FILE_HEADER_CRC_OFFSET)) {
+        LOG_WARNING("'{}' is not an event log, leaving it alone", path);
+        return false;
+    }
+    auto partition = std::make_shared<Partition>();
+    partition->start_ms = static_cast<int64_t>(load_le64(header + 16));
+    partition->path = path;
+    if (static_cast<int64_t>(load_le64(header + 24)) != partition_ms_ ||
+        partition->start_ms != partition_of(partition->start_ms) ||
+        partitions_.count(partition->start_ms) != 0) {
+        LOG_WARNING("Event log '{}' does not match the configured partitioning, leaving it alone",
+                    path);
+        return false;
+    }
+
+    uint64_t offset = FILE_HEADER_BYTES;
+    while (offset < size) {
+        BlockMeta meta;
+        meta.offset = offset;
+        bool valid =
+            size - offset >= BLOCK_HEADER_BYTES &&
+            read_all(fd.get(), header, BLOCK_HEADER_BYTES, offset) &&
+            load_le32(header) == BLOCK_MAGIC && load_le16(header + 4) == FORMAT_VERSION &&
+            load_le16(header + 6) == COLUMN_COUNT &&
+            load_le32(header + BLOCK_HEADER_CRC_OFFSET) == crc32(header, BLOCK_HEADER_CRC_OFFSET);
+        uint64_t payload = 0;
+        if (valid) {
+            meta.sequence = load_le64(header + 8);
+            meta.min_ms = static_cast<int64_t>(load_le64(header + 16));
+            meta.max_ms = static_cast<int64_t>(load_le64(header + 24));
+            meta.events = load_le32(header + 32);
+            std::memcpy(meta.types.data(), header + 40, BLOOM_BYTES);
+            std::memcpy(meta.cameras.data(), header + 72, BLOOM_BYTES);
+            for (size_t c = 0; c < COLUMN_COUNT; ++c) {
+                meta.column_bytes[c] = load_le32(header + BLOCK_COLUMNS_OFFSET + c * 8);
+                meta.column_crcs[c] = load_le32(header + BLOCK_COLUMNS_OFFSET + c * 8 + 4);
+                payload += meta.column_bytes[c];
+            }
+            valid = meta.events > 0 && payload <= size - offset - BLOCK_HEADER_BYTES;
+        }
+        if (!valid) {
+            // A crash mid-write leaves a partial block at the end; cut it off
+            LOG_WARNING("Event log '{}' has a torn block at offset {}, truncating", path, offset);
+            if (::ftruncate(fd.get(), static_cast<off_t>(offset)) != 0) {
+                LOG_ERROR("Cannot truncate event log '{}': {}", path, std::strerror(errno));
+                return false;
+            }
+            repaired_files_.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        partition->blocks.push_back(meta);
+        next_sequence_ = std::max(next_sequence_, meta.sequence + 1);
+        offset += BLOCK_HEADER_BYTES + payload;
+    }
+
+    partition->fd = std::move(fd);
+    partition->size = offset;
+    partitions_.emplace(partition->start_ms, std::move(partition));
+    return true;
+}
+
+std::shared_ptr<EventLog::Partition> EventLog::open_partition_locked(int64_t partition_ms) {
+    const auto it = partitions_.find(partition_ms);
+    if (it != partitions_.end()) {
+        return it->second;
+    }
+
+    auto partition = std::make_shared<Partition>();
+    partition->start_ms = partition_ms;
+    partition->path = partition_path(partition_ms);
+    partition->fd = ScopedFd(
+        ::open(partition->path.c_str(), O_RDWR | O_APPEND | O_CREAT | O_EXCL | O_CLOEXEC, 0644));
+    if (!partition->fd.is_valid()) {
+        LOG_ERROR("Cannot create event log '{}': {}", partition->path, std::strerror(errno));
+        return nullptr;
+    }
+
+    uint8_t header[FILE_HEADER_BYTES] = {};
+    store_le64(header, FILE_MAGIC);
+    store_le32(header + 8, FORMAT_VERSION);
+    store_le64(header + 16, static_cast<uint64_t>(partition_ms));
+    store_le64(header + 24, static_cast<uint64_t>(partition_ms_));
+    store_le32(header + FILE_HEADER_CRC_OFFSET, crc32(header, FILE_HEADER_CRC_OFFSET));
+    if (!write_all(partition->fd.get(), header, FILE_HEADER_BYTES)) {
+        LOG_ERROR("Cannot write event log header '{}': {}", partition->path, std::strerror(errno));
+        ::unlink(partition->path.c_str());
+        return nullptr;
+    }
+    if (config_.sync_blocks) {
+        // The new name must survive a crash along with the blocks synced into it
+        ScopedFd directory(::open(config_.directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+        if (directory.is_valid()) {
+            ::fsync(directory.get());
+        }
+    }
+    partition->size = FILE_HEADER_BYTES;
+    partitions_.emplace(partition_ms, partition);
+    return partition;
+}
+
+void EventLog::remove_expired_locked() {
+    const int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                               std::chrono::system_clock::now().time_since_epoch())
+                               .count();
+    const int64_t cutoff_ms =
+        now_ms - std::chrono::duration_cast<std::chrono::milliseconds>(config_.retention).count();
+    for (auto it = partitions_.begin();
+         it != partitions_.end() && it->first + partition_ms_ <= cutoff_ms;) {
+        // Queries still reading it hold the descriptor; the file goes with the last one
+        if (::unlink(it->second->path.c_str()) != 0) {
+            LOG_WARNING("Cannot remove expired event log '{}': {}",
+                        it->second->path,
+                        std::strerror(errno));
+        }
+        partitions_removed_.fetch_add(1, std::memory_order_relaxed);
+        it = partitions_.erase(it);
+    }
+}
+
+bool EventLog::read_column(const DiskBlock& block,
+                           size_t column,
+                           std::vector<uint8_t>* bytes) const {
+    uint64_t offset = block.meta.offset + BLOCK_HEADER_BYTES;
+    for (size_t c = 0; c < column; ++c) {
+        offset += block.meta.column_bytes[c];
+    }
+    bytes->resize(block.meta.column_bytes[column]);
+    columns_read_.fetch_add(1, std::memory_order_relaxed);
+    column_bytes_read_.fetch_add(bytes->size(), std::memory_order_relaxed);
+    if (!read_all(block.partition->fd.get(), bytes->data(), bytes->size(), offset)) {
+        LOG_ERROR("Cannot read event block from '{}': {}",
+                  block.partition->path,
+                  std::strerror(errno));
+        return false;
+    }
+    if (crc32(bytes->data(), bytes->size()) != block.meta.column_crcs[column]) {
+        LOG_WARNING("Event block {} in '{}' failed its checksum",
+                    block.meta.sequence,
+                    block.partition->path);
+        return false;
+    }
+    return true;
+}
+
+} // namespace dashcam
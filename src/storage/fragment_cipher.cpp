@@ -0,0 +1,338 @@
+#include "dashcam/storage/fragment_cipher.h"
+#include "dashcam/utils/byte_order.h"
+#include "dashcam/utils/logger.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+
+namespace dashcam {
+
+namespace {
+
+constexpr size_t NONCE_BYTES = 12;
+
+// Domain separation for the per-segment key; bump on any format change
+constexpr char KEY_DERIVATION_LABEL[] = "dashcam fmp4 aes-256-gcm v1";
+
+// EVP_CipherUpdate() takes an int length
+constexpr uint32_t MAX_CHUNK_BYTES = 1u << 30;
+
+} // namespace
+
+/**
+ * @brief One fragment's worth of chunk jobs
+ */
+struct FragmentCipher::Batch {
+    bool encrypt = true;
+    uint32_t fragment_sequence = 0;
+    const WriteChunk* pieces = nullptr;   // Source bytes, in order
+    uint32_t piece_count = 0;
+    uint8_t* out = nullptr;               // Destination; equals the source when decrypting
+    uint8_t* tags_out = nullptr;
+    const uint8_t* tags_in = nullptr;
+    uint64_t total_bytes = 0;
+    uint32_t chunk_count = 0;
+
+    std::atomic<uint32_t> next_chunk{0};
+    std::atomic<uint32_t> failures{0};
+};
+
+/**
+ * @brief A cipher context owned by exactly one thread
+ */
+struct FragmentCipher::ThreadContext {
+    ThreadContext() : context(EVP_CIPHER_CTX_new()) {
+        assert(context != nullptr);
+        // Cipher is fixed for the context's lifetime; key and nonce change per chunk
+        EVP_CipherInit_ex(context, EVP_aes_256_gcm(), nullptr, nullptr, nullptr, 1);
+    }
+
+    ~ThreadContext() {
+        EVP_CIPHER_CTX_free(context);
+    }
+
+    ThreadContext(const ThreadContext&) = delete;
+    ThreadContext& operator=(const ThreadContext&) = delete;
+
+    EVP_CIPHER_CTX* context;
+};
+
+FragmentCipher::FragmentCipher(const FragmentCipherConfig& config)
+    : config_(config), contexts_(config.worker_threads + 1) {
+    // Tiger Style: assert preconditions
+    assert(config_.chunk_bytes > 0);
+    assert(config_.chunk_bytes <= MAX_CHUNK_BYTES);
+    assert(config_.worker_threads <= MAX_WORKER_THREADS);
+
+    workers_.reserve(config_.worker_threads);
+    for (uint32_t i = 1; i <= config_.worker_threads; ++i) {
+        workers_.emplace_back(&FragmentCipher::worker_loop, this, i);
+    }
+}
+
+FragmentCipher::~FragmentCipher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_ready_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+    OPENSSL_cleanse(config_.master_key.data(), config_.master_key.size());
+    OPENSSL_cleanse(segment_key_.data(), segment_key_.size());
+}
+
+bool FragmentCipher::start_segment(SegmentEncryption* out) {
+    assert(out != nullptr);
+
+    SegmentEncryption encryption;
+    if (RAND_bytes(encryption.salt.data(), static_cast<int>(encryption.salt.size())) != 1) {
+        LOG_ERROR("No entropy available for a segment encryption salt");
+        has_segment_ = false;
+        return false;
+    }
+    encryption.chunk_bytes = config_.chunk_bytes;
+    if (!derive_segment_key(encryption)) {
+        return false;
+    }
+    *out = encryption;
+    return true;
+}
+
+bool FragmentCipher::resume_segment(const SegmentEncryption& encryption) {
+    if (encryption.chunk_bytes == 0 || encryption.chunk_bytes > MAX_CHUNK_BYTES) {
+        LOG_ERROR("Invalid encryption chunk size {}", encryption.chunk_bytes);
+        has_segment_ = false;
+        return false;
+    }
+    return derive_segment_key(encryption);
+}
+
+uint32_t FragmentCipher::chunk_count(uint64_t fragment_bytes) const {
+    const uint32_t chunk_bytes = has_segment_ ? segment_chunk_bytes_ : config_.chunk_bytes;
+    const uint64_t count = (fragment_bytes + chunk_bytes - 1) / chunk_bytes;
+    assert(count <= UINT32_MAX);
+    return static_cast<uint32_t>(count);
+}
+
+bool FragmentCipher::encrypt_fragment(uint32_t fragment_sequence,
+                                      const WriteChunk* samples,
+                                      uint32_t sample_count,
+                                      uint8_t* out,
+                                      uint8_t* tags_out) {
+    assert(has_segment_); // Tiger Style: assert preconditions
+    assert(samples != nullptr && sample_count > 0);
+    assert(out != nullptr && tags_out != nullptr);
+
+    Batch batch;
+    batch.encrypt = true;
+    batch.fragment_sequence = fragment_sequence;
+    batch.pieces = samples;
+    batch.piece_count = sample_count;
+    batch.out = out;
+    batch.tags_out = tags_out;
+    for (uint32_t i = 0; i < sample_count; ++i) {
+        batch.total_bytes += samples[i].size_bytes;
+    }
+    batch.chunk_count = chunk_count(batch.total_bytes);
+    assert(batch.chunk_count <= MAX_CHUNKS_PER_FRAGMENT);
+    return run_batch(batch);
+}
+
+bool FragmentCipher::decrypt_fragment(uint32_t fragment_sequence,
+                                      uint8_t* data,
+                                      uint64_t size_bytes,
+                                      const uint8_t* tags) {
+    assert(has_segment_);
+    assert(data != nullptr && size_bytes > 0);
+    assert(tags != nullptr);
+
+    WriteChunk whole;
+    whole.data = data;
+    whole.size_bytes = static_cast<size_t>(size_bytes);
+
+    Batch batch;
+    batch.encrypt = false;
+    batch.fragment_sequence = fragment_sequence;
+    batch.pieces = &whole;
+    batch.piece_count = 1;
+    batch.out = data;
+    batch.tags_in = tags;
+    batch.total_bytes = size_bytes;
+    batch.chunk_count = chunk_count(size_bytes);
+    if (batch.chunk_count > MAX_CHUNKS_PER_FRAGMENT) {
+        LOG_ERROR("Encrypted fragment of {} bytes has too many chunks", size_bytes);
+        return false;
+    }
+
+    const bool ok = run_batch(batch);
+    if (!ok) {
+        stats_.authentication_failures++;
+        LOG_WARNING("Fragment {} failed authentication", fragment_sequence);
+    }
+    return ok;
+}
+
+FragmentCipherStats FragmentCipher::stats() const {
+    return stats_;
+}
+
+bool FragmentCipher::derive_segment_key(const SegmentEncryption& encryption) {
+    // HMAC-SHA256(master, label || salt || chunk_bytes) as a PRF
+    constexpr size_t LABEL_BYTES = sizeof(KEY_DERIVATION_LABEL);
+    uint8_t input[LABEL_BYTES + ENCRYPTION_SALT_BYTES + 4];
+    std::memcpy(input, KEY_DERIVATION_LABEL, LABEL_BYTES);
+    std::memcpy(input + LABEL_BYTES, encryption.salt.data(), encryption.salt.size());
+    store_be32(input + LABEL_BYTES + ENCRYPTION_SALT_BYTES, encryption.chunk_bytes);
+
+    unsigned int length = 0;
+    const uint8_t* result = HMAC(EVP_sha256(),
+                                 config_.master_key.data(),
+                                 static_cast<int>(config_.master_key.size()),
+                                 input,
+                                 sizeof(input),
+                                 segment_key_.data(),
+                                 &length);
+    if (result == nullptr || length != segment_key_.size()) {
+        LOG_ERROR("Segment key derivation failed");
+        has_segment_ = false;
+        return false;
+    }
+    segment_chunk_bytes_ = encryption.chunk_bytes;
+    has_segment_ = true;
+    return true;
+}
+
+bool FragmentCipher::run_batch(Batch& batch) {
+    assert(batch.chunk_count > 0);
+
+    // A single chunk is not worth waking anyone for
+    if (workers_.empty() || batch.chunk_count == 1) {
+        run_chunks(batch, contexts_[0]);
+    } else {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            assert(batch_ == nullptr);
+            batch_ = &batch;
+            batch_generation_++;
+            busy_workers_ = static_cast<uint32_t>(workers_.size());
+        }
+        work_ready_.notify_all();
+        run_chunks(batch, contexts_[0]);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        work_done_.wait(lock, [this] { return busy_workers_ == 0; });
+        batch_ = nullptr;
+    }
+
+    stats_.fragments++;
+    stats_.chunks += batch.chunk_count;
+    stats_.bytes += batch.total_bytes;
+    return batch.failures.load() == 0;
+}
+
+void FragmentCipher::run_chunks(Batch& batch, ThreadContext& context) {
+    // Chunks are claimed one at a time so a slow thread never holds up the rest
+    for (uint32_t chunk = batch.next_chunk.fetch_add(1); chunk < batch.chunk_count;
+         chunk = batch.next_chunk.fetch_add(1)) {
+        if (!process_chunk(batch, chunk, context)) {
+            batch.failures.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+bool FragmentCipher::process_chunk(const Batch& batch,
+                                   uint32_t chunk,
+                                   ThreadContext& context) const {
+    EVP_CIPHER_CTX* ctx = context.context;
+    const uint64_t begin = static_cast<uint64_t>(chunk) * segment_chunk_bytes_;
+    const uint64_t end = std::min<uint64_t>(begin + segment_chunk_bytes_, batch.total_bytes);
+    assert(begin < end);
+
+    uint8_t nonce[NONCE_BYTES] = {};
+    store_be32(nonce, batch.fragment_sequence);
+    store_be32(nonce + 4, chunk);
+
+    const int encrypt = batch.encrypt ? 1 : 0;
+    if (EVP_CipherInit_ex(ctx, nullptr, nullptr, segment_key_.data(), nonce, encrypt) != 1) {
+        return false;
+    }
+
+    // Walk the pieces overlapping [begin, end); bounded by piece_count
+    uint64_t piece_start = 0;
+    for (uint32_t i = 0; i < batch.piece_count && piece_start < end; ++i) {
+        const WriteChunk& piece = batch.pieces[i];
+        const uint64_t piece_end = piece_start + piece.size_bytes;
+        if (piece_end > begin) {
+            const uint64_t from = std::max(begin, piece_start);
+            const uint64_t to = std::min(end, piece_end);
+            int written = 0;
+            if (EVP_CipherUpdate(ctx,
+                                 batch.out + from,
+                                 &written,
+                                 piece.data + (from - piece_start),
+                                 static_cast<int>(to - from)) != 1) {
+                return false;
+            }
+            assert(static_cast<uint64_t>(written) == to - from); // GCM is a stream mode
+        }
+        piece_start = piece_end;
+    }
+
+    uint8_t* tag_out = batch.encrypt ? batch.tags_out + chunk * ENCRYPTION_TAG_BYTES : nullptr;
+    if (!batch.encrypt) {
+        uint8_t tag[ENCRYPTION_TAG_BYTES];
+        std::memcpy(tag, batch.tags_in + chunk * ENCRYPTION_TAG_BYTES, sizeof(tag));
+        if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, sizeof(tag), tag) != 1) {
+            return false;
+        }
+    }
+
+    int final_bytes = 0;
+    if (EVP_CipherFinal_ex(ctx, nullptr, &final_bytes) != 1) {
+        return false; // Authentication failure when decrypting
+    }
+    assert(final_bytes == 0);
+    if (batch.encrypt) {
+        return EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, ENCRYPTION_TAG_BYTES, tag_out) == 1;
+    }
+    return true;
+}
+
+void FragmentCipher::worker_loop(uint32_t index) {
+    assert(index > 0 && index < contexts_.size());
+    uint64_t seen_generation = 0;
+
+    // Tiger Style: runs until the destructor sets stopping_
+    while (true) {
+        Batch* batch = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_ready_.wait(lock, [&] {
+                return stopping_ || batch_generation_ != seen_generation;
+            });
+            if (stopping_) {
+                return;
+            }
+            seen_generation = batch_generation_;
+            batch = batch_;
+        }
+        assert(batch != nullptr);
+        run_chunks(*batch, contexts_[index]);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            busy_workers_--;
+        }
+        work_done_.notify_one();
+    }
+}
+
+} // namespace dashcam
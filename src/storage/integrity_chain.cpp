@@ -0,0 +1,506 @@
+#include "dashcam/storage/integrity_chain.h"
+#include "dashcam/storage/checkpoint_file.h"
+#include "dashcam/utils/byte_order.h"
+#include "dashcam/utils/logger.h"
+
+#include <cassert>
+#include <cstring>
+
+#include <openssl/evp.h>
+
+namespace dashcam {
+
+namespace {
+
+constexpr size_t SIGNATURE_BYTES = 64;
+
+// Domain separation; bump on any change to what is hashed or signed
+constexpr char CHAIN_LABEL[] = "dashcam fragment chain v1";
+constexpr char CHECKPOINT_LABEL[] = "dashcam checkpoint v1";
+
+// Same bound as recovery: a one-hour segment at one fragment per second, with headroom
+constexpr uint32_t MAX_VERIFY_BOXES = 1u << 16;
+
+// moof header, then mfhd header and version/flags, then the sequence number
+constexpr size_t MFHD_SEQUENCE_OFFSET = 8 + 12;
+
+using ChainHash = std::array<uint8_t, CHAIN_HASH_BYTES>;
+using PublicKey = std::array<uint8_t, SIGNING_KEY_BYTES>;
+
+/**
+ * @brief link = SHA-256(prefix || pieces...)
+ */
+bool hash_link(EVP_MD_CTX* ctx,
+               const uint8_t* prefix,
+               size_t prefix_bytes,
+               const WriteChunk* pieces,
+               uint32_t piece_count,
+               ChainHash* out) {
+    if (EVP_DigestInit_ex(ctx, EVP_sha256(), nullptr) != 1 ||
+        EVP_DigestUpdate(ctx, prefix, prefix_bytes) != 1) {
+        return false;
+    }
+    for (uint32_t i = 0; i < piece_count; ++i) {
+        if (EVP_DigestUpdate(ctx, pieces[i].data, pieces[i].size_bytes) != 1) {
+            return false;
+        }
+    }
+    unsigned int length = 0;
+    return EVP_DigestFinal_ex(ctx, out->data(), &length) == 1 && length == out->size();
+}
+
+// Large enough for either link prefix below
+constexpr size_t INIT_PREFIX_BYTES = sizeof(CHAIN_LABEL) + CHAIN_HASH_BYTES + 8;
+
+/**
+ * @brief Prefix of the sequence 0 link: label || genesis || segment id
+ */
+size_t init_prefix(const ChainHash& genesis, uint64_t segment_id, uint8_t* out) {
+    constexpr size_t LABEL_BYTES = sizeof(CHAIN_LABEL);
+    std::memcpy(out, CHAIN_LABEL, LABEL_BYTES);
+    std::memcpy(out + LABEL_BYTES, genesis.data(), genesis.size());
+    store_be64(out + LABEL_BYTES + CHAIN_HASH_BYTES, segment_id);
+    return INIT_PREFIX_BYTES;
+}
+
+/**
+ * @brief Prefix of a fragment link: previous link || sequence
+ */
+size_t fragment_prefix(const ChainHash& previous, uint32_t sequence, uint8_t* out) {
+    std::memcpy(out, previous.data(), previous.size());
+    store_be32(out + CHAIN_HASH_BYTES, sequence);
+    return CHAIN_HASH_BYTES + 4;
+}
+
+constexpr size_t CHECKPOINT_MESSAGE_BYTES =
+    sizeof(CHECKPOINT_LABEL) + 8 + 4 + 2 * CHAIN_HASH_BYTES;
+
+void checkpoint_message(const IntegrityCheckpoint& checkpoint, uint8_t* out) {
+    constexpr size_t LABEL_BYTES = sizeof(CHECKPOINT_LABEL);
+    std::memcpy(out, CHECKPOINT_LABEL, LABEL_BYTES);
+    store_be64(out + LABEL_BYTES, checkpoint.segment_id);
+    store_be32(out + LABEL_BYTES + 8, checkpoint.fragment_sequence);
+    std::memcpy(out + LABEL_BYTES + 12, checkpoint.genesis.data(), CHAIN_HASH_BYTES);
+    std::memcpy(out + LABEL_BYTES + 12 + CHAIN_HASH_BYTES,
+                checkpoint.chain_hash.data(),
+                CHAIN_HASH_BYTES);
+}
+
+WriteChunk file_range(const uint8_t* data, uint64_t begin, uint64_t end) {
+    WriteChunk range;
+    range.data = data + begin;
+    range.size_bytes = static_cast<size_t>(end - begin);
+    return range;
+}
+
+} // namespace
+
+/**
+ * @brief OpenSSL state owned by the worker, plus the key
+ */
+struct IntegrityChain::Crypto {
+    Crypto() : hash(EVP_MD_CTX_new()), sign(EVP_MD_CTX_new()) {
+        assert(hash != nullptr && sign != nullptr);
+    }
+
+    ~Crypto() {
+        EVP_PKEY_free(key);
+        EVP_MD_CTX_free(sign);
+        EVP_MD_CTX_free(hash);
+    }
+
+    Crypto(const Crypto&) = delete;
+    Crypto& operator=(const Crypto&) = delete;
+
+    EVP_PKEY* key = nullptr;
+    EVP_MD_CTX* hash;
+    EVP_MD_CTX* sign;
+};
+
+IntegrityChain::IntegrityChain(const IntegrityChainConfig& config, SegmentIndex& index)
+    : config_(config),
+      index_(index),
+      crypto_(std::make_unique<Crypto>()),
+      jobs_(config.max_pending_fragments) {
+    // Tiger Style: assert preconditions
+    assert(config_.checkpoint_interval > 0);
+    assert(config_.max_pending_fragments > 0);
+
+    crypto_->key = EVP_PKEY_new_raw_private_key(
+        EVP_PKEY_ED25519, nullptr, config_.signing_key.data(), config_.signing_key.size());
+    if (crypto_->key == nullptr) {
+        LOG_ERROR("Integrity signing key is not a valid Ed25519 seed");
+    }
+}
+
+IntegrityChain::~IntegrityChain() {
+    stop();
+}
+
+bool IntegrityChain::start() {
+    assert(!thread_.joinable());
+    if (crypto_->key == nullptr) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_requested_ = false;
+    }
+    thread_ = std::thread([this] { run(); });
+    return true;
+}
+
+void IntegrityChain::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_requested_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void IntegrityChain::resume(const std::array<uint8_t, CHAIN_HASH_BYTES>& link) {
+    assert(!thread_.joinable()); // Tiger Style: assert preconditions
+    link_ = link;
+}
+
+void IntegrityChain::begin_segment(uint64_t segment_id) {
+    assert(!in_segment_); // Tiger Style: assert preconditions
+    current_segment_ = segment_id;
+    in_segment_ = true;
+    segment_has_gap_ = false;
+}
+
+bool IntegrityChain::submit(uint32_t sequence,
+                            const WriteChunk& head,
+                            const WriteChunk* body,
+                            uint32_t body_count) {
+    assert(in_segment_);
+    assert(head.data != nullptr);
+    assert(body_count == 0 || body != nullptr);
+    assert(body_count < SegmentWriter::MAX_BATCH_CHUNKS);
+
+    Job* job = segment_has_gap_ ? nullptr : reserve_job();
+    if (job == nullptr) {
+        if (!segment_has_gap_) {
+            LOG_WARNING("Integrity queue full, segment {} unchained from fragment {}",
+                        current_segment_,
+                        sequence);
+        }
+        segment_has_gap_ = true;
+        fragments_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Only references are copied; the bytes stay in the writer's buffers
+    job->kind = JobKind::Fragment;
+    job->segment_id = current_segment_;
+    job->sequence = sequence;
+    job->pieces[0] = head;
+    for (uint32_t i = 0; i < body_count; ++i) {
+        job->pieces[i + 1] = body[i];
+    }
+    job->piece_count = body_count + 1;
+    commit_job();
+    return true;
+}
+
+void IntegrityChain::end_segment() {
+    assert(in_segment_);
+    in_segment_ = false;
+
+    // Even after a gap: signing the last link hashed lets the next segment's
+    // genesis be checked against this one
+    Job* job = reserve_job();
+    if (job == nullptr) {
+        // The last periodic checkpoint still covers a prefix of the segment
+        LOG_WARNING("Integrity queue full, no final checkpoint for segment {}",
+                    current_segment_);
+        failures_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    job->kind = JobKind::EndSegment;
+    job->segment_id = current_segment_;
+    job->piece_count = 0;
+    commit_job();
+}
+
+std::array<uint8_t, SIGNING_KEY_BYTES> IntegrityChain::public_key() const {
+    PublicKey key{};
+    size_t length = key.size();
+    if (crypto_->key == nullptr ||
+        EVP_PKEY_get_raw_public_key(crypto_->key, key.data(), &length) != 1) {
+        return PublicKey{};
+    }
+    assert(length == key.size());
+    return key;
+}
+
+IntegrityChainStats IntegrityChain::stats() const {
+    IntegrityChainStats stats;
+    stats.fragments_hashed = fragments_hashed_.load(std::memory_order_relaxed);
+    stats.bytes_hashed = bytes_hashed_.load(std::memory_order_relaxed);
+    stats.checkpoints_written = checkpoints_written_.load(std::memory_order_relaxed);
+    stats.fragments_dropped = fragments_dropped_.load(std::memory_order_relaxed);
+    stats.failures = failures_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+bool IntegrityChain::verify_checkpoint(const std::array<uint8_t, SIGNING_KEY_BYTES>& public_key,
+                                       const IntegrityCheckpoint& checkpoint) {
+    EVP_PKEY* key = EVP_PKEY_new_raw_public_key(
+        EVP_PKEY_ED25519, nullptr, public_key.data(), public_key.size());
+    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+
+    uint8_t message[CHECKPOINT_MESSAGE_BYTES];
+    checkpoint_message(checkpoint, message);
+
+    // Ed25519 is a one-shot scheme: no separate digest
+    const bool ok = key != nullptr && ctx != nullptr &&
+                    EVP_DigestVerifyInit(ctx, nullptr, nullptr, nullptr, key) == 1 &&
+                    EVP_DigestVerify(ctx,
+                                     checkpoint.signature.data(),
+                                     checkpoint.signature.size(),
+                                     message,
+                                     sizeof(message)) == 1;
+    EVP_MD_CTX_free(ctx);
+    EVP_PKEY_free(key);
+    return ok;
+}
+
+ChainVerification IntegrityChain::verify_segment(
+    const std::array<uint8_t, SIGNING_KEY_BYTES>& public_key,
+    const uint8_t* data,
+    uint64_t size_bytes,
+    const std::vector<IntegrityCheckpoint>& checkpoints,
+    const std::array<uint8_t, CHAIN_HASH_BYTES>* previous_link) {
+    assert(data != nullptr || size_bytes == 0);
+
+    ChainVerification result;
+    if (checkpoints.empty() || checkpoints.front().fragment_sequence != 0) {
+        LOG_WARNING("Segment has no anchoring integrity checkpoint");
+        return result;
+    }
+    result.linked_to_previous = previous_link != nullptr && checkpoints.front().genesis == *previous_link;
+    if (previous_link != nullptr && !result.linked_to_previous) {
+        // A segment between the two was removed, or they were reordered
+        LOG_WARNING("Segment {} does not continue the previous segment's chain",
+                    checkpoints.front().segment_id);
+        return result;
+    }
+    for (const IntegrityCheckpoint& checkpoint : checkpoints) {
+        if (!verify_checkpoint(public_key, checkpoint)) {
+            LOG_WARNING("Integrity checkpoint {} of segment {} has a bad signature",
+                        checkpoint.fragment_sequence,
+                        checkpoint.segment_id);
+            return result;
+        }
+    }
+
+    // The initialization segment is everything before the first moof
+    uint64_t offset = 0;
+    uint32_t boxes = 0;
+    while (offset + 8 <= size_bytes && boxes < MAX_VERIFY_BOXES &&
+           std::memcmp(data + offset + 4, "moof", 4) != 0) {
+        const uint32_t box_size = load_be32(data + offset);
+        if (box_size < 8 || box_size > size_bytes - offset) {
+            break;
+        }
+        offset += box_size;
+        boxes++;
+    }
+
+    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+    if (ctx == nullptr) {
+        return result;
+    }
+
+    const IntegrityCheckpoint& anchor = checkpoints.front();
+    uint8_t prefix[INIT_PREFIX_BYTES];
+    const WriteChunk init = file_range(data, 0, offset);
+    ChainHash link{};
+    bool ok = hash_link(ctx,
+                        prefix,
+                        init_prefix(anchor.genesis, anchor.segment_id, prefix),
+                        &init,
+                        1,
+                        &link) &&
+              link == anchor.chain_hash;
+    if (ok) {
+        result.checkpoints_matched = 1;
+    }
+
+    // Each fragment is a moof and the mdat right after it
+    size_t next = 1;
+    while (ok && offset + 8 <= size_bytes && boxes < MAX_VERIFY_BOXES) {
+        const uint32_t moof_size = load_be32(data + offset);
+        if (std::memcmp(data + offset + 4, "moof", 4) != 0 ||
+            moof_size < MFHD_SEQUENCE_OFFSET + 4 || moof_size > size_bytes - offset - 8) {
+            break;
+        }
+        const uint64_t mdat = offset + moof_size;
+        const uint32_t mdat_size = load_be32(data + mdat);
+        if (std::memcmp(data + mdat + 4, "mdat", 4) != 0 || mdat_size < 8 ||
+            mdat_size > size_bytes - mdat) {
+            break;
+        }
+        const uint32_t sequence = load_be32(data + offset + MFHD_SEQUENCE_OFFSET);
+        const uint64_t end = mdat + mdat_size;
+
+        const WriteChunk fragment = file_range(data, offset, end);
+        ok = hash_link(ctx, prefix, fragment_prefix(link, sequence, prefix), &fragment, 1, &link);
+        result.fragments_in_file++;
+
+        if (ok && next < checkpoints.size() && checkpoints[next].fragment_sequence == sequence) {
+            ok = checkpoints[next].chain_hash == link;
+            if (ok) {
+                result.checkpoints_matched++;
+                result.verified_through = sequence;
+                next++;
+            }
+        }
+        offset = end;
+        boxes += 2;
+    }
+    EVP_MD_CTX_free(ctx);
+
+    // A checkpoint left unmatched means a fragment was altered, removed or cut off
+    result.valid = ok && next == checkpoints.size();
+    if (!result.valid) {
+        LOG_WARNING("Segment {} fails integrity verification after fragment {}",
+                    anchor.segment_id,
+                    result.verified_through);
+    }
+    return result;
+}
+
+IntegrityChain::Job* IntegrityChain::reserve_job() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (count_ == jobs_.size()) {
+        return nullptr;
+    }
+    // The worker never reads past head_ + count_, so the tail is ours to fill
+    return &jobs_[(head_ + count_) % jobs_.size()];
+}
+
+void IntegrityChain::commit_job() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        assert(count_ < jobs_.size());
+        count_++;
+    }
+    wake_.notify_one();
+}
+
+void IntegrityChain::run() {
+    // Tiger Style: runs until stop() is requested and the queue is drained
+    while (true) {
+        Job* job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return count_ > 0 || stop_requested_; });
+            if (count_ == 0) {
+                return;
+            }
+            job = &jobs_[head_];
+        }
+
+        hash_job(*job);
+        // Let the writer's buffers go back to their pools
+        for (uint32_t i = 0; i < job->piece_count; ++i) {
+            job->pieces[i] = WriteChunk{};
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            head_ = (head_ + 1) % static_cast<uint32_t>(jobs_.size());
+            count_--;
+        }
+    }
+}
+
+void IntegrityChain::hash_job(const Job& job) {
+    if (job.kind == JobKind::EndSegment) {
+        // A segment whose first fragment was dropped has no chain to sign
+        if (anchored_segment_ == job.segment_id && last_sequence_ != last_checkpoint_sequence_) {
+            write_checkpoint(job.segment_id, last_sequence_);
+        }
+        return;
+    }
+
+    uint8_t prefix[INIT_PREFIX_BYTES];
+    size_t prefix_bytes = 0;
+    if (job.sequence == 0) {
+        // The previous segment's final link carries the chain across files
+        genesis_ = link_;
+        prefix_bytes = init_prefix(genesis_, job.segment_id, prefix);
+    } else {
+        prefix_bytes = fragment_prefix(link_, job.sequence, prefix);
+    }
+
+    if (!hash_link(crypto_->hash, prefix, prefix_bytes, job.pieces.data(), job.piece_count,
+                   &link_)) {
+        LOG_ERROR("Hashing fragment {} of segment {} failed", job.sequence, job.segment_id);
+        failures_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    uint64_t bytes = 0;
+    for (uint32_t i = 0; i < job.piece_count; ++i) {
+        bytes += job.pieces[i].size_bytes;
+    }
+    fragments_hashed_.fetch_add(1, std::memory_order_relaxed);
+    bytes_hashed_.fetch_add(bytes, std::memory_order_relaxed);
+
+    last_sequence_ = job.sequence;
+    if (job.sequence == 0) {
+        anchored_segment_ = job.segment_id;
+        last_checkpoint_sequence_ = 0;
+        write_checkpoint(job.segment_id, 0);
+    } else if (job.sequence - last_checkpoint_sequence_ >= config_.checkpoint_interval) {
+        write_checkpoint(job.segment_id, job.sequence);
+    }
+}
+
+void IntegrityChain::write_checkpoint(uint64_t segment_id, uint32_t sequence) {
+    IntegrityCheckpoint checkpoint;
+    checkpoint.segment_id = segment_id;
+    checkpoint.fragment_sequence = sequence;
+    checkpoint.genesis = genesis_;
+    checkpoint.chain_hash = link_;
+
+    uint8_t message[CHECKPOINT_MESSAGE_BYTES];
+    checkpoint_message(checkpoint, message);
+    size_t signature_bytes = SIGNATURE_BYTES;
+    static_assert(SIGNATURE_BYTES == sizeof(checkpoint.signature), "Ed25519 signature size");
+
+    EVP_MD_CTX_reset(crypto_->sign);
+    if (EVP_DigestSignInit(crypto_->sign, nullptr, nullptr, nullptr, crypto_->key) != 1 ||
+        EVP_DigestSign(crypto_->sign,
+                       checkpoint.signature.data(),
+                       &signature_bytes,
+                       message,
+                       sizeof(message)) != 1) {
+        LOG_ERROR("Signing checkpoint {} of segment {} failed", sequence, segment_id);
+        failures_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const std::optional<SegmentInfo> segment = index_.find(segment_id);
+    if (!segment || !index_.add_checkpoint(checkpoint)) {
+        LOG_WARNING("Segment {} left the index before checkpoint {}", segment_id, sequence);
+        failures_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    last_checkpoint_sequence_ = sequence;
+    // The index is lost at power-off; the file is what footage is verified against later
+    if (!append_checkpoint_file(checkpoint_file_path(segment->path), checkpoint)) {
+        failures_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    checkpoints_written_.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace dashcam
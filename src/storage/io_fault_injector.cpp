@@ -0,0 +1,79 @@
+#include "dashcam/storage/io_fault_injector.h"
+
+#include <cassert>
+#include <cerrno>
+#include <thread>
+
+namespace dashcam {
+
+IoFaultInjector::IoFaultInjector(const IoFaultConfig& config) {
+    configure(config);
+}
+
+void IoFaultInjector::configure(const IoFaultConfig& config) {
+    // Tiger Style: assert preconditions
+    assert(config.write_delay.count() >= 0);
+    assert(config.sync_delay.count() >= 0);
+    assert(config.fail_every_nth_write == 0 || config.write_errno != 0);
+    assert(config.fail_every_nth_sync == 0 || config.sync_errno != 0);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+}
+
+int IoFaultInjector::before_write(uint64_t bytes) {
+    const IoFaultConfig config = current_config();
+    const uint64_t sequence = writes_seen_.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    if (config.write_delay.count() > 0) {
+        std::this_thread::sleep_for(config.write_delay);
+    }
+
+    int injected = 0;
+    if (config.fail_every_nth_write > 0 && sequence % config.fail_every_nth_write == 0) {
+        injected = config.write_errno;
+    } else if (config.enospc_after_bytes > 0 &&
+               bytes_allowed_.load(std::memory_order_relaxed) + bytes >
+                   config.enospc_after_bytes) {
+        injected = ENOSPC;
+    }
+
+    if (injected != 0) {
+        writes_failed_.fetch_add(1, std::memory_order_relaxed);
+        return injected;
+    }
+    bytes_allowed_.fetch_add(bytes, std::memory_order_relaxed);
+    return 0;
+}
+
+int IoFaultInjector::before_sync() {
+    const IoFaultConfig config = current_config();
+    const uint64_t sequence = syncs_seen_.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    if (config.sync_delay.count() > 0) {
+        std::this_thread::sleep_for(config.sync_delay);
+    }
+
+    if (config.fail_every_nth_sync > 0 && sequence % config.fail_every_nth_sync == 0) {
+        syncs_failed_.fetch_add(1, std::memory_order_relaxed);
+        return config.sync_errno;
+    }
+    return 0;
+}
+
+IoFaultStats IoFaultInjector::stats() const {
+    IoFaultStats stats;
+    stats.writes_seen = writes_seen_.load(std::memory_order_relaxed);
+    stats.syncs_seen = syncs_seen_.load(std::memory_order_relaxed);
+    stats.writes_failed = writes_failed_.load(std::memory_order_relaxed);
+    stats.syncs_failed = syncs_failed_.load(std::memory_order_relaxed);
+    stats.bytes_allowed = bytes_allowed_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+IoFaultConfig IoFaultInjector::current_config() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return config_;
+}
+
+} // namespace dashcam
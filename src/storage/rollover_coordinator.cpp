@@ -0,0 +1,177 @@
+#include "dashcam/storage/rollover_coordinator.h"
+#include "dashcam/utils/logger.h"
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace dashcam {
+
+RolloverCoordinator::RolloverCoordinator(const RolloverConfig& config,
+                                         const SegmentLayout& layout,
+                                         SegmentIndex& index)
+    : config_(config), layout_(layout), index_(index), next_segment_id_(config.first_segment_id) {
+    assert(config_.segment_duration.count() > 0); // Tiger Style: assert preconditions
+}
+
+uint32_t RolloverCoordinator::add_camera(std::string_view camera_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Tiger Style: assert preconditions
+    assert(!camera_id.empty());
+    assert(camera_count_ < MAX_CAMERAS);
+    assert(next_boundary_us_.load(std::memory_order_relaxed) == NO_PENDING);
+    for (uint32_t i = 0; i < camera_count_; ++i) {
+        assert(cameras_[i].camera_id != camera_id);
+    }
+
+    cameras_[camera_count_].camera_id = std::string(camera_id);
+    return camera_count_++;
+}
+
+bool RolloverCoordinator::start(int64_t now_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    assert(camera_count_ > 0);
+
+    if (!open_batch(now_us)) {
+        return false;
+    }
+    next_boundary_us_.store(align_up(now_us), std::memory_order_release);
+    return true;
+}
+
+bool RolloverCoordinator::keyframe_due(uint32_t camera, int64_t capture_us) {
+    assert(camera < camera_count_);
+    CameraState& state = cameras_[camera];
+
+    // A camera behind the others still owes a keyframe for its own pending boundary
+    const int64_t due = std::min(state.pending_start_us.load(std::memory_order_acquire),
+                                 next_boundary_us_.load(std::memory_order_acquire));
+    if (capture_us < due || state.forced_for_us == due) {
+        return false;
+    }
+    state.forced_for_us = due;
+    forced_keyframes_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+std::optional<SegmentInfo> RolloverCoordinator::on_keyframe(uint32_t camera, int64_t capture_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    assert(camera < camera_count_);
+    CameraState& state = cameras_[camera];
+    const int64_t duration = config_.segment_duration.count();
+    const int64_t boundary = next_boundary_us_.load(std::memory_order_relaxed);
+
+    if (state.pending && capture_us >= state.pending->start_time_us + duration) {
+        // Stalled through a whole segment: its entry never got a file
+        LOG_WARNING("Camera {} missed segment {}, rejoining at {}",
+                    state.camera_id,
+                    state.pending->segment_id,
+                    capture_us);
+        index_.remove(state.pending->segment_id);
+        state.pending.reset();
+        state.pending_start_us.store(NO_PENDING, std::memory_order_release);
+        late_segments_.fetch_add(1, std::memory_order_relaxed);
+
+        if (capture_us < boundary) {
+            // Rejoin the segment the other cameras are recording now
+            SegmentInfo segment = make_segment(state, boundary - duration);
+            if (!index_.add(segment)) {
+                index_failures_.fetch_add(1, std::memory_order_relaxed);
+                return std::nullopt;
+            }
+            segments_created_.fetch_add(1, std::memory_order_relaxed);
+            return segment;
+        }
+    }
+
+    if (!state.pending) {
+        if (capture_us < boundary) {
+            return std::nullopt;
+        }
+        // First camera past the boundary opens the next segment for everyone.
+        // After a stall of every camera, skip to the boundary just passed.
+        const int64_t start_us = align_up(capture_us) - duration;
+        if (!open_batch(start_us)) {
+            // Keep the boundary so the next keyframe past it tries again
+            return std::nullopt;
+        }
+        next_boundary_us_.store(start_us + duration, std::memory_order_release);
+        if (!state.pending) {
+            return std::nullopt;
+        }
+    }
+
+    if (capture_us < state.pending->start_time_us) {
+        return std::nullopt;
+    }
+    SegmentInfo segment = std::move(*state.pending);
+    state.pending.reset();
+    state.pending_start_us.store(NO_PENDING, std::memory_order_release);
+    return segment;
+}
+
+int64_t RolloverCoordinator::next_boundary_us() const {
+    return next_boundary_us_.load(std::memory_order_acquire);
+}
+
+RolloverStats RolloverCoordinator::stats() const {
+    RolloverStats stats;
+    stats.rollovers = rollovers_.load(std::memory_order_relaxed);
+    stats.segments_created = segments_created_.load(std::memory_order_relaxed);
+    stats.forced_keyframes = forced_keyframes_.load(std::memory_order_relaxed);
+    stats.late_segments = late_segments_.load(std::memory_order_relaxed);
+    stats.index_failures = index_failures_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+bool RolloverCoordinator::open_batch(int64_t start_us) {
+    // Cameras still holding an unclaimed segment keep it; they are behind
+    std::vector<SegmentInfo> batch;
+    batch.reserve(camera_count_);
+    for (uint32_t i = 0; i < camera_count_; ++i) {
+        if (!cameras_[i].pending) {
+            batch.push_back(make_segment(cameras_[i], start_us));
+        }
+    }
+    if (batch.empty()) {
+        return true;
+    }
+
+    if (!index_.add_batch(batch)) {
+        LOG_ERROR("Index rejected the segment batch starting at {}", start_us);
+        index_failures_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    size_t next = 0;
+    for (uint32_t i = 0; i < camera_count_; ++i) {
+        CameraState& state = cameras_[i];
+        if (!state.pending) {
+            assert(batch[next].camera_id == state.camera_id);
+            state.pending = std::move(batch[next++]);
+            state.pending_start_us.store(start_us, std::memory_order_release);
+        }
+    }
+    rollovers_.fetch_add(1, std::memory_order_relaxed);
+    segments_created_.fetch_add(next, std::memory_order_relaxed);
+    return true;
+}
+
+int64_t RolloverCoordinator::align_up(int64_t time_us) const {
+    // First boundary strictly after time_us
+    const int64_t duration = config_.segment_duration.count();
+    assert(time_us >= 0);
+    return (time_us / duration + 1) * duration;
+}
+
+SegmentInfo RolloverCoordinator::make_segment(const CameraState& camera, int64_t start_us) {
+    SegmentInfo segment;
+    segment.segment_id = next_segment_id_++;
+    segment.camera_id = camera.camera_id;
+    segment.path = layout_.path_for(camera.camera_id, segment.segment_id, start_us);
+    segment.start_time_us = start_us;
+    segment.end_time_us = start_us;
+    return segment;
+}
+
+} // namespace dashcam
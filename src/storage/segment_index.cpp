@@ -0,0 +1,159 @@
+#include "dashcam/storage/segment_index.h"
+
+#include <cassert>
+
+namespace dashcam {
+
+bool SegmentIndex::add(const SegmentInfo& segment) {
+    assert(segment.end_time_us >= segment.start_time_us); // Tiger Style: assert preconditions
+    assert(!segment.path.empty());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto [it, inserted] = segments_.emplace(segment.segment_id, segment);
+    if (!inserted) {
+        return false;
+    }
+    total_bytes_ += it->second.size_bytes;
+    return true;
+}
+
+bool SegmentIndex::add_batch(const std::vector<SegmentInfo>& segments) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < segments.size(); ++i) {
+        // Tiger Style: assert preconditions
+        assert(segments[i].end_time_us >= segments[i].start_time_us);
+        assert(!segments[i].path.empty());
+        if (segments_.count(segments[i].segment_id) > 0) {
+            return false;
+        }
+        for (size_t j = 0; j < i; ++j) {
+            if (segments[j].segment_id == segments[i].segment_id) {
+                return false;
+            }
+        }
+    }
+
+    for (const SegmentInfo& segment : segments) {
+        segments_.emplace(segment.segment_id, segment);
+        total_bytes_ += segment.size_bytes;
+    }
+    return true;
+}
+
+bool SegmentIndex::update(uint64_t segment_id, int64_t end_time_us, uint64_t size_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = segments_.find(segment_id);
+    if (it == segments_.end()) {
+        return false;
+    }
+    assert(end_time_us >= it->second.start_time_us);
+    assert(total_bytes_ >= it->second.size_bytes);
+
+    total_bytes_ = total_bytes_ - it->second.size_bytes + size_bytes;
+    it->second.end_time_us = end_time_us;
+    it->second.size_bytes = size_bytes;
+    return true;
+}
+
+bool SegmentIndex::remove(uint64_t segment_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = segments_.find(segment_id);
+    if (it == segments_.end() || it->second.pin_count > 0) {
+        return false;
+    }
+    assert(total_bytes_ >= it->second.size_bytes);
+    total_bytes_ -= it->second.size_bytes;
+    segments_.erase(it);
+    checkpoints_.erase(segment_id);
+    return true;
+}
+
+std::optional<SegmentInfo> SegmentIndex::find(uint64_t segment_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = segments_.find(segment_id);
+    if (it == segments_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::vector<SegmentInfo> SegmentIndex::overlapping(std::string_view camera_id,
+                                                   int64_t start_us,
+                                                   int64_t end_us) const {
+    std::vector<SegmentInfo> result;
+    if (start_us > end_us) {
+        return result;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [id, segment] : segments_) {
+        if (!camera_id.empty() && segment.camera_id != camera_id) {
+            continue;
+        }
+        if (segment.start_time_us <= end_us && segment.end_time_us >= start_us) {
+            result.push_back(segment);
+        }
+    }
+    return result;
+}
+
+bool SegmentIndex::pin(uint64_t segment_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = segments_.find(segment_id);
+    if (it == segments_.end()) {
+        return false;
+    }
+    assert(it->second.pin_count < UINT32_MAX);
+    it->second.pin_count++;
+    return true;
+}
+
+bool SegmentIndex::unpin(uint64_t segment_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = segments_.find(segment_id);
+    if (it == segments_.end() || it->second.pin_count == 0) {
+        return false;
+    }
+    it->second.pin_count--;
+    return true;
+}
+
+std::optional<SegmentInfo> SegmentIndex::oldest_unpinned(uint64_t exclude_segment_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [id, segment] : segments_) {
+        if (segment.pin_count == 0 && id != exclude_segment_id) {
+            return segment;
+        }
+    }
+    return std::nullopt;
+}
+
+bool SegmentIndex::add_checkpoint(const IntegrityCheckpoint& checkpoint) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (segments_.find(checkpoint.segment_id) == segments_.end()) {
+        return false;
+    }
+    checkpoints_[checkpoint.segment_id].push_back(checkpoint);
+    return true;
+}
+
+std::vector<IntegrityCheckpoint> SegmentIndex::checkpoints(uint64_t segment_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = checkpoints_.find(segment_id);
+    if (it == checkpoints_.end()) {
+        return {};
+    }
+    return it->second;
+}
+
+size_t SegmentIndex::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return segments_.size();
+}
+
+uint64_t SegmentIndex::total_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return total_bytes_;
+}
+
+} // namespace dashcam
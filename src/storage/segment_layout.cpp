@@ -0,0 +1,259 @@
+#include "dashcam/storage/segment_layout.h"
+#include "dashcam/storage/checkpoint_file.h"
+#include "dashcam/utils/logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace dashcam {
+
+namespace {
+
+// Bound on directory entries read from one shard; an hour of one camera at
+// one-second segments is 3600 files plus sidecars
+constexpr uint32_t MAX_ENTRIES_PER_SHARD = 1u << 20;
+
+constexpr uint32_t MAX_REBUILD_THREADS = 64;
+
+struct Shard {
+    std::string camera_id;
+    std::string directory;
+};
+
+struct ShardResult {
+    std::vector<SegmentInfo> segments;
+    uint64_t files_skipped = 0;
+};
+
+int64_t modification_time_us(const struct stat& info) {
+#if defined(__linux__)
+    return static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000 + info.st_mtim.tv_nsec / 1000;
+#else
+    return static_cast<int64_t>(info.st_mtime) * 1000000;
+#endif
+}
+
+std::vector<std::filesystem::path> subdirectories(const std::filesystem::path& parent) {
+    std::vector<std::filesystem::path> result;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(parent, ec)) {
+        if (entry.is_directory(ec)) {
+            result.push_back(entry.path());
+        }
+    }
+    return result;
+}
+
+std::vector<Shard> find_shards(const std::string& root) {
+    std::vector<Shard> shards;
+    for (const auto& camera : subdirectories(root)) {
+        for (const auto& day : subdirectories(camera)) {
+            for (const auto& hour : subdirectories(day)) {
+                shards.push_back(Shard{camera.filename().string(), hour.string()});
+            }
+        }
+    }
+    return shards;
+}
+
+ShardResult scan_shard(const Shard& shard) {
+    ShardResult result;
+    DIR* directory = ::opendir(shard.directory.c_str());
+    if (directory == nullptr) {
+        LOG_WARNING("Cannot scan shard '{}': {}", shard.directory, std::strerror(errno));
+        return result;
+    }
+    const int directory_fd = ::dirfd(directory);
+
+    for (uint32_t i = 0; i < MAX_ENTRIES_PER_SHARD; ++i) {
+        const struct dirent* entry = ::readdir(directory);
+        if (entry == nullptr) {
+            break;
+        }
+        const std::string_view name(entry->d_name);
+        if (name == "." || name == "..") {
+            continue;
+        }
+
+        const std::optional<SegmentFileName> parsed = SegmentLayout::parse_file_name(name);
+        struct stat info {};
+        if (!parsed || ::fstatat(directory_fd, entry->d_name, &info, 0) != 0 ||
+            !S_ISREG(info.st_mode)) {
+            result.files_skipped++;
+            continue;
+        }
+
+        SegmentInfo segment;
+        segment.segment_id = parsed->segment_id;
+        segment.camera_id = shard.camera_id;
+        segment.path = shard.directory + "/" + std::string(name);
+        segment.start_time_us = parsed->start_time_us;
+        segment.end_time_us = std::max(parsed->start_time_us, modification_time_us(info));
+        segment.size_bytes = static_cast<uint64_t>(info.st_size);
+        result.segments.push_back(std::move(segment));
+    }
+    ::closedir(directory);
+    return result;
+}
+
+uint64_t load_checkpoints(SegmentIndex& index, const SegmentInfo& segment) {
+    uint64_t loaded = 0;
+    for (const IntegrityCheckpoint& checkpoint : load_checkpoint_file(checkpoint_file_path(segment.path))) {
+        // A file renamed or copied from another segment proves nothing about this one
+        if (checkpoint.segment_id != segment.segment_id || !index.add_checkpoint(checkpoint)) {
+            LOG_WARNING("Ignoring checkpoint for segment {} found with segment {}",
+                        checkpoint.segment_id,
+                        segment.segment_id);
+            continue;
+        }
+        loaded++;
+    }
+    return loaded;
+}
+
+} // namespace
+
+SegmentLayout::SegmentLayout(std::string_view root) : root_(root) {
+    assert(!root_.empty()); // Tiger Style: assert preconditions
+}
+
+const std::string& SegmentLayout::root() const {
+    return root_;
+}
+
+std::string SegmentLayout::directory_for(std::string_view camera_id, int64_t start_time_us) const {
+    assert(!camera_id.empty());
+    assert(camera_id.find('/') == std::string_view::npos);
+
+    // Floor division so pre-epoch times land in the right hour
+    int64_t seconds = start_time_us / 1000000;
+    if (start_time_us % 1000000 < 0) {
+        seconds--;
+    }
+    const auto time = static_cast<std::time_t>(seconds);
+    std::tm utc {};
+    ::gmtime_r(&time, &utc);
+
+    char shard[32];
+    std::snprintf(shard,
+                  sizeof(shard),
+                  "%04d%02d%02d/%02d",
+                  utc.tm_year + 1900,
+                  utc.tm_mon + 1,
+                  utc.tm_mday,
+                  utc.tm_hour);
+    return root_ + "/" + std::string(camera_id) + "/" + shard;
+}
+
+std::string SegmentLayout::path_for(std::string_view camera_id,
+                                    uint64_t segment_id,
+                                    int64_t start_time_us) const {
+    return directory_for(camera_id, start_time_us) + "/" + std::to_string(segment_id) + "_" +
+           std::to_string(start_time_us) + std::string(SEGMENT_EXTENSION);
+}
+
+bool SegmentLayout::ensure_directory(const std::string& directory) const {
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec) {
+        LOG_ERROR("Failed to create shard directory '{}': {}", directory, ec.message());
+        return false;
+    }
+    return true;
+}
+
+std::optional<SegmentFileName> SegmentLayout::parse_file_name(std::string_view file_name) {
+    if (file_name.size() <= SEGMENT_EXTENSION.size() ||
+        file_name.substr(file_name.size() - SEGMENT_EXTENSION.size()) != SEGMENT_EXTENSION) {
+        return std::nullopt;
+    }
+    const std::string_view stem = file_name.substr(0, file_name.size() - SEGMENT_EXTENSION.size());
+    const size_t separator = stem.find('_');
+    if (separator == std::string_view::npos) {
+        return std::nullopt;
+    }
+
+    SegmentFileName parsed;
+    const char* id_end = stem.data() + separator;
+    const auto id = std::from_chars(stem.data(), id_end, parsed.segment_id);
+    if (id.ec != std::errc() || id.ptr != id_end) {
+        return std::nullopt;
+    }
+    const char* start_end = stem.data() + stem.size();
+    const auto start = std::from_chars(id_end + 1, start_end, parsed.start_time_us);
+    if (start.ec != std::errc() || start.ptr != start_end) {
+        return std::nullopt;
+    }
+    return parsed;
+}
+
+IndexRebuildStats SegmentLayout::rebuild_index(SegmentIndex& index, uint32_t threads) const {
+    assert(threads > 0);
+    const auto started = std::chrono::steady_clock::now();
+
+    const std::vector<Shard> shards = find_shards(root_);
+    const uint32_t workers = std::min<uint32_t>(
+        {threads, MAX_REBUILD_THREADS, static_cast<uint32_t>(std::max<size_t>(shards.size(), 1))});
+
+    std::atomic<size_t> next_shard{0};
+    std::atomic<uint64_t> indexed{0};
+    std::atomic<uint64_t> skipped{0};
+    std::atomic<uint64_t> duplicates{0};
+    std::atomic<uint64_t> checkpoints{0};
+
+    // Shards are claimed one at a time, so a busy hour does not stall a worker's share
+    const auto worker = [&] {
+        for (size_t i = next_shard.fetch_add(1); i < shards.size(); i = next_shard.fetch_add(1)) {
+            const ShardResult result = scan_shard(shards[i]);
+            skipped.fetch_add(result.files_skipped, std::memory_order_relaxed);
+            for (const SegmentInfo& segment : result.segments) {
+                if (index.add(segment)) {
+                    indexed.fetch_add(1, std::memory_order_relaxed);
+                    checkpoints.fetch_add(load_checkpoints(index, segment), std::memory_order_relaxed);
+                } else {
+                    duplicates.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(workers);
+    for (uint32_t i = 0; i < workers; ++i) {
+        pool.emplace_back(worker);
+    }
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+
+    IndexRebuildStats stats;
+    stats.shards_scanned = shards.size();
+    stats.segments_indexed = indexed.load();
+    stats.files_skipped = skipped.load();
+    stats.duplicate_ids = duplicates.load();
+    stats.checkpoints_loaded = checkpoints.load();
+    stats.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started);
+
+    LOG_INFO("Rebuilt segment index from {} shards: {} segments in {} ms using {} threads",
+             stats.shards_scanned,
+             stats.segments_indexed,
+             stats.elapsed.count(),
+             workers);
+    return stats;
+}
+
+} // namespace dashcam
@@ -0,0 +1,198 @@
+#include "dashcam/storage/segment_reader.h"
+#include "dashcam/utils/io_priority.h"
+#include "dashcam/utils/logger.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dashcam {
+
+/**
+ * @brief One mmap() window; unmapped when the last span referencing it dies
+ */
+struct SegmentReader::Window {
+    const uint8_t* base = nullptr;
+    size_t length = 0;
+    uint64_t file_offset = 0;
+
+    ~Window() {
+        if (base != nullptr) {
+            ::munmap(const_cast<uint8_t*>(base), length);
+        }
+    }
+};
+
+SegmentReader::SegmentReader(const SegmentReaderConfig& config)
+    : config_(config), page_size_(static_cast<size_t>(::sysconf(_SC_PAGESIZE))) {
+    assert(config_.chunk_bytes > 0); // Tiger Style: assert preconditions
+    assert(config_.window_bytes >= config_.chunk_bytes);
+    assert(page_size_ > 0);
+    assert(config_.window_bytes % page_size_ == 0);
+}
+
+SegmentReader::~SegmentReader() {
+    close();
+}
+
+bool SegmentReader::open(std::string_view path, uint64_t offset, uint64_t length) {
+    assert(!is_open());
+    assert(!path.empty());
+
+    path_ = std::string(path);
+    fd_.reset(::open(path_.c_str(), O_RDONLY | O_CLOEXEC));
+    if (!fd_.is_valid()) {
+        LOG_ERROR("Failed to open segment '{}' for reading: {}", path_, std::strerror(errno));
+        return false;
+    }
+
+    struct stat info {};
+    if (::fstat(fd_.get(), &info) != 0) {
+        LOG_ERROR("Failed to stat segment '{}': {}", path_, std::strerror(errno));
+        fd_.reset();
+        return false;
+    }
+    file_size_ = static_cast<uint64_t>(info.st_size);
+    if (offset > file_size_) {
+        LOG_WARNING("Read offset {} is past the end of '{}' ({} bytes)", offset, path_, file_size_);
+        fd_.reset();
+        return false;
+    }
+
+    position_ = offset;
+    end_ = offset + std::min(length, file_size_ - offset);
+
+    if (config_.idle_io_priority) {
+        set_thread_idle_io_priority();
+    }
+#if defined(__linux__)
+    // Doubles the kernel readahead window for this file
+    ::posix_fadvise(fd_.get(),
+                    static_cast<off_t>(position_),
+                    static_cast<off_t>(end_ - position_),
+                    POSIX_FADV_SEQUENTIAL);
+#endif
+    return true;
+}
+
+std::optional<ReadSpan> SegmentReader::next(size_t max_bytes) {
+    assert(max_bytes > 0); // Tiger Style: assert preconditions
+    if (!is_open() || position_ >= end_) {
+        return std::nullopt;
+    }
+
+    if (!window_ || position_ >= window_->file_offset + window_->length) {
+        if (!map_window(position_)) {
+            return std::nullopt;
+        }
+    }
+    assert(position_ >= window_->file_offset);
+
+    const uint64_t window_end = window_->file_offset + window_->length;
+    const auto size = static_cast<size_t>(std::min<uint64_t>(
+        {config_.chunk_bytes, max_bytes, window_end - position_, end_ - position_}));
+    assert(size > 0);
+
+    ReadSpan span;
+    span.data = window_->base + (position_ - window_->file_offset);
+    span.size_bytes = size;
+    span.offset = position_;
+    span.owner = window_;
+
+    position_ += size;
+    stats_.bytes_read += size;
+    return span;
+}
+
+void SegmentReader::close() {
+    if (!is_open()) {
+        return;
+    }
+    if (behind_) {
+        drop(behind_);
+    }
+    if (window_) {
+        drop(window_);
+    }
+    behind_.reset();
+    window_.reset();
+    fd_.reset();
+    path_.clear();
+    file_size_ = 0;
+    position_ = 0;
+    end_ = 0;
+}
+
+bool SegmentReader::is_open() const {
+    return fd_.is_valid();
+}
+
+uint64_t SegmentReader::position() const {
+    return position_;
+}
+
+uint64_t SegmentReader::end_offset() const {
+    return end_;
+}
+
+uint64_t SegmentReader::file_size_bytes() const {
+    return file_size_;
+}
+
+SegmentReaderStats SegmentReader::stats() const {
+    return stats_;
+}
+
+bool SegmentReader::map_window(uint64_t offset) {
+    // mmap() offsets must be page aligned; the window may start a little early
+    const uint64_t start = offset - offset % page_size_;
+    const auto length = static_cast<size_t>(std::min<uint64_t>(config_.window_bytes, end_ - start));
+    assert(length > 0);
+
+    void* mapping = ::mmap(
+        nullptr, length, PROT_READ, MAP_SHARED, fd_.get(), static_cast<off_t>(start));
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR("Failed to map {} bytes of '{}' at {}: {}",
+                  length,
+                  path_,
+                  start,
+                  std::strerror(errno));
+        return false;
+    }
+    ::madvise(mapping, length, MADV_SEQUENTIAL);
+
+    auto window = std::make_shared<Window>();
+    window->base = static_cast<const uint8_t*>(mapping);
+    window->length = length;
+    window->file_offset = start;
+    stats_.windows_mapped++;
+
+    // Keep one finished window around for spans still in flight; drop the one before
+    if (behind_) {
+        drop(behind_);
+    }
+    behind_ = std::move(window_);
+    window_ = std::move(window);
+    return true;
+}
+
+void SegmentReader::drop(const std::shared_ptr<Window>& window) {
+    assert(window);
+    // Unmap our page table entries first: fadvise cannot drop mapped pages
+    ::madvise(const_cast<uint8_t*>(window->base), window->length, MADV_DONTNEED);
+#if defined(__linux__)
+    ::posix_fadvise(fd_.get(),
+                    static_cast<off_t>(window->file_offset),
+                    static_cast<off_t>(window->length),
+                    POSIX_FADV_DONTNEED);
+#endif
+    stats_.bytes_dropped += window->length;
+}
+
+} // namespace dashcam
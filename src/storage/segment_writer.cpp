@@ -0,0 +1,311 @@
+#include "dashcam/storage/segment_writer.h"
+#include "dashcam/utils/logger.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace dashcam {
+
+namespace {
+
+// Upper bound on writev() retries for one batch. A healthy kernel completes a
+// batch in one call; partial writes happen on signals or nearly-full disks.
+constexpr uint32_t MAX_WRITE_ATTEMPTS_PER_BATCH = 64;
+
+int data_sync(int fd) {
+#if defined(__APPLE__)
+    return ::fsync(fd); // macOS has no fdatasync()
+#else
+    return ::fdatasync(fd);
+#endif
+}
+
+} // namespace
+
+WriteChunk make_write_chunk(std::shared_ptr<const std::vector<uint8_t>> buffer, bool keyframe) {
+    assert(buffer);
+    assert(!buffer->empty());
+
+    WriteChunk chunk;
+    chunk.data = buffer->data();
+    chunk.size_bytes = buffer->size();
+    chunk.keyframe = keyframe;
+    chunk.owner = std::move(buffer);
+    return chunk;
+}
+
+SegmentWriter::SegmentWriter(const SegmentWriterConfig& config,
+                             StorageAccounting* accounting,
+                             IoFaultInjector* faults)
+    : config_(config), accounting_(accounting), faults_(faults), created_at_(Clock::now()) {
+    assert(config_.max_batch_bytes > 0);
+    assert(config_.max_batch_latency.count() >= 0);
+    assert(config_.durability.mode != DurabilityMode::Periodic ||
+           config_.durability.sync_interval.count() > 0);
+}
+
+SegmentWriter::~SegmentWriter() {
+    if (is_open()) {
+        close(Clock::now());
+    }
+}
+
+bool SegmentWriter::open(std::string_view path) {
+    assert(!is_open()); // Tiger Style: assert preconditions
+    assert(!path.empty());
+
+    path_ = std::string(path);
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        LOG_ERROR("Failed to open segment '{}': {}", path_, std::strerror(errno));
+        return false;
+    }
+
+    written_bytes_ = 0;
+    unsynced_bytes_ = 0;
+    last_sync_at_ = Clock::now();
+    assert(pending_count_ == 0);
+    return true;
+}
+
+bool SegmentWriter::append(WriteChunk chunk, Clock::time_point now) {
+    assert(is_open());
+    assert(chunk.data != nullptr);
+    assert(chunk.size_bytes > 0);
+
+    bool ok = true;
+
+    // Make the previous GOP durable before the next one starts, so a power
+    // cut loses at most the GOP currently being recorded.
+    if (chunk.keyframe && config_.durability.mode == DurabilityMode::OnKeyframe) {
+        ok = flush() && ok;
+        ok = sync(now) && ok;
+    }
+
+    if (pending_count_ == MAX_BATCH_CHUNKS) {
+        ok = flush() && ok;
+    }
+
+    if (pending_count_ == 0) {
+        batch_started_at_ = now;
+    }
+    pending_bytes_ += chunk.size_bytes;
+    pending_[pending_count_] = std::move(chunk);
+    pending_count_++;
+    assert(pending_count_ <= MAX_BATCH_CHUNKS);
+
+    if (pending_bytes_ >= config_.max_batch_bytes) {
+        ok = flush() && ok;
+    }
+
+    return poll(now) && ok;
+}
+
+bool SegmentWriter::poll(Clock::time_point now) {
+    if (!is_open()) {
+        return true;
+    }
+
+    bool ok = true;
+    if (pending_count_ > 0 && now - batch_started_at_ >= config_.max_batch_latency) {
+        ok = flush() && ok;
+    }
+
+    if (config_.durability.mode == DurabilityMode::Periodic && unsynced_bytes_ > 0 &&
+        now - last_sync_at_ >= config_.durability.sync_interval) {
+        ok = sync(now) && ok;
+    }
+    return ok;
+}
+
+bool SegmentWriter::flush() {
+    if (pending_count_ == 0) {
+        return true;
+    }
+    assert(is_open());
+
+    const uint64_t written_before = written_bytes_;
+    const bool ok = write_batch();
+    if (ok) {
+        batches_flushed_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        batches_failed_.fetch_add(1, std::memory_order_relaxed);
+        // A partial write left its prefix in the file; only the rest is lost
+        const uint64_t written = written_bytes_ - written_before;
+        assert(written < pending_bytes_);
+        bytes_dropped_.fetch_add(pending_bytes_ - written, std::memory_order_relaxed);
+    }
+    release_batch();
+    return ok;
+}
+
+bool SegmentWriter::sync(Clock::time_point now) {
+    assert(is_open());
+    if (unsynced_bytes_ == 0) {
+        last_sync_at_ = now;
+        return true;
+    }
+
+    const auto started = Clock::now();
+    const int injected = faults_ != nullptr ? faults_->before_sync() : 0;
+    int result = -1;
+    if (injected == 0) {
+        result = data_sync(fd_);
+    } else {
+        errno = injected;
+    }
+    sync_latency_.record(Clock::now() - started);
+    sync_syscalls_.fetch_add(1, std::memory_order_relaxed);
+
+    if (result != 0) {
+        LOG_ERROR("fdatasync failed for segment '{}': {}", path_, std::strerror(errno));
+        return false;
+    }
+
+    unsynced_bytes_ = 0;
+    last_sync_at_ = now;
+    return true;
+}
+
+bool SegmentWriter::close(Clock::time_point now) {
+    if (!is_open()) {
+        return true;
+    }
+
+    bool ok = flush();
+    if (config_.durability.mode != DurabilityMode::None) {
+        ok = sync(now) && ok;
+    }
+
+    if (::close(fd_) != 0) {
+        LOG_ERROR("Failed to close segment '{}': {}", path_, std::strerror(errno));
+        ok = false;
+    }
+    fd_ = -1;
+    return ok;
+}
+
+bool SegmentWriter::is_open() const {
+    return fd_ >= 0;
+}
+
+uint64_t SegmentWriter::segment_size_bytes() const {
+    return written_bytes_ + pending_bytes_;
+}
+
+size_t SegmentWriter::pending_bytes() const {
+    return pending_bytes_;
+}
+
+uint32_t SegmentWriter::pending_chunks() const {
+    return pending_count_;
+}
+
+SegmentWriterStats SegmentWriter::stats(Clock::time_point now) const {
+    SegmentWriterStats stats;
+    stats.bytes_written = bytes_written_.load(std::memory_order_relaxed);
+    stats.write_syscalls = write_syscalls_.load(std::memory_order_relaxed);
+    stats.sync_syscalls = sync_syscalls_.load(std::memory_order_relaxed);
+    stats.batches_flushed = batches_flushed_.load(std::memory_order_relaxed);
+    stats.batches_failed = batches_failed_.load(std::memory_order_relaxed);
+    stats.bytes_dropped = bytes_dropped_.load(std::memory_order_relaxed);
+
+    if (stats.write_syscalls > 0) {
+        stats.bytes_per_syscall =
+            static_cast<double>(stats.bytes_written) / static_cast<double>(stats.write_syscalls);
+    }
+
+    const double elapsed_seconds = std::chrono::duration<double>(now - created_at_).count();
+    if (elapsed_seconds > 0.0) {
+        stats.syscalls_per_second =
+            static_cast<double>(stats.write_syscalls + stats.sync_syscalls) / elapsed_seconds;
+    }
+    return stats;
+}
+
+const LatencyHistogram& SegmentWriter::write_latency() const {
+    return write_latency_;
+}
+
+const LatencyHistogram& SegmentWriter::sync_latency() const {
+    return sync_latency_;
+}
+
+bool SegmentWriter::write_batch() {
+    assert(pending_count_ > 0);
+    assert(pending_count_ <= MAX_BATCH_CHUNKS);
+
+    for (uint32_t i = 0; i < pending_count_; ++i) {
+        iovecs_[i].iov_base = const_cast<uint8_t*>(pending_[i].data);
+        iovecs_[i].iov_len = pending_[i].size_bytes;
+    }
+
+    iovec* next = iovecs_.data();
+    uint32_t remaining_iovecs = pending_count_;
+    size_t remaining_bytes = pending_bytes_;
+
+    for (uint32_t attempt = 0; attempt < MAX_WRITE_ATTEMPTS_PER_BATCH; ++attempt) {
+        const auto started = Clock::now();
+        const int injected = faults_ != nullptr ? faults_->before_write(remaining_bytes) : 0;
+        ssize_t written = -1;
+        if (injected == 0) {
+            written = ::writev(fd_, next, static_cast<int>(remaining_iovecs));
+        } else {
+            errno = injected;
+        }
+        write_latency_.record(Clock::now() - started);
+        write_syscalls_.fetch_add(1, std::memory_order_relaxed);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("writev failed for segment '{}': {}", path_, std::strerror(errno));
+            return false;
+        }
+
+        const auto advanced = static_cast<size_t>(written);
+        assert(advanced <= remaining_bytes);
+        bytes_written_.fetch_add(advanced, std::memory_order_relaxed);
+        if (accounting_ != nullptr) {
+            accounting_->on_write(advanced);
+        }
+        written_bytes_ += advanced;
+        unsynced_bytes_ += advanced;
+        remaining_bytes -= advanced;
+        if (remaining_bytes == 0) {
+            return true;
+        }
+
+        // Partial write: skip fully written iovecs and trim the first partial one
+        size_t skip = advanced;
+        while (skip >= next->iov_len) {
+            skip -= next->iov_len;
+            ++next;
+            --remaining_iovecs;
+            assert(remaining_iovecs > 0);
+        }
+        next->iov_base = static_cast<uint8_t*>(next->iov_base) + skip;
+        next->iov_len -= skip;
+    }
+
+    LOG_ERROR("Gave up writing segment '{}' after {} partial writes",
+              path_,
+              MAX_WRITE_ATTEMPTS_PER_BATCH);
+    return false;
+}
+
+void SegmentWriter::release_batch() {
+    // Drop buffer references promptly so the encoder can reuse them
+    for (uint32_t i = 0; i < pending_count_; ++i) {
+        pending_[i] = WriteChunk{};
+    }
+    pending_count_ = 0;
+    pending_bytes_ = 0;
+}
+
+} // namespace dashcam
@@ -0,0 +1,319 @@
+#include "dashcam/storage/sidecar_index.h"
+#include "dashcam/utils/byte_order.h"
+#include "dashcam/utils/crc32.h"
+#include "dashcam/utils/logger.h"
+#include "dashcam/utils/scoped_fd.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace dashcam {
+
+namespace {
+
+constexpr uint64_t SIDECAR_MAGIC = 0x3130584449534344ull; // "DCSIDX01" little-endian
+constexpr uint32_t SIDECAR_VERSION = 1;
+constexpr size_t HEADER_BYTES = 64;
+constexpr size_t HEADER_CRC_OFFSET = 60;
+constexpr size_t KEYFRAME_ENTRY_BYTES = 32;
+constexpr size_t THUMBNAIL_ENTRY_BYTES = 32;
+
+// A sidecar write is a single buffer; bound the retries on short writes
+constexpr uint32_t MAX_WRITE_ATTEMPTS = 64;
+
+} // namespace
+
+SidecarIndexBuilder::SidecarIndexBuilder(const SidecarIndexConfig& config) : config_(config) {
+    assert(config_.max_keyframes > 0); // Tiger Style: assert preconditions
+    assert(config_.max_thumbnails > 0);
+    assert(config_.max_thumbnail_bytes > 0);
+    assert(config_.thumbnail_interval.count() > 0);
+
+    keyframes_.reserve(config_.max_keyframes);
+    thumbnails_.reserve(config_.max_thumbnails);
+}
+
+void SidecarIndexBuilder::reset(uint64_t segment_id, int64_t segment_start_us) {
+    segment_id_ = segment_id;
+    segment_start_us_ = segment_start_us;
+    keyframes_.clear();
+    thumbnails_.clear();
+    thumbnail_data_.clear();
+    last_thumbnail_us_.reset();
+}
+
+bool SidecarIndexBuilder::add_keyframe(const KeyframeEntry& entry) {
+    if (keyframes_.size() >= config_.max_keyframes) {
+        return false;
+    }
+    if (!keyframes_.empty() && entry.media_time_us < keyframes_.back().media_time_us) {
+        return false;
+    }
+    keyframes_.push_back(entry);
+    return true;
+}
+
+bool SidecarIndexBuilder::wants_thumbnail(int64_t media_time_us) const {
+    if (thumbnails_.size() >= config_.max_thumbnails) {
+        return false;
+    }
+    return !last_thumbnail_us_ ||
+           media_time_us - *last_thumbnail_us_ >= config_.thumbnail_interval.count();
+}
+
+bool SidecarIndexBuilder::add_thumbnail(int64_t media_time_us,
+                                        uint16_t width,
+                                        uint16_t height,
+                                        const uint8_t* jpeg,
+                                        uint32_t size_bytes) {
+    assert(jpeg != nullptr);
+    assert(size_bytes > 0);
+
+    if (size_bytes > config_.max_thumbnail_bytes ||
+        thumbnails_.size() >= config_.max_thumbnails) {
+        return false;
+    }
+    if (last_thumbnail_us_ && media_time_us < *last_thumbnail_us_) {
+        return false;
+    }
+
+    ThumbnailEntry entry;
+    entry.media_time_us = media_time_us;
+    entry.data_offset = thumbnail_data_.size();
+    entry.size_bytes = size_bytes;
+    entry.width = width;
+    entry.height = height;
+    entry.crc = crc32(jpeg, size_bytes);
+    thumbnails_.push_back(entry);
+    thumbnail_data_.insert(thumbnail_data_.end(), jpeg, jpeg + size_bytes);
+    last_thumbnail_us_ = media_time_us;
+    return true;
+}
+
+bool SidecarIndexBuilder::write(std::string_view path) const {
+    assert(!path.empty());
+
+    const size_t tables_bytes =
+        keyframes_.size() * KEYFRAME_ENTRY_BYTES + thumbnails_.size() * THUMBNAIL_ENTRY_BYTES;
+    std::vector<uint8_t> file(HEADER_BYTES + tables_bytes, 0);
+
+    uint8_t* at = file.data() + HEADER_BYTES;
+    for (const KeyframeEntry& entry : keyframes_) {
+        store_le64(at, static_cast<uint64_t>(entry.media_time_us));
+        store_le64(at + 8, entry.fragment_offset);
+        store_le64(at + 16, entry.sample_offset);
+        store_le32(at + 24, entry.size_bytes);
+        at += KEYFRAME_ENTRY_BYTES;
+    }
+    for (const ThumbnailEntry& entry : thumbnails_) {
+        store_le64(at, static_cast<uint64_t>(entry.media_time_us));
+        store_le64(at + 8, entry.data_offset);
+        store_le32(at + 16, entry.size_bytes);
+        store_le16(at + 20, entry.width);
+        store_le16(at + 22, entry.height);
+        store_le32(at + 24, entry.crc);
+        at += THUMBNAIL_ENTRY_BYTES;
+    }
+    assert(at == file.data() + file.size());
+
+    uint8_t* header = file.data();
+    store_le64(header, SIDECAR_MAGIC);
+    store_le32(header + 8, SIDECAR_VERSION);
+    store_le32(header + 12, static_cast<uint32_t>(keyframes_.size()));
+    store_le32(header + 16, static_cast<uint32_t>(thumbnails_.size()));
+    store_le64(header + 24, segment_id_);
+    store_le64(header + 32, static_cast<uint64_t>(segment_start_us_));
+    store_le64(header + 40, thumbnail_data_.size());
+    store_le32(header + 48, crc32(header + HEADER_BYTES, tables_bytes));
+    store_le32(header + HEADER_CRC_OFFSET, crc32(header, HEADER_CRC_OFFSET));
+
+    file.insert(file.end(), thumbnail_data_.begin(), thumbnail_data_.end());
+
+    const std::string final_path(path);
+    const std::string temp_path = final_path + ".tmp";
+    ScopedFd fd(::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+    if (!fd.is_valid()) {
+        LOG_ERROR("Failed to create sidecar '{}': {}", temp_path, std::strerror(errno));
+        return false;
+    }
+
+    size_t written = 0;
+    for (uint32_t attempt = 0; attempt < MAX_WRITE_ATTEMPTS && written < file.size(); ++attempt) {
+        const ssize_t result = ::write(fd.get(), file.data() + written, file.size() - written);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            break;
+        }
+        written += static_cast<size_t>(result);
+    }
+    fd.reset();
+
+    if (written != file.size()) {
+        LOG_ERROR("Failed to write sidecar '{}': {}", temp_path, std::strerror(errno));
+        ::unlink(temp_path.c_str());
+        return false;
+    }
+    if (std::rename(temp_path.c_str(), final_path.c_str()) != 0) {
+        LOG_ERROR("Failed to publish sidecar '{}': {}", final_path, std::strerror(errno));
+        ::unlink(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+uint32_t SidecarIndexBuilder::keyframe_count() const {
+    return static_cast<uint32_t>(keyframes_.size());
+}
+
+uint32_t SidecarIndexBuilder::thumbnail_count() const {
+    return static_cast<uint32_t>(thumbnails_.size());
+}
+
+bool SidecarIndexReader::open(std::string_view path) {
+    file_.close();
+    if (!file_.open(path)) {
+        return false;
+    }
+
+    const uint8_t* data = file_.data();
+    const uint64_t size = file_.size();
+    if (size < HEADER_BYTES || load_le64(data) != SIDECAR_MAGIC ||
+        load_le32(data + HEADER_CRC_OFFSET) != crc32(data, HEADER_CRC_OFFSET)) {
+        LOG_WARNING("Sidecar '{}' has no valid header", path);
+        file_.close();
+        return false;
+    }
+    if (load_le32(data + 8) != SIDECAR_VERSION) {
+        LOG_WARNING("Sidecar '{}' has unsupported version {}", path, load_le32(data + 8));
+        file_.close();
+        return false;
+    }
+
+    const uint32_t keyframes = load_le32(data + 12);
+    const uint32_t thumbnails = load_le32(data + 16);
+    const uint64_t tables_bytes = uint64_t{keyframes} * KEYFRAME_ENTRY_BYTES +
+                                  uint64_t{thumbnails} * THUMBNAIL_ENTRY_BYTES;
+    const uint64_t data_bytes = load_le64(data + 40);
+    if (HEADER_BYTES + tables_bytes + data_bytes != size ||
+        load_le32(data + 48) != crc32(data + HEADER_BYTES, tables_bytes)) {
+        LOG_WARNING("Sidecar '{}' is truncated or its tables are corrupt", path);
+        file_.close();
+        return false;
+    }
+
+    segment_id_ = load_le64(data + 24);
+    segment_start_us_ = static_cast<int64_t>(load_le64(data + 32));
+    keyframe_count_ = keyframes;
+    thumbnail_count_ = thumbnails;
+    keyframe_table_ = data + HEADER_BYTES;
+    thumbnail_table_ = keyframe_table_ + uint64_t{keyframes} * KEYFRAME_ENTRY_BYTES;
+    thumbnail_data_ = thumbnail_table_ + uint64_t{thumbnails} * THUMBNAIL_ENTRY_BYTES;
+    thumbnail_data_size_ = data_bytes;
+    return true;
+}
+
+uint64_t SidecarIndexReader::segment_id() const {
+    return segment_id_;
+}
+
+int64_t SidecarIndexReader::segment_start_us() const {
+    return segment_start_us_;
+}
+
+uint32_t SidecarIndexReader::keyframe_count() const {
+    return keyframe_count_;
+}
+
+uint32_t SidecarIndexReader::thumbnail_count() const {
+    return thumbnail_count_;
+}
+
+KeyframeEntry SidecarIndexReader::keyframe(uint32_t index) const {
+    assert(index < keyframe_count_);
+    const uint8_t* at = keyframe_table_ + size_t{index} * KEYFRAME_ENTRY_BYTES;
+
+    KeyframeEntry entry;
+    entry.media_time_us = static_cast<int64_t>(load_le64(at));
+    entry.fragment_offset = load_le64(at + 8);
+    entry.sample_offset = load_le64(at + 16);
+    entry.size_bytes = load_le32(at + 24);
+    return entry;
+}
+
+std::optional<KeyframeEntry> SidecarIndexReader::keyframe_at_or_before(
+    int64_t media_time_us) const {
+    // Find the first keyframe after the time; the answer is the one before it
+    uint32_t low = 0;
+    uint32_t high = keyframe_count_;
+    while (low < high) {
+        const uint32_t middle = low + (high - low) / 2;
+        if (keyframe(middle).media_time_us <= media_time_us) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == 0) {
+        return std::nullopt;
+    }
+    return keyframe(low - 1);
+}
+
+std::optional<ThumbnailView> SidecarIndexReader::thumbnail(uint32_t index) const {
+    assert(index < thumbnail_count_);
+    const uint8_t* at = thumbnail_table_ + size_t{index} * THUMBNAIL_ENTRY_BYTES;
+
+    ThumbnailView view;
+    view.media_time_us = static_cast<int64_t>(load_le64(at));
+    const uint64_t offset = load_le64(at + 8);
+    view.size_bytes = load_le32(at + 16);
+    view.width = load_le16(at + 20);
+    view.height = load_le16(at + 22);
+    if (offset > thumbnail_data_size_ || view.size_bytes > thumbnail_data_size_ - offset) {
+        return std::nullopt;
+    }
+    view.jpeg = thumbnail_data_ + offset;
+    if (crc32(view.jpeg, view.size_bytes) != load_le32(at + 24)) {
+        return std::nullopt;
+    }
+    return view;
+}
+
+std::optional<ThumbnailView> SidecarIndexReader::nearest_thumbnail(int64_t media_time_us) const {
+    if (thumbnail_count_ == 0) {
+        return std::nullopt;
+    }
+
+    const auto time_of = [this](uint32_t index) {
+        return static_cast<int64_t>(
+            load_le64(thumbnail_table_ + size_t{index} * THUMBNAIL_ENTRY_BYTES));
+    };
+
+    uint32_t low = 0;
+    uint32_t high = thumbnail_count_;
+    while (low < high) {
+        const uint32_t middle = low + (high - low) / 2;
+        if (time_of(middle) < media_time_us) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    // low is the first thumbnail at or after the time; its predecessor may be closer
+    uint32_t best = low < thumbnail_count_ ? low : thumbnail_count_ - 1;
+    if (low > 0 && (low == thumbnail_count_ ||
+                    media_time_us - time_of(low - 1) < time_of(low) - media_time_us)) {
+        best = low - 1;
+    }
+    return thumbnail(best);
+}
+
+} // namespace dashcam
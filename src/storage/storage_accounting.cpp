@@ -0,0 +1,116 @@
+#include "dashcam/storage/storage_accounting.h"
+#include "dashcam/utils/logger.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/statvfs.h>
+
+namespace dashcam {
+
+StorageAccounting::StorageAccounting(std::string_view volume_path) : volume_path_(volume_path) {
+    assert(!volume_path_.empty()); // Tiger Style: assert preconditions
+}
+
+StorageAccounting::~StorageAccounting() {
+    stop();
+}
+
+bool StorageAccounting::start(std::chrono::milliseconds interval) {
+    assert(!reconcile_thread_.joinable());
+    assert(interval.count() > 0);
+
+    if (!reconcile()) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_requested_ = false;
+    }
+    reconcile_thread_ = std::thread([this, interval] { reconcile_loop(interval); });
+    return true;
+}
+
+void StorageAccounting::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_requested_ = true;
+    }
+    wake_.notify_all();
+    if (reconcile_thread_.joinable()) {
+        reconcile_thread_.join();
+    }
+}
+
+bool StorageAccounting::reconcile() {
+    struct statvfs info {};
+    if (::statvfs(volume_path_.c_str(), &info) != 0) {
+        LOG_ERROR("statvfs failed for '{}': {}", volume_path_, std::strerror(errno));
+        return false;
+    }
+
+    const uint64_t block_size = info.f_frsize != 0 ? info.f_frsize : info.f_bsize;
+    assert(info.f_bfree <= info.f_blocks);
+    const uint64_t used = (static_cast<uint64_t>(info.f_blocks) - info.f_bfree) * block_size;
+    const uint64_t available = static_cast<uint64_t>(info.f_bavail) * block_size;
+
+    const uint64_t previous_used = used_bytes_.exchange(used, std::memory_order_relaxed);
+    available_bytes_.store(available, std::memory_order_relaxed);
+    reconcile_count_.fetch_add(1, std::memory_order_relaxed);
+
+    LOG_DEBUG("Storage reconciled for '{}': used {} bytes (drift {}), available {} bytes",
+              volume_path_,
+              used,
+              static_cast<int64_t>(used - previous_used),
+              available);
+    return true;
+}
+
+void StorageAccounting::on_write(uint64_t bytes) {
+    used_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+
+    // Saturate at zero: between reconciles we may overestimate what we wrote
+    uint64_t available = available_bytes_.load(std::memory_order_relaxed);
+    uint64_t next = available > bytes ? available - bytes : 0;
+    while (!available_bytes_.compare_exchange_weak(available, next, std::memory_order_relaxed)) {
+        next = available > bytes ? available - bytes : 0;
+    }
+}
+
+void StorageAccounting::on_evict(uint64_t bytes) {
+    available_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+
+    uint64_t used = used_bytes_.load(std::memory_order_relaxed);
+    uint64_t next = used > bytes ? used - bytes : 0;
+    while (!used_bytes_.compare_exchange_weak(used, next, std::memory_order_relaxed)) {
+        next = used > bytes ? used - bytes : 0;
+    }
+}
+
+StorageUsage StorageAccounting::usage() const {
+    StorageUsage usage;
+    usage.used_bytes = used_bytes_.load(std::memory_order_relaxed);
+    usage.available_bytes = available_bytes_.load(std::memory_order_relaxed);
+    return usage;
+}
+
+uint64_t StorageAccounting::reconcile_count() const {
+    return reconcile_count_.load(std::memory_order_relaxed);
+}
+
+void StorageAccounting::reconcile_loop(std::chrono::milliseconds interval) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Tiger Style: this loop is intentionally unbounded; it ends on stop()
+    while (!stop_requested_) {
+        if (wake_.wait_for(lock, interval, [this] { return stop_requested_; })) {
+            break;
+        }
+        lock.unlock();
+        reconcile();
+        lock.lock();
+    }
+}
+
+} // namespace dashcam
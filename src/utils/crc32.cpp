@@ -0,0 +1,39 @@
+#include "dashcam/utils/crc32.h"
+
+#include <array>
+#include <cassert>
+
+namespace dashcam {
+
+namespace {
+
+constexpr uint32_t CRC32_POLYNOMIAL = 0xEDB88320u;
+
+constexpr std::array<uint32_t, 256> make_crc32_table() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t value = i;
+        for (uint32_t bit = 0; bit < 8; ++bit) {
+            value = (value & 1u) ? (value >> 1) ^ CRC32_POLYNOMIAL : value >> 1;
+        }
+        table[i] = value;
+    }
+    return table;
+}
+
+constexpr std::array<uint32_t, 256> CRC32_TABLE = make_crc32_table();
+
+} // namespace
+
+uint32_t crc32(const void* data, size_t size, uint32_t crc) {
+    assert(data != nullptr || size == 0);
+
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    uint32_t value = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        value = CRC32_TABLE[(value ^ bytes[i]) & 0xFFu] ^ (value >> 8);
+    }
+    return ~value;
+}
+
+} // namespace dashcam
@@ -0,0 +1,40 @@
+#include "dashcam/utils/io_priority.h"
+#include "dashcam/utils/logger.h"
+
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace dashcam {
+
+namespace {
+
+// From linux/ioprio.h, which glibc does not wrap
+constexpr int IOPRIO_WHO_PROCESS = 1;
+constexpr int IOPRIO_CLASS_IDLE = 3;
+constexpr int IOPRIO_CLASS_SHIFT = 13;
+
+} // namespace
+
+bool set_thread_idle_io_priority() {
+#if defined(__linux__) && defined(SYS_ioprio_set)
+    // With IOPRIO_WHO_PROCESS, who == 0 means the calling thread
+    const int priority = IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT;
+    if (::syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, priority) != 0) {
+        LOG_WARNING("ioprio_set(IDLE) failed: {}", std::strerror(errno));
+        return false;
+    }
+    return true;
+#else
+    (void)IOPRIO_WHO_PROCESS;
+    (void)IOPRIO_CLASS_IDLE;
+    (void)IOPRIO_CLASS_SHIFT;
+    return false;
+#endif
+}
+
+} // namespace dashcam
@@ -0,0 +1,107 @@
+#include "dashcam/utils/latency_histogram.h"
+
+#include <cassert>
+#include <cmath>
+
+namespace dashcam {
+
+void LatencyHistogram::record(std::chrono::nanoseconds latency) {
+    const int64_t raw = latency.count();
+    const uint64_t nanoseconds = raw > 0 ? static_cast<uint64_t>(raw) : 0;
+
+    const uint32_t bucket = bucket_for(nanoseconds);
+    assert(bucket < BUCKET_COUNT);
+
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+    uint64_t observed_max = max_ns_.load(std::memory_order_relaxed);
+    while (nanoseconds > observed_max &&
+           !max_ns_.compare_exchange_weak(observed_max, nanoseconds, std::memory_order_relaxed)) {
+        // observed_max is refreshed by the failed exchange
+    }
+}
+
+uint64_t LatencyHistogram::count() const {
+    return count_.load(std::memory_order_relaxed);
+}
+
+std::chrono::nanoseconds LatencyHistogram::max() const {
+    return std::chrono::nanoseconds(static_cast<int64_t>(max_ns_.load(std::memory_order_relaxed)));
+}
+
+std::chrono::nanoseconds LatencyHistogram::mean() const {
+    const uint64_t samples = count();
+    if (samples == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    const uint64_t sum = sum_ns_.load(std::memory_order_relaxed);
+    return std::chrono::nanoseconds(static_cast<int64_t>(sum / samples));
+}
+
+std::chrono::nanoseconds LatencyHistogram::percentile(double percentile) const {
+    // Sum the buckets rather than trusting count_: with concurrent writers
+    // the two can briefly disagree and we must never walk off the end.
+    const std::chrono::nanoseconds bound = percentile_of(bucket_counts(), percentile);
+
+    // Report the bucket's upper bound, but never more than the real max
+    const std::chrono::nanoseconds observed_max = max();
+    return bound < observed_max ? bound : observed_max;
+}
+
+LatencyHistogram::BucketCounts LatencyHistogram::bucket_counts() const {
+    BucketCounts snapshot{};
+    for (uint32_t i = 0; i < BUCKET_COUNT; ++i) {
+        snapshot[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+std::chrono::nanoseconds LatencyHistogram::percentile_of(const BucketCounts& counts,
+                                                         double percentile) {
+    assert(percentile >= 0.0);
+    assert(percentile <= 100.0);
+
+    uint64_t total = 0;
+    for (const uint64_t samples : counts) {
+        total += samples;
+    }
+    if (total == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+
+    const auto rank = static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(total)));
+    const uint64_t target = rank == 0 ? 1 : rank;
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += counts[i];
+        if (seen >= target) {
+            return std::chrono::nanoseconds(static_cast<int64_t>((uint64_t{1} << (i + 1)) - 1));
+        }
+    }
+    assert(false && "Percentile rank beyond total");
+    return std::chrono::nanoseconds(0);
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_ns_.store(0, std::memory_order_relaxed);
+    max_ns_.store(0, std::memory_order_relaxed);
+}
+
+uint32_t LatencyHistogram::bucket_for(uint64_t nanoseconds) {
+    uint32_t bucket = 0;
+    // Bounded by the width of the value: at most 63 iterations
+    while (nanoseconds > 1 && bucket + 1 < BUCKET_COUNT) {
+        nanoseconds >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+} // namespace dashcam
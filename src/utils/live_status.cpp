@@ -0,0 +1,63 @@
+#include "dashcam/utils/live_status.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace dashcam {
+
+LiveStatus::LiveStatus(const LiveStatusConfig& config)
+    : writers_(config.writers),
+      started_(std::chrono::steady_clock::now()),
+      slots_(std::make_unique<Slot[]>(config.writers)) {
+    // Tiger Style: assert preconditions
+    assert(config.writers > 0);
+}
+
+void LiveStatus::publish(uint32_t writer, const CaptureStatus& status) {
+    assert(writer < writers_); // Tiger Style: assert preconditions
+    slots_[writer].status.store(status);
+}
+
+LiveStatusSnapshot LiveStatus::snapshot() const {
+    LiveStatusSnapshot snapshot;
+    uint32_t retries = 0;
+    for (uint32_t i = 0; i < writers_; ++i) {
+        uint32_t slot_retries = 0;
+        const CaptureStatus status = slots_[i].status.load(&slot_retries);
+        retries += slot_retries;
+
+        snapshot.frames_captured += status.frames_captured;
+        snapshot.audio_enabled = snapshot.audio_enabled || status.audio;
+        if (status.recording) {
+            snapshot.current_fps = snapshot.recording_writers == 0
+                                       ? status.current_fps
+                                       : std::min(snapshot.current_fps, status.current_fps);
+            ++snapshot.recording_writers;
+        }
+    }
+    snapshot.recording = snapshot.recording_writers > 0;
+    snapshot.uptime_seconds =
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - started_)
+            .count();
+
+    // Readers only touch the shared counter when they actually collided
+    if (retries > 0) {
+        read_retries_.fetch_add(retries, std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+LiveStatusStats LiveStatus::stats() const {
+    LiveStatusStats stats;
+    for (uint32_t i = 0; i < writers_; ++i) {
+        stats.publishes += slots_[i].status.version();
+    }
+    stats.read_retries = read_retries_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+uint32_t LiveStatus::writers() const {
+    return writers_;
+}
+
+} // namespace dashcam
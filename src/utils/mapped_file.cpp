@@ -0,0 +1,80 @@
+#include "dashcam/utils/mapped_file.h"
+#include "dashcam/utils/logger.h"
+#include "dashcam/utils/scoped_fd.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace dashcam {
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(other.data_), size_(other.size_), open_(other.open_) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.open_ = false;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        data_ = other.data_;
+        size_ = other.size_;
+        open_ = other.open_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.open_ = false;
+    }
+    return *this;
+}
+
+bool MappedFile::open(std::string_view path) {
+    assert(!open_); // Tiger Style: assert preconditions
+    assert(!path.empty());
+
+    const std::string path_string(path);
+    ScopedFd fd(::open(path_string.c_str(), O_RDONLY | O_CLOEXEC));
+    if (!fd.is_valid()) {
+        LOG_ERROR("Failed to open '{}': {}", path_string, std::strerror(errno));
+        return false;
+    }
+
+    struct stat info {};
+    if (::fstat(fd.get(), &info) != 0) {
+        LOG_ERROR("Failed to stat '{}': {}", path_string, std::strerror(errno));
+        return false;
+    }
+
+    size_ = static_cast<size_t>(info.st_size);
+    open_ = true;
+    if (size_ == 0) {
+        return true; // mmap() rejects zero-length mappings
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    void* mapping = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd.get(), 0);
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR("Failed to mmap '{}': {}", path_string, std::strerror(errno));
+        size_ = 0;
+        open_ = false;
+        return false;
+    }
+    data_ = static_cast<const uint8_t*>(mapping);
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_ != nullptr) {
+        ::munmap(const_cast<uint8_t*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    open_ = false;
+}
+
+} // namespace dashcam
@@ -0,0 +1,86 @@
+#include "dashcam/utils/symbol_table.h"
+#include "dashcam/utils/logger.h"
+
+namespace dashcam {
+
+SymbolTable::SymbolTable(uint32_t max_symbols) : max_symbols_(max_symbols) {
+    // Tiger Style: assert preconditions
+    assert(max_symbols_ > 1);
+    assert(max_symbols_ <= MAX_SYMBOLS);
+    chunks_[0].store(new std::string[CHUNK_SYMBOLS], std::memory_order_relaxed);
+    symbols_.emplace(std::string_view{}, Symbol::EMPTY);
+    size_.store(1, std::memory_order_release);
+}
+
+SymbolTable::~SymbolTable() {
+    for (std::atomic<std::string*>& chunk : chunks_) {
+        delete[] chunk.load(std::memory_order_relaxed);
+    }
+}
+
+SymbolTable& SymbolTable::global() {
+    // Never destroyed: threads still recording during exit keep valid names
+    static SymbolTable* const table = new SymbolTable();
+    return *table;
+}
+
+std::optional<Symbol> SymbolTable::intern(std::string_view value) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        const auto it = symbols_.find(value);
+        if (it != symbols_.end()) {
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    const auto it = symbols_.find(value);
+    if (it != symbols_.end()) {
+        return it->second; // Interned by another thread in between
+    }
+    const uint32_t index = size_.load(std::memory_order_relaxed);
+    if (index == max_symbols_) {
+        // Every refusal drops an event; log the first and then every 1024th
+        const uint64_t overflowed = overflowed_.fetch_add(1, std::memory_order_relaxed);
+        if (overflowed % 1024 == 0) {
+            LOG_ERROR("Symbol table full at {} strings; refused '{}' ({} refused so far)",
+                      max_symbols_,
+                      value,
+                      overflowed + 1);
+        }
+        return std::nullopt;
+    }
+
+    std::string* chunk = chunks_[index / CHUNK_SYMBOLS].load(std::memory_order_relaxed);
+    if (chunk == nullptr) {
+        chunk = new std::string[CHUNK_SYMBOLS];
+        chunks_[index / CHUNK_SYMBOLS].store(chunk, std::memory_order_release);
+    }
+    std::string& name = chunk[index % CHUNK_SYMBOLS];
+    name.assign(value);
+    const Symbol symbol = static_cast<Symbol>(index);
+    symbols_.emplace(std::string_view(name), symbol);
+    bytes_.fetch_add(name.size(), std::memory_order_relaxed);
+    // Publishes the name before any reader can hold its symbol
+    size_.store(index + 1, std::memory_order_release);
+    return symbol;
+}
+
+std::optional<Symbol> SymbolTable::find(std::string_view value) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    const auto it = symbols_.find(value);
+    if (it == symbols_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+SymbolTableStats SymbolTable::stats() const {
+    SymbolTableStats stats;
+    stats.symbols = size_.load(std::memory_order_relaxed);
+    stats.bytes = bytes_.load(std::memory_order_relaxed);
+    stats.overflowed = overflowed_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace dashcam
@@ -0,0 +1,271 @@
+#include <gtest/gtest.h>
+#include "dashcam/media/audio_capture.h"
+#include "dashcam/utils/byte_order.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+namespace dashcam {
+namespace test {
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+/**
+ * @brief Write a canonical 44-byte-header WAV file
+ */
+void write_wav(const std::filesystem::path& path,
+               const std::vector<int16_t>& samples,
+               uint32_t sample_rate,
+               uint16_t channels,
+               uint16_t bits = 16) {
+    const auto data_bytes = static_cast<uint32_t>(samples.size() * sizeof(int16_t));
+    std::vector<uint8_t> header(44);
+    std::memcpy(header.data(), "RIFF", 4);
+    store_le32(header.data() + 4, 36 + data_bytes);
+    std::memcpy(header.data() + 8, "WAVEfmt ", 8);
+    store_le32(header.data() + 16, 16);
+    store_le16(header.data() + 20, 1);
+    store_le16(header.data() + 22, channels);
+    store_le32(header.data() + 24, sample_rate);
+    store_le32(header.data() + 28, sample_rate * channels * bits / 8);
+    store_le16(header.data() + 32, static_cast<uint16_t>(channels * bits / 8));
+    store_le16(header.data() + 34, bits);
+    std::memcpy(header.data() + 36, "data", 4);
+    store_le32(header.data() + 40, data_bytes);
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+    file.write(reinterpret_cast<const char*>(samples.data()), data_bytes);
+}
+
+PcmPeriodInfo period_at(Clock::time_point time, uint32_t frames, bool discontinuity = false) {
+    PcmPeriodInfo info;
+    info.capture_time = time;
+    info.frames = frames;
+    info.discontinuity = discontinuity;
+    return info;
+}
+
+} // namespace
+
+class AudioCaptureTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_dir_ = std::filesystem::temp_directory_path() / "dashcam_audio_capture_test";
+        std::filesystem::remove_all(test_dir_);
+        std::filesystem::create_directories(test_dir_);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(test_dir_);
+    }
+
+    std::filesystem::path test_dir_;
+};
+
+TEST_F(AudioCaptureTest, RingReportsFullAndWrapsInOrder) {
+    PcmRing ring(4, 2, 3);
+    PcmPeriodInfo info;
+    EXPECT_EQ(ring.front(&info), nullptr);
+
+    const auto now = Clock::now();
+    for (int16_t round = 0; round < 5; ++round) {
+        while (int16_t* slot = ring.begin_write()) {
+            slot[0] = round;
+            ring.commit_write(period_at(now, 4, round == 3));
+        }
+        EXPECT_EQ(ring.size(), 3u);
+
+        // Full: the producer is told instead of waiting
+        EXPECT_EQ(ring.begin_write(), nullptr);
+        for (uint32_t i = 0; i < 3; ++i) {
+            const int16_t* pcm = ring.front(&info);
+            ASSERT_NE(pcm, nullptr);
+            EXPECT_EQ(pcm[0], round);
+            EXPECT_EQ(info.discontinuity, round == 3);
+            ring.pop();
+        }
+    }
+    EXPECT_EQ(ring.size(), 0u);
+}
+
+TEST_F(AudioCaptureTest, RingHandsPeriodsAcrossThreadsIntact) {
+    constexpr uint32_t PERIODS = 20000;
+    PcmRing ring(8, 1, 4);
+    const auto now = Clock::now();
+
+    std::thread producer([&] {
+        for (uint32_t i = 0; i < PERIODS;) {
+            int16_t* slot = ring.begin_write();
+            if (slot == nullptr) {
+                std::this_thread::yield();
+                continue;
+            }
+            for (uint32_t j = 0; j < 8; ++j) {
+                slot[j] = static_cast<int16_t>(i + j);
+            }
+            ring.commit_write(period_at(now, 8));
+            ++i;
+        }
+    });
+
+    uint32_t received = 0;
+    PcmPeriodInfo info;
+    while (received < PERIODS) {
+        const int16_t* pcm = ring.front(&info);
+        if (pcm == nullptr) {
+            std::this_thread::yield();
+            continue;
+        }
+        for (uint32_t j = 0; j < 8; ++j) {
+            ASSERT_EQ(pcm[j], static_cast<int16_t>(received + j));
+        }
+        ring.pop();
+        ++received;
+    }
+    producer.join();
+}
+
+TEST_F(AudioCaptureTest, WavSourceReadsStereoAndEnds) {
+    const auto path = test_dir_ / "stereo.wav";
+    write_wav(path, {1, -1, 2, -2, 3, -3}, 44100, 2);
+
+    AudioSource source;
+    ASSERT_TRUE(source.open_wav(path.string(), false));
+    EXPECT_EQ(source.format().sample_rate, 44100u);
+    EXPECT_EQ(source.format().channels, 2u);
+
+    std::vector<int16_t> out(8, 0);
+    EXPECT_EQ(source.read(out.data(), 4), 3u);
+    EXPECT_EQ(out[4], 3);
+    EXPECT_EQ(out[5], -3);
+    EXPECT_EQ(source.read(out.data(), 4), 0u);
+
+    // Looping restarts at the first frame
+    ASSERT_TRUE(source.open_wav(path.string(), true));
+    EXPECT_EQ(source.read(out.data(), 4), 4u);
+    EXPECT_EQ(out[6], 1);
+
+    const auto eight_bit = test_dir_ / "eight_bit.wav";
+    write_wav(eight_bit, {0, 0}, 8000, 1, 8);
+    AudioSource rejected;
+    EXPECT_FALSE(rejected.open_wav(eight_bit.string(), false));
+    EXPECT_FALSE(rejected.open_wav((test_dir_ / "missing.wav").string(), false));
+}
+
+TEST_F(AudioCaptureTest, TimelineAbsorbsJitterAndResyncsOnDriftOrDrops) {
+    const auto epoch = Clock::now();
+    AudioTimeline timeline(48000, epoch, std::chrono::microseconds(20000));
+    using std::chrono::milliseconds;
+
+    // First period anchors at its capture time: 100 ms after the epoch
+    EXPECT_EQ(timeline.place(period_at(epoch + milliseconds(100), 960)), 4800);
+
+    // 3 ms of scheduling jitter does not move the next period off the grid
+    EXPECT_EQ(timeline.place(period_at(epoch + milliseconds(123), 960)), 5760);
+
+    // 50 ms of drift does
+    EXPECT_EQ(timeline.place(period_at(epoch + milliseconds(190), 960)), 9120);
+    EXPECT_EQ(timeline.resyncs(), 1u);
+
+    // Dropped periods always resync, however small the gap
+    EXPECT_EQ(timeline.place(period_at(epoch + milliseconds(230), 960, true)), 11040);
+    EXPECT_EQ(timeline.resyncs(), 2u);
+}
+
+TEST_F(AudioCaptureTest, FrameCountsPastDaysOfCaptureConvertExactly) {
+    using std::chrono::milliseconds;
+    using std::chrono::nanoseconds;
+
+    // 4.8e10 frames (over 2^34) is 11.6 days at 48 kHz; frames * 1e9 would wrap
+    const uint64_t frames = 48000ull * 1000000 + 24000;
+    ASSERT_GT(frames, 1ull << 34);
+    EXPECT_EQ(AudioCapture::frames_to_duration(frames, 48000), milliseconds(1000000500));
+
+    // Sub-second remainders still truncate to the nanosecond
+    EXPECT_EQ(AudioCapture::frames_to_duration((1ull << 24) * 44100 + 1, 44100),
+              std::chrono::seconds(1ull << 24) + nanoseconds(22675));
+}
+
+TEST_F(AudioCaptureTest, CapturedAudioIsMuxedAlongsideVideo) {
+    // One second of 48 kHz mono: exactly 50 periods of 20 ms
+    const auto path = test_dir_ / "tone.wav";
+    write_wav(path, std::vector<int16_t>(48000, 7), 48000, 1);
+    AudioSource source;
+    ASSERT_TRUE(source.open_wav(path.string(), false));
+
+    AudioCaptureConfig config;
+    config.ring_periods = 64;
+    config.realtime = false;
+    AudioCapture capture(config, source);
+
+    SegmentWriterConfig writer_config;
+    writer_config.durability.mode = DurabilityMode::None;
+    Fmp4MuxerConfig muxer_config;
+    muxer_config.decoder_config = {0x01, 0x64, 0x00, 0x1F};
+    muxer_config.audio.sample_rate = 48000;
+    SegmentWriter writer(writer_config);
+    Fmp4Muxer muxer(muxer_config, writer);
+    ASSERT_TRUE(writer.open((test_dir_ / "segment.mp4").string()));
+    const auto now = Clock::now();
+    ASSERT_TRUE(muxer.begin_segment(now));
+
+    const auto epoch = Clock::now();
+    capture.start(epoch);
+    for (int i = 0; i < 2000 && capture.stats().periods_captured < 50; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(capture.stats().periods_captured, 50u);
+
+    // 30 fps video over the same second, draining audio up to each frame
+    for (int64_t i = 0; i < 30; ++i) {
+        auto frame = std::make_shared<const std::vector<uint8_t>>(500, 1);
+        SampleTiming timing;
+        timing.decode_time = i * 3000;
+        timing.duration = 3000;
+        ASSERT_TRUE(muxer.add_sample(make_write_chunk(std::move(frame), i % 15 == 0), timing, now));
+        capture.drain(muxer, epoch + std::chrono::microseconds(i * 33333), now);
+    }
+    capture.drain(muxer, epoch + std::chrono::seconds(1), now);
+    capture.stop();
+    ASSERT_TRUE(muxer.end_segment(now));
+    ASSERT_TRUE(writer.close(now));
+
+    const AudioCaptureStats stats = capture.stats();
+    EXPECT_EQ(stats.periods_dropped, 0u);
+    EXPECT_GE(stats.periods_drained, 49u);
+    EXPECT_EQ(stats.periods_muxed, stats.periods_drained);
+    EXPECT_EQ(stats.resyncs, 0u);
+    EXPECT_EQ(muxer.stats().audio_samples_written, stats.periods_muxed);
+    EXPECT_EQ(muxer.stats().audio_samples_dropped, 0u);
+}
+
+TEST_F(AudioCaptureTest, FullRingDropsInsteadOfBlocking) {
+    AudioSource source;
+    source.generate_tone(AudioFormat{16000, 1}, 440);
+
+    AudioCaptureConfig config;
+    config.period_frames = 320;
+    config.ring_periods = 2;
+    config.realtime = false;
+    AudioCapture capture(config, source);
+
+    // Nobody drains: the capture thread keeps running and counts what it loses
+    capture.start(Clock::now());
+    for (int i = 0; i < 2000 && capture.stats().periods_dropped < 10; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    capture.stop();
+
+    const AudioCaptureStats stats = capture.stats();
+    EXPECT_EQ(stats.periods_captured, 2u);
+    EXPECT_GE(stats.periods_dropped, 10u);
+}
+
+} // namespace test
+} // namespace dashcam
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include "dashcam/storage/background_deleter.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+namespace dashcam {
+namespace test {
+
+class BackgroundDeleterTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_dir_ = std::filesystem::temp_directory_path() / "dashcam_background_deleter_test";
+        std::filesystem::remove_all(test_dir_);
+        std::filesystem::create_directories(test_dir_);
+
+        config_.truncate_step_bytes = 256 * 1024;
+        config_.step_interval = std::chrono::milliseconds(0);
+        config_.throttle_backoff = std::chrono::milliseconds(1);
+        config_.idle_io_priority = false;
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(test_dir_);
+    }
+
+    std::string make_file(const std::string& name, size_t size_bytes) {
+        const auto path = test_dir_ / name;
+        std::ofstream(path, std::ios::binary) << std::string(size_bytes, 'x');
+        return path.string();
+    }
+
+    static void wait_for_deleted(const BackgroundDeleter& deleter, uint64_t files) {
+        for (int i = 0; i < 1000 && deleter.stats().files_deleted < files; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+
+    std::filesystem::path test_dir_;
+    BackgroundDeleterConfig config_;
+};
+
+TEST_F(BackgroundDeleterTest, TruncatesInStepsBeforeUnlink) {
+    const std::string path = make_file("segment_1.mp4", 1024 * 1024);
+    const std::string checkpoints = make_file("segment_1.chain", 144);
+    StorageAccounting accounting(test_dir_.string());
+    accounting.on_write(1024 * 1024);
+
+    BackgroundDeleter deleter(config_, nullptr, &accounting);
+    deleter.start();
+    ASSERT_TRUE(deleter.enqueue(path));
+    wait_for_deleted(deleter, 1);
+    deleter.stop();
+
+    const BackgroundDeleterStats stats = deleter.stats();
+    EXPECT_EQ(stats.files_deleted, 1u);
+    EXPECT_EQ(stats.truncate_steps, 4u);
+    EXPECT_EQ(stats.bytes_freed, 1024u * 1024u);
+    EXPECT_EQ(accounting.usage().used_bytes, 0u);
+    EXPECT_FALSE(std::filesystem::exists(path));
+    EXPECT_FALSE(std::filesystem::exists(checkpoints));
+}
+
+TEST_F(BackgroundDeleterTest, LeavesHardLinkedDataIntact) {
+    const std::string path = make_file("segment_2.mp4", 300 * 1024);
+    const std::string protected_path = (test_dir_ / "protected.mp4").string();
+    std::filesystem::create_hard_link(path, protected_path);
+
+    BackgroundDeleter deleter(config_, nullptr, nullptr);
+    deleter.start();
+    ASSERT_TRUE(deleter.enqueue(path));
+    deleter.stop();
+
+    EXPECT_EQ(deleter.stats().files_deleted, 1u);
+    EXPECT_EQ(deleter.stats().truncate_steps, 0u);
+    EXPECT_FALSE(std::filesystem::exists(path));
+    EXPECT_EQ(std::filesystem::file_size(protected_path), 300u * 1024u);
+}
+
+TEST_F(BackgroundDeleterTest, PausesWhileRecentWritesAreSlow) {
+    const std::string path = make_file("segment_3.mp4", 512 * 1024);
+    LatencyHistogram write_latency;
+    config_.max_write_p99 = std::chrono::milliseconds(1);
+
+    BackgroundDeleter deleter(config_, &write_latency, nullptr);
+    deleter.start();
+
+    // Only writes recorded after start() count; these make the window slow
+    for (int i = 0; i < 32; ++i) {
+        write_latency.record(std::chrono::milliseconds(50));
+    }
+    ASSERT_TRUE(deleter.enqueue(path));
+    wait_for_deleted(deleter, 1);
+    deleter.stop();
+
+    // The first check sees the slow window, the next sees no new writes
+    EXPECT_EQ(deleter.stats().throttle_pauses, 1u);
+    EXPECT_EQ(deleter.stats().files_deleted, 1u);
+}
+
+TEST_F(BackgroundDeleterTest, MissingFileCountsAsFailure) {
+    BackgroundDeleter deleter(config_, nullptr, nullptr);
+    deleter.start();
+    ASSERT_TRUE(deleter.enqueue((test_dir_ / "missing.mp4").string()));
+    deleter.stop();
+
+    EXPECT_EQ(deleter.stats().files_failed, 1u);
+    EXPECT_EQ(deleter.stats().pending_files, 0u);
+}
+
+} // namespace test
+} // namespace dashcam
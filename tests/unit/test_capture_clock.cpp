@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+#include "dashcam/media/capture_clock.h"
+
+namespace dashcam {
+namespace test {
+
+TEST(CaptureClockTest, MapsMonotonicTimeOntoUtcBothWays) {
+    const auto anchor = CaptureClock::Clock::now();
+    const CaptureClock clock(anchor, 1700000000000000);
+
+    EXPECT_EQ(clock.to_us(anchor), 1700000000000000);
+    EXPECT_EQ(clock.to_us(anchor + std::chrono::milliseconds(1500)), 1700000001500000);
+    EXPECT_EQ(clock.from_us(1700000001500000), anchor + std::chrono::milliseconds(1500));
+    EXPECT_GE(clock.now_us(), 1700000000000000);
+}
+
+TEST(CaptureClockTest, TrackerFindsOffsetUnderDeliveryJitter) {
+    // Device clock runs 5 s behind; frames arrive 2-9 ms after capture
+    constexpr int64_t OFFSET_US = 5000000;
+    CameraClockTracker tracker(2000000);
+
+    const int64_t latencies[] = {9000, 4000, 2000, 7000, 3000, 8000};
+    for (int64_t frame = 0; frame < 60; ++frame) {
+        const int64_t captured = 1000000 + frame * 33333;
+        const int64_t latency = latencies[frame % 6];
+        tracker.observe(captured - OFFSET_US, captured + latency);
+    }
+
+    // The best delivery bounds the offset; capture times are recovered to within it
+    EXPECT_EQ(tracker.offset_us(), OFFSET_US + 2000);
+    EXPECT_EQ(tracker.to_capture_us(1000000 - OFFSET_US), 1002000);
+    EXPECT_EQ(tracker.last_jitter_us(), 8000 - 2000);
+}
+
+TEST(CaptureClockTest, TrackerFollowsDriftAcrossWindows) {
+    CameraClockTracker tracker(1000000);
+    tracker.observe(0, 10000);
+
+    // The device clock slips 5 ms; one window later the old minimum is gone
+    int64_t arrival = 10000;
+    for (int i = 0; i < 90; ++i) {
+        arrival += 33333;
+        tracker.observe(arrival - 15000, arrival);
+    }
+    EXPECT_EQ(tracker.offset_us(), 15000);
+}
+
+} // namespace test
+} // namespace dashcam
@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+#include "dashcam/storage/circular_log.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace dashcam {
+namespace test {
+
+using Clock = CircularRecordLog::Clock;
+
+class CircularLogTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_dir_ = std::filesystem::temp_directory_path() / "dashcam_circular_log_test";
+        std::filesystem::remove_all(test_dir_);
+        std::filesystem::create_directories(test_dir_);
+        ring_path_ = (test_dir_ / "front.ring").string();
+
+        config_.file_size_bytes = CircularRecordLog::DATA_OFFSET + 256 * 1024;
+        config_.max_batch_bytes = 16 * 1024;
+        config_.durability.mode = DurabilityMode::None;
+        config_.label = "front";
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(test_dir_);
+    }
+
+    static WriteChunk payload_of(size_t size, uint8_t fill, bool keyframe = false) {
+        auto buffer = std::make_shared<const std::vector<uint8_t>>(size, fill);
+        return make_write_chunk(std::move(buffer), keyframe);
+    }
+
+    std::filesystem::path test_dir_;
+    std::string ring_path_;
+    CircularLogConfig config_;
+};
+
+TEST_F(CircularLogTest, PreallocatesFullSizeOnCreate) {
+    CircularRecordLog log;
+    ASSERT_TRUE(log.open(ring_path_, config_));
+
+    EXPECT_EQ(std::filesystem::file_size(ring_path_), config_.file_size_bytes);
+    EXPECT_EQ(log.record_count(), 0u);
+    EXPECT_EQ(log.data_capacity_bytes(), 256u * 1024u);
+}
+
+TEST_F(CircularLogTest, AppendedRecordsReadBackIntact) {
+    CircularRecordLog log;
+    ASSERT_TRUE(log.open(ring_path_, config_));
+
+    const auto now = Clock::now();
+    for (uint8_t i = 0; i < 10; ++i) {
+        ASSERT_TRUE(log.append(payload_of(1000 + i, i, i == 0), i * 33333, now));
+    }
+    ASSERT_TRUE(log.flush());
+
+    const auto records = log.records_between(0, 1000000);
+    ASSERT_EQ(records.size(), 10u);
+    EXPECT_TRUE(records[0].keyframe);
+    EXPECT_FALSE(records[1].keyframe);
+
+    std::vector<uint8_t> payload;
+    ASSERT_TRUE(log.read_record(records[7], &payload));
+    EXPECT_EQ(payload.size(), 1007u);
+    EXPECT_EQ(payload[0], 7);
+}
+
+TEST_F(CircularLogTest, WrapsByOverwritingOldestRecords) {
+    CircularRecordLog log;
+    ASSERT_TRUE(log.open(ring_path_, config_));
+
+    // Roughly four laps of the ring
+    const auto now = Clock::now();
+    for (int64_t i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(log.append(payload_of(1000, static_cast<uint8_t>(i)), i * 1000, now));
+    }
+    ASSERT_TRUE(log.flush());
+
+    const CircularLogStats stats = log.stats();
+    EXPECT_GT(stats.records_overwritten, 0u);
+    EXPECT_EQ(stats.records_appended, 1000u);
+    EXPECT_EQ(log.record_count(), 1000u - stats.records_overwritten);
+
+    // Oldest records are gone; the newest survive and are readable
+    EXPECT_TRUE(log.records_between(0, 1000).empty());
+    const auto newest = log.records_between(999000, 999000);
+    ASSERT_EQ(newest.size(), 1u);
+    std::vector<uint8_t> payload;
+    ASSERT_TRUE(log.read_record(newest[0], &payload));
+    EXPECT_EQ(payload[0], static_cast<uint8_t>(999));
+
+    // Still exactly one file, at its original size
+    EXPECT_EQ(std::filesystem::file_size(ring_path_), config_.file_size_bytes);
+}
+
+TEST_F(CircularLogTest, ReopenRecoversIndex) {
+    size_t records_before = 0;
+    {
+        CircularRecordLog log;
+        ASSERT_TRUE(log.open(ring_path_, config_));
+        const auto now = Clock::now();
+        for (int64_t i = 0; i < 600; ++i) {
+            ASSERT_TRUE(log.append(payload_of(700, static_cast<uint8_t>(i)), i * 1000, now));
+        }
+        records_before = log.record_count();
+    } // Destructor checkpoints
+
+    CircularRecordLog reopened;
+    ASSERT_TRUE(reopened.open(ring_path_, config_));
+    EXPECT_EQ(reopened.record_count(), records_before);
+
+    // Appends continue after the recovered head
+    ASSERT_TRUE(reopened.append(payload_of(10, 1), 600000, Clock::now()));
+    EXPECT_FALSE(reopened.append(payload_of(10, 1), 5, Clock::now()));
+}
+
+TEST_F(CircularLogTest, RecoversRecordsWrittenAfterLastCheckpoint) {
+    CircularRecordLog writer;
+    ASSERT_TRUE(writer.open(ring_path_, config_));
+    const auto now = Clock::now();
+    for (int64_t i = 0; i < 20; ++i) {
+        ASSERT_TRUE(writer.append(payload_of(500, 3), i, now));
+    }
+    ASSERT_TRUE(writer.flush()); // Written but never checkpointed
+
+    // A second reader sees the superblock from format time and scans forward
+    CircularRecordLog reader;
+    ASSERT_TRUE(reader.open(ring_path_, config_));
+    EXPECT_EQ(reader.record_count(), 20u);
+}
+
+TEST_F(CircularLogTest, CorruptPayloadBelowCheckpointedHeadEndsRecovery) {
+    RingRecordInfo damaged;
+    {
+        CircularRecordLog log;
+        ASSERT_TRUE(log.open(ring_path_, config_));
+        const auto now = Clock::now();
+        for (int64_t i = 0; i < 20; ++i) {
+            ASSERT_TRUE(log.append(payload_of(500, 3), i, now));
+        }
+        ASSERT_TRUE(log.flush());
+        const auto records = log.records_between(0, 19);
+        ASSERT_EQ(records.size(), 20u);
+        damaged = records[10];
+    } // Destructor checkpoints: the head now covers all 20 records
+
+    // A payload that never reached the card, under an intact header
+    std::fstream file(ring_path_, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(static_cast<std::streamoff>(CircularRecordLog::DATA_OFFSET + damaged.offset +
+                                           CircularRecordLog::RECORD_HEADER_SIZE + 100));
+    file.put(static_cast<char>(0x5A));
+    file.close();
+
+    CircularRecordLog reopened;
+    ASSERT_TRUE(reopened.open(ring_path_, config_));
+    EXPECT_EQ(reopened.record_count(), 10u);
+}
+
+TEST_F(CircularLogTest, LargeBatchesEvictAtMostAnEighthAhead) {
+    config_.max_batch_bytes = 128 * 1024;
+    CircularRecordLog log;
+    ASSERT_TRUE(log.open(ring_path_, config_));
+
+    // Several laps; once wrapped, eviction never runs more than 1/8th of the
+    // ring (plus the record being placed and the wrap gap) ahead of the head
+    const auto now = Clock::now();
+    size_t fewest = SIZE_MAX;
+    for (int64_t i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(log.append(payload_of(1000, 1), i * 1000, now));
+        if (log.stats().records_overwritten > 0) {
+            fewest = std::min(fewest, log.record_count());
+        }
+    }
+    const uint64_t record_bytes = 1000 + CircularRecordLog::RECORD_HEADER_SIZE;
+    const uint64_t capacity = log.data_capacity_bytes();
+    EXPECT_GE(fewest * record_bytes, capacity - capacity / 8 - 3 * record_bytes);
+}
+
+TEST_F(CircularLogTest, RejectsRecordLargerThanHalfTheRing) {
+    CircularRecordLog log;
+    ASSERT_TRUE(log.open(ring_path_, config_));
+    EXPECT_FALSE(log.append(payload_of(200 * 1024, 1), 0, Clock::now()));
+}
+
+} // namespace test
+} // namespace dashcam
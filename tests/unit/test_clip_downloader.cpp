@@ -0,0 +1,379 @@
+#include <gtest/gtest.h>
+#include "grpc/clip_downloader.h"
+#include "dashcam.grpc.pb.h"
+#include "dashcam/storage/background_deleter.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+namespace dashcam {
+namespace test {
+
+namespace {
+
+/**
+ * @brief DownloadClip alone, answered by a downloader under test
+ */
+class ClipDownloadService final
+    : public DashcamService::WithRawCallbackMethod_DownloadClip<DashcamService::Service> {
+public:
+    explicit ClipDownloadService(ClipDownloader& downloader) : downloader_(downloader) {}
+
+    grpc::ServerWriteReactor<grpc::ByteBuffer>* DownloadClip(
+        grpc::CallbackServerContext* context,
+        const grpc::ByteBuffer* request) override {
+        DownloadClipRequest parsed;
+        EXPECT_TRUE(parse_request(*request, &parsed));
+        return downloader_.download(context, parsed);
+    }
+
+private:
+    ClipDownloader& downloader_;
+};
+
+/**
+ * @brief Everything one download returned
+ */
+struct Download {
+    grpc::StatusCode code = grpc::StatusCode::UNKNOWN;
+    std::vector<ClipChunk> chunks;
+    std::string bytes;
+};
+
+} // namespace
+
+class ClipDownloaderTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_dir_ = std::filesystem::temp_directory_path() / "dashcam_clip_downloader_test";
+        std::filesystem::remove_all(test_dir_);
+        std::filesystem::create_directories(test_dir_);
+        index_ = std::make_shared<SegmentIndex>();
+    }
+
+    void TearDown() override {
+        if (server_) {
+            downloader_->stop();
+            server_->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(1));
+        }
+        std::filesystem::remove_all(test_dir_);
+    }
+
+    /**
+     * @brief Write a segment file, each byte derived from its id and offset, and index it
+     */
+    std::string add_segment(uint64_t segment_id,
+                            const std::string& camera,
+                            int64_t start_us,
+                            size_t size) {
+        std::string contents(size, '\0');
+        for (size_t i = 0; i < size; ++i) {
+            contents[i] = static_cast<char>(i * 7 + segment_id * 13 + i / 4096);
+        }
+        const std::string path = segment_path(segment_id, start_us);
+        std::ofstream(path, std::ios::binary)
+            .write(contents.data(), static_cast<std::streamsize>(size));
+
+        SegmentInfo info;
+        info.segment_id = segment_id;
+        info.camera_id = camera;
+        info.path = path;
+        info.start_time_us = start_us;
+        info.end_time_us = start_us + 60000000 - 1;
+        info.size_bytes = size;
+        EXPECT_TRUE(index_->add(info));
+        return contents;
+    }
+
+    std::string segment_path(uint64_t segment_id, int64_t start_us) const {
+        const std::string name =
+            std::to_string(segment_id) + "_" + std::to_string(start_us) + ".mp4";
+        return (test_dir_ / name).string();
+    }
+
+    void start(const ClipDownloaderConfig& config = ClipDownloaderConfig{},
+               bool with_index = true) {
+        downloader_ = std::make_unique<ClipDownloader>(with_index ? index_ : nullptr, config);
+        service_ = std::make_unique<ClipDownloadService>(*downloader_);
+
+        grpc::ServerBuilder builder;
+        int port = 0;
+        builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+        builder.RegisterService(service_.get());
+        server_ = builder.BuildAndStart();
+        ASSERT_NE(server_, nullptr);
+        stub_ = DashcamService::NewStub(grpc::CreateChannel(
+            "127.0.0.1:" + std::to_string(port), grpc::InsecureChannelCredentials()));
+    }
+
+    Download download(const DownloadClipRequest& request) {
+        Download result;
+        grpc::ClientContext context;
+        auto reader = stub_->DownloadClip(&context, request);
+        ClipChunk chunk;
+        while (reader->Read(&chunk)) {
+            result.bytes += chunk.data();
+            chunk.clear_data();
+            result.chunks.push_back(chunk);
+        }
+        result.code = reader->Finish().error_code();
+        return result;
+    }
+
+    bool wait_for_active(uint64_t active) {
+        for (int i = 0; i < 5000; ++i) {
+            if (downloader_->stats().active == active) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return false;
+    }
+
+    std::filesystem::path test_dir_;
+    std::shared_ptr<SegmentIndex> index_;
+    std::unique_ptr<ClipDownloader> downloader_;
+    std::unique_ptr<ClipDownloadService> service_;
+    std::unique_ptr<grpc::Server> server_;
+    std::unique_ptr<DashcamService::Stub> stub_;
+};
+
+TEST_F(ClipDownloaderTest, DownloadsSegmentsInRequestOrder) {
+    const std::string first = add_segment(1, "front", 0, 300000);
+    const std::string second = add_segment(2, "front", 60000000, 1500000);
+    const std::string third = add_segment(3, "front", 120000000, 5000);
+    start();
+
+    DownloadClipRequest request;
+    request.add_segment_ids(2);
+    request.add_segment_ids(1);
+    request.add_segment_ids(3);
+    const Download result = download(request);
+    ASSERT_EQ(result.code, grpc::StatusCode::OK);
+    EXPECT_EQ(result.bytes, second + first + third);
+
+    ASSERT_FALSE(result.chunks.empty());
+    const ClipChunk& head = result.chunks.front();
+    EXPECT_EQ(head.clip_size(), result.bytes.size());
+    EXPECT_EQ(std::vector<uint64_t>(head.segment_ids().begin(), head.segment_ids().end()),
+              (std::vector<uint64_t>{2, 1, 3}));
+    EXPECT_EQ(std::vector<uint64_t>(head.segment_sizes().begin(), head.segment_sizes().end()),
+              (std::vector<uint64_t>{1500000, 300000, 5000}));
+
+    uint64_t offset = 0;
+    for (size_t i = 0; i < result.chunks.size(); ++i) {
+        EXPECT_EQ(result.chunks[i].offset(), offset);
+        if (i > 0) {
+            EXPECT_EQ(result.chunks[i].segment_ids_size(), 0);
+        }
+        const uint64_t next =
+            i + 1 < result.chunks.size() ? result.chunks[i + 1].offset() : result.bytes.size();
+        offset = next;
+    }
+
+    const ClipDownloaderStats stats = downloader_->stats();
+    EXPECT_EQ(stats.started, 1u);
+    EXPECT_EQ(stats.completed, 1u);
+    EXPECT_EQ(stats.failed, 0u);
+    EXPECT_EQ(stats.chunks, result.chunks.size());
+}
+
+TEST_F(ClipDownloaderTest, ResumesFromAnOffsetWithinASegment) {
+    const std::string first = add_segment(1, "front", 0, 200000);
+    const std::string second = add_segment(2, "front", 60000000, 400000);
+    start();
+
+    DownloadClipRequest request;
+    request.add_segment_ids(1);
+    request.add_segment_ids(2);
+    request.set_offset(250001);
+    const Download result = download(request);
+    ASSERT_EQ(result.code, grpc::StatusCode::OK);
+    EXPECT_EQ(result.bytes, (first + second).substr(250001));
+
+    ASSERT_FALSE(result.chunks.empty());
+    EXPECT_EQ(result.chunks.front().offset(), 250001u);
+    EXPECT_EQ(result.chunks.front().segment_id(), 2u);
+    EXPECT_EQ(result.chunks.front().segment_offset(), 50001u);
+    EXPECT_EQ(result.chunks.front().clip_size(), 600000u);
+    EXPECT_EQ(downloader_->stats().resumed, 1u);
+
+    // Resuming at the very end still describes the clip
+    request.set_offset(600000);
+    const Download end = download(request);
+    ASSERT_EQ(end.code, grpc::StatusCode::OK);
+    ASSERT_EQ(end.chunks.size(), 1u);
+    EXPECT_TRUE(end.bytes.empty());
+    EXPECT_EQ(end.chunks.front().clip_size(), 600000u);
+
+    request.set_offset(600001);
+    EXPECT_EQ(download(request).code, grpc::StatusCode::OUT_OF_RANGE);
+}
+
+TEST_F(ClipDownloaderTest, ResolvesACameraTimeRange) {
+    const std::string first = add_segment(1, "front", 0, 10000);
+    add_segment(2, "rear", 0, 10000);
+    const std::string second = add_segment(3, "front", 60000000, 20000);
+    add_segment(4, "front", 120000000, 30000);
+    start();
+
+    DownloadClipRequest request;
+    request.set_camera_id("front");
+    request.set_start_time_us(30000000);
+    request.set_end_time_us(90000000);
+    const Download result = download(request);
+    ASSERT_EQ(result.code, grpc::StatusCode::OK);
+    EXPECT_EQ(result.bytes, first + second);
+    ASSERT_FALSE(result.chunks.empty());
+    EXPECT_EQ(result.chunks.front().segment_ids_size(), 2);
+
+    request.set_start_time_us(500000000);
+    request.set_end_time_us(600000000);
+    EXPECT_EQ(download(request).code, grpc::StatusCode::NOT_FOUND);
+}
+
+TEST_F(ClipDownloaderTest, RejectsBadRequests) {
+    add_segment(1, "front", 0, 1000);
+    start();
+
+    EXPECT_EQ(download(DownloadClipRequest{}).code, grpc::StatusCode::INVALID_ARGUMENT);
+
+    DownloadClipRequest backwards;
+    backwards.set_camera_id("front");
+    backwards.set_start_time_us(10);
+    backwards.set_end_time_us(5);
+    EXPECT_EQ(download(backwards).code, grpc::StatusCode::INVALID_ARGUMENT);
+
+    DownloadClipRequest unknown;
+    unknown.add_segment_ids(1);
+    unknown.add_segment_ids(7);
+    EXPECT_EQ(download(unknown).code, grpc::StatusCode::NOT_FOUND);
+
+    // Indexed, but deleted from disk
+    DownloadClipRequest gone;
+    gone.add_segment_ids(1);
+    std::filesystem::remove(segment_path(1, 0));
+    EXPECT_EQ(download(gone).code, grpc::StatusCode::NOT_FOUND);
+    EXPECT_EQ(downloader_->stats().failed, 2u);
+}
+
+TEST_F(ClipDownloaderTest, FailsWithoutASegmentIndex) {
+    start(ClipDownloaderConfig{}, false);
+    DownloadClipRequest request;
+    request.add_segment_ids(1);
+    EXPECT_EQ(download(request).code, grpc::StatusCode::FAILED_PRECONDITION);
+}
+
+TEST_F(ClipDownloaderTest, ChunksGrowOnAFastConnection) {
+    const std::string contents = add_segment(1, "front", 0, 8 * 1024 * 1024);
+    ClipDownloaderConfig config;
+    config.target_write_time = std::chrono::milliseconds(1000);
+    start(config);
+
+    DownloadClipRequest request;
+    request.add_segment_ids(1);
+    const Download result = download(request);
+    ASSERT_EQ(result.code, grpc::StatusCode::OK);
+    EXPECT_EQ(result.bytes, contents);
+
+    std::vector<uint64_t> sizes;
+    for (size_t i = 0; i < result.chunks.size(); ++i) {
+        const uint64_t end =
+            i + 1 < result.chunks.size() ? result.chunks[i + 1].offset() : contents.size();
+        sizes.push_back(end - result.chunks[i].offset());
+    }
+    EXPECT_EQ(sizes.front(), config.min_chunk_bytes);
+    EXPECT_EQ(*std::max_element(sizes.begin(), sizes.end()), config.max_chunk_bytes);
+}
+
+TEST_F(ClipDownloaderTest, RefusesDownloadsBeyondTheLimit) {
+    add_segment(1, "front", 0, 32 * 1024 * 1024);
+    ClipDownloaderConfig config;
+    config.max_downloads = 1;
+    start(config);
+
+    // Never reads: the download stays busy behind flow control
+    DownloadClipRequest request;
+    request.add_segment_ids(1);
+    grpc::ClientContext stalled_context;
+    auto stalled = stub_->DownloadClip(&stalled_context, request);
+    ASSERT_TRUE(wait_for_active(1));
+
+    EXPECT_EQ(download(request).code, grpc::StatusCode::RESOURCE_EXHAUSTED);
+    EXPECT_EQ(downloader_->stats().rejected, 1u);
+
+    stalled_context.TryCancel();
+    EXPECT_EQ(stalled->Finish().error_code(), grpc::StatusCode::CANCELLED);
+    ASSERT_TRUE(wait_for_active(0));
+    EXPECT_EQ(download(request).code, grpc::StatusCode::OK);
+}
+
+TEST_F(ClipDownloaderTest, StopEndsDownloadsSoClientsResume) {
+    add_segment(1, "front", 0, 32 * 1024 * 1024);
+    start();
+
+    DownloadClipRequest request;
+    request.add_segment_ids(1);
+    grpc::ClientContext context;
+    auto reader = stub_->DownloadClip(&context, request);
+    ClipChunk chunk;
+    ASSERT_TRUE(reader->Read(&chunk));
+
+    downloader_->stop();
+    EXPECT_EQ(downloader_->stats().active, 0u);
+    uint64_t received = chunk.data().size();
+    while (reader->Read(&chunk)) {
+        received += chunk.data().size();
+    }
+    EXPECT_EQ(reader->Finish().error_code(), grpc::StatusCode::UNAVAILABLE);
+    EXPECT_LT(received, 32u * 1024 * 1024);
+    EXPECT_EQ(download(request).code, grpc::StatusCode::UNAVAILABLE);
+}
+
+TEST_F(ClipDownloaderTest, EvictionWaitsForTheDownload) {
+    const std::string contents = add_segment(1, "front", 0, 8 * 1024 * 1024);
+    ClipDownloaderConfig config;
+    config.max_bytes_per_second = 16 * 1024 * 1024;
+    start(config);
+
+    DownloadClipRequest request;
+    request.add_segment_ids(1);
+    grpc::ClientContext context;
+    auto reader = stub_->DownloadClip(&context, request);
+    ClipChunk chunk;
+    ASSERT_TRUE(reader->Read(&chunk));
+    std::string received = chunk.data();
+
+    // Retention cannot take the segment, and a deletion queued anyway waits;
+    // truncating the file now would fault the mapped chunks
+    EXPECT_FALSE(index_->remove(1));
+    BackgroundDeleterConfig deleter_config;
+    deleter_config.step_interval = std::chrono::milliseconds(0);
+    deleter_config.throttle_backoff = std::chrono::milliseconds(1);
+    deleter_config.idle_io_priority = false;
+    BackgroundDeleter deleter(deleter_config, nullptr, nullptr, index_.get());
+    deleter.start();
+    ASSERT_TRUE(deleter.enqueue(segment_path(1, 0)));
+
+    while (reader->Read(&chunk)) {
+        received += chunk.data();
+    }
+    ASSERT_EQ(reader->Finish().error_code(), grpc::StatusCode::OK);
+    EXPECT_EQ(received, contents);
+
+    // Unpinned once the last chunk is released, then deleted
+    for (int i = 0; i < 5000 && deleter.stats().files_deleted == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    deleter.stop();
+    EXPECT_EQ(deleter.stats().files_deleted, 1u);
+    EXPECT_GT(deleter.stats().files_deferred, 0u);
+    EXPECT_FALSE(std::filesystem::exists(segment_path(1, 0)));
+    EXPECT_EQ(index_->find(1)->pin_count, 0u);
+}
+
+} // namespace test
+} // namespace dashcam
@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#include "dashcam/storage/clip_protector.h"
+#include "dashcam/storage/segment_index.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace dashcam {
+namespace test {
+
+class ClipProtectorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_dir_ = std::filesystem::temp_directory_path() / "dashcam_clip_protector_test";
+        std::filesystem::remove_all(test_dir_);
+        std::filesystem::create_directories(test_dir_ / "recordings");
+
+        // Two cameras, three 60 s segments each
+        uint64_t segment_id = 1;
+        for (const char* camera : {"front", "rear"}) {
+            for (int64_t minute = 0; minute < 3; ++minute) {
+                add_segment(segment_id++, camera, minute * 60000000, (minute + 1) * 60000000 - 1);
+            }
+        }
+        config_.protected_dir = (test_dir_ / "protected").string();
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(test_dir_);
+    }
+
+    void add_segment(uint64_t id, const std::string& camera, int64_t start_us, int64_t end_us) {
+        const auto path = test_dir_ / "recordings" / (camera + "_" + std::to_string(id) + ".mp4");
+        std::ofstream(path) << "segment " << id;
+
+        SegmentInfo info;
+        info.segment_id = id;
+        info.camera_id = camera;
+        info.path = path.string();
+        info.start_time_us = start_us;
+        info.end_time_us = end_us;
+        info.size_bytes = std::filesystem::file_size(path);
+        ASSERT_TRUE(index_.add(info));
+    }
+
+    std::filesystem::path test_dir_;
+    SegmentIndex index_;
+    ClipProtectorConfig config_;
+};
+
+TEST_F(ClipProtectorTest, ProtectsAllCamerasOverlappingWindow) {
+    ClipProtector protector(index_, config_);
+
+    // 30 s on either side of the first minute boundary touches two segments per camera
+    const auto clip = protector.protect("incident_1", 30000000, 90000000);
+    ASSERT_TRUE(clip.has_value());
+    ASSERT_EQ(clip->segments.size(), 4u);
+
+    for (const ProtectedSegment& segment : clip->segments) {
+        // Whatever the filesystem supports, no method may move data here
+        EXPECT_NE(segment.method, ProtectionMethod::RangeCopy);
+        EXPECT_NE(segment.method, ProtectionMethod::BufferedCopy);
+    }
+    EXPECT_EQ(protector.stats().bytes_copied, 0u);
+    EXPECT_EQ(protector.stats().clips_protected, 1u);
+}
+
+TEST_F(ClipProtectorTest, PinningExcludesSegmentsFromEviction) {
+    config_.allow_reflink = false;
+    config_.allow_hard_link = false;
+    ClipProtector protector(index_, config_);
+
+    const auto clip = protector.protect("incident_2", 0, 1000);
+    ASSERT_TRUE(clip.has_value());
+    ASSERT_EQ(clip->segments.size(), 2u);
+    EXPECT_EQ(clip->segments[0].method, ProtectionMethod::IndexPin);
+
+    // Segment 1 (front) and 4 (rear) are pinned; the oldest evictable is 2
+    EXPECT_FALSE(index_.remove(1));
+    const auto candidate = index_.oldest_unpinned(0);
+    ASSERT_TRUE(candidate.has_value());
+    EXPECT_EQ(candidate->segment_id, 2u);
+
+    protector.release(*clip);
+    EXPECT_TRUE(index_.remove(1));
+}
+
+TEST_F(ClipProtectorTest, FallsBackToCopyWhenPinningDisabled) {
+    config_.allow_reflink = false;
+    config_.allow_hard_link = false;
+    config_.allow_pinning = false;
+    ClipProtector protector(index_, config_);
+
+    const auto clip = protector.protect("incident_3", 0, 1000);
+    ASSERT_TRUE(clip.has_value());
+    ASSERT_EQ(clip->segments.size(), 2u);
+
+    for (const ProtectedSegment& segment : clip->segments) {
+        EXPECT_TRUE(segment.method == ProtectionMethod::RangeCopy ||
+                    segment.method == ProtectionMethod::BufferedCopy);
+        EXPECT_TRUE(std::filesystem::exists(segment.protected_path));
+    }
+    EXPECT_GT(protector.stats().bytes_copied, 0u);
+}
+
+TEST_F(ClipProtectorTest, OpenSegmentIsPinnedUntilItCloses) {
+    // Front segment 7 is still being recorded when the incident is flagged
+    add_segment(7, "front", 180000000, 180000000);
+    const std::string path = index_.find(7)->path;
+    ClipProtector protector(index_, config_);
+
+    auto clip = protector.protect("incident_4", 170000000, 190000000, {7});
+    ASSERT_TRUE(clip.has_value());
+    ASSERT_EQ(clip->segments.size(), 3u);
+    const ProtectedSegment& open = clip->segments[2];
+    EXPECT_EQ(open.segment_id, 7u);
+    EXPECT_TRUE(open.open);
+    EXPECT_EQ(open.method, ProtectionMethod::IndexPin);
+    EXPECT_FALSE(index_.remove(7));
+
+    // Footage after the trigger keeps arriving
+    std::ofstream(path, std::ios::app) << " and everything after the trigger";
+    const uint64_t final_size = std::filesystem::file_size(path);
+    ASSERT_TRUE(index_.update(7, 239999999, final_size));
+
+    ASSERT_TRUE(protector.segment_closed(*clip, 7));
+    EXPECT_FALSE(clip->segments[2].open);
+    EXPECT_FALSE(protector.segment_closed(*clip, 7));
+    if (clip->segments[2].method == ProtectionMethod::IndexPin) {
+        EXPECT_FALSE(index_.remove(7));
+    } else {
+        EXPECT_EQ(std::filesystem::file_size(clip->segments[2].protected_path), final_size);
+    }
+
+    protector.release(*clip);
+    EXPECT_TRUE(index_.remove(7));
+}
+
+TEST_F(ClipProtectorTest, EmptyWindowProtectsNothing) {
+    ClipProtector protector(index_, config_);
+
+    const auto clip = protector.protect("quiet", 500000000, 600000000);
+    ASSERT_TRUE(clip.has_value());
+    EXPECT_TRUE(clip->segments.empty());
+}
+
+TEST(SegmentIndexTest, OverlapQueryFiltersByCamera) {
+    SegmentIndex index;
+    SegmentInfo front{1, "front", "/rec/1.mp4", 0, 59, 100, 0};
+    SegmentInfo rear{2, "rear", "/rec/2.mp4", 0, 59, 200, 0};
+    ASSERT_TRUE(index.add(front));
+    ASSERT_TRUE(index.add(rear));
+    EXPECT_FALSE(index.add(front));
+
+    EXPECT_EQ(index.overlapping("", 10, 20).size(), 2u);
+    EXPECT_EQ(index.overlapping("rear", 10, 20).size(), 1u);
+    EXPECT_TRUE(index.overlapping("front", 60, 120).empty());
+    EXPECT_EQ(index.total_bytes(), 300u);
+
+    ASSERT_TRUE(index.update(1, 119, 150));
+    EXPECT_EQ(index.overlapping("front", 60, 120).size(), 1u);
+    EXPECT_EQ(index.total_bytes(), 350u);
+}
+
+} // namespace test
+} // namespace dashcam
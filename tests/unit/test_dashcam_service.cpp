@@ -0,0 +1,333 @@
+#include <gtest/gtest.h>
+#include "grpc/dashcam_service_impl.h"
+
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dashcam {
+namespace test {
+
+namespace {
+
+size_t process_thread_count() {
+    size_t threads = 0;
+    for ([[maybe_unused]] const auto& entry : std::filesystem::directory_iterator("/proc/self/task")) {
+        ++threads;
+    }
+    return threads;
+}
+
+/**
+ * @brief Client side of one StreamStatus call, driven by the callback API
+ */
+class StatusClient final : public grpc::ClientReadReactor<DashcamStatus> {
+public:
+    explicit StatusClient(DashcamService::Stub& stub, bool delta_updates = false) {
+        request_.set_delta_updates(delta_updates);
+        stub.async()->StreamStatus(&context_, &request_, this);
+        StartRead(&status_);
+        StartCall();
+    }
+
+    void OnReadDone(bool ok) override {
+        if (!ok) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++updates_;
+            last_resolution_ = status_.current_resolution();
+            last_changed_fields_ = status_.changed_fields();
+        }
+        cv_.notify_all();
+        StartRead(&status_);
+    }
+
+    void OnDone(const grpc::Status& status) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_ = true;
+            code_ = status.error_code();
+        }
+        cv_.notify_all();
+    }
+
+    bool wait_for_updates(uint64_t count) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, std::chrono::seconds(10), [&] { return updates_ >= count || done_; }) &&
+               updates_ >= count;
+    }
+
+    bool wait_done() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, std::chrono::seconds(10), [&] { return done_; });
+    }
+
+    void cancel() { context_.TryCancel(); }
+
+    grpc::StatusCode code() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return code_;
+    }
+
+    uint32_t last_changed_fields() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return last_changed_fields_;
+    }
+
+    std::string last_resolution() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return last_resolution_;
+    }
+
+private:
+    grpc::ClientContext context_;
+    GetStatusRequest request_;
+    DashcamStatus status_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    uint64_t updates_ = 0;
+    std::string last_resolution_;
+    uint32_t last_changed_fields_ = 0;
+    bool done_ = false;
+    grpc::StatusCode code_ = grpc::StatusCode::UNKNOWN;
+};
+
+} // namespace
+
+class DashcamServiceTest : public ::testing::Test {
+protected:
+    void start(std::chrono::milliseconds interval, std::shared_ptr<const LiveStatus> live_status = nullptr) {
+        DashcamServiceConfig config;
+        config.status.interval = interval;
+        service_ = std::make_unique<DashcamServiceImpl>(
+            nullptr, std::move(live_status), nullptr, config);
+
+        grpc::ServerBuilder builder;
+        int port = 0;
+        builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+        builder.RegisterService(service_.get());
+        server_ = builder.BuildAndStart();
+        ASSERT_NE(server_, nullptr);
+        address_ = "127.0.0.1:" + std::to_string(port);
+    }
+
+    std::unique_ptr<DashcamService::Stub> connect(int channel_tag = 0) {
+        // Distinct arguments give each channel its own connection
+        grpc::ChannelArguments args;
+        args.SetInt("dashcam.test_channel", channel_tag);
+        return DashcamService::NewStub(
+            grpc::CreateCustomChannel(address_, grpc::InsecureChannelCredentials(), args));
+    }
+
+    void TearDown() override {
+        if (server_) {
+            service_->begin_shutdown();
+            server_->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(1));
+        }
+    }
+
+    std::unique_ptr<DashcamServiceImpl> service_;
+    std::unique_ptr<grpc::Server> server_;
+    std::string address_;
+};
+
+TEST_F(DashcamServiceTest, UnaryCallsAnswerThroughCallbackReactors) {
+    start(std::chrono::milliseconds(100));
+    auto stub = connect();
+
+    grpc::ClientContext context;
+    GetStatusResponse response;
+    ASSERT_TRUE(stub->GetStatus(&context, GetStatusRequest(), &response).ok());
+    EXPECT_TRUE(response.success());
+    EXPECT_EQ(response.status().current_resolution(), "1920x1080");
+    // No storage accounting attached: a placeholder, not a full card
+    EXPECT_EQ(response.status().storage_available_bytes(), 1000000000u);
+
+    grpc::ClientContext config_context;
+    GetConfigResponse config;
+    ASSERT_TRUE(stub->GetConfig(&config_context, GetConfigRequest(), &config).ok());
+    EXPECT_EQ(config.config().target_fps(), 30u);
+    // No pipeline attached: nothing captures audio
+    EXPECT_FALSE(config.config().audio_enabled());
+}
+
+TEST_F(DashcamServiceTest, GetStatusReportsLiveStatus) {
+    auto live_status = std::make_shared<LiveStatus>();
+    live_status->publish(0, CaptureStatus{1234, 25, true, true});
+    start(std::chrono::milliseconds(100), live_status);
+    auto stub = connect();
+
+    grpc::ClientContext context;
+    GetStatusResponse response;
+    ASSERT_TRUE(stub->GetStatus(&context, GetStatusRequest(), &response).ok());
+    EXPECT_TRUE(response.status().recording());
+    EXPECT_EQ(response.status().frames_captured(), 1234u);
+    EXPECT_EQ(response.status().current_fps(), 25u);
+
+    grpc::ClientContext config_context;
+    GetConfigResponse config;
+    ASSERT_TRUE(stub->GetConfig(&config_context, GetConfigRequest(), &config).ok());
+    EXPECT_TRUE(config.config().audio_enabled());
+
+    // The final status carries the same counters, with recording already off
+    grpc::ClientContext stop_context;
+    StopRecordingResponse stopped;
+    ASSERT_TRUE(stub->StopRecording(&stop_context, StopRecordingRequest(), &stopped).ok());
+    EXPECT_FALSE(stopped.final_status().recording());
+    EXPECT_EQ(stopped.final_status().frames_captured(), 1234u);
+    EXPECT_EQ(stopped.final_status().current_resolution(), "1920x1080");
+}
+
+TEST_F(DashcamServiceTest, StateChangesReachStreamsBeforeTheNextTick) {
+    start(std::chrono::seconds(30));
+    auto stub = connect();
+    StatusClient subscriber(*stub);
+    ASSERT_TRUE(subscriber.wait_for_updates(1));
+
+    grpc::ClientContext context;
+    StartRecordingResponse response;
+    ASSERT_TRUE(stub->StartRecording(&context, StartRecordingRequest(), &response).ok());
+    ASSERT_TRUE(subscriber.wait_for_updates(2));
+    subscriber.cancel();
+    ASSERT_TRUE(subscriber.wait_done());
+}
+
+TEST_F(DashcamServiceTest, StreamsOptInToDeltaUpdates) {
+    auto live_status = std::make_shared<LiveStatus>();
+    start(std::chrono::seconds(30), live_status);
+    auto stub = connect();
+    StatusClient subscriber(*stub, true);
+    ASSERT_TRUE(subscriber.wait_for_updates(1));
+    EXPECT_EQ(subscriber.last_changed_fields(), 0u);
+    EXPECT_EQ(subscriber.last_resolution(), "1920x1080");
+
+    live_status->publish(0, CaptureStatus{900, 30, true});
+    grpc::ClientContext context;
+    StartRecordingResponse response;
+    ASSERT_TRUE(stub->StartRecording(&context, StartRecordingRequest(), &response).ok());
+    ASSERT_TRUE(subscriber.wait_for_updates(2));
+
+    // Only what changed: the resolution is not resent
+    EXPECT_NE(subscriber.last_changed_fields(), 0u);
+    EXPECT_TRUE(subscriber.last_resolution().empty());
+    subscriber.cancel();
+    ASSERT_TRUE(subscriber.wait_done());
+}
+
+TEST_F(DashcamServiceTest, StreamRunsUntilClientCancels) {
+    start(std::chrono::milliseconds(5));
+    auto stub = connect();
+
+    StatusClient subscriber(*stub);
+    ASSERT_TRUE(subscriber.wait_for_updates(5));
+    EXPECT_EQ(subscriber.last_resolution(), "1920x1080");
+    EXPECT_EQ(service_->status_stats().subscribers, 1u);
+
+    subscriber.cancel();
+    ASSERT_TRUE(subscriber.wait_done());
+    EXPECT_EQ(subscriber.code(), grpc::StatusCode::CANCELLED);
+
+    for (int i = 0; i < 1000 && service_->status_stats().subscribers > 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(service_->status_stats().subscribers, 0u);
+}
+
+TEST_F(DashcamServiceTest, ShutdownFinishesOpenStreams) {
+    start(std::chrono::milliseconds(20));
+    auto stub = connect();
+    StatusClient subscriber(*stub);
+    ASSERT_TRUE(subscriber.wait_for_updates(1));
+
+    const auto begin = std::chrono::steady_clock::now();
+    service_->begin_shutdown();
+    server_->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(5));
+    server_.reset();
+
+    // Ended by the service, well before the deadline
+    EXPECT_LT(std::chrono::steady_clock::now() - begin, std::chrono::seconds(2));
+    ASSERT_TRUE(subscriber.wait_done());
+    EXPECT_EQ(subscriber.code(), grpc::StatusCode::OK);
+}
+
+TEST_F(DashcamServiceTest, StreamPreviewSendsPublishedFrames) {
+    start(std::chrono::milliseconds(100));
+    auto stub = connect();
+
+    {
+        grpc::ClientContext context;
+        auto reader = stub->StreamPreview(&context, StreamPreviewRequest{});
+        PreviewFrame frame;
+        EXPECT_FALSE(reader->Read(&frame));
+        EXPECT_EQ(reader->Finish().error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+    }
+
+    grpc::ClientContext context;
+    StreamPreviewRequest request;
+    request.set_camera_id("front");
+    auto reader = stub->StreamPreview(&context, request);
+    for (int i = 0; i < 1000 && service_->preview_stats().subscribers == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(service_->preview_stats().subscribers, 1u);
+
+    auto pool = FrameBufferPool::create(FrameBufferPoolConfig{});
+    FrameBuffer buffer = pool->acquire();
+    buffer.resize(3);
+    buffer.data()[0] = 'j';
+    buffer.data()[1] = 'p';
+    buffer.data()[2] = 'g';
+    PreviewFrameInfo info;
+    info.camera_id = "front";
+    info.timestamp_ms = 1234;
+    info.keyframe = true;
+    info.width = 640;
+    info.height = 360;
+    service_->publish_preview(info, std::move(buffer));
+
+    PreviewFrame frame;
+    ASSERT_TRUE(reader->Read(&frame));
+    EXPECT_EQ(frame.data(), "jpg");
+    EXPECT_EQ(frame.timestamp_ms(), 1234);
+    EXPECT_TRUE(frame.keyframe());
+    context.TryCancel();
+    EXPECT_EQ(reader->Finish().error_code(), grpc::StatusCode::CANCELLED);
+}
+
+TEST_F(DashcamServiceTest, ThousandStreamsDoNotPinThreads) {
+    constexpr size_t STREAMS = 1000;
+    constexpr int CHANNELS = 4;
+    start(std::chrono::milliseconds(50));
+
+    std::vector<std::unique_ptr<DashcamService::Stub>> stubs;
+    for (int i = 0; i < CHANNELS; ++i) {
+        stubs.push_back(connect(i));
+    }
+    std::vector<std::unique_ptr<StatusClient>> subscribers;
+    subscribers.reserve(STREAMS);
+    for (size_t i = 0; i < STREAMS; ++i) {
+        subscribers.push_back(std::make_unique<StatusClient>(*stubs[i % CHANNELS]));
+    }
+    for (auto& subscriber : subscribers) {
+        ASSERT_TRUE(subscriber->wait_for_updates(2));
+    }
+    EXPECT_EQ(service_->status_stats().subscribers, STREAMS);
+
+    // A thread-per-stream server would need over a thousand here; this
+    // process holds both ends and still stays small
+    EXPECT_LT(process_thread_count(), 100u);
+
+    for (auto& subscriber : subscribers) {
+        subscriber->cancel();
+    }
+    for (auto& subscriber : subscribers) {
+        ASSERT_TRUE(subscriber->wait_done());
+    }
+}
+
+} // namespace test
+} // namespace dashcam
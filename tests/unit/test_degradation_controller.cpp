@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include "dashcam/storage/degradation_controller.h"
+
+#include <vector>
+
+namespace dashcam {
+namespace test {
+
+namespace {
+
+constexpr uint64_t PLENTY_FREE = 64ull << 30;
+
+StoragePressure pressure(uint32_t queue_depth, uint64_t free_bytes = PLENTY_FREE) {
+    StoragePressure result;
+    result.queue_depth = queue_depth;
+    result.queue_capacity = 100;
+    result.free_bytes = free_bytes;
+    return result;
+}
+
+} // namespace
+
+TEST(DegradationControllerTest, EscalatesImmediatelyAndEmitsEvents) {
+    std::vector<LogEvent> events;
+    DegradationController controller(DegradationConfig{},
+                                     [&](const LogEvent& event) { events.push_back(event); });
+    const auto now = DegradationController::Clock::now();
+
+    EXPECT_EQ(controller.update(pressure(10), now), DegradationTier::Normal);
+    EXPECT_EQ(controller.update(pressure(60), now), DegradationTier::DropPreview);
+    // Low free space alone jumps straight to the most severe tier
+    EXPECT_EQ(controller.update(pressure(10, 100ull << 20), now),
+              DegradationTier::EmergencyEvict);
+
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(events[1].event_type(), "storage_degraded");
+    EXPECT_EQ(events[1].metadata().at("from_tier"), "drop_preview");
+    EXPECT_EQ(events[1].metadata().at("to_tier"), "emergency_evict");
+
+    const DegradationStats stats = controller.stats();
+    EXPECT_EQ(stats.escalations, 2u);
+    EXPECT_EQ(stats.tier_entries[static_cast<size_t>(DegradationTier::EmergencyEvict)], 1u);
+    EXPECT_EQ(controller.emergency_eviction_bytes(pressure(10, 100ull << 20)),
+              (2ull << 30) - (100ull << 20));
+}
+
+TEST(DegradationControllerTest, RecoversOneTierAtATimeAfterDwell) {
+    DegradationConfig config;
+    config.min_dwell = std::chrono::milliseconds(1000);
+    DegradationController controller(config, nullptr);
+    auto now = DegradationController::Clock::now();
+
+    controller.update(pressure(95), now);
+    ASSERT_EQ(controller.tier(), DegradationTier::EmergencyEvict);
+
+    // Pressure gone, but the dwell has not elapsed
+    EXPECT_EQ(controller.update(pressure(0), now + std::chrono::milliseconds(10)),
+              DegradationTier::EmergencyEvict);
+
+    now += std::chrono::milliseconds(1000);
+    EXPECT_EQ(controller.update(pressure(0), now), DegradationTier::KeyframesOnly);
+    now += std::chrono::milliseconds(1000);
+    EXPECT_EQ(controller.update(pressure(0), now), DegradationTier::DropPreview);
+    now += std::chrono::milliseconds(1000);
+    EXPECT_EQ(controller.update(pressure(0), now), DegradationTier::Normal);
+    EXPECT_EQ(controller.stats().recoveries, 3u);
+}
+
+TEST(DegradationControllerTest, RecoveryRequiresMargin) {
+    DegradationConfig config;
+    config.min_dwell = std::chrono::milliseconds(0);
+    DegradationController controller(config, nullptr);
+    const auto now = DegradationController::Clock::now();
+
+    controller.update(pressure(55), now);
+    ASSERT_EQ(controller.tier(), DegradationTier::DropPreview);
+
+    // Below the 50% threshold but not below 50% * 0.8
+    EXPECT_EQ(controller.update(pressure(45), now), DegradationTier::DropPreview);
+    EXPECT_EQ(controller.update(pressure(39), now), DegradationTier::Normal);
+}
+
+TEST(DegradationControllerTest, FrontCameraIsNeverShed) {
+    DegradationController controller(DegradationConfig{}, nullptr);
+    const auto now = DegradationController::Clock::now();
+
+    EXPECT_TRUE(controller.admit_preview_frame());
+    EXPECT_TRUE(controller.admit_camera_frame("rear", false));
+
+    controller.update(pressure(80), now);
+    ASSERT_EQ(controller.tier(), DegradationTier::KeyframesOnly);
+
+    EXPECT_FALSE(controller.admit_preview_frame());
+    EXPECT_FALSE(controller.admit_camera_frame("rear", false));
+    EXPECT_TRUE(controller.admit_camera_frame("rear", true));
+    EXPECT_TRUE(controller.admit_camera_frame("front", false));
+
+    const DegradationStats stats = controller.stats();
+    EXPECT_EQ(stats.preview_frames_shed, 1u);
+    EXPECT_EQ(stats.camera_frames_shed, 1u);
+}
+
+} // namespace test
+} // namespace dashcam
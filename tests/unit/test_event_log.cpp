@@ -0,0 +1,246 @@
+#include <gtest/gtest.h>
+#include "dashcam/storage/event_log.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace dashcam {
+namespace test {
+
+namespace {
+
+int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+LogEvent make_event(int64_t timestamp_ms,
+                    const std::string& type,
+                    const std::string& camera,
+                    int n) {
+    LogEvent event;
+    event.set_timestamp_ms(timestamp_ms);
+    event.set_event_type(type);
+    event.set_camera_id(camera);
+    event.set_message("event " + std::to_string(n));
+    (*event.mutable_metadata())["n"] = std::to_string(n);
+    return event;
+}
+
+} // namespace
+
+class EventLogTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_dir_ = std::filesystem::temp_directory_path() / "dashcam_event_log_test";
+        std::filesystem::remove_all(test_dir_);
+        config_.directory = test_dir_.string();
+        config_.sync_blocks = false;
+        config_.max_events_limit = 100000;
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(test_dir_);
+    }
+
+    std::vector<LogEvent> read_all(const EventLog& log, EventLogQuery query) {
+        std::vector<LogEvent> events;
+        while (true) {
+            EventLogPage page = log.query(query);
+            for (LogEvent& event : page.events) {
+                events.push_back(std::move(event));
+            }
+            if (!page.has_more) {
+                return events;
+            }
+            query.resume = page.next;
+        }
+    }
+
+    std::vector<std::filesystem::path> files() const {
+        std::vector<std::filesystem::path> result;
+        for (const auto& entry : std::filesystem::directory_iterator(test_dir_)) {
+            result.push_back(entry.path());
+        }
+        return result;
+    }
+
+    std::filesystem::path test_dir_;
+    EventLogConfig config_;
+};
+
+TEST_F(EventLogTest, EventsSurviveReopen) {
+    const int64_t base = now_ms() - 60000;
+    std::vector<LogEvent> written;
+    {
+        EventLog log(config_);
+        ASSERT_TRUE(log.open());
+        for (int n = 0; n < 10000; ++n) {
+            const std::string type = n % 50 == 0 ? "incident" : "segment_written";
+            written.push_back(make_event(base + n * 5, type, n % 2 == 0 ? "front" : "rear", n));
+            ASSERT_TRUE(log.append(written.back()));
+        }
+        ASSERT_TRUE(log.flush());
+
+        const EventLogStats stats = log.stats();
+        EXPECT_EQ(stats.blocks_written, 3u);
+        // Delta times and dictionaries beat per-event protobuf
+        EXPECT_LT(stats.bytes_written, stats.raw_bytes * 2 / 3);
+    }
+
+    EventLog log(config_);
+    ASSERT_TRUE(log.open());
+    EventLogQuery query;
+    query.max_events = 777;
+    const std::vector<LogEvent> read = read_all(log, query);
+    ASSERT_EQ(read.size(), written.size());
+    for (size_t i = 0; i < read.size(); ++i) {
+        EXPECT_EQ(read[i].SerializeAsString(), written[i].SerializeAsString()) << i;
+    }
+}
+
+TEST_F(EventLogTest, QueriesSkipBlocksAndReadOnlyNeededColumns) {
+    config_.block_events = 100;
+    EventLog log(config_);
+    ASSERT_TRUE(log.open());
+    const int64_t base = now_ms() - 60000;
+    for (int n = 0; n < 1000; ++n) {
+        // One incident, in the eighth block
+        const std::string type =
+            n == 750 ? "incident" : (n % 2 == 0 ? "segment_written" : "frame_dropped");
+        ASSERT_TRUE(log.append(make_event(base + n, type, "front", n)));
+    }
+    ASSERT_TRUE(log.flush());
+    ASSERT_EQ(log.stats().blocks_written, 10u);
+
+    EventLogQuery query;
+    query.event_types = {"incident"};
+    EventLogPage page = log.query(query);
+    ASSERT_EQ(page.events.size(), 1u);
+    EXPECT_EQ(page.events[0].timestamp_ms(), base + 750);
+    EventLogStats stats = log.stats();
+    EXPECT_EQ(stats.blocks_skipped, 9u);
+    EXPECT_EQ(stats.blocks_read, 1u);
+    EXPECT_EQ(stats.columns_read, 5u);
+
+    // A camera no block has: every block is ruled out by its header
+    query.event_types.clear();
+    query.camera_id = "rear";
+    EXPECT_TRUE(log.query(query).events.empty());
+    EXPECT_EQ(log.stats().columns_read, 5u);
+
+    // Time range inside the third block; the filter column decides, the
+    // payload of a block without matches is never read
+    query.camera_id.clear();
+    query.start_ms = base + 210;
+    query.end_ms = base + 220;
+    query.event_types = {"frame_dropped"};
+    page = log.query(query);
+    ASSERT_EQ(page.events.size(), 5u);
+    EXPECT_EQ(page.events[0].message(), "event 211");
+    stats = log.stats();
+    EXPECT_EQ(stats.blocks_read, 2u);
+    EXPECT_EQ(stats.columns_read, 10u);
+
+    query.event_types = {"segment_written"};
+    query.start_ms = base + 251;
+    query.end_ms = base + 252;
+    query.camera_id = "front";
+    EXPECT_EQ(log.query(query).events.size(), 0u);
+    // Time, type; no camera, message or metadata
+    EXPECT_EQ(log.stats().columns_read, 12u);
+}
+
+TEST_F(EventLogTest, PagesAcrossBlocksAndBufferedEvents) {
+    config_.block_events = 16;
+    EventLog log(config_);
+    ASSERT_TRUE(log.open());
+    // Same millisecond throughout, spread over written blocks and the buffer
+    const int64_t t = now_ms();
+    for (int n = 0; n < 100; ++n) {
+        ASSERT_TRUE(log.append(make_event(t, "tick", "front", n)));
+        if (n == 59) {
+            ASSERT_TRUE(log.flush());
+        }
+    }
+
+    EventLogQuery query;
+    query.max_events = 7;
+    const std::vector<LogEvent> read = read_all(log, query);
+    ASSERT_EQ(read.size(), 100u);
+    for (int n = 0; n < 100; ++n) {
+        EXPECT_EQ(read[n].message(), "event " + std::to_string(n));
+    }
+}
+
+TEST_F(EventLogTest, LateEventsAreSortedIntoTheirBlock) {
+    EventLog log(config_);
+    ASSERT_TRUE(log.open());
+    const int64_t t = now_ms();
+    ASSERT_TRUE(log.append(make_event(t, "tick", "front", 0)));
+    ASSERT_TRUE(log.append(make_event(t + 20, "tick", "front", 2)));
+    ASSERT_TRUE(log.append(make_event(t + 10, "tick", "front", 1)));
+    ASSERT_TRUE(log.flush());
+
+    EventLogQuery query;
+    query.start_ms = t + 5;
+    const EventLogPage page = log.query(query);
+    ASSERT_EQ(page.events.size(), 2u);
+    EXPECT_EQ(page.events[0].message(), "event 1");
+    EXPECT_EQ(page.events[1].message(), "event 2");
+}
+
+TEST_F(EventLogTest, TornBlockIsCutAtOpen) {
+    const int64_t t = now_ms();
+    {
+        EventLog log(config_);
+        ASSERT_TRUE(log.open());
+        for (int n = 0; n < 10; ++n) {
+            ASSERT_TRUE(log.append(make_event(t + n, "tick", "front", n)));
+        }
+    }
+    const std::vector<std::filesystem::path> paths = files();
+    ASSERT_EQ(paths.size(), 1u);
+    const uint64_t intact = std::filesystem::file_size(paths[0]);
+    {
+        // A crash partway through the next block
+        std::ofstream out(paths[0], std::ios::binary | std::ios::app);
+        out << std::string(100, '\x42');
+    }
+
+    EventLog log(config_);
+    ASSERT_TRUE(log.open());
+    EXPECT_EQ(log.stats().repaired_files, 1u);
+    EXPECT_EQ(std::filesystem::file_size(paths[0]), intact);
+    ASSERT_TRUE(log.append(make_event(t + 10, "tick", "front", 10)));
+    ASSERT_TRUE(log.flush());
+    EXPECT_EQ(read_all(log, EventLogQuery{}).size(), 11u);
+}
+
+TEST_F(EventLogTest, ExpiredPartitionsAreDeleted) {
+    config_.partition = std::chrono::hours(1);
+    config_.retention = std::chrono::hours(3);
+    EventLog log(config_);
+    ASSERT_TRUE(log.open());
+    const int64_t hour = 3600 * 1000;
+    const int64_t t = now_ms();
+    for (int h = 6; h >= 0; --h) {
+        ASSERT_TRUE(log.append(make_event(t - h * hour, "tick", "front", h)));
+    }
+    ASSERT_TRUE(log.flush());
+
+    const EventLogStats stats = log.stats();
+    EXPECT_EQ(stats.partitions + stats.partitions_removed, 7u);
+    EXPECT_GE(stats.partitions_removed, 3u);
+    EXPECT_EQ(files().size(), stats.partitions);
+    for (const LogEvent& event : read_all(log, EventLogQuery{})) {
+        EXPECT_GT(event.timestamp_ms(), t - 4 * hour);
+    }
+}
+
+} // namespace test
+} // namespace dashcam
@@ -0,0 +1,311 @@
+#include <gtest/gtest.h>
+#include "grpc/event_publisher.h"
+#include "dashcam.grpc.pb.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dashcam {
+namespace test {
+
+namespace {
+
+/**
+ * @brief StreamEvents alone, answered by a publisher under test
+ */
+class EventStreamingService final
+    : public DashcamEventService::WithRawCallbackMethod_StreamEvents<DashcamEventService::Service> {
+public:
+    explicit EventStreamingService(EventPublisher& publisher) : publisher_(publisher) {}
+
+    grpc::ServerWriteReactor<grpc::ByteBuffer>* StreamEvents(grpc::CallbackServerContext* context,
+                                                            const grpc::ByteBuffer* /*request*/) override {
+        return publisher_.subscribe(context);
+    }
+
+private:
+    EventPublisher& publisher_;
+};
+
+class EventReader final : public grpc::ClientReadReactor<LogEvent> {
+public:
+    EventReader(DashcamEventService::Stub& stub, bool reading) : reading_(reading) {
+        stub.async()->StreamEvents(&context_, &request_, this);
+        if (reading_) {
+            StartRead(&event_);
+        }
+        StartCall();
+    }
+
+    // The call must end before the reactor goes away
+    ~EventReader() override {
+        context_.TryCancel();
+        wait_done();
+    }
+
+    void start_reading() {
+        StartRead(&event_);
+    }
+
+    void OnReadDone(bool ok) override {
+        if (!ok) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            events_.push_back(event_);
+        }
+        cv_.notify_all();
+        StartRead(&event_);
+    }
+
+    void OnDone(const grpc::Status& status) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_ = true;
+            code_ = status.error_code();
+        }
+        cv_.notify_all();
+    }
+
+    bool wait_for_events(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, std::chrono::seconds(10), [&] { return events_.size() >= count || done_; }) &&
+               events_.size() >= count;
+    }
+
+    bool wait_done() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, std::chrono::seconds(10), [&] { return done_; });
+    }
+
+    std::vector<LogEvent> events() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return events_;
+    }
+
+    grpc::StatusCode code() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return code_;
+    }
+
+private:
+    const bool reading_;
+    grpc::ClientContext context_;
+    GetEventsRequest request_;
+    LogEvent event_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<LogEvent> events_;
+    bool done_ = false;
+    grpc::StatusCode code_ = grpc::StatusCode::UNKNOWN;
+};
+
+LogEvent make_event(int64_t timestamp_ms, size_t payload_bytes = 0) {
+    LogEvent event;
+    event.set_timestamp_ms(timestamp_ms);
+    event.set_event_type("frame_dropped");
+    event.set_message(std::string(payload_bytes, 'x'));
+    event.set_camera_id("front");
+    return event;
+}
+
+} // namespace
+
+class EventPublisherTest : public ::testing::Test {
+protected:
+    void start(const EventPublisherConfig& config) {
+        publisher_ = std::make_unique<EventPublisher>(config);
+        service_ = std::make_unique<EventStreamingService>(*publisher_);
+
+        grpc::ServerBuilder builder;
+        int port = 0;
+        builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+        builder.RegisterService(service_.get());
+        server_ = builder.BuildAndStart();
+        ASSERT_NE(server_, nullptr);
+        address_ = "127.0.0.1:" + std::to_string(port);
+        stub_ = connect(0);
+    }
+
+    std::unique_ptr<DashcamEventService::Stub> connect(int channel_tag) {
+        // Own connection per tag, so one stalled stream cannot block another's
+        // window. Without BDP probing the client's window stays small and a
+        // client that does not read stalls the server's writes quickly.
+        grpc::ChannelArguments args;
+        args.SetInt("dashcam.test_channel", channel_tag);
+        args.SetInt(GRPC_ARG_HTTP2_BDP_PROBE, 0);
+        return DashcamEventService::NewStub(
+            grpc::CreateCustomChannel(address_, grpc::InsecureChannelCredentials(), args));
+    }
+
+    void wait_for_subscribers(uint64_t count) {
+        for (int i = 0; i < 1000 && publisher_->stats().subscribers != count; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ASSERT_EQ(publisher_->stats().subscribers, count);
+    }
+
+    void TearDown() override {
+        if (publisher_) {
+            publisher_->stop();
+        }
+        if (server_) {
+            server_->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(1));
+        }
+    }
+
+    std::unique_ptr<EventPublisher> publisher_;
+    std::unique_ptr<EventStreamingService> service_;
+    std::unique_ptr<grpc::Server> server_;
+    std::string address_;
+    std::unique_ptr<DashcamEventService::Stub> stub_;
+};
+
+TEST_F(EventPublisherTest, EveryStreamGetsEveryEventInOrder) {
+    EventPublisherConfig config;
+    start(config);
+    std::vector<std::unique_ptr<EventReader>> readers;
+    for (int i = 0; i < 3; ++i) {
+        readers.push_back(std::make_unique<EventReader>(*stub_, true));
+    }
+    wait_for_subscribers(3);
+
+    // Two publishing threads; each stream must still see one global order
+    std::thread other([this] {
+        for (int64_t t = 1000; t < 1050; ++t) {
+            publisher_->publish(make_event(t));
+        }
+    });
+    for (int64_t t = 0; t < 50; ++t) {
+        publisher_->publish(make_event(t));
+    }
+    other.join();
+
+    std::vector<int64_t> first_order;
+    for (auto& reader : readers) {
+        ASSERT_TRUE(reader->wait_for_events(100));
+        std::vector<int64_t> order;
+        for (const LogEvent& event : reader->events()) {
+            order.push_back(event.timestamp_ms());
+        }
+        if (first_order.empty()) {
+            first_order = order;
+        }
+        EXPECT_EQ(order, first_order);
+    }
+    EXPECT_EQ(publisher_->stats().dropped, 0u);
+}
+
+TEST_F(EventPublisherTest, SlowStreamDropsWithAGapMarker) {
+    constexpr int64_t EVENTS = 200;
+    EventPublisherConfig config;
+    config.queue_capacity = 4;
+    start(config);
+
+    auto slow_stub = connect(1);
+    EventReader fast(*stub_, true);
+    EventReader slow(*slow_stub, false);
+    wait_for_subscribers(2);
+
+    // Large events fill the slow client's flow-control window quickly; the
+    // pace is set by the fast client, which therefore never loses any
+    for (int64_t t = 0; t < EVENTS; ++t) {
+        publisher_->publish(make_event(t, 64 * 1024));
+        ASSERT_TRUE(fast.wait_for_events(t + 1));
+    }
+
+    // The publisher never waited for the slow stream, and held at most its queue
+    const EventPublisherStats stats = publisher_->stats();
+    EXPECT_GT(stats.dropped, 0u);
+    bool slow_seen = false;
+    for (const SubscriberStats& subscriber : publisher_->subscriber_stats()) {
+        EXPECT_LE(subscriber.queued, config.queue_capacity);
+        EXPECT_FALSE(subscriber.peer.empty());
+        slow_seen = slow_seen || subscriber.dropped > 0;
+    }
+    EXPECT_TRUE(slow_seen);
+
+    // Once it drains there is room again; the next event is preceded by a marker
+    slow.start_reading();
+    for (int i = 0; i < 1000 && publisher_->subscriber_stats().size() == 2; ++i) {
+        bool drained = true;
+        for (const SubscriberStats& subscriber : publisher_->subscriber_stats()) {
+            drained = drained && subscriber.queued == 0 && subscriber.lag.count() == 0;
+        }
+        if (drained) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    publisher_->publish(make_event(EVENTS));
+
+    uint64_t received = 0;
+    uint64_t reported_dropped = 0;
+    ASSERT_TRUE(fast.wait_for_events(EVENTS + 1));
+    for (int i = 0; i < 1000; ++i) {
+        const std::vector<LogEvent> events = slow.events();
+        if (!events.empty() && events.back().timestamp_ms() == EVENTS) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    const std::vector<LogEvent> events = slow.events();
+    ASSERT_FALSE(events.empty());
+    EXPECT_EQ(events.back().timestamp_ms(), EVENTS);
+    int64_t last = -1;
+    for (const LogEvent& event : events) {
+        if (event.event_type() == EVENTS_DROPPED_EVENT_TYPE) {
+            reported_dropped += std::stoull(event.metadata().at("dropped"));
+            continue;
+        }
+        EXPECT_GT(event.timestamp_ms(), last);
+        last = event.timestamp_ms();
+        ++received;
+    }
+    // Every event is either delivered or accounted for by a marker
+    EXPECT_EQ(received + reported_dropped, static_cast<uint64_t>(EVENTS + 1));
+    EXPECT_EQ(reported_dropped, publisher_->stats().dropped);
+    EXPECT_GE(publisher_->stats().gaps, 1u);
+}
+
+TEST_F(EventPublisherTest, StalledStreamIsDisconnected) {
+    EventPublisherConfig config;
+    config.queue_capacity = 4;
+    config.max_write_stall = std::chrono::milliseconds(100);
+    start(config);
+
+    EventReader stalled(*stub_, false);
+    wait_for_subscribers(1);
+    for (int64_t t = 0; t < 100; ++t) {
+        publisher_->publish(make_event(t, 64 * 1024));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    publisher_->publish(make_event(100));
+
+    stalled.start_reading();
+    ASSERT_TRUE(stalled.wait_done());
+    EXPECT_EQ(stalled.code(), grpc::StatusCode::CANCELLED);
+    EXPECT_EQ(publisher_->stats().disconnected, 1u);
+    wait_for_subscribers(0);
+}
+
+TEST_F(EventPublisherTest, StopFinishesOpenAndLaterStreams) {
+    EventPublisherConfig config;
+    start(config);
+
+    EventReader open(*stub_, true);
+    wait_for_subscribers(1);
+    publisher_->stop();
+    ASSERT_TRUE(open.wait_done());
+    EXPECT_EQ(open.code(), grpc::StatusCode::OK);
+
+    EventReader late(*stub_, true);
+    ASSERT_TRUE(late.wait_done());
+    EXPECT_EQ(late.code(), grpc::StatusCode::OK);
+}
+
+} // namespace test
+} // namespace dashcam
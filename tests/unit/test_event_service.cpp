@@ -0,0 +1,211 @@
+#include <gtest/gtest.h>
+#include "grpc/event_service_impl.h"
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dashcam {
+namespace test {
+
+namespace {
+
+LogEvent make_event(int64_t timestamp_ms, const std::string& type, const std::string& camera) {
+    LogEvent event;
+    event.set_timestamp_ms(timestamp_ms);
+    event.set_event_type(type);
+    event.set_camera_id(camera);
+    return event;
+}
+
+} // namespace
+
+class DashcamEventServiceTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        start_server(nullptr);
+    }
+
+    void start_server(std::shared_ptr<EventLog> log) {
+        TearDown();
+        service_ = std::make_unique<DashcamEventServiceImpl>(std::move(log));
+
+        grpc::ServerBuilder builder;
+        int port = 0;
+        builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+        builder.RegisterService(service_.get());
+        server_ = builder.BuildAndStart();
+        ASSERT_NE(server_, nullptr);
+        stub_ = DashcamEventService::NewStub(grpc::CreateChannel(
+            "127.0.0.1:" + std::to_string(port), grpc::InsecureChannelCredentials()));
+    }
+
+    void TearDown() override {
+        if (!server_) {
+            return;
+        }
+        service_->begin_shutdown();
+        server_->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(1));
+        server_.reset();
+    }
+
+    grpc::Status get_events(const GetEventsRequest& request, GetEventsResponse* response) {
+        grpc::ClientContext context;
+        return stub_->GetEvents(&context, request, response);
+    }
+
+    std::unique_ptr<DashcamEventServiceImpl> service_;
+    std::unique_ptr<grpc::Server> server_;
+    std::unique_ptr<DashcamEventService::Stub> stub_;
+};
+
+TEST_F(DashcamEventServiceTest, GetEventsPagesThroughTheRange) {
+    for (int64_t t = 0; t < 100; ++t) {
+        service_->record(make_event(t, t % 4 == 0 ? "incident" : "tick", "front"));
+    }
+
+    GetEventsRequest request;
+    request.set_start_timestamp_ms(10);
+    request.set_end_timestamp_ms(90);
+    request.add_event_types("incident");
+    request.set_max_events(8);
+
+    std::vector<int64_t> seen;
+    int pages = 0;
+    while (true) {
+        GetEventsResponse response;
+        ASSERT_TRUE(get_events(request, &response).ok());
+        ASSERT_TRUE(response.success());
+        ++pages;
+        for (const LogEvent& event : response.events()) {
+            seen.push_back(event.timestamp_ms());
+        }
+        if (!response.has_more()) {
+            EXPECT_TRUE(response.next_page_token().empty());
+            break;
+        }
+        request.set_page_token(response.next_page_token());
+    }
+
+    // 12, 16, ..., 88
+    EXPECT_EQ(pages, 3);
+    ASSERT_EQ(seen.size(), 20u);
+    EXPECT_EQ(seen.front(), 12);
+    EXPECT_EQ(seen.back(), 88);
+}
+
+TEST_F(DashcamEventServiceTest, GetEventsRejectsBadArguments) {
+    GetEventsRequest request;
+    GetEventsResponse response;
+    request.set_start_timestamp_ms(100);
+    request.set_end_timestamp_ms(50);
+    EXPECT_EQ(get_events(request, &response).error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+
+    request.set_end_timestamp_ms(0);
+    request.set_page_token("not-a-token");
+    EXPECT_EQ(get_events(request, &response).error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+}
+
+TEST_F(DashcamEventServiceTest, StreamEventsAppliesTheRequestFilter) {
+    GetEventsRequest request;
+    request.set_camera_id("rear");
+    grpc::ClientContext context;
+    std::unique_ptr<grpc::ClientReader<LogEvent>> reader = stub_->StreamEvents(&context, request);
+
+    for (int i = 0; i < 1000 && service_->stream_stats().subscribers != 1; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(service_->stream_stats().subscribers, 1u);
+
+    for (int64_t t = 0; t < 10; ++t) {
+        service_->record(make_event(t, "tick", t % 2 == 0 ? "front" : "rear"));
+    }
+
+    LogEvent event;
+    for (int64_t t = 1; t < 10; t += 2) {
+        ASSERT_TRUE(reader->Read(&event));
+        EXPECT_EQ(event.timestamp_ms(), t);
+        EXPECT_EQ(event.camera_id(), "rear");
+    }
+
+    // Recorded events are also kept for GetEvents
+    EXPECT_EQ(service_->store_stats().stored, 10u);
+
+    service_->begin_shutdown();
+    EXPECT_FALSE(reader->Read(&event));
+    EXPECT_TRUE(reader->Finish().ok());
+}
+
+TEST_F(DashcamEventServiceTest, GetEventsFallsBackToTheLogForOlderRanges) {
+    const std::filesystem::path directory =
+        std::filesystem::temp_directory_path() / "dashcam_event_service_log_test";
+    std::filesystem::remove_all(directory);
+    EventLogConfig log_config;
+    log_config.directory = directory.string();
+    log_config.sync_blocks = false;
+    const int64_t base = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::system_clock::now().time_since_epoch())
+                             .count() -
+                         3600 * 1000;
+
+    // History from before a restart is only in the log
+    {
+        EventLog previous(log_config);
+        ASSERT_TRUE(previous.open());
+        for (int64_t t = 0; t < 50; ++t) {
+            ASSERT_TRUE(previous.append(make_event(base + t, "tick", "front")));
+        }
+    }
+    auto log = std::make_shared<EventLog>(log_config);
+    ASSERT_TRUE(log->open());
+    start_server(log);
+    for (int64_t t = 1000; t < 1010; ++t) {
+        service_->record(make_event(base + t, "tick", "front"));
+    }
+
+    // Starts before the ring: every page comes from the log, recent events included
+    GetEventsRequest request;
+    request.set_start_timestamp_ms(base);
+    request.set_max_events(16);
+    std::vector<int64_t> seen;
+    while (true) {
+        GetEventsResponse response;
+        ASSERT_TRUE(get_events(request, &response).ok());
+        for (const LogEvent& event : response.events()) {
+            seen.push_back(event.timestamp_ms() - base);
+        }
+        if (!response.has_more()) {
+            break;
+        }
+        EXPECT_EQ(response.next_page_token().front(), 'L');
+        request.set_page_token(response.next_page_token());
+    }
+    ASSERT_EQ(seen.size(), 60u);
+    EXPECT_EQ(seen[49], 49);
+    EXPECT_EQ(seen[50], 1000);
+    EXPECT_GT(log->stats().queries, 0u);
+
+    // Within the ring: the log is not asked
+    const uint64_t log_queries = log->stats().queries;
+    request.set_start_timestamp_ms(base + 1000);
+    request.set_max_events(4);
+    request.clear_page_token();
+    GetEventsResponse response;
+    ASSERT_TRUE(get_events(request, &response).ok());
+    EXPECT_EQ(response.events_size(), 4);
+    EXPECT_EQ(response.next_page_token(), "5");
+    EXPECT_EQ(log->stats().queries, log_queries);
+
+    request.set_page_token("L12.x");
+    EXPECT_EQ(get_events(request, &response).error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+
+    TearDown();
+    service_.reset();
+    log.reset();
+    std::filesystem::remove_all(directory);
+}
+
+} // namespace test
+} // namespace dashcam
@@ -0,0 +1,285 @@
+#include <gtest/gtest.h>
+#include "grpc/event_store.h"
+
+#include <google/protobuf/util/message_differencer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dashcam {
+namespace test {
+
+namespace {
+
+LogEvent make_event(int64_t timestamp_ms, const std::string& type, const std::string& camera) {
+    LogEvent event;
+    event.set_timestamp_ms(timestamp_ms);
+    event.set_event_type(type);
+    event.set_camera_id(camera);
+    event.set_message(type + "@" + std::to_string(timestamp_ms));
+    return event;
+}
+
+std::vector<int64_t> timestamps(const EventPage& page) {
+    std::vector<int64_t> result;
+    for (const LogEvent& event : page.events) {
+        result.push_back(event.timestamp_ms());
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(EventStoreTest, ReturnsTimeRangeInOrder) {
+    EventStore store;
+    for (int64_t t = 0; t < 1000; t += 10) {
+        store.append(make_event(t, "tick", "front"));
+    }
+
+    EventQuery query;
+    query.start_ms = 200;
+    query.end_ms = 500;
+    const EventPage page = store.query(query);
+
+    ASSERT_EQ(page.events.size(), 30u);
+    EXPECT_EQ(page.events.front().timestamp_ms(), 200);
+    EXPECT_EQ(page.events.back().timestamp_ms(), 490);
+    EXPECT_FALSE(page.has_more);
+    // Binary search: only the events returned were looked at
+    EXPECT_EQ(store.stats().scanned, 30u);
+}
+
+TEST(EventStoreTest, EventsComeBackWhole) {
+    EventStoreConfig config;
+    config.capacity = 2;
+    EventStore store(config);
+    LogEvent event = make_event(1, "storage_degraded", "rear");
+    (*event.mutable_metadata())["tier"] = "2";
+    (*event.mutable_metadata())["free_bytes"] = "1048576";
+    store.append(event);
+    // Slots are reused in place: an evicted event's entries must not leak
+    store.append(make_event(2, "tick", "front"));
+    store.append(make_event(3, "tick", ""));
+    store.append(event);
+
+    EventQuery query;
+    query.filter.event_types = {"storage_degraded"};
+    const EventPage page = store.query(query);
+    ASSERT_EQ(page.events.size(), 1u);
+    EXPECT_TRUE(google::protobuf::util::MessageDifferencer::Equals(page.events[0], event));
+
+    query.filter.event_types = {"tick"};
+    const EventPage ticks = store.query(query);
+    ASSERT_EQ(ticks.events.size(), 1u);
+    EXPECT_TRUE(ticks.events[0].metadata().empty());
+    EXPECT_TRUE(ticks.events[0].camera_id().empty());
+
+    // A name never recorded matches nothing, and is not interned by asking
+    const uint32_t symbols = SymbolTable::global().size();
+    query.filter.event_types = {"never_recorded_type"};
+    EXPECT_TRUE(store.query(query).events.empty());
+    query.filter.event_types.clear();
+    query.filter.camera_id = "never_recorded_camera";
+    EXPECT_TRUE(store.query(query).events.empty());
+    EXPECT_EQ(SymbolTable::global().size(), symbols);
+}
+
+TEST(EventStoreTest, FiltersWalkOnlyTheSmallestIndex) {
+    EventStore store;
+    for (int64_t t = 0; t < 1000; ++t) {
+        const std::string camera = t % 2 == 0 ? "front" : "rear";
+        const std::string type =
+            t % 100 == 1 ? "incident" : (t % 3 == 0 ? "frame_dropped" : "tick");
+        store.append(make_event(t, type, camera));
+    }
+
+    EventQuery query;
+    query.filter.event_types = {"incident", "frame_dropped"};
+    query.filter.camera_id = "rear";
+    query.max_events = 1000;
+    const EventPage page = store.query(query);
+
+    for (const LogEvent& event : page.events) {
+        EXPECT_EQ(event.camera_id(), "rear");
+        EXPECT_NE(event.event_type(), "tick");
+    }
+    // 10 incidents (all odd) and 164 odd frame drops, merged in time order
+    EXPECT_EQ(page.events.size(), 174u);
+    const std::vector<int64_t> order = timestamps(page);
+    EXPECT_TRUE(std::is_sorted(order.begin(), order.end()));
+    // The two type lists (341 entries) were walked, not rear's (500) or the ring
+    EXPECT_EQ(store.stats().scanned, 341u);
+
+    query.filter.event_types = {"incident"};
+    query.filter.camera_id = "front";
+    EXPECT_TRUE(store.query(query).events.empty());
+
+    query.filter.event_types = {"no_such_type"};
+    query.filter.camera_id.clear();
+    EXPECT_TRUE(store.query(query).events.empty());
+}
+
+TEST(EventStoreTest, PagesWithoutGapsOrDuplicates) {
+    EventStore store;
+    // Same millisecond throughout: pages must resume by sequence, not time
+    for (int i = 0; i < 250; ++i) {
+        LogEvent event = make_event(42, "tick", "front");
+        event.set_message(std::to_string(i));
+        store.append(event);
+    }
+
+    EventQuery query;
+    query.max_events = 100;
+    std::vector<std::string> seen;
+    int pages = 0;
+    while (true) {
+        const EventPage page = store.query(query);
+        ++pages;
+        for (const LogEvent& event : page.events) {
+            seen.push_back(event.message());
+        }
+        if (!page.has_more) {
+            break;
+        }
+        query.resume_sequence = page.next_sequence;
+    }
+
+    EXPECT_EQ(pages, 3);
+    ASSERT_EQ(seen.size(), 250u);
+    for (int i = 0; i < 250; ++i) {
+        EXPECT_EQ(seen[i], std::to_string(i));
+    }
+}
+
+TEST(EventStoreTest, PageSizeIsCapped) {
+    EventStoreConfig config;
+    config.default_max_events = 10;
+    config.max_events_limit = 50;
+    EventStore store(config);
+    for (int64_t t = 0; t < 100; ++t) {
+        store.append(make_event(t, "tick", ""));
+    }
+
+    EventQuery query;
+    EXPECT_EQ(store.query(query).events.size(), 10u);
+    query.max_events = 5000;
+    const EventPage page = store.query(query);
+    EXPECT_EQ(page.events.size(), 50u);
+    EXPECT_TRUE(page.has_more);
+}
+
+TEST(EventStoreTest, EvictsOldestWithTheirIndexEntries) {
+    EventStoreConfig config;
+    config.capacity = 8;
+    EventStore store(config);
+    store.append(make_event(0, "boot", "front"));
+    for (int64_t t = 1; t < 20; ++t) {
+        store.append(make_event(t, t % 2 == 0 ? "even" : "odd", t < 10 ? "front" : "rear"));
+    }
+
+    const EventStoreStats stats = store.stats();
+    EXPECT_EQ(stats.appended, 20u);
+    EXPECT_EQ(stats.evicted, 12u);
+    EXPECT_EQ(stats.stored, 8u);
+
+    EventQuery query;
+    EXPECT_EQ(timestamps(store.query(query)),
+              (std::vector<int64_t>{12, 13, 14, 15, 16, 17, 18, 19}));
+    query.filter.event_types = {"boot"};
+    EXPECT_TRUE(store.query(query).events.empty());
+    query.filter.event_types = {"odd"};
+    EXPECT_EQ(timestamps(store.query(query)), (std::vector<int64_t>{13, 15, 17, 19}));
+    query.filter.event_types.clear();
+    query.filter.camera_id = "front";
+    EXPECT_TRUE(store.query(query).events.empty());
+}
+
+TEST(EventStoreTest, ResumedPageContinuesAtOldestAfterEviction) {
+    EventStoreConfig config;
+    config.capacity = 10;
+    EventStore store(config);
+    for (int64_t t = 0; t < 10; ++t) {
+        store.append(make_event(t, "tick", ""));
+    }
+    EventQuery query;
+    query.max_events = 3;
+    const EventPage first = store.query(query);
+    ASSERT_TRUE(first.has_more);
+
+    // The rest of the first pass is overwritten before the next page
+    for (int64_t t = 10; t < 17; ++t) {
+        store.append(make_event(t, "tick", ""));
+    }
+    query.resume_sequence = first.next_sequence;
+    EXPECT_EQ(timestamps(store.query(query)), (std::vector<int64_t>{7, 8, 9}));
+}
+
+TEST(EventStoreTest, LateEventsAreFiledAtTheNewestTime) {
+    EventStore store;
+    store.append(make_event(100, "tick", ""));
+    store.append(make_event(50, "late", ""));
+    store.append(make_event(200, "tick", ""));
+    EXPECT_EQ(store.stats().reordered, 1u);
+
+    EventQuery query;
+    query.start_ms = 100;
+    query.end_ms = 150;
+    const EventPage page = store.query(query);
+    ASSERT_EQ(page.events.size(), 2u);
+    EXPECT_EQ(page.events[1].event_type(), "late");
+    EXPECT_EQ(page.events[1].timestamp_ms(), 50);
+}
+
+TEST(EventStoreTest, QueriesRunWhileEventsArrive) {
+    EventStoreConfig config;
+    config.capacity = 4096;
+    EventStore store(config);
+
+    std::atomic<bool> done{false};
+    std::atomic<int> queries{0};
+    std::atomic<bool> ok{true};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; ++r) {
+        readers.emplace_back([&, r] {
+            EventQuery query;
+            query.filter.camera_id = r == 0 ? "front" : "";
+            query.filter.event_types = {"incident"};
+            query.max_events = 200;
+            while (!done.load()) {
+                const EventPage page = store.query(query);
+                const std::vector<int64_t> order = timestamps(page);
+                for (const LogEvent& event : page.events) {
+                    if (!query.filter.matches(event)) {
+                        ok = false;
+                    }
+                }
+                if (!std::is_sorted(order.begin(), order.end())) {
+                    ok = false;
+                }
+                queries.fetch_add(1);
+            }
+        });
+    }
+
+    // One core here: let the readers start before the writer runs
+    while (queries.load() < 2) {
+        std::this_thread::yield();
+    }
+    for (int64_t t = 0; t < 20000; ++t) {
+        const char* camera = t % 2 == 0 ? "front" : "rear";
+        store.append(make_event(t, t % 7 == 0 ? "incident" : "tick", camera));
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_TRUE(ok.load());
+    EXPECT_EQ(store.stats().stored, 4096u);
+}
+
+} // namespace test
+} // namespace dashcam
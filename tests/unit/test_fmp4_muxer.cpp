@@ -0,0 +1,266 @@
+#include <gtest/gtest.h>
+#include "dashcam/media/fmp4_muxer.h"
+#include "dashcam/utils/byte_order.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace dashcam {
+namespace test {
+
+using Clock = SegmentWriter::Clock;
+
+class Fmp4MuxerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_dir_ = std::filesystem::temp_directory_path() / "dashcam_fmp4_muxer_test";
+        std::filesystem::remove_all(test_dir_);
+        std::filesystem::create_directories(test_dir_);
+        segment_path_ = (test_dir_ / "segment.mp4").string();
+
+        writer_config_.durability.mode = DurabilityMode::None;
+        muxer_config_.width = 1280;
+        muxer_config_.height = 720;
+        // Not a real avcC record; the muxer passes it through untouched
+        muxer_config_.decoder_config = {0x01, 0x64, 0x00, 0x1F, 0xFF, 0xE0};
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(test_dir_);
+    }
+
+    static WriteChunk frame(size_t size, uint8_t fill, bool keyframe) {
+        auto buffer = std::make_shared<const std::vector<uint8_t>>(size, fill);
+        return make_write_chunk(std::move(buffer), keyframe);
+    }
+
+    // Two 3-frame GOPs at 30 fps in a 90 kHz timescale
+    void write_two_gops(Fmp4Muxer& muxer, const Clock::time_point now) {
+        for (uint8_t i = 0; i < 6; ++i) {
+            SampleTiming timing;
+            timing.decode_time = 1000000 + i * 3000;
+            timing.duration = 3000;
+            ASSERT_TRUE(muxer.add_sample(frame(100 + i, i, i % 3 == 0), timing, now));
+        }
+    }
+
+    std::vector<uint8_t> read_segment() const {
+        std::ifstream file(segment_path_, std::ios::binary);
+        return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)),
+                                    std::istreambuf_iterator<char>());
+    }
+
+    static std::vector<std::string> top_level_boxes(const std::vector<uint8_t>& data) {
+        std::vector<std::string> types;
+        size_t offset = 0;
+        while (offset + 8 <= data.size()) {
+            types.emplace_back(reinterpret_cast<const char*>(data.data() + offset + 4), 4);
+            offset += load_be32(data.data() + offset);
+        }
+        return types;
+    }
+
+    // Offsets of the direct children of type `type` inside [begin, end)
+    static std::vector<size_t> child_boxes(const std::vector<uint8_t>& data,
+                                           size_t begin,
+                                           size_t end,
+                                           const char* type) {
+        std::vector<size_t> found;
+        while (begin + 8 <= end) {
+            if (std::memcmp(data.data() + begin + 4, type, 4) == 0) {
+                found.push_back(begin);
+            }
+            begin += load_be32(data.data() + begin);
+        }
+        return found;
+    }
+
+    std::filesystem::path test_dir_;
+    std::string segment_path_;
+    SegmentWriterConfig writer_config_;
+    Fmp4MuxerConfig muxer_config_;
+};
+
+TEST_F(Fmp4MuxerTest, WritesOneFragmentPerGop) {
+    SegmentWriter writer(writer_config_);
+    Fmp4Muxer muxer(muxer_config_, writer);
+    const auto now = Clock::now();
+
+    ASSERT_TRUE(writer.open(segment_path_));
+    ASSERT_TRUE(muxer.begin_segment(now));
+    write_two_gops(muxer, now);
+    EXPECT_EQ(muxer.pending_samples(), 3u);
+    ASSERT_TRUE(muxer.end_segment(now));
+    ASSERT_TRUE(writer.close(now));
+
+    const std::vector<uint8_t> data = read_segment();
+    const std::vector<std::string> expected = {"ftyp", "moov", "moof", "mdat", "moof", "mdat"};
+    EXPECT_EQ(top_level_boxes(data), expected);
+
+    const Fmp4MuxerStats stats = muxer.stats();
+    EXPECT_EQ(stats.fragments_written, 2u);
+    EXPECT_EQ(stats.samples_written, 6u);
+    EXPECT_EQ(stats.payload_bytes, 615u);
+    EXPECT_EQ(stats.header_bytes + stats.payload_bytes, data.size());
+    EXPECT_EQ(fmp4_playable_prefix(data.data(), data.size()), data.size());
+}
+
+TEST_F(Fmp4MuxerTest, TrunDataOffsetPointsAtFirstPayload) {
+    SegmentWriter writer(writer_config_);
+    Fmp4Muxer muxer(muxer_config_, writer);
+    const auto now = Clock::now();
+
+    ASSERT_TRUE(writer.open(segment_path_));
+    ASSERT_TRUE(muxer.begin_segment(now));
+    write_two_gops(muxer, now);
+    ASSERT_TRUE(muxer.end_segment(now));
+    ASSERT_TRUE(writer.close(now));
+
+    const std::vector<uint8_t> data = read_segment();
+    const size_t ftyp_size = load_be32(data.data());
+    const size_t moof_at = ftyp_size + load_be32(data.data() + ftyp_size);
+
+    // moof(8) mfhd(16) traf(8) tfhd(16) tfdt(20) then trun: header(12) count(4) offset(4)
+    const size_t trun_at = moof_at + 8 + 16 + 8 + 16 + 20;
+    ASSERT_EQ(std::string(reinterpret_cast<const char*>(data.data() + trun_at + 4), 4), "trun");
+    EXPECT_EQ(load_be32(data.data() + trun_at + 12), 3u);
+
+    const uint32_t data_offset = load_be32(data.data() + trun_at + 16);
+    EXPECT_EQ(data[moof_at + data_offset], 0);          // Frame 0 fill
+    EXPECT_EQ(data[moof_at + data_offset + 100], 1);    // Frame 1 follows directly
+
+    // First fragment decodes from zero, relative to the segment start
+    EXPECT_EQ(load_be64(data.data() + moof_at + 8 + 16 + 8 + 16 + 12), 0u);
+}
+
+TEST_F(Fmp4MuxerTest, TornFragmentIsExcludedFromPlayablePrefix) {
+    SegmentWriter writer(writer_config_);
+    Fmp4Muxer muxer(muxer_config_, writer);
+    const auto now = Clock::now();
+
+    ASSERT_TRUE(writer.open(segment_path_));
+    ASSERT_TRUE(muxer.begin_segment(now));
+    write_two_gops(muxer, now);
+    ASSERT_TRUE(muxer.end_segment(now));
+    ASSERT_TRUE(writer.close(now));
+
+    std::vector<uint8_t> data = read_segment();
+    const uint64_t full = data.size();
+
+    // Lose the tail of the second GOP's payload, as after a power cut
+    data.resize(full - 50);
+    const uint64_t playable = fmp4_playable_prefix(data.data(), data.size());
+    EXPECT_LT(playable, data.size());
+    EXPECT_EQ(top_level_boxes(std::vector<uint8_t>(data.begin(), data.begin() + playable)),
+              (std::vector<std::string>{"ftyp", "moov", "moof", "mdat"}));
+
+    EXPECT_EQ(fmp4_playable_prefix(data.data(), 20), 0u);
+}
+
+TEST_F(Fmp4MuxerTest, RejectsSegmentStartingWithoutKeyframe) {
+    SegmentWriter writer(writer_config_);
+    Fmp4Muxer muxer(muxer_config_, writer);
+    const auto now = Clock::now();
+
+    ASSERT_TRUE(writer.open(segment_path_));
+    ASSERT_TRUE(muxer.begin_segment(now));
+    EXPECT_FALSE(muxer.add_sample(frame(10, 1, false), SampleTiming{0, 3000, 0}, now));
+    EXPECT_TRUE(muxer.add_sample(frame(10, 1, true), SampleTiming{0, 3000, 0}, now));
+    EXPECT_EQ(muxer.pending_samples(), 1u);
+}
+
+TEST_F(Fmp4MuxerTest, InterleavesAudioAfterVideoInEachFragment) {
+    muxer_config_.audio.sample_rate = 48000;
+    SegmentWriter writer(writer_config_);
+    Fmp4Muxer muxer(muxer_config_, writer);
+    const auto now = Clock::now();
+    const std::vector<uint8_t> period(3200, 0xA5);   // 1600 mono frames, 1/30 s
+
+    ASSERT_TRUE(writer.open(segment_path_));
+    ASSERT_TRUE(muxer.begin_segment(now));
+
+    // Nothing to sync to before the first keyframe
+    EXPECT_FALSE(muxer.add_audio_sample(period.data(), period.size(), {533333, 1600, 0}, now));
+
+    // Video decode time 1000000 at 90 kHz is 533333 at 48 kHz
+    for (uint8_t i = 0; i < 6; ++i) {
+        SampleTiming video;
+        video.decode_time = 1000000 + i * 3000;
+        video.duration = 3000;
+        ASSERT_TRUE(muxer.add_sample(frame(100 + i, i, i % 3 == 0), video, now));
+        const SampleTiming audio{533333 + i * 1600, 1600, 0};
+        ASSERT_TRUE(muxer.add_audio_sample(period.data(), period.size(), audio, now));
+    }
+
+    // A second ahead of the video is outside the skew bound
+    EXPECT_FALSE(muxer.add_audio_sample(period.data(), period.size(), {600000, 1600, 0}, now));
+    EXPECT_EQ(muxer.pending_audio_samples(), 3u);
+    ASSERT_TRUE(muxer.end_segment(now));
+    ASSERT_TRUE(writer.close(now));
+
+    const std::vector<uint8_t> data = read_segment();
+    EXPECT_EQ(top_level_boxes(data),
+              (std::vector<std::string>{"ftyp", "moov", "moof", "mdat", "moof", "mdat"}));
+    const Fmp4MuxerStats stats = muxer.stats();
+    EXPECT_EQ(stats.audio_samples_written, 6u);
+    EXPECT_EQ(stats.audio_samples_dropped, 2u);
+    EXPECT_EQ(stats.header_bytes + stats.payload_bytes, data.size());
+
+    const size_t ftyp_size = load_be32(data.data());
+    const size_t moov_size = load_be32(data.data() + ftyp_size);
+    EXPECT_EQ(child_boxes(data, ftyp_size + 8, ftyp_size + moov_size, "trak").size(), 2u);
+
+    // Second fragment: video traf, then an audio traf whose data follows the video
+    const size_t first_moof = ftyp_size + moov_size;
+    const size_t first_mdat = first_moof + load_be32(data.data() + first_moof);
+    const size_t moof_at = first_mdat + load_be32(data.data() + first_mdat);
+    const std::vector<size_t> trafs =
+        child_boxes(data, moof_at + 8, moof_at + load_be32(data.data() + moof_at), "traf");
+    ASSERT_EQ(trafs.size(), 2u);
+
+    // traf(8) tfhd(16) tfdt(20) then trun: header(12) count(4) offset(4)
+    const size_t audio_traf = trafs[1];
+    EXPECT_EQ(load_be32(data.data() + audio_traf + 8 + 12), 2u);     // Track id
+    EXPECT_EQ(load_be64(data.data() + audio_traf + 8 + 16 + 12), 3u * 1600);
+    const size_t trun_at = audio_traf + 8 + 16 + 20;
+    EXPECT_EQ(load_be32(data.data() + trun_at + 12), 3u);
+    const uint32_t audio_offset = load_be32(data.data() + trun_at + 16);
+    EXPECT_EQ(data[moof_at + audio_offset - 1], 5);    // Last byte of video frame 5
+    EXPECT_EQ(data[moof_at + audio_offset], 0xA5);
+    EXPECT_EQ(moof_at + audio_offset + 3 * period.size(), data.size());
+}
+
+TEST_F(Fmp4MuxerTest, AudioGapStartsNewFragment) {
+    muxer_config_.audio.sample_rate = 48000;
+    SegmentWriter writer(writer_config_);
+    Fmp4Muxer muxer(muxer_config_, writer);
+    const auto now = Clock::now();
+    const std::vector<uint8_t> period(1920, 0x11);   // 960 mono frames, 20 ms
+
+    ASSERT_TRUE(writer.open(segment_path_));
+    ASSERT_TRUE(muxer.begin_segment(now));
+    ASSERT_TRUE(muxer.add_sample(frame(100, 0, true), SampleTiming{0, 3000, 0}, now));
+    ASSERT_TRUE(muxer.add_audio_sample(period.data(), period.size(), {0, 960, 0}, now));
+
+    // Overlapping audio is dropped; a gap flushes the fragment and restarts audio
+    EXPECT_FALSE(muxer.add_audio_sample(period.data(), period.size(), {480, 960, 0}, now));
+    ASSERT_TRUE(muxer.add_audio_sample(period.data(), period.size(), {2880, 960, 0}, now));
+    EXPECT_EQ(muxer.pending_samples(), 0u);
+    EXPECT_EQ(muxer.pending_audio_samples(), 1u);
+
+    // An audio-only fragment closes the segment
+    ASSERT_TRUE(muxer.end_segment(now));
+    ASSERT_TRUE(writer.close(now));
+    const std::vector<uint8_t> data = read_segment();
+    EXPECT_EQ(top_level_boxes(data),
+              (std::vector<std::string>{"ftyp", "moov", "moof", "mdat", "moof", "mdat"}));
+    EXPECT_EQ(fmp4_playable_prefix(data.data(), data.size()), data.size());
+    EXPECT_EQ(muxer.stats().audio_samples_written, 2u);
+    EXPECT_EQ(muxer.stats().audio_samples_dropped, 1u);
+}
+
+} // namespace test
+} // namespace dashcam
@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+#include "dashcam/media/fmp4_muxer.h"
+#include "dashcam/storage/fragment_cipher.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace dashcam {
+namespace test {
+
+namespace {
+
+FragmentCipherConfig small_chunk_config(uint32_t worker_threads) {
+    FragmentCipherConfig config;
+    for (size_t i = 0; i < config.master_key.size(); ++i) {
+        config.master_key[i] = static_cast<uint8_t>(i * 7 + 1);
+    }
+    config.chunk_bytes = 1000;
+    config.worker_threads = worker_threads;
+    return config;
+}
+
+// Samples of uneven sizes so chunks straddle sample boundaries
+std::vector<WriteChunk> make_samples() {
+    std::vector<WriteChunk> samples;
+    for (uint32_t i = 0; i < 7; ++i) {
+        auto buffer = std::make_shared<std::vector<uint8_t>>(300 + i * 450);
+        for (size_t j = 0; j < buffer->size(); ++j) {
+            (*buffer)[j] = static_cast<uint8_t>(i * 31 + j);
+        }
+        samples.push_back(make_write_chunk(std::move(buffer), i == 0));
+    }
+    return samples;
+}
+
+std::vector<uint8_t> concatenate(const std::vector<WriteChunk>& samples) {
+    std::vector<uint8_t> bytes;
+    for (const WriteChunk& sample : samples) {
+        bytes.insert(bytes.end(), sample.data, sample.data + sample.size_bytes);
+    }
+    return bytes;
+}
+
+} // namespace
+
+TEST(FragmentCipherTest, RoundTripsAcrossChunksAndWorkers) {
+    FragmentCipher cipher(small_chunk_config(3));
+    SegmentEncryption encryption;
+    ASSERT_TRUE(cipher.start_segment(&encryption));
+    EXPECT_EQ(encryption.chunk_bytes, 1000u);
+
+    const std::vector<WriteChunk> samples = make_samples();
+    const std::vector<uint8_t> plaintext = concatenate(samples);
+    const uint32_t chunks = cipher.chunk_count(plaintext.size());
+    ASSERT_GT(chunks, 4u);
+
+    std::vector<uint8_t> ciphertext(plaintext.size());
+    std::vector<uint8_t> tags(chunks * ENCRYPTION_TAG_BYTES);
+    ASSERT_TRUE(cipher.encrypt_fragment(
+        5, samples.data(), static_cast<uint32_t>(samples.size()), ciphertext.data(), tags.data()));
+    EXPECT_NE(ciphertext, plaintext);
+
+    // A reader with only the master key and the stored salt
+    FragmentCipher reader(small_chunk_config(0));
+    ASSERT_TRUE(reader.resume_segment(encryption));
+    ASSERT_TRUE(reader.decrypt_fragment(5, ciphertext.data(), ciphertext.size(), tags.data()));
+    EXPECT_EQ(ciphertext, plaintext);
+    EXPECT_EQ(cipher.stats().chunks, chunks);
+}
+
+TEST(FragmentCipherTest, TamperingFailsAuthentication) {
+    FragmentCipher cipher(small_chunk_config(1));
+    SegmentEncryption encryption;
+    ASSERT_TRUE(cipher.start_segment(&encryption));
+
+    const std::vector<WriteChunk> samples = make_samples();
+    const size_t size = concatenate(samples).size();
+    std::vector<uint8_t> ciphertext(size);
+    std::vector<uint8_t> tags(cipher.chunk_count(size) * ENCRYPTION_TAG_BYTES);
+    ASSERT_TRUE(cipher.encrypt_fragment(
+        1, samples.data(), static_cast<uint32_t>(samples.size()), ciphertext.data(), tags.data()));
+
+    std::vector<uint8_t> flipped = ciphertext;
+    flipped[size / 2] ^= 0x01;
+    EXPECT_FALSE(cipher.decrypt_fragment(1, flipped.data(), size, tags.data()));
+
+    // The nonce binds the fragment sequence, so fragments cannot be swapped
+    std::vector<uint8_t> moved = ciphertext;
+    EXPECT_FALSE(cipher.decrypt_fragment(2, moved.data(), size, tags.data()));
+    EXPECT_EQ(cipher.stats().authentication_failures, 2u);
+}
+
+TEST(FragmentCipherTest, EachSegmentGetsItsOwnKey) {
+    FragmentCipher cipher(small_chunk_config(0));
+    const std::vector<WriteChunk> samples = make_samples();
+    const size_t size = concatenate(samples).size();
+    const uint32_t count = static_cast<uint32_t>(samples.size());
+
+    SegmentEncryption first;
+    SegmentEncryption second;
+    std::vector<uint8_t> first_out(size);
+    std::vector<uint8_t> second_out(size);
+    std::vector<uint8_t> tags(cipher.chunk_count(size) * ENCRYPTION_TAG_BYTES);
+
+    ASSERT_TRUE(cipher.start_segment(&first));
+    ASSERT_TRUE(cipher.encrypt_fragment(1, samples.data(), count, first_out.data(), tags.data()));
+    ASSERT_TRUE(cipher.start_segment(&second));
+    ASSERT_TRUE(cipher.encrypt_fragment(1, samples.data(), count, second_out.data(), tags.data()));
+
+    EXPECT_NE(first.salt, second.salt);
+    EXPECT_NE(first_out, second_out);
+}
+
+TEST(FragmentCipherTest, EncryptedSegmentDecryptsFragmentByFragment) {
+    const auto path = std::filesystem::temp_directory_path() / "dashcam_encrypted_segment.mp4";
+    SegmentWriterConfig writer_config;
+    writer_config.durability.mode = DurabilityMode::None;
+    Fmp4MuxerConfig muxer_config;
+    muxer_config.decoder_config = {0x01, 0x64, 0x00, 0x1F};
+    muxer_config.max_fragment_bytes = 1024 * 1024;
+
+    FragmentCipher cipher(small_chunk_config(2));
+    SegmentWriter writer(writer_config);
+    Fmp4Muxer muxer(muxer_config, writer, nullptr, &cipher);
+    const auto now = SegmentWriter::Clock::now();
+
+    const std::vector<WriteChunk> samples = make_samples();
+    ASSERT_TRUE(writer.open(path.string()));
+    ASSERT_TRUE(muxer.begin_segment(now));
+    for (uint32_t gop = 0; gop < 2; ++gop) {
+        for (size_t i = 0; i < samples.size(); ++i) {
+            SampleTiming timing;
+            timing.decode_time = static_cast<int64_t>((gop * samples.size() + i) * 3000);
+            timing.duration = 3000;
+            ASSERT_TRUE(muxer.add_sample(samples[i], timing, now));
+        }
+    }
+    ASSERT_TRUE(muxer.end_segment(now));
+    ASSERT_TRUE(writer.close(now));
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                              std::istreambuf_iterator<char>());
+    std::filesystem::remove(path);
+    EXPECT_EQ(fmp4_playable_prefix(data.data(), data.size()), data.size());
+
+    // Ciphertext on disk, plaintext after decryption
+    const std::vector<uint8_t> plaintext = concatenate(samples);
+    const auto contains_plaintext = [&] {
+        return std::search(data.begin(), data.end(), plaintext.begin(), plaintext.end()) !=
+               data.end();
+    };
+    EXPECT_FALSE(contains_plaintext());
+
+    FragmentCipher reader(small_chunk_config(0));
+    ASSERT_TRUE(fmp4_decrypt_segment(data.data(), data.size(), reader));
+    EXPECT_TRUE(contains_plaintext());
+    EXPECT_EQ(reader.stats().fragments, 2u);
+}
+
+} // namespace test
+} // namespace dashcam
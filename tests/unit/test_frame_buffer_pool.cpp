@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include "dashcam/media/frame_buffer_pool.h"
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace dashcam {
+namespace test {
+
+TEST(FrameBufferPoolTest, BuffersReturnWhenTheLastReferenceGoes) {
+    FrameBufferPoolConfig config;
+    config.buffers = 2;
+    config.buffer_bytes = 1024;
+    auto pool = FrameBufferPool::create(config);
+
+    FrameBuffer first = pool->acquire();
+    ASSERT_TRUE(first);
+    EXPECT_EQ(first.size(), 0u);
+    EXPECT_EQ(first.capacity(), 1024u);
+    std::memcpy(first.data(), "frame", 5);
+    first.resize(5);
+
+    FrameBuffer shared = first.share();
+    EXPECT_EQ(shared.data(), first.data());
+    EXPECT_EQ(shared.size(), 5u);
+
+    FrameBuffer second = pool->acquire();
+    ASSERT_TRUE(second);
+    EXPECT_NE(second.data(), first.data());
+    EXPECT_FALSE(pool->acquire());
+    EXPECT_EQ(pool->stats().exhausted, 1u);
+    EXPECT_EQ(pool->stats().in_use, 2u);
+
+    // One reference left: still in use
+    first = FrameBuffer();
+    EXPECT_EQ(pool->stats().in_use, 2u);
+    shared = FrameBuffer();
+    EXPECT_EQ(pool->stats().in_use, 1u);
+
+    FrameBuffer again = pool->acquire();
+    ASSERT_TRUE(again);
+    EXPECT_EQ(again.size(), 0u);
+    EXPECT_EQ(pool->stats().acquired, 3u);
+}
+
+TEST(FrameBufferPoolTest, TokensReleaseLikeReferences) {
+    FrameBufferPoolConfig config;
+    config.buffers = 1;
+    config.buffer_bytes = 64;
+    auto pool = FrameBufferPool::create(config);
+
+    FrameBuffer frame = pool->acquire();
+    void* token = frame.share().into_token();
+    frame = FrameBuffer();
+    EXPECT_EQ(pool->stats().in_use, 1u);
+    FrameBuffer::release_token(token);
+    EXPECT_EQ(pool->stats().in_use, 0u);
+}
+
+TEST(FrameBufferPoolTest, BuffersInUseKeepThePoolAlive) {
+    FrameBufferPoolConfig config;
+    config.buffers = 1;
+    config.buffer_bytes = 64;
+    auto pool = FrameBufferPool::create(config);
+    FrameBuffer frame = pool->acquire();
+    frame.resize(64);
+    std::memset(frame.data(), 0x5a, 64);
+
+    // The encoder goes away while a viewer still holds its frame
+    pool.reset();
+    EXPECT_EQ(frame.data()[63], 0x5a);
+    frame = FrameBuffer();
+}
+
+TEST(FrameBufferPoolTest, ReleasedFromManyThreads) {
+    FrameBufferPoolConfig config;
+    config.buffers = 8;
+    config.buffer_bytes = 64;
+    auto pool = FrameBufferPool::create(config);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&pool] {
+            for (int i = 0; i < 10000; ++i) {
+                FrameBuffer frame = pool->acquire();
+                if (frame) {
+                    FrameBuffer copy = frame.share();
+                    frame = FrameBuffer();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const FrameBufferPoolStats stats = pool->stats();
+    EXPECT_EQ(stats.in_use, 0u);
+    EXPECT_EQ(stats.acquired + stats.exhausted, 40000u);
+}
+
+} // namespace test
+} // namespace dashcam
@@ -0,0 +1,274 @@
+#include <gtest/gtest.h>
+#include "dashcam/media/fmp4_muxer.h"
+#include "dashcam/storage/checkpoint_file.h"
+#include "dashcam/storage/integrity_chain.h"
+#include "dashcam/storage/segment_layout.h"
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace dashcam {
+namespace test {
+
+namespace {
+
+// 2023-11-14 22:13:20 UTC
+constexpr int64_t BASE_TIME_US = 1700000000000000;
+
+IntegrityChainConfig test_chain_config() {
+    IntegrityChainConfig config;
+    for (size_t i = 0; i < config.signing_key.size(); ++i) {
+        config.signing_key[i] = static_cast<uint8_t>(i * 13 + 5);
+    }
+    config.checkpoint_interval = 2;
+    return config;
+}
+
+std::filesystem::path test_root() {
+    return std::filesystem::temp_directory_path() / "dashcam_integrity_chain_test";
+}
+
+/**
+ * @brief A one-minute segment of the front camera, where the layout puts it
+ */
+SegmentInfo segment_info(uint64_t segment_id) {
+    const SegmentLayout layout(test_root().string());
+    SegmentInfo info;
+    info.segment_id = segment_id;
+    info.camera_id = "front";
+    info.start_time_us = BASE_TIME_US + static_cast<int64_t>(segment_id) * 60000000;
+    info.end_time_us = info.start_time_us + 60000000;
+    info.path = layout.path_for(info.camera_id, segment_id, info.start_time_us);
+    EXPECT_TRUE(layout.ensure_directory(layout.directory_for(info.camera_id, info.start_time_us)));
+    return info;
+}
+
+/**
+ * @brief Record one segment of `fragments` one-sample fragments and read it back
+ *
+ * The file stays in place, next to the checkpoint file the chain writes.
+ */
+std::vector<uint8_t> record_segment(IntegrityChain& chain,
+                                    uint64_t segment_id,
+                                    uint32_t fragments,
+                                    FragmentCipher* cipher = nullptr) {
+    const std::string path = segment_info(segment_id).path;
+    SegmentWriterConfig writer_config;
+    writer_config.durability.mode = DurabilityMode::None;
+    Fmp4MuxerConfig muxer_config;
+    muxer_config.decoder_config = {0x01, 0x64, 0x00, 0x1F};
+
+    SegmentWriter writer(writer_config);
+    Fmp4Muxer muxer(muxer_config, writer, nullptr, cipher, &chain);
+    const auto now = SegmentWriter::Clock::now();
+
+    EXPECT_TRUE(writer.open(path));
+    chain.begin_segment(segment_id);
+    EXPECT_TRUE(muxer.begin_segment(now));
+    for (uint32_t i = 0; i < fragments; ++i) {
+        auto frame = std::make_shared<std::vector<uint8_t>>(2000 + i * 100,
+                                                            static_cast<uint8_t>(i));
+        SampleTiming timing;
+        timing.decode_time = static_cast<int64_t>(i) * 3000;
+        timing.duration = 3000;
+        EXPECT_TRUE(muxer.add_sample(make_write_chunk(std::move(frame), true), timing, now));
+    }
+    EXPECT_TRUE(muxer.end_segment(now));
+    chain.end_segment();
+    EXPECT_TRUE(writer.close(now));
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                              std::istreambuf_iterator<char>());
+    return data;
+}
+
+} // namespace
+
+class IntegrityChainTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::filesystem::remove_all(test_root());
+        std::filesystem::create_directories(test_root());
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(test_root());
+    }
+};
+
+TEST_F(IntegrityChainTest, RecordedSegmentVerifiesAgainstSignedCheckpoints) {
+    SegmentIndex index;
+    ASSERT_TRUE(index.add(segment_info(1)));
+    IntegrityChain chain(test_chain_config(), index);
+    ASSERT_TRUE(chain.start());
+
+    const std::vector<uint8_t> data = record_segment(chain, 1, 5);
+    chain.stop();
+
+    // Anchor, fragments 2 and 4, and the final fragment 5
+    const std::vector<IntegrityCheckpoint> checkpoints = index.checkpoints(1);
+    ASSERT_EQ(checkpoints.size(), 4u);
+    EXPECT_EQ(checkpoints.back().fragment_sequence, 5u);
+    for (const IntegrityCheckpoint& checkpoint : checkpoints) {
+        EXPECT_TRUE(IntegrityChain::verify_checkpoint(chain.public_key(), checkpoint));
+    }
+
+    const ChainVerification result =
+        IntegrityChain::verify_segment(chain.public_key(), data.data(), data.size(), checkpoints);
+    EXPECT_TRUE(result.valid);
+    EXPECT_EQ(result.checkpoints_matched, 4u);
+    EXPECT_EQ(result.verified_through, 5u);
+    EXPECT_EQ(result.fragments_in_file, 5u);
+    EXPECT_EQ(chain.stats().fragments_hashed, 6u);
+    EXPECT_EQ(chain.stats().bytes_hashed, data.size());
+}
+
+TEST_F(IntegrityChainTest, TamperingIsDetected) {
+    SegmentIndex index;
+    ASSERT_TRUE(index.add(segment_info(1)));
+    IntegrityChain chain(test_chain_config(), index);
+    ASSERT_TRUE(chain.start());
+    const std::vector<uint8_t> data = record_segment(chain, 1, 4);
+    chain.stop();
+    const std::vector<IntegrityCheckpoint> checkpoints = index.checkpoints(1);
+
+    // One flipped payload bit near the end of the file
+    std::vector<uint8_t> edited = data;
+    edited[edited.size() - 10] ^= 0x01;
+    EXPECT_FALSE(
+        IntegrityChain::verify_segment(chain.public_key(), edited.data(), edited.size(), checkpoints)
+            .valid);
+
+    // Cutting off the last fragment leaves the final checkpoint unmatched
+    const ChainVerification cut =
+        IntegrityChain::verify_segment(chain.public_key(), data.data(), data.size() - 2400,
+                                       checkpoints);
+    EXPECT_FALSE(cut.valid);
+    EXPECT_EQ(cut.verified_through, 2u);
+
+    // A forged checkpoint fails its signature
+    std::vector<IntegrityCheckpoint> forged = checkpoints;
+    forged.back().chain_hash[0] ^= 0x01;
+    EXPECT_FALSE(IntegrityChain::verify_checkpoint(chain.public_key(), forged.back()));
+    EXPECT_FALSE(
+        IntegrityChain::verify_segment(chain.public_key(), data.data(), data.size(), forged).valid);
+}
+
+TEST_F(IntegrityChainTest, ConsecutiveSegmentsAreLinked) {
+    SegmentIndex index;
+    ASSERT_TRUE(index.add(segment_info(1)));
+    ASSERT_TRUE(index.add(segment_info(2)));
+    IntegrityChain chain(test_chain_config(), index);
+    ASSERT_TRUE(chain.start());
+
+    FragmentCipherConfig cipher_config;
+    cipher_config.master_key.fill(0x42);
+    FragmentCipher cipher(cipher_config);
+    record_segment(chain, 1, 3, &cipher);
+    const std::vector<uint8_t> second = record_segment(chain, 2, 3, &cipher);
+    chain.stop();
+
+    // The second segment starts from the first segment's final link
+    const std::vector<IntegrityCheckpoint> first_checkpoints = index.checkpoints(1);
+    const std::vector<IntegrityCheckpoint> second_checkpoints = index.checkpoints(2);
+    ASSERT_FALSE(first_checkpoints.empty());
+    ASSERT_FALSE(second_checkpoints.empty());
+    EXPECT_EQ(second_checkpoints.front().genesis, first_checkpoints.back().chain_hash);
+
+    // Ciphertext is what was written, so it is what verifies
+    EXPECT_TRUE(IntegrityChain::verify_segment(
+                    chain.public_key(), second.data(), second.size(), second_checkpoints)
+                    .valid);
+
+    // Removing a segment drops its checkpoints too
+    ASSERT_TRUE(index.remove(1));
+    EXPECT_TRUE(index.checkpoints(1).empty());
+}
+
+TEST_F(IntegrityChainTest, FullQueueDropsAndLeavesSegmentUnchained) {
+    SegmentIndex index;
+    ASSERT_TRUE(index.add(segment_info(1)));
+    IntegrityChainConfig config = test_chain_config();
+    config.max_pending_fragments = 2;
+    IntegrityChain chain(config, index);
+
+    // Worker not started: the queue fills and the storage thread never blocks
+    const std::vector<uint8_t> data = record_segment(chain, 1, 4);
+    EXPECT_EQ(chain.stats().fragments_dropped, 3u);
+
+    ASSERT_TRUE(chain.start());
+    chain.stop();
+    EXPECT_EQ(chain.stats().fragments_hashed, 2u);
+
+    // Only the anchor was signed; fragment 1 is hashed but not checkpointed
+    const std::vector<IntegrityCheckpoint> checkpoints = index.checkpoints(1);
+    ASSERT_EQ(checkpoints.size(), 1u);
+    const ChainVerification result =
+        IntegrityChain::verify_segment(chain.public_key(), data.data(), data.size(), checkpoints);
+    EXPECT_TRUE(result.valid);
+    EXPECT_EQ(result.verified_through, 0u);
+    EXPECT_EQ(result.fragments_in_file, 4u);
+}
+
+TEST_F(IntegrityChainTest, CheckpointsSurviveRestartAndLinkSegments) {
+    std::vector<std::vector<uint8_t>> data;
+    std::array<uint8_t, SIGNING_KEY_BYTES> public_key{};
+    {
+        SegmentIndex index;
+        IntegrityChain chain(test_chain_config(), index);
+        ASSERT_TRUE(chain.start());
+        for (uint64_t segment_id = 1; segment_id <= 3; ++segment_id) {
+            ASSERT_TRUE(index.add(segment_info(segment_id)));
+            data.push_back(record_segment(chain, segment_id, 3));
+        }
+        chain.stop();
+        public_key = chain.public_key();
+        EXPECT_EQ(chain.stats().failures, 0u);
+        EXPECT_EQ(load_checkpoint_file(checkpoint_file_path(segment_info(2).path)).size(),
+                  index.checkpoints(2).size());
+    }
+
+    // After a restart, only the files are left
+    SegmentIndex index;
+    const IndexRebuildStats stats = SegmentLayout(test_root().string()).rebuild_index(index, 2);
+    EXPECT_EQ(stats.segments_indexed, 3u);
+    EXPECT_EQ(stats.files_skipped, 3u);
+    // Anchor, fragment 2 and the final fragment 3 of each segment
+    EXPECT_EQ(stats.checkpoints_loaded, 9u);
+
+    const std::vector<IntegrityCheckpoint> first = index.checkpoints(1);
+    const std::vector<IntegrityCheckpoint> second = index.checkpoints(2);
+    const std::vector<IntegrityCheckpoint> third = index.checkpoints(3);
+    ASSERT_EQ(second.size(), 3u);
+    for (const IntegrityCheckpoint& checkpoint : second) {
+        EXPECT_TRUE(IntegrityChain::verify_checkpoint(public_key, checkpoint));
+    }
+    const ChainVerification linked = IntegrityChain::verify_segment(
+        public_key, data[1].data(), data[1].size(), second, &first.back().chain_hash);
+    EXPECT_TRUE(linked.valid);
+    EXPECT_TRUE(linked.linked_to_previous);
+    EXPECT_EQ(linked.verified_through, 3u);
+
+    // With segment 2 gone, segment 3 no longer continues from segment 1
+    const ChainVerification gap = IntegrityChain::verify_segment(
+        public_key, data[2].data(), data[2].size(), third, &first.back().chain_hash);
+    EXPECT_FALSE(gap.valid);
+    EXPECT_FALSE(gap.linked_to_previous);
+
+    // A chain resumed from the last persisted link carries on across the restart
+    IntegrityChain chain(test_chain_config(), index);
+    chain.resume(third.back().chain_hash);
+    ASSERT_TRUE(chain.start());
+    ASSERT_TRUE(index.add(segment_info(4)));
+    const std::vector<uint8_t> fourth = record_segment(chain, 4, 2);
+    chain.stop();
+    EXPECT_TRUE(IntegrityChain::verify_segment(
+                    public_key, fourth.data(), fourth.size(), index.checkpoints(4),
+                    &third.back().chain_hash)
+                    .linked_to_previous);
+}
+
+} // namespace test
+} // namespace dashcam
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include "dashcam/storage/io_fault_injector.h"
+#include "dashcam/storage/segment_writer.h"
+
+#include <cerrno>
+#include <csignal>
+#include <filesystem>
+
+#include <sys/resource.h>
+
+namespace dashcam {
+namespace test {
+
+using Clock = SegmentWriter::Clock;
+
+class IoFaultInjectorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_dir_ = std::filesystem::temp_directory_path() / "dashcam_io_fault_test";
+        std::filesystem::remove_all(test_dir_);
+        std::filesystem::create_directories(test_dir_);
+        segment_path_ = (test_dir_ / "segment.bin").string();
+        config_.max_batch_bytes = 1;    // Every append is its own writev()
+        config_.durability.mode = DurabilityMode::None;
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(test_dir_);
+    }
+
+    static WriteChunk chunk_of(size_t size) {
+        return make_write_chunk(std::make_shared<const std::vector<uint8_t>>(size, 0x5a), false);
+    }
+
+    std::filesystem::path test_dir_;
+    std::string segment_path_;
+    SegmentWriterConfig config_;
+};
+
+TEST_F(IoFaultInjectorTest, NoFaultsByDefault) {
+    IoFaultInjector faults;
+    EXPECT_EQ(faults.before_write(100), 0);
+    EXPECT_EQ(faults.before_sync(), 0);
+
+    const IoFaultStats stats = faults.stats();
+    EXPECT_EQ(stats.writes_seen, 1u);
+    EXPECT_EQ(stats.syncs_seen, 1u);
+    EXPECT_EQ(stats.writes_failed, 0u);
+    EXPECT_EQ(stats.bytes_allowed, 100u);
+}
+
+TEST_F(IoFaultInjectorTest, EnospcAfterByteBudgetDropsBatches) {
+    IoFaultConfig fault_config;
+    fault_config.enospc_after_bytes = 2500;
+    IoFaultInjector faults(fault_config);
+    SegmentWriter writer(config_, nullptr, &faults);
+
+    const auto now = Clock::now();
+    ASSERT_TRUE(writer.open(segment_path_));
+    EXPECT_TRUE(writer.append(chunk_of(1000), now));
+    EXPECT_TRUE(writer.append(chunk_of(1000), now));
+    EXPECT_FALSE(writer.append(chunk_of(1000), now));
+    EXPECT_TRUE(writer.close(now));
+
+    const SegmentWriterStats stats = writer.stats(now);
+    EXPECT_EQ(stats.bytes_written, 2000u);
+    EXPECT_EQ(stats.bytes_dropped, 1000u);
+    EXPECT_EQ(stats.batches_failed, 1u);
+    EXPECT_EQ(std::filesystem::file_size(segment_path_), 2000u);
+}
+
+TEST_F(IoFaultInjectorTest, PartialWriteDropsOnlyTheUnwrittenRest) {
+    SegmentWriter writer(config_);
+    const auto now = Clock::now();
+    ASSERT_TRUE(writer.open(segment_path_));
+
+    // A file size limit makes writev() stop part way, then fail with EFBIG
+    rlimit saved {};
+    ASSERT_EQ(::getrlimit(RLIMIT_FSIZE, &saved), 0);
+    const auto saved_handler = std::signal(SIGXFSZ, SIG_IGN);
+    rlimit limited = saved;
+    limited.rlim_cur = 1500;
+    ASSERT_EQ(::setrlimit(RLIMIT_FSIZE, &limited), 0);
+    const bool appended = writer.append(chunk_of(2000), now);
+    ::setrlimit(RLIMIT_FSIZE, &saved);
+    std::signal(SIGXFSZ, saved_handler);
+
+    EXPECT_FALSE(appended);
+    EXPECT_TRUE(writer.close(now));
+    const SegmentWriterStats stats = writer.stats(now);
+    EXPECT_EQ(stats.bytes_written, 1500u);
+    EXPECT_EQ(stats.bytes_dropped, 500u);
+    EXPECT_EQ(stats.batches_failed, 1u);
+}
+
+TEST_F(IoFaultInjectorTest, EveryNthWriteAndSyncFail) {
+    IoFaultConfig fault_config;
+    fault_config.write_errno = EIO;
+    fault_config.fail_every_nth_write = 2;
+    fault_config.sync_errno = EIO;
+    fault_config.fail_every_nth_sync = 1;
+    IoFaultInjector faults(fault_config);
+    SegmentWriter writer(config_, nullptr, &faults);
+
+    const auto now = Clock::now();
+    ASSERT_TRUE(writer.open(segment_path_));
+    EXPECT_TRUE(writer.append(chunk_of(10), now));
+    EXPECT_FALSE(writer.append(chunk_of(10), now));
+    EXPECT_TRUE(writer.append(chunk_of(10), now));
+    EXPECT_FALSE(writer.sync(now));
+
+    // Clearing the faults mid-run lets the writer recover
+    faults.configure(IoFaultConfig{});
+    EXPECT_TRUE(writer.sync(now));
+    EXPECT_TRUE(writer.close(now));
+
+    const IoFaultStats stats = faults.stats();
+    EXPECT_EQ(stats.writes_failed, 1u);
+    EXPECT_EQ(stats.syncs_failed, 1u);
+}
+
+TEST_F(IoFaultInjectorTest, InjectedDelayShowsInWriteLatency) {
+    IoFaultConfig fault_config;
+    fault_config.write_delay = std::chrono::milliseconds(5);
+    IoFaultInjector faults(fault_config);
+    SegmentWriter writer(config_, nullptr, &faults);
+
+    const auto now = Clock::now();
+    ASSERT_TRUE(writer.open(segment_path_));
+    ASSERT_TRUE(writer.append(chunk_of(10), now));
+    ASSERT_TRUE(writer.close(now));
+
+    EXPECT_EQ(writer.write_latency().count(), 1u);
+    EXPECT_GE(writer.write_latency().max(), std::chrono::milliseconds(5));
+}
+
+} // namespace test
+} // namespace dashcam
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include "dashcam/utils/latency_histogram.h"
+
+namespace dashcam {
+namespace test {
+
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::chrono::nanoseconds;
+
+TEST(LatencyHistogramTest, EmptyHistogramReportsZero) {
+    LatencyHistogram histogram;
+
+    EXPECT_EQ(histogram.count(), 0u);
+    EXPECT_EQ(histogram.percentile(99.0), nanoseconds(0));
+    EXPECT_EQ(histogram.mean(), nanoseconds(0));
+    EXPECT_EQ(histogram.max(), nanoseconds(0));
+}
+
+TEST(LatencyHistogramTest, PercentilesSeparateFastAndSlowSamples) {
+    LatencyHistogram histogram;
+    for (int i = 0; i < 99; ++i) {
+        histogram.record(microseconds(100));
+    }
+    histogram.record(milliseconds(20));
+
+    EXPECT_EQ(histogram.count(), 100u);
+    EXPECT_EQ(histogram.max(), milliseconds(20));
+
+    // p50 lands in the 100us bucket, which is bounded by the next power of two
+    EXPECT_GE(histogram.percentile(50.0), microseconds(100));
+    EXPECT_LT(histogram.percentile(50.0), microseconds(200));
+
+    // p100 is capped at the real maximum rather than the bucket bound
+    EXPECT_EQ(histogram.percentile(100.0), milliseconds(20));
+}
+
+TEST(LatencyHistogramTest, NegativeSamplesClampToZero) {
+    LatencyHistogram histogram;
+    histogram.record(nanoseconds(-5));
+
+    EXPECT_EQ(histogram.count(), 1u);
+    EXPECT_EQ(histogram.max(), nanoseconds(0));
+}
+
+TEST(LatencyHistogramTest, ResetClearsSamples) {
+    LatencyHistogram histogram;
+    histogram.record(milliseconds(1));
+    histogram.reset();
+
+    EXPECT_EQ(histogram.count(), 0u);
+    EXPECT_EQ(histogram.percentile(50.0), nanoseconds(0));
+}
+
+TEST(LatencyHistogramTest, SnapshotDifferenceGivesRecentPercentile) {
+    LatencyHistogram histogram;
+    for (int i = 0; i < 100; ++i) {
+        histogram.record(milliseconds(50));
+    }
+    const LatencyHistogram::BucketCounts before = histogram.bucket_counts();
+    for (int i = 0; i < 10; ++i) {
+        histogram.record(microseconds(100));
+    }
+
+    LatencyHistogram::BucketCounts window = histogram.bucket_counts();
+    for (uint32_t i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i) {
+        window[i] -= before[i];
+    }
+    EXPECT_LT(LatencyHistogram::percentile_of(window, 99.0), microseconds(200));
+    EXPECT_GE(histogram.percentile(99.0), milliseconds(50));
+}
+
+} // namespace test
+} // namespace dashcam
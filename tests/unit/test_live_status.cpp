@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include "dashcam/utils/live_status.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace dashcam {
+namespace test {
+
+namespace {
+
+// Every word carries the same value, so a torn copy is detectable
+struct Pattern {
+    uint64_t words[5];
+};
+
+} // namespace
+
+TEST(SeqlockTest, LoadsTheLatestStore) {
+    Seqlock<CaptureStatus> seqlock;
+    EXPECT_EQ(seqlock.load().frames_captured, 0u);
+    EXPECT_EQ(seqlock.version(), 0u);
+
+    seqlock.store(CaptureStatus{42, 30, true});
+    const CaptureStatus status = seqlock.load();
+    EXPECT_EQ(status.frames_captured, 42u);
+    EXPECT_EQ(status.current_fps, 30u);
+    EXPECT_TRUE(status.recording);
+    EXPECT_EQ(seqlock.version(), 1u);
+}
+
+TEST(SeqlockTest, ReadersNeverSeeATornValue) {
+    Seqlock<Pattern> seqlock;
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> torn{0};
+    std::atomic<uint64_t> reads{0};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            uint64_t last = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                const Pattern pattern = seqlock.load();
+                for (uint64_t word : pattern.words) {
+                    if (word != pattern.words[0]) {
+                        torn.fetch_add(1);
+                    }
+                }
+                // A single writer only moves forward
+                if (pattern.words[0] < last) {
+                    torn.fetch_add(1);
+                }
+                last = pattern.words[0];
+                reads.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    // Overlap with the readers even on a single core
+    while (reads.load() == 0) {
+        std::this_thread::yield();
+    }
+    for (uint64_t value = 1; value <= 200000; ++value) {
+        Pattern pattern;
+        for (uint64_t& word : pattern.words) {
+            word = value;
+        }
+        seqlock.store(pattern);
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_EQ(torn.load(), 0u);
+    EXPECT_GT(reads.load(), 0u);
+    EXPECT_EQ(seqlock.load().words[0], 200000u);
+    EXPECT_EQ(seqlock.version(), 200000u);
+}
+
+TEST(LiveStatusTest, SnapshotCombinesWriters) {
+    LiveStatusConfig config;
+    config.writers = 3;
+    LiveStatus status(config);
+
+    LiveStatusSnapshot idle = status.snapshot();
+    EXPECT_FALSE(idle.recording);
+    EXPECT_FALSE(idle.audio_enabled);
+    EXPECT_EQ(idle.current_fps, 0u);
+
+    status.publish(0, CaptureStatus{100, 30, true});
+    status.publish(1, CaptureStatus{50, 24, true, true});
+    status.publish(2, CaptureStatus{10, 0, false});
+
+    const LiveStatusSnapshot snapshot = status.snapshot();
+    EXPECT_TRUE(snapshot.recording);
+    EXPECT_EQ(snapshot.frames_captured, 160u);
+    EXPECT_EQ(snapshot.current_fps, 24u);
+    EXPECT_EQ(snapshot.recording_writers, 2u);
+    EXPECT_TRUE(snapshot.audio_enabled);
+    EXPECT_GE(snapshot.uptime_seconds, 0);
+    EXPECT_EQ(status.stats().publishes, 3u);
+}
+
+TEST(LiveStatusTest, ConcurrentWritersAndReadersStayConsistent) {
+    constexpr uint32_t WRITERS = 2;
+    constexpr uint64_t PUBLISHES = 100000;
+    LiveStatusConfig config;
+    config.writers = WRITERS;
+    LiveStatus status(config);
+
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> bad{0};
+    std::atomic<bool> reading{false};
+    std::thread reader([&] {
+        uint64_t last = 0;
+        while (!done.load(std::memory_order_relaxed)) {
+            reading = true;
+            const LiveStatusSnapshot snapshot = status.snapshot();
+            // Each writer's frame count only grows, so the total does too
+            if (snapshot.frames_captured < last) {
+                bad.fetch_add(1);
+            }
+            last = snapshot.frames_captured;
+        }
+    });
+
+    while (!reading.load()) {
+        std::this_thread::yield();
+    }
+    std::vector<std::thread> writers;
+    for (uint32_t w = 0; w < WRITERS; ++w) {
+        writers.emplace_back([&status, w] {
+            for (uint64_t frames = 1; frames <= PUBLISHES; ++frames) {
+                status.publish(w, CaptureStatus{frames, static_cast<uint32_t>(frames % 1000), true});
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    done = true;
+    reader.join();
+
+    EXPECT_EQ(bad.load(), 0u);
+    EXPECT_EQ(status.snapshot().frames_captured, WRITERS * PUBLISHES);
+    EXPECT_EQ(status.stats().publishes, WRITERS * PUBLISHES);
+}
+
+} // namespace test
+} // namespace dashcam
@@ -0,0 +1,393 @@
+#include <gtest/gtest.h>
+#include "grpc/preview_publisher.h"
+#include "dashcam.grpc.pb.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dashcam {
+namespace test {
+
+namespace {
+
+/**
+ * @brief StreamPreview alone, answered by a publisher under test
+ */
+class PreviewStreamingService final
+    : public DashcamService::WithRawCallbackMethod_StreamPreview<DashcamService::Service> {
+public:
+    explicit PreviewStreamingService(PreviewPublisher& publisher) : publisher_(publisher) {}
+
+    grpc::ServerWriteReactor<grpc::ByteBuffer>* StreamPreview(grpc::CallbackServerContext* context,
+                                                             const grpc::ByteBuffer* request) override {
+        StreamPreviewRequest parsed;
+        EXPECT_TRUE(parse_request(*request, &parsed));
+        PreviewRequest preview;
+        preview.camera_id = parsed.camera_id();
+        preview.max_fps = parsed.max_fps();
+        preview.max_width = parsed.max_width();
+        return publisher_.subscribe(context, preview);
+    }
+
+private:
+    PreviewPublisher& publisher_;
+};
+
+class PreviewReader final : public grpc::ClientReadReactor<PreviewFrame> {
+public:
+    PreviewReader(DashcamService::Stub& stub, const StreamPreviewRequest& request, bool reading)
+        : request_(request) {
+        stub.async()->StreamPreview(&context_, &request_, this);
+        if (reading) {
+            StartRead(&frame_);
+        }
+        StartCall();
+    }
+
+    // The call must end before the reactor goes away
+    ~PreviewReader() override {
+        context_.TryCancel();
+        wait_done();
+    }
+
+    void start_reading() {
+        StartRead(&frame_);
+    }
+
+    void OnReadDone(bool ok) override {
+        if (!ok) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            frames_.push_back(frame_);
+        }
+        cv_.notify_all();
+        StartRead(&frame_);
+    }
+
+    void OnDone(const grpc::Status& status) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_ = true;
+            code_ = status.error_code();
+        }
+        cv_.notify_all();
+    }
+
+    bool wait_for_frames(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, std::chrono::seconds(10), [&] { return frames_.size() >= count || done_; }) &&
+               frames_.size() >= count;
+    }
+
+    bool wait_done() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, std::chrono::seconds(10), [&] { return done_; });
+    }
+
+    std::vector<PreviewFrame> frames() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return frames_;
+    }
+
+    grpc::StatusCode code() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return code_;
+    }
+
+private:
+    grpc::ClientContext context_;
+    const StreamPreviewRequest request_;
+    PreviewFrame frame_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<PreviewFrame> frames_;
+    bool done_ = false;
+    grpc::StatusCode code_ = grpc::StatusCode::UNKNOWN;
+};
+
+StreamPreviewRequest make_request(const std::string& camera, uint32_t max_fps = 0, uint32_t max_width = 0) {
+    StreamPreviewRequest request;
+    request.set_camera_id(camera);
+    request.set_max_fps(max_fps);
+    request.set_max_width(max_width);
+    return request;
+}
+
+PreviewFrameInfo make_info(int64_t timestamp_ms, bool keyframe, uint32_t width = 640) {
+    PreviewFrameInfo info;
+    info.camera_id = "front";
+    info.timestamp_ms = timestamp_ms;
+    info.keyframe = keyframe;
+    info.width = width;
+    info.height = width * 9 / 16;
+    return info;
+}
+
+} // namespace
+
+class PreviewPublisherTest : public ::testing::Test {
+protected:
+    void start(const PreviewPublisherConfig& config, size_t frame_bytes = 1024) {
+        FrameBufferPoolConfig pool_config;
+        pool_config.buffer_bytes = frame_bytes;
+        pool_ = FrameBufferPool::create(pool_config);
+        publisher_ = std::make_unique<PreviewPublisher>(config);
+        service_ = std::make_unique<PreviewStreamingService>(*publisher_);
+
+        grpc::ServerBuilder builder;
+        int port = 0;
+        builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+        builder.RegisterService(service_.get());
+        server_ = builder.BuildAndStart();
+        ASSERT_NE(server_, nullptr);
+        address_ = "127.0.0.1:" + std::to_string(port);
+        stub_ = connect(0);
+    }
+
+    std::unique_ptr<DashcamService::Stub> connect(int channel_tag) {
+        // Own connection per tag; without BDP probing a client that does not
+        // read stalls the server's writes quickly
+        grpc::ChannelArguments args;
+        args.SetInt("dashcam.test_channel", channel_tag);
+        args.SetInt(GRPC_ARG_HTTP2_BDP_PROBE, 0);
+        return DashcamService::NewStub(
+            grpc::CreateCustomChannel(address_, grpc::InsecureChannelCredentials(), args));
+    }
+
+    void wait_for_subscribers(uint64_t count) {
+        for (int i = 0; i < 1000 && publisher_->stats().subscribers != count; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ASSERT_EQ(publisher_->stats().subscribers, count);
+    }
+
+    /**
+     * @brief Encode a frame whose bytes all equal the low byte of its timestamp
+     */
+    void publish(const PreviewFrameInfo& info, size_t bytes = 100) {
+        FrameBuffer frame = pool_->acquire();
+        ASSERT_TRUE(frame);
+        std::memset(frame.data(), static_cast<int>(info.timestamp_ms & 0xff), bytes);
+        frame.resize(bytes);
+        publisher_->publish(info, std::move(frame));
+    }
+
+    void TearDown() override {
+        if (publisher_) {
+            publisher_->stop();
+        }
+        if (server_) {
+            server_->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(1));
+        }
+    }
+
+    std::shared_ptr<FrameBufferPool> pool_;
+    std::unique_ptr<PreviewPublisher> publisher_;
+    std::unique_ptr<PreviewStreamingService> service_;
+    std::unique_ptr<grpc::Server> server_;
+    std::string address_;
+    std::unique_ptr<DashcamService::Stub> stub_;
+};
+
+TEST_F(PreviewPublisherTest, NewViewerStartsOnARequestedKeyframe) {
+    start(PreviewPublisherConfig{});
+    publish(make_info(0, true));
+    publish(make_info(33, false));
+    EXPECT_FALSE(publisher_->take_keyframe_request("front"));
+
+    PreviewReader reader(*stub_, make_request("front"), true);
+    wait_for_subscribers(1);
+
+    // Mid-GOP frames cannot be decoded; the viewer waits and asks for a keyframe
+    publish(make_info(67, false));
+    EXPECT_TRUE(publisher_->take_keyframe_request("front"));
+    EXPECT_FALSE(publisher_->take_keyframe_request("front"));
+    EXPECT_FALSE(publisher_->take_keyframe_request("rear"));
+    publish(make_info(100, true));
+    publish(make_info(133, false));
+
+    ASSERT_TRUE(reader.wait_for_frames(2));
+    const std::vector<PreviewFrame> frames = reader.frames();
+    EXPECT_TRUE(frames[0].keyframe());
+    EXPECT_EQ(frames[0].timestamp_ms(), 100);
+    EXPECT_EQ(frames[0].sequence(), 3u);
+    EXPECT_EQ(frames[0].width(), 640u);
+    EXPECT_EQ(frames[0].height(), 360u);
+    EXPECT_EQ(frames[0].camera_id(), "front");
+    EXPECT_EQ(frames[0].data(), std::string(100, static_cast<char>(100)));
+    EXPECT_FALSE(frames[1].keyframe());
+    EXPECT_EQ(frames[1].data(), std::string(100, static_cast<char>(133)));
+
+    const PreviewPublisherStats stats = publisher_->stats();
+    EXPECT_EQ(stats.keyframe_waits, 1u);
+    EXPECT_EQ(stats.keyframes_requested, 1u);
+}
+
+TEST_F(PreviewPublisherTest, FramesReturnToThePoolOnceSent) {
+    start(PreviewPublisherConfig{});
+    std::vector<std::unique_ptr<PreviewReader>> readers;
+    for (int i = 0; i < 3; ++i) {
+        readers.push_back(std::make_unique<PreviewReader>(*stub_, make_request("front"), true));
+    }
+    wait_for_subscribers(3);
+
+    for (int64_t t = 0; t < 20; ++t) {
+        publish(make_info(t * 33, t == 0));
+        for (auto& reader : readers) {
+            ASSERT_TRUE(reader->wait_for_frames(t + 1));
+        }
+    }
+    // The viewers shared each buffer; every one is back once gRPC let go
+    for (int i = 0; i < 1000 && pool_->stats().in_use != 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(pool_->stats().in_use, 0u);
+    EXPECT_EQ(pool_->stats().acquired, 20u);
+    EXPECT_EQ(publisher_->stats().writes_started, 60u);
+}
+
+TEST_F(PreviewPublisherTest, EachViewerHasItsOwnFrameRate) {
+    start(PreviewPublisherConfig{});
+    PreviewReader full(*stub_, make_request("front"), true);
+    PreviewReader slow(*stub_, make_request("front", 10), true);
+    wait_for_subscribers(2);
+
+    // All-intra: every frame can be skipped without breaking decoding
+    for (int64_t t = 0; t < 30; ++t) {
+        PreviewFrameInfo info = make_info(t * 33, true);
+        info.discardable = true;
+        publish(info);
+        ASSERT_TRUE(full.wait_for_frames(t + 1));
+    }
+    ASSERT_TRUE(slow.wait_for_frames(10));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    const std::vector<PreviewFrame> frames = slow.frames();
+    ASSERT_EQ(frames.size(), 10u);
+    for (size_t i = 1; i < frames.size(); ++i) {
+        EXPECT_GE(frames[i].timestamp_ms() - frames[i - 1].timestamp_ms(), 99);
+    }
+    EXPECT_EQ(publisher_->stats().rate_limited, 20u);
+}
+
+TEST_F(PreviewPublisherTest, RateLimitedReferenceStreamResumesOnNextKeyframe) {
+    start(PreviewPublisherConfig{});
+    PreviewReader reader(*stub_, make_request("front", 10), true);
+    wait_for_subscribers(1);
+
+    // One GOP of reference frames: once a frame is skipped, the rest cannot decode
+    for (int64_t t = 0; t < 10; ++t) {
+        publish(make_info(t * 33, t % 5 == 0));
+    }
+    ASSERT_TRUE(reader.wait_for_frames(2));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    const std::vector<PreviewFrame> frames = reader.frames();
+    ASSERT_EQ(frames.size(), 2u);
+    EXPECT_EQ(frames[0].timestamp_ms(), 0);
+    EXPECT_EQ(frames[1].timestamp_ms(), 165);
+    EXPECT_TRUE(frames[1].keyframe());
+    // Waiting for the rate limit never forces a keyframe
+    EXPECT_FALSE(publisher_->take_keyframe_request("front"));
+}
+
+TEST_F(PreviewPublisherTest, ViewersGetTheWidestRenditionThatFits) {
+    start(PreviewPublisherConfig{});
+    publish(make_info(0, true, 320));
+    publish(make_info(0, true, 1280));
+    PreviewReader small(*stub_, make_request("front", 0, 640), true);
+    PreviewReader large(*stub_, make_request("front"), true);
+    PreviewReader tiny(*stub_, make_request("front", 0, 100), true);
+    wait_for_subscribers(3);
+
+    for (int64_t t = 1; t <= 5; ++t) {
+        publish(make_info(t * 33, t == 1, 320));
+        publish(make_info(t * 33, t == 1, 1280));
+    }
+    ASSERT_TRUE(small.wait_for_frames(5));
+    ASSERT_TRUE(large.wait_for_frames(5));
+    ASSERT_TRUE(tiny.wait_for_frames(5));
+    for (const PreviewFrame& frame : small.frames()) {
+        EXPECT_EQ(frame.width(), 320u);
+    }
+    for (const PreviewFrame& frame : large.frames()) {
+        EXPECT_EQ(frame.width(), 1280u);
+    }
+    // Nothing fits: the narrowest
+    for (const PreviewFrame& frame : tiny.frames()) {
+        EXPECT_EQ(frame.width(), 320u);
+    }
+}
+
+TEST_F(PreviewPublisherTest, SlowViewerDropsThenRestartsOnAKeyframe) {
+    constexpr size_t FRAME_BYTES = 64 * 1024;
+    PreviewPublisherConfig config;
+    config.queue_frames = 2;
+    config.min_keyframe_interval = std::chrono::milliseconds(0);
+    start(config, FRAME_BYTES);
+
+    auto slow_stub = connect(1);
+    PreviewReader fast(*stub_, make_request("front"), true);
+    PreviewReader slow(*slow_stub, make_request("front"), false);
+    wait_for_subscribers(2);
+
+    // Large frames fill the slow client's window; the fast client sets the pace
+    for (int64_t t = 0; t < 40; ++t) {
+        publish(make_info(t * 33, t == 0), FRAME_BYTES);
+        ASSERT_TRUE(fast.wait_for_frames(t + 1));
+    }
+    const PreviewPublisherStats stats = publisher_->stats();
+    EXPECT_GT(stats.dropped, 0u);
+    EXPECT_TRUE(publisher_->take_keyframe_request("front"));
+    // The slow viewer holds at most its queue and the write in flight
+    EXPECT_LE(pool_->stats().in_use, config.queue_frames + 1);
+
+    // Drained, it picks up again at the forced keyframe
+    slow.start_reading();
+    for (int i = 0; i < 1000 && pool_->stats().in_use != 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    publish(make_info(40 * 33, false));
+    publish(make_info(41 * 33, true));
+    publish(make_info(42 * 33, false));
+    ASSERT_TRUE(fast.wait_for_frames(43));
+    for (int i = 0; i < 1000; ++i) {
+        const std::vector<PreviewFrame> frames = slow.frames();
+        if (!frames.empty() && frames.back().timestamp_ms() == 42 * 33) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    const std::vector<PreviewFrame> frames = slow.frames();
+    ASSERT_GE(frames.size(), 3u);
+    EXPECT_TRUE(frames.front().keyframe());
+    EXPECT_EQ(frames[frames.size() - 2].timestamp_ms(), 41 * 33);
+    EXPECT_TRUE(frames[frames.size() - 2].keyframe());
+    EXPECT_EQ(frames.back().timestamp_ms(), 42 * 33);
+    // Frames seen before the loss run without gaps up to it
+    for (size_t i = 1; i + 2 < frames.size(); ++i) {
+        EXPECT_EQ(frames[i].sequence(), frames[i - 1].sequence() + 1);
+    }
+}
+
+TEST_F(PreviewPublisherTest, StopFinishesOpenAndLaterStreams) {
+    start(PreviewPublisherConfig{});
+
+    PreviewReader open(*stub_, make_request("front"), true);
+    wait_for_subscribers(1);
+    publisher_->stop();
+    ASSERT_TRUE(open.wait_done());
+    EXPECT_EQ(open.code(), grpc::StatusCode::OK);
+
+    PreviewReader late(*stub_, make_request("front"), true);
+    ASSERT_TRUE(late.wait_done());
+    EXPECT_EQ(late.code(), grpc::StatusCode::OK);
+}
+
+} // namespace test
+} // namespace dashcam
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include "dashcam/storage/rollover_coordinator.h"
+
+namespace dashcam {
+namespace test {
+
+// 2023-11-14 22:13:00 UTC, on a minute boundary
+constexpr int64_t BASE_TIME_US = 1699999980000000;
+constexpr int64_t MINUTE_US = 60000000;
+
+class RolloverCoordinatorTest : public ::testing::Test {
+protected:
+    RolloverCoordinatorTest() : layout_("/recordings") {
+        config_.first_segment_id = 100;
+    }
+
+    RolloverConfig config_;
+    SegmentLayout layout_;
+    SegmentIndex index_;
+};
+
+TEST_F(RolloverCoordinatorTest, AllCamerasCutAtTheSameBoundary) {
+    RolloverCoordinator coordinator(config_, layout_, index_);
+    const uint32_t front = coordinator.add_camera("front");
+    const uint32_t rear = coordinator.add_camera("rear");
+
+    // Both first segments start together, mid-minute
+    const int64_t start = BASE_TIME_US + 20000000;
+    ASSERT_TRUE(coordinator.start(start));
+    EXPECT_EQ(index_.size(), 2u);
+    EXPECT_EQ(coordinator.next_boundary_us(), BASE_TIME_US + MINUTE_US);
+    EXPECT_TRUE(coordinator.keyframe_due(front, start + 100));
+    EXPECT_FALSE(coordinator.keyframe_due(front, start + 33433));
+    ASSERT_TRUE(coordinator.on_keyframe(front, start + 100).has_value());
+    EXPECT_TRUE(coordinator.keyframe_due(rear, start + 5000));
+    const auto rear_first = coordinator.on_keyframe(rear, start + 5000);
+    ASSERT_TRUE(rear_first.has_value());
+    EXPECT_EQ(rear_first->start_time_us, start);
+
+    // A natural keyframe before the boundary does not cut
+    const int64_t boundary = BASE_TIME_US + MINUTE_US;
+    EXPECT_FALSE(coordinator.on_keyframe(front, boundary - 500000).has_value());
+
+    // The front camera reaches the boundary first and creates both entries
+    EXPECT_TRUE(coordinator.keyframe_due(front, boundary + 1200));
+    const auto front_next = coordinator.on_keyframe(front, boundary + 1200);
+    ASSERT_TRUE(front_next.has_value());
+    EXPECT_EQ(front_next->start_time_us, boundary);
+    const auto at_boundary = index_.overlapping("", boundary, boundary);
+    ASSERT_EQ(at_boundary.size(), 2u);
+    EXPECT_EQ(at_boundary[1].camera_id, "rear");
+
+    // The rear camera is forced and cuts on its own frame, at the same nominal time
+    EXPECT_FALSE(coordinator.keyframe_due(rear, boundary - 20000));
+    EXPECT_TRUE(coordinator.keyframe_due(rear, boundary + 18000));
+    EXPECT_FALSE(coordinator.keyframe_due(rear, boundary + 51000));
+    const auto rear_next = coordinator.on_keyframe(rear, boundary + 18000);
+    ASSERT_TRUE(rear_next.has_value());
+    EXPECT_EQ(rear_next->start_time_us, boundary);
+    EXPECT_EQ(rear_next->segment_id, at_boundary[1].segment_id);
+    EXPECT_EQ(rear_next->path, layout_.path_for("rear", rear_next->segment_id, boundary));
+
+    const RolloverStats stats = coordinator.stats();
+    EXPECT_EQ(stats.rollovers, 2u);
+    EXPECT_EQ(stats.segments_created, 4u);
+    EXPECT_EQ(stats.forced_keyframes, 4u);
+    EXPECT_EQ(coordinator.next_boundary_us(), boundary + MINUTE_US);
+}
+
+TEST_F(RolloverCoordinatorTest, StalledCameraRejoinsWithoutHoldingOthersBack) {
+    RolloverCoordinator coordinator(config_, layout_, index_);
+    const uint32_t front = coordinator.add_camera("front");
+    const uint32_t rear = coordinator.add_camera("rear");
+    ASSERT_TRUE(coordinator.start(BASE_TIME_US));
+    ASSERT_TRUE(coordinator.on_keyframe(front, BASE_TIME_US).has_value());
+    ASSERT_TRUE(coordinator.on_keyframe(rear, BASE_TIME_US).has_value());
+
+    // Front keeps cutting every minute while rear delivers nothing
+    ASSERT_TRUE(coordinator.on_keyframe(front, BASE_TIME_US + MINUTE_US).has_value());
+    ASSERT_TRUE(coordinator.on_keyframe(front, BASE_TIME_US + 2 * MINUTE_US).has_value());
+    EXPECT_EQ(index_.overlapping("rear", 0, INT64_MAX).size(), 2u);
+
+    // Rear comes back mid-minute: its unused entry is replaced by the current minute
+    const auto rejoined = coordinator.on_keyframe(rear, BASE_TIME_US + 2 * MINUTE_US + 7000000);
+    ASSERT_TRUE(rejoined.has_value());
+    EXPECT_EQ(rejoined->start_time_us, BASE_TIME_US + 2 * MINUTE_US);
+    const auto rear_segments = index_.overlapping("rear", 0, INT64_MAX);
+    ASSERT_EQ(rear_segments.size(), 2u);
+    EXPECT_EQ(rear_segments[1].start_time_us, BASE_TIME_US + 2 * MINUTE_US);
+    EXPECT_EQ(coordinator.stats().late_segments, 1u);
+
+    // Back in step: both cut at the next boundary
+    const int64_t next = BASE_TIME_US + 3 * MINUTE_US;
+    EXPECT_TRUE(coordinator.on_keyframe(rear, next + 10).has_value());
+    EXPECT_TRUE(coordinator.on_keyframe(front, next + 20).has_value());
+    EXPECT_EQ(index_.overlapping("", next, next).size(), 2u);
+}
+
+TEST_F(RolloverCoordinatorTest, RejectedBatchIsRetriedOnTheNextKeyframe) {
+    RolloverCoordinator coordinator(config_, layout_, index_);
+    const uint32_t front = coordinator.add_camera("front");
+    ASSERT_TRUE(coordinator.start(BASE_TIME_US));
+    ASSERT_TRUE(coordinator.on_keyframe(front, BASE_TIME_US).has_value());
+
+    // Segment 101 is already taken, so the index rejects the next batch
+    SegmentInfo taken;
+    taken.segment_id = 101;
+    taken.camera_id = "rear";
+    taken.path = "/recordings/101.mp4";
+    ASSERT_TRUE(index_.add(taken));
+
+    const int64_t boundary = BASE_TIME_US + MINUTE_US;
+    EXPECT_FALSE(coordinator.on_keyframe(front, boundary + 1000).has_value());
+    EXPECT_EQ(coordinator.stats().index_failures, 1u);
+    EXPECT_EQ(coordinator.next_boundary_us(), boundary);
+
+    // The next keyframe opens the segment for the same boundary
+    const auto next = coordinator.on_keyframe(front, boundary + 34000);
+    ASSERT_TRUE(next.has_value());
+    EXPECT_EQ(next->start_time_us, boundary);
+    EXPECT_EQ(coordinator.next_boundary_us(), boundary + MINUTE_US);
+    EXPECT_EQ(coordinator.stats().rollovers, 2u);
+}
+
+TEST_F(RolloverCoordinatorTest, IndexBatchIsAllOrNothing) {
+    SegmentInfo segment;
+    segment.segment_id = 1;
+    segment.camera_id = "front";
+    segment.path = "/recordings/1.mp4";
+    segment.size_bytes = 10;
+    ASSERT_TRUE(index_.add(segment));
+
+    SegmentInfo other = segment;
+    other.segment_id = 2;
+    EXPECT_FALSE(index_.add_batch({other, segment}));
+    EXPECT_FALSE(index_.add_batch({other, other}));
+    EXPECT_EQ(index_.size(), 1u);
+
+    SegmentInfo third = segment;
+    third.segment_id = 3;
+    EXPECT_TRUE(index_.add_batch({other, third}));
+    EXPECT_EQ(index_.size(), 3u);
+    EXPECT_EQ(index_.total_bytes(), 30u);
+}
+
+} // namespace test
+} // namespace dashcam
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include "dashcam/storage/segment_layout.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace dashcam {
+namespace test {
+
+// 2023-11-14 22:13:20 UTC
+constexpr int64_t BASE_TIME_US = 1700000000000000;
+constexpr int64_t HOUR_US = 3600000000;
+
+class SegmentLayoutTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        root_ = std::filesystem::temp_directory_path() / "dashcam_segment_layout_test";
+        std::filesystem::remove_all(root_);
+        std::filesystem::create_directories(root_);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(root_);
+    }
+
+    std::filesystem::path root_;
+};
+
+TEST_F(SegmentLayoutTest, ShardsByCameraDayAndHour) {
+    SegmentLayout layout(root_.string());
+    EXPECT_EQ(layout.directory_for("front", BASE_TIME_US), root_.string() + "/front/20231114/22");
+    EXPECT_EQ(layout.directory_for("rear", BASE_TIME_US + 2 * HOUR_US),
+              root_.string() + "/rear/20231115/00");
+    EXPECT_EQ(layout.path_for("front", 7, BASE_TIME_US),
+              root_.string() + "/front/20231114/22/7_1700000000000000.mp4");
+}
+
+TEST_F(SegmentLayoutTest, ParsesOnlySegmentFileNames) {
+    const auto parsed = SegmentLayout::parse_file_name("42_1700000000000000.mp4");
+    ASSERT_TRUE(parsed.has_value());
+    EXPECT_EQ(parsed->segment_id, 42u);
+    EXPECT_EQ(parsed->start_time_us, BASE_TIME_US);
+
+    EXPECT_FALSE(SegmentLayout::parse_file_name("42_1700000000000000.idx").has_value());
+    EXPECT_FALSE(SegmentLayout::parse_file_name("42_17x.mp4").has_value());
+    EXPECT_FALSE(SegmentLayout::parse_file_name("42.mp4").has_value());
+    EXPECT_FALSE(SegmentLayout::parse_file_name(".mp4").has_value());
+}
+
+TEST_F(SegmentLayoutTest, RebuildsIndexFromShardsInParallel) {
+    SegmentLayout layout(root_.string());
+
+    // Two cameras, three hours, four one-minute segments per hour
+    uint64_t segment_id = 1;
+    for (const char* camera : {"front", "rear"}) {
+        for (int64_t hour = 0; hour < 3; ++hour) {
+            for (int64_t minute = 0; minute < 4; ++minute) {
+                const int64_t start = BASE_TIME_US + hour * HOUR_US + minute * 60000000;
+                const std::string path = layout.path_for(camera, segment_id++, start);
+                ASSERT_TRUE(layout.ensure_directory(layout.directory_for(camera, start)));
+                std::ofstream(path) << std::string(100, 'v');
+                std::ofstream(path + ".idx") << "sidecar";
+            }
+        }
+    }
+
+    SegmentIndex index;
+    const IndexRebuildStats stats = layout.rebuild_index(index, 4);
+    EXPECT_EQ(stats.shards_scanned, 6u);
+    EXPECT_EQ(stats.segments_indexed, 24u);
+    EXPECT_EQ(stats.files_skipped, 24u);
+    EXPECT_EQ(index.size(), 24u);
+    EXPECT_EQ(index.total_bytes(), 2400u);
+
+    const auto first = index.find(1);
+    ASSERT_TRUE(first.has_value());
+    EXPECT_EQ(first->camera_id, "front");
+    EXPECT_EQ(first->start_time_us, BASE_TIME_US);
+    EXPECT_GE(first->end_time_us, first->start_time_us);
+    EXPECT_EQ(index.overlapping("rear", 0, INT64_MAX).size(), 12u);
+
+    // A second rebuild finds the same files already indexed
+    EXPECT_EQ(layout.rebuild_index(index, 2).duplicate_ids, 24u);
+}
+
+} // namespace test
+} // namespace dashcam
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include "dashcam/storage/segment_reader.h"
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace dashcam {
+namespace test {
+
+class SegmentReaderTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_dir_ = std::filesystem::temp_directory_path() / "dashcam_segment_reader_test";
+        std::filesystem::remove_all(test_dir_);
+        std::filesystem::create_directories(test_dir_);
+        path_ = (test_dir_ / "segment.mp4").string();
+
+        // 3 MiB plus a partial page, each byte derived from its offset
+        contents_.resize(3 * 1024 * 1024 + 100);
+        for (size_t i = 0; i < contents_.size(); ++i) {
+            contents_[i] = static_cast<uint8_t>(i * 7 + i / 4096);
+        }
+        std::ofstream(path_, std::ios::binary)
+            .write(reinterpret_cast<const char*>(contents_.data()),
+                   static_cast<std::streamsize>(contents_.size()));
+
+        config_.chunk_bytes = 256 * 1024;
+        config_.window_bytes = 1024 * 1024;
+        config_.idle_io_priority = false;
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(test_dir_);
+    }
+
+    bool matches(const ReadSpan& span) const {
+        return std::equal(span.data, span.data + span.size_bytes, contents_.begin() + span.offset);
+    }
+
+    std::filesystem::path test_dir_;
+    std::string path_;
+    std::vector<uint8_t> contents_;
+    SegmentReaderConfig config_;
+};
+
+TEST_F(SegmentReaderTest, ReadsWholeFileInWindowedSpans) {
+    SegmentReader reader(config_);
+    ASSERT_TRUE(reader.open(path_));
+
+    uint64_t expected_offset = 0;
+    uint32_t spans = 0;
+    for (auto span = reader.next(); span; span = reader.next()) {
+        EXPECT_EQ(span->offset, expected_offset);
+        EXPECT_LE(span->size_bytes, config_.chunk_bytes);
+        EXPECT_TRUE(matches(*span));
+        expected_offset += span->size_bytes;
+        spans++;
+    }
+    EXPECT_EQ(expected_offset, contents_.size());
+    EXPECT_EQ(spans, 13u);
+
+    const SegmentReaderStats stats = reader.stats();
+    EXPECT_EQ(stats.bytes_read, contents_.size());
+    EXPECT_EQ(stats.windows_mapped, 4u);
+    EXPECT_EQ(stats.bytes_dropped, 2u * 1024 * 1024); // All but the last two windows
+}
+
+TEST_F(SegmentReaderTest, ResumesFromUnalignedOffset) {
+    SegmentReader reader(config_);
+    ASSERT_TRUE(reader.open(path_, 1000001, 5000));
+
+    const auto span = reader.next();
+    ASSERT_TRUE(span.has_value());
+    EXPECT_EQ(span->offset, 1000001u);
+    EXPECT_EQ(span->size_bytes, 5000u);
+    EXPECT_TRUE(matches(*span));
+    EXPECT_FALSE(reader.next().has_value());
+
+    reader.close();
+    EXPECT_FALSE(reader.open(path_, contents_.size() + 1));
+}
+
+TEST_F(SegmentReaderTest, CallerCanCapEachSpan) {
+    SegmentReader reader(config_);
+    ASSERT_TRUE(reader.open(path_));
+
+    const auto small = reader.next(1000);
+    ASSERT_TRUE(small.has_value());
+    EXPECT_EQ(small->size_bytes, 1000u);
+    EXPECT_TRUE(matches(*small));
+
+    // A cap above chunk_bytes does not widen the span
+    const auto full = reader.next(10 * config_.chunk_bytes);
+    ASSERT_TRUE(full.has_value());
+    EXPECT_EQ(full->offset, 1000u);
+    EXPECT_EQ(full->size_bytes, config_.chunk_bytes);
+    EXPECT_TRUE(matches(*full));
+}
+
+TEST_F(SegmentReaderTest, SpansOutliveReader) {
+    std::vector<ReadSpan> held;
+    {
+        SegmentReader reader(config_);
+        ASSERT_TRUE(reader.open(path_));
+        for (auto span = reader.next(); span; span = reader.next()) {
+            held.push_back(*span);
+        }
+    }
+
+    // Every page was dropped from the cache, but the mappings stay readable
+    for (const ReadSpan& span : held) {
+        EXPECT_TRUE(matches(span));
+    }
+}
+
+} // namespace test
+} // namespace dashcam
@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+#include "dashcam/storage/segment_writer.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace dashcam {
+namespace test {
+
+using Clock = SegmentWriter::Clock;
+using std::chrono::milliseconds;
+
+class SegmentWriterTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_dir_ = std::filesystem::temp_directory_path() / "dashcam_segment_writer_test";
+        std::filesystem::remove_all(test_dir_);
+        std::filesystem::create_directories(test_dir_);
+        segment_path_ = (test_dir_ / "segment.bin").string();
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(test_dir_);
+    }
+
+    static WriteChunk chunk_of(size_t size, uint8_t fill, bool keyframe = false) {
+        auto buffer = std::make_shared<const std::vector<uint8_t>>(size, fill);
+        return make_write_chunk(std::move(buffer), keyframe);
+    }
+
+    std::string read_segment() const {
+        std::ifstream file(segment_path_, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+
+    std::filesystem::path test_dir_;
+    std::string segment_path_;
+};
+
+TEST_F(SegmentWriterTest, CoalescesSmallChunksIntoOneWrite) {
+    SegmentWriterConfig config;
+    config.max_batch_bytes = 1024 * 1024;
+    config.max_batch_latency = milliseconds(1000);
+    config.durability.mode = DurabilityMode::None;
+    SegmentWriter writer(config);
+
+    const auto start = Clock::now();
+    ASSERT_TRUE(writer.open(segment_path_));
+    for (uint8_t i = 0; i < 100; ++i) {
+        ASSERT_TRUE(writer.append(chunk_of(1000, i), start));
+    }
+    EXPECT_EQ(writer.pending_chunks(), 100u);
+    EXPECT_EQ(writer.stats(start).write_syscalls, 0u);
+
+    ASSERT_TRUE(writer.close(start));
+    const auto stats = writer.stats(start + milliseconds(1));
+    EXPECT_EQ(stats.write_syscalls, 1u);
+    EXPECT_EQ(stats.sync_syscalls, 0u);
+    EXPECT_EQ(stats.bytes_written, 100000u);
+    EXPECT_DOUBLE_EQ(stats.bytes_per_syscall, 100000.0);
+
+    // Data lands in order
+    const std::string contents = read_segment();
+    ASSERT_EQ(contents.size(), 100000u);
+    EXPECT_EQ(static_cast<uint8_t>(contents[0]), 0);
+    EXPECT_EQ(static_cast<uint8_t>(contents[99999]), 99);
+}
+
+TEST_F(SegmentWriterTest, FlushesWhenBatchBytesReached) {
+    SegmentWriterConfig config;
+    config.max_batch_bytes = 4096;
+    config.max_batch_latency = milliseconds(1000);
+    config.durability.mode = DurabilityMode::None;
+    SegmentWriter writer(config);
+
+    const auto start = Clock::now();
+    ASSERT_TRUE(writer.open(segment_path_));
+    ASSERT_TRUE(writer.append(chunk_of(3000, 1), start));
+    EXPECT_EQ(writer.stats(start).write_syscalls, 0u);
+    ASSERT_TRUE(writer.append(chunk_of(3000, 2), start));
+    EXPECT_EQ(writer.stats(start).write_syscalls, 1u);
+    EXPECT_EQ(writer.pending_bytes(), 0u);
+    EXPECT_EQ(writer.segment_size_bytes(), 6000u);
+}
+
+TEST_F(SegmentWriterTest, FlushesWhenBatchLatencyReached) {
+    SegmentWriterConfig config;
+    config.max_batch_bytes = 1024 * 1024;
+    config.max_batch_latency = milliseconds(100);
+    config.durability.mode = DurabilityMode::None;
+    SegmentWriter writer(config);
+
+    const auto start = Clock::now();
+    ASSERT_TRUE(writer.open(segment_path_));
+    ASSERT_TRUE(writer.append(chunk_of(10, 1), start));
+
+    ASSERT_TRUE(writer.poll(start + milliseconds(50)));
+    EXPECT_EQ(writer.pending_chunks(), 1u);
+
+    ASSERT_TRUE(writer.poll(start + milliseconds(100)));
+    EXPECT_EQ(writer.pending_chunks(), 0u);
+    EXPECT_EQ(writer.stats(start).write_syscalls, 1u);
+}
+
+TEST_F(SegmentWriterTest, PeriodicPolicySyncsOnSchedule) {
+    SegmentWriterConfig config;
+    config.max_batch_bytes = 1;
+    config.durability.mode = DurabilityMode::Periodic;
+    config.durability.sync_interval = milliseconds(500);
+    SegmentWriter writer(config);
+
+    const auto start = Clock::now();
+    ASSERT_TRUE(writer.open(segment_path_));
+    ASSERT_TRUE(writer.append(chunk_of(100, 1), start + milliseconds(100)));
+    ASSERT_TRUE(writer.append(chunk_of(100, 2), start + milliseconds(200)));
+    EXPECT_EQ(writer.stats(start).sync_syscalls, 0u);
+
+    ASSERT_TRUE(writer.poll(start + milliseconds(600)));
+    EXPECT_EQ(writer.stats(start).sync_syscalls, 1u);
+    EXPECT_EQ(writer.sync_latency().count(), 1u);
+
+    // Nothing new written: no further syncs however long we wait
+    ASSERT_TRUE(writer.poll(start + milliseconds(5000)));
+    EXPECT_EQ(writer.stats(start).sync_syscalls, 1u);
+}
+
+TEST_F(SegmentWriterTest, KeyframePolicySyncsPreviousGop) {
+    SegmentWriterConfig config;
+    config.max_batch_bytes = 1024 * 1024;
+    config.max_batch_latency = milliseconds(1000);
+    config.durability.mode = DurabilityMode::OnKeyframe;
+    SegmentWriter writer(config);
+
+    const auto start = Clock::now();
+    ASSERT_TRUE(writer.open(segment_path_));
+    ASSERT_TRUE(writer.append(chunk_of(100, 1, true), start));
+    ASSERT_TRUE(writer.append(chunk_of(100, 2), start));
+    ASSERT_TRUE(writer.append(chunk_of(100, 3), start));
+    EXPECT_EQ(writer.stats(start).sync_syscalls, 0u);
+
+    // The next keyframe forces the first GOP out and onto disk
+    ASSERT_TRUE(writer.append(chunk_of(100, 4, true), start));
+    const auto stats = writer.stats(start);
+    EXPECT_EQ(stats.write_syscalls, 1u);
+    EXPECT_EQ(stats.sync_syscalls, 1u);
+    EXPECT_EQ(writer.pending_chunks(), 1u);
+}
+
+TEST_F(SegmentWriterTest, OpenFailsForMissingDirectory) {
+    SegmentWriter writer(SegmentWriterConfig{});
+    EXPECT_FALSE(writer.open((test_dir_ / "missing" / "segment.bin").string()));
+    EXPECT_FALSE(writer.is_open());
+}
+
+} // namespace test
+} // namespace dashcam
@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include "dashcam/media/fmp4_muxer.h"
+#include "dashcam/storage/sidecar_index.h"
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace dashcam {
+namespace test {
+
+class SidecarIndexTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_dir_ = std::filesystem::temp_directory_path() / "dashcam_sidecar_index_test";
+        std::filesystem::remove_all(test_dir_);
+        std::filesystem::create_directories(test_dir_);
+        sidecar_path_ = (test_dir_ / "segment.idx").string();
+        config_.thumbnail_interval = std::chrono::seconds(10);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(test_dir_);
+    }
+
+    // One keyframe per second for a minute, with a thumbnail whenever one is due
+    void fill(SidecarIndexBuilder& builder) {
+        builder.reset(42, 1700000000000000);
+        for (int64_t second = 0; second < 60; ++second) {
+            const int64_t media_time_us = second * 1000000;
+            ASSERT_TRUE(builder.add_keyframe(
+                KeyframeEntry{media_time_us, uint64_t(second) * 1000, uint64_t(second) * 1000 + 200,
+                              500}));
+            if (builder.wants_thumbnail(media_time_us)) {
+                const std::vector<uint8_t> jpeg(300, static_cast<uint8_t>(second));
+                ASSERT_TRUE(builder.add_thumbnail(media_time_us, 160, 90, jpeg.data(), 300));
+            }
+        }
+    }
+
+    std::filesystem::path test_dir_;
+    std::string sidecar_path_;
+    SidecarIndexConfig config_;
+};
+
+TEST_F(SidecarIndexTest, RoundTripsThroughMappedReader) {
+    SidecarIndexBuilder builder(config_);
+    fill(builder);
+    EXPECT_EQ(builder.keyframe_count(), 60u);
+    EXPECT_EQ(builder.thumbnail_count(), 6u);
+    ASSERT_TRUE(builder.write(sidecar_path_));
+    EXPECT_FALSE(std::filesystem::exists(sidecar_path_ + ".tmp"));
+
+    SidecarIndexReader reader;
+    ASSERT_TRUE(reader.open(sidecar_path_));
+    EXPECT_EQ(reader.segment_id(), 42u);
+    EXPECT_EQ(reader.segment_start_us(), 1700000000000000);
+    ASSERT_EQ(reader.keyframe_count(), 60u);
+    ASSERT_EQ(reader.thumbnail_count(), 6u);
+
+    const KeyframeEntry entry = reader.keyframe(7);
+    EXPECT_EQ(entry.media_time_us, 7000000);
+    EXPECT_EQ(entry.fragment_offset, 7000u);
+    EXPECT_EQ(entry.sample_offset, 7200u);
+    EXPECT_EQ(entry.size_bytes, 500u);
+
+    const auto thumbnail = reader.thumbnail(2);
+    ASSERT_TRUE(thumbnail.has_value());
+    EXPECT_EQ(thumbnail->media_time_us, 20000000);
+    EXPECT_EQ(thumbnail->width, 160);
+    EXPECT_EQ(thumbnail->size_bytes, 300u);
+    EXPECT_EQ(thumbnail->jpeg[0], 20);
+}
+
+TEST_F(SidecarIndexTest, SeeksAndScrubsByTime) {
+    SidecarIndexBuilder builder(config_);
+    fill(builder);
+    ASSERT_TRUE(builder.write(sidecar_path_));
+
+    SidecarIndexReader reader;
+    ASSERT_TRUE(reader.open(sidecar_path_));
+
+    EXPECT_EQ(reader.keyframe_at_or_before(12500000)->media_time_us, 12000000);
+    EXPECT_EQ(reader.keyframe_at_or_before(12000000)->media_time_us, 12000000);
+    EXPECT_EQ(reader.keyframe_at_or_before(999999999)->media_time_us, 59000000);
+    EXPECT_FALSE(reader.keyframe_at_or_before(-1).has_value());
+
+    EXPECT_EQ(reader.nearest_thumbnail(14000000)->media_time_us, 10000000);
+    EXPECT_EQ(reader.nearest_thumbnail(16000000)->media_time_us, 20000000);
+    EXPECT_EQ(reader.nearest_thumbnail(500000000)->media_time_us, 50000000);
+    EXPECT_EQ(reader.nearest_thumbnail(-5)->media_time_us, 0);
+}
+
+TEST_F(SidecarIndexTest, RejectsCorruptFiles) {
+    SidecarIndexBuilder builder(config_);
+    fill(builder);
+    ASSERT_TRUE(builder.write(sidecar_path_));
+    const auto size = std::filesystem::file_size(sidecar_path_);
+
+    // Flip a byte inside the keyframe table
+    {
+        std::fstream file(sidecar_path_, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(100);
+        file.put('\x7f');
+    }
+    SidecarIndexReader reader;
+    EXPECT_FALSE(reader.open(sidecar_path_));
+
+    ASSERT_TRUE(builder.write(sidecar_path_));
+    std::filesystem::resize_file(sidecar_path_, size - 1);
+    EXPECT_FALSE(reader.open(sidecar_path_));
+    EXPECT_FALSE(reader.open((test_dir_ / "missing.idx").string()));
+}
+
+TEST_F(SidecarIndexTest, MuxerRecordsKeyframeOffsets) {
+    const std::string segment_path = (test_dir_ / "segment.mp4").string();
+    SegmentWriterConfig writer_config;
+    writer_config.durability.mode = DurabilityMode::None;
+    SegmentWriter writer(writer_config);
+    Fmp4MuxerConfig muxer_config;
+    muxer_config.decoder_config = {0x01, 0x64, 0x00, 0x1F};
+    SidecarIndexBuilder builder(config_);
+    Fmp4Muxer muxer(muxer_config, writer, &builder);
+
+    const auto now = SegmentWriter::Clock::now();
+    builder.reset(1, 0);
+    ASSERT_TRUE(writer.open(segment_path));
+    ASSERT_TRUE(muxer.begin_segment(now));
+    for (uint8_t i = 0; i < 90; ++i) {
+        // 30 fps, keyframe every second
+        const auto payload = std::make_shared<const std::vector<uint8_t>>(64, i);
+        ASSERT_TRUE(muxer.add_sample(make_write_chunk(payload, i % 30 == 0),
+                                     SampleTiming{int64_t{i} * 3000, 3000, 0},
+                                     now));
+    }
+    ASSERT_TRUE(muxer.end_segment(now));
+    ASSERT_TRUE(writer.close(now));
+    ASSERT_TRUE(builder.write(sidecar_path_));
+
+    SidecarIndexReader reader;
+    ASSERT_TRUE(reader.open(sidecar_path_));
+    ASSERT_EQ(reader.keyframe_count(), 3u);
+
+    std::ifstream segment(segment_path, std::ios::binary);
+    for (uint32_t i = 0; i < 3; ++i) {
+        const KeyframeEntry entry = reader.keyframe(i);
+        EXPECT_EQ(entry.media_time_us, int64_t{i} * 1000000);
+
+        char box_type[4];
+        segment.seekg(static_cast<std::streamoff>(entry.fragment_offset + 4));
+        segment.read(box_type, 4);
+        EXPECT_EQ(std::string(box_type, 4), "moof");
+
+        segment.seekg(static_cast<std::streamoff>(entry.sample_offset));
+        EXPECT_EQ(segment.get(), static_cast<int>(i * 30));
+    }
+}
+
+} // namespace test
+} // namespace dashcam
@@ -0,0 +1,353 @@
+#include <gtest/gtest.h>
+#include "grpc/status_publisher.h"
+#include "dashcam.grpc.pb.h"
+
+#include <grpcpp/support/proto_buffer_reader.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace dashcam {
+namespace test {
+
+namespace {
+
+/**
+ * @brief StreamStatus alone, answered by a publisher under test
+ */
+class PublishingService final
+    : public DashcamService::WithRawCallbackMethod_StreamStatus<DashcamService::Service> {
+public:
+    explicit PublishingService(StatusPublisher& publisher) : publisher_(publisher) {}
+
+    grpc::ServerWriteReactor<grpc::ByteBuffer>* StreamStatus(grpc::CallbackServerContext* context,
+                                                            const grpc::ByteBuffer* request) override {
+        grpc::ByteBuffer bytes(*request);
+        grpc::ProtoBufferReader reader(&bytes);
+        GetStatusRequest parsed;
+        EXPECT_TRUE(parsed.ParseFromZeroCopyStream(&reader));
+        return publisher_.subscribe(context, parsed.delta_updates());
+    }
+
+private:
+    StatusPublisher& publisher_;
+};
+
+class StatusReader final : public grpc::ClientReadReactor<DashcamStatus> {
+public:
+    explicit StatusReader(DashcamService::Stub& stub, bool delta_updates = false) {
+        request_.set_delta_updates(delta_updates);
+        stub.async()->StreamStatus(&context_, &request_, this);
+        StartRead(&status_);
+        StartCall();
+    }
+
+    // The call must end before the reactor goes away
+    ~StatusReader() override {
+        cancel();
+        wait_done();
+    }
+
+    void OnReadDone(bool ok) override {
+        if (!ok) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            updates_.push_back(status_);
+            apply_status_update(&state_, status_);
+            frames_.push_back(state_.frames_captured());
+        }
+        cv_.notify_all();
+        StartRead(&status_);
+    }
+
+    void OnDone(const grpc::Status& status) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_ = true;
+            code_ = status.error_code();
+        }
+        cv_.notify_all();
+    }
+
+    bool wait_for_updates(size_t count, std::chrono::milliseconds timeout = std::chrono::seconds(10)) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, timeout, [&] { return frames_.size() >= count || done_; }) &&
+               frames_.size() >= count;
+    }
+
+    bool wait_done() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, std::chrono::seconds(10), [&] { return done_; });
+    }
+
+    std::vector<uint64_t> frames() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return frames_;
+    }
+
+    std::vector<DashcamStatus> updates() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return updates_;
+    }
+
+    DashcamStatus state() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return state_;
+    }
+
+    grpc::StatusCode code() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return code_;
+    }
+
+    void cancel() { context_.TryCancel(); }
+
+private:
+    grpc::ClientContext context_;
+    GetStatusRequest request_;
+    DashcamStatus status_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<DashcamStatus> updates_;
+    DashcamStatus state_;
+    std::vector<uint64_t> frames_;
+    bool done_ = false;
+    grpc::StatusCode code_ = grpc::StatusCode::UNKNOWN;
+};
+
+} // namespace
+
+class StatusPublisherTest : public ::testing::Test {
+protected:
+    void start(const StatusPublisherConfig& config) {
+        publisher_ = std::make_unique<StatusPublisher>(config, [this](DashcamStatus* status) {
+            status->set_recording(recording_.load());
+            status->set_frames_captured(frames_.load());
+            status->set_storage_used_bytes(123456789);
+            status->set_storage_available_bytes(987654321);
+            status->set_current_fps(30);
+            status->set_current_resolution("1920x1080");
+            status->add_active_cameras("front");
+            status->add_active_cameras("rear");
+        });
+        publisher_->start();
+        service_ = std::make_unique<PublishingService>(*publisher_);
+
+        grpc::ServerBuilder builder;
+        int port = 0;
+        builder.AddListeningPort("127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+        builder.RegisterService(service_.get());
+        server_ = builder.BuildAndStart();
+        ASSERT_NE(server_, nullptr);
+        stub_ = DashcamService::NewStub(grpc::CreateChannel("127.0.0.1:" + std::to_string(port),
+                                                            grpc::InsecureChannelCredentials()));
+    }
+
+    void TearDown() override {
+        if (publisher_) {
+            publisher_->stop();
+        }
+        if (server_) {
+            server_->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(1));
+        }
+    }
+
+    std::atomic<bool> recording_{true};
+    std::atomic<uint64_t> frames_{0};
+    std::unique_ptr<StatusPublisher> publisher_;
+    std::unique_ptr<PublishingService> service_;
+    std::unique_ptr<grpc::Server> server_;
+    std::unique_ptr<DashcamService::Stub> stub_;
+};
+
+TEST_F(StatusPublisherTest, SerializesOncePerTickForEverySubscriber) {
+    constexpr size_t READERS = 50;
+    StatusPublisherConfig config;
+    config.interval = std::chrono::milliseconds(5);
+    start(config);
+
+    std::vector<std::unique_ptr<StatusReader>> readers;
+    for (size_t i = 0; i < READERS; ++i) {
+        readers.push_back(std::make_unique<StatusReader>(*stub_));
+    }
+    for (uint64_t tick = 1; tick <= 5; ++tick) {
+        frames_.store(tick * 100);
+        publisher_->notify();
+    }
+    for (auto& reader : readers) {
+        ASSERT_TRUE(reader->wait_for_updates(3));
+        const std::vector<uint64_t> frames = reader->frames();
+        for (size_t i = 1; i < frames.size(); ++i) {
+            EXPECT_LE(frames[i - 1], frames[i]);
+        }
+        reader->cancel();
+        ASSERT_TRUE(reader->wait_done());
+    }
+
+    // Every write shared a tick's single serialization
+    const StatusPublisherStats stats = publisher_->stats();
+    EXPECT_EQ(stats.serializations, stats.ticks);
+    EXPECT_GE(stats.writes_started, READERS * 3);
+}
+
+TEST_F(StatusPublisherTest, ReportsEveryStreamWithItsCounters) {
+    StatusPublisherConfig config;
+    config.interval = std::chrono::milliseconds(5);
+    start(config);
+
+    StatusReader first(*stub_);
+    StatusReader second(*stub_);
+    ASSERT_TRUE(first.wait_for_updates(3));
+    ASSERT_TRUE(second.wait_for_updates(3));
+
+    const std::vector<SubscriberStats> streams = publisher_->subscriber_stats();
+    ASSERT_EQ(streams.size(), 2u);
+    for (const SubscriberStats& stream : streams) {
+        EXPECT_FALSE(stream.peer.empty());
+        EXPECT_GE(stream.writes, 3u);
+        EXPECT_GT(stream.bytes_written, 0u);
+        // A single slot: a status stream never queues more than the newest value
+        EXPECT_LE(stream.queued, 1u);
+    }
+}
+
+TEST_F(StatusPublisherTest, UnchangedTicksSendNothingUntilNotified) {
+    StatusPublisherConfig config;
+    config.interval = std::chrono::milliseconds(5);
+    config.publish_unchanged = false;
+    start(config);
+
+    StatusReader reader(*stub_);
+    ASSERT_TRUE(reader.wait_for_updates(1));
+    EXPECT_FALSE(reader.wait_for_updates(2, std::chrono::milliseconds(100)));
+    EXPECT_GT(publisher_->stats().unchanged_skipped, 0u);
+
+    frames_.store(7);
+    publisher_->notify();
+    ASSERT_TRUE(reader.wait_for_updates(2));
+    EXPECT_EQ(reader.frames().back(), 7u);
+}
+
+TEST_F(StatusPublisherTest, ChangesPublishOnNotifyWithoutWaitingForTheInterval) {
+    StatusPublisherConfig config;
+    config.interval = std::chrono::seconds(60);
+    start(config);
+
+    StatusReader reader(*stub_);
+    ASSERT_TRUE(reader.wait_for_updates(1));
+    frames_.store(42);
+    publisher_->notify();
+    ASSERT_TRUE(reader.wait_for_updates(2, std::chrono::seconds(5)));
+    EXPECT_EQ(reader.frames().back(), 42u);
+}
+
+TEST_F(StatusPublisherTest, StopFinishesOpenAndLaterStreams) {
+    StatusPublisherConfig config;
+    start(config);
+
+    StatusReader open(*stub_);
+    ASSERT_TRUE(open.wait_for_updates(1));
+    publisher_->stop();
+    ASSERT_TRUE(open.wait_done());
+    EXPECT_EQ(open.code(), grpc::StatusCode::OK);
+    EXPECT_EQ(publisher_->stats().subscribers, 0u);
+
+    StatusReader late(*stub_);
+    ASSERT_TRUE(late.wait_done());
+    EXPECT_EQ(late.code(), grpc::StatusCode::OK);
+}
+
+TEST_F(StatusPublisherTest, DeltaStreamsSendChangedFieldsAfterASnapshot) {
+    StatusPublisherConfig config;
+    config.interval = std::chrono::seconds(60);
+    start(config);
+
+    StatusReader delta(*stub_, true);
+    StatusReader full(*stub_);
+    ASSERT_TRUE(delta.wait_for_updates(1));
+    ASSERT_TRUE(full.wait_for_updates(1));
+    for (uint64_t frames = 1; frames <= 5; ++frames) {
+        frames_.store(frames * 30);
+        publisher_->notify();
+        ASSERT_TRUE(delta.wait_for_updates(frames + 1));
+        ASSERT_TRUE(full.wait_for_updates(frames + 1));
+    }
+
+    const std::vector<DashcamStatus> updates = delta.updates();
+    ASSERT_EQ(updates.size(), 6u);
+    EXPECT_EQ(updates[0].changed_fields(), 0u);
+    EXPECT_EQ(updates[0].current_resolution(), "1920x1080");
+    uint64_t delta_bytes = 0;
+    for (size_t i = 1; i < updates.size(); ++i) {
+        EXPECT_EQ(updates[i].changed_fields(), (1u << DashcamStatus::kFramesCapturedFieldNumber) | 1u);
+        EXPECT_TRUE(updates[i].current_resolution().empty());
+        delta_bytes += updates[i].ByteSizeLong();
+    }
+    uint64_t full_bytes = 0;
+    for (const DashcamStatus& update : full.updates()) {
+        full_bytes += update.ByteSizeLong();
+    }
+
+    // Same state at the client, a fraction of the bytes
+    EXPECT_EQ(delta.state().SerializeAsString(), full.state().SerializeAsString());
+    EXPECT_LT(delta_bytes * 4, full_bytes);
+    EXPECT_EQ(publisher_->stats().delta_writes, 5u);
+}
+
+TEST_F(StatusPublisherTest, DeltaStreamsResyncWithAFullSnapshot) {
+    StatusPublisherConfig config;
+    config.interval = std::chrono::seconds(60);
+    config.full_resync_updates = 2;
+    start(config);
+
+    StatusReader reader(*stub_, true);
+    ASSERT_TRUE(reader.wait_for_updates(1));
+    for (uint64_t frames = 1; frames <= 6; ++frames) {
+        frames_.store(frames);
+        publisher_->notify();
+        ASSERT_TRUE(reader.wait_for_updates(frames + 1));
+    }
+
+    // Snapshot, two deltas, snapshot, two deltas, snapshot
+    std::vector<bool> snapshots;
+    for (const DashcamStatus& update : reader.updates()) {
+        snapshots.push_back(update.changed_fields() == 0);
+    }
+    EXPECT_EQ(snapshots, (std::vector<bool>{true, false, false, true, false, false, true}));
+    EXPECT_EQ(reader.state().frames_captured(), 6u);
+    EXPECT_EQ(publisher_->stats().resyncs, 2u);
+}
+
+TEST_F(StatusPublisherTest, DeltaCarriesChangesToDefaultValues) {
+    StatusPublisherConfig config;
+    config.interval = std::chrono::seconds(60);
+    start(config);
+
+    StatusReader reader(*stub_, true);
+    ASSERT_TRUE(reader.wait_for_updates(1));
+    EXPECT_TRUE(reader.state().recording());
+
+    recording_.store(false);
+    publisher_->notify();
+    ASSERT_TRUE(reader.wait_for_updates(2));
+    EXPECT_NE(reader.updates().back().changed_fields() & (1u << DashcamStatus::kRecordingFieldNumber), 0u);
+    EXPECT_FALSE(reader.state().recording());
+    EXPECT_EQ(reader.state().active_cameras_size(), 2);
+}
+
+TEST_F(StatusPublisherTest, UnchangedTicksSendNothingToDeltaStreams) {
+    StatusPublisherConfig config;
+    config.interval = std::chrono::milliseconds(5);
+    start(config);
+
+    StatusReader delta(*stub_, true);
+    StatusReader full(*stub_);
+    ASSERT_TRUE(full.wait_for_updates(5));
+    EXPECT_EQ(delta.updates().size(), 1u);
+}
+
+} // namespace test
+} // namespace dashcam
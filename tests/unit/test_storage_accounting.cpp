@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include "dashcam/storage/storage_accounting.h"
+
+#include <filesystem>
+#include <thread>
+
+namespace dashcam {
+namespace test {
+
+TEST(StorageAccountingTest, ReconcileReadsVolumeUsage) {
+    StorageAccounting accounting(std::filesystem::temp_directory_path().string());
+    EXPECT_EQ(accounting.usage().used_bytes, 0u);
+
+    ASSERT_TRUE(accounting.reconcile());
+    EXPECT_EQ(accounting.reconcile_count(), 1u);
+    EXPECT_GT(accounting.usage().used_bytes + accounting.usage().available_bytes, 0u);
+}
+
+TEST(StorageAccountingTest, WritesAndEvictionsAdjustCountersWithoutIo) {
+    StorageAccounting accounting(std::filesystem::temp_directory_path().string());
+    ASSERT_TRUE(accounting.reconcile());
+    const StorageUsage before = accounting.usage();
+
+    accounting.on_write(4096);
+    EXPECT_EQ(accounting.usage().used_bytes, before.used_bytes + 4096);
+    EXPECT_EQ(accounting.usage().available_bytes, before.available_bytes - 4096);
+
+    accounting.on_evict(4096);
+    EXPECT_EQ(accounting.usage().used_bytes, before.used_bytes);
+    EXPECT_EQ(accounting.usage().available_bytes, before.available_bytes);
+    EXPECT_EQ(accounting.reconcile_count(), 1u);
+}
+
+TEST(StorageAccountingTest, CountersSaturateAtZero) {
+    StorageAccounting accounting("/nonexistent/volume");
+    EXPECT_FALSE(accounting.reconcile());
+
+    accounting.on_write(100);
+    accounting.on_evict(1000);
+    EXPECT_EQ(accounting.usage().used_bytes, 0u);
+    EXPECT_EQ(accounting.usage().available_bytes, 1000u);
+
+    accounting.on_write(5000);
+    EXPECT_EQ(accounting.usage().available_bytes, 0u);
+}
+
+TEST(StorageAccountingTest, BackgroundThreadReconciles) {
+    StorageAccounting accounting(std::filesystem::temp_directory_path().string());
+    ASSERT_TRUE(accounting.start(std::chrono::milliseconds(5)));
+
+    for (int i = 0; i < 200 && accounting.reconcile_count() < 3; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    accounting.stop();
+    EXPECT_GE(accounting.reconcile_count(), 3u);
+}
+
+} // namespace test
+} // namespace dashcam
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include "dashcam/utils/symbol_table.h"
+#include "grpc/event_filter.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dashcam {
+namespace test {
+
+TEST(SymbolTableTest, InternsEachStringOnce) {
+    SymbolTable symbols;
+    EXPECT_EQ(symbols.intern(""), Symbol::EMPTY);
+    EXPECT_EQ(symbols.name(Symbol::EMPTY), "");
+
+    const Symbol incident = *symbols.intern("incident");
+    const Symbol front = *symbols.intern("front");
+    EXPECT_NE(incident, front);
+    EXPECT_EQ(symbols.intern(std::string("incident")), incident);
+    EXPECT_EQ(symbols.name(incident), "incident");
+    EXPECT_EQ(symbols.name(front), "front");
+
+    const SymbolTableStats stats = symbols.stats();
+    EXPECT_EQ(stats.symbols, 3u);
+    EXPECT_EQ(stats.bytes, 13u);
+}
+
+TEST(SymbolTableTest, FindNeverAdds) {
+    SymbolTable symbols;
+    EXPECT_FALSE(symbols.find("rear").has_value());
+    EXPECT_EQ(symbols.size(), 1u);
+
+    const Symbol rear = *symbols.intern("rear");
+    ASSERT_TRUE(symbols.find("rear").has_value());
+    EXPECT_EQ(*symbols.find("rear"), rear);
+}
+
+TEST(SymbolTableTest, FullTableRefusesNewStrings) {
+    SymbolTable symbols(3);
+    const Symbol incident = *symbols.intern("incident");
+    ASSERT_TRUE(symbols.intern("front").has_value());
+
+    // A refusal is reported, never a silent EMPTY
+    EXPECT_FALSE(symbols.intern("rear").has_value());
+    EXPECT_FALSE(symbols.intern("rear").has_value());
+    EXPECT_EQ(symbols.intern("incident"), incident);
+    EXPECT_EQ(symbols.intern(""), Symbol::EMPTY);
+    EXPECT_FALSE(symbols.find("rear").has_value());
+
+    const SymbolTableStats stats = symbols.stats();
+    EXPECT_EQ(stats.symbols, 3u);
+    EXPECT_EQ(stats.overflowed, 2u);
+}
+
+TEST(SymbolTableTest, NamesStayValidAcrossChunks) {
+    SymbolTable symbols;
+    const std::string& first = symbols.name(*symbols.intern("type0"));
+    std::vector<Symbol> issued;
+    for (uint32_t i = 0; i < SymbolTable::CHUNK_SYMBOLS * 2; ++i) {
+        issued.push_back(*symbols.intern("type" + std::to_string(i)));
+    }
+    EXPECT_EQ(first, "type0");
+    for (uint32_t i = 0; i < issued.size(); ++i) {
+        EXPECT_EQ(symbols.name(issued[i]), "type" + std::to_string(i));
+    }
+}
+
+TEST(SymbolTableTest, ConcurrentInternAgrees) {
+    SymbolTable symbols;
+    constexpr int THREADS = 4;
+    constexpr int NAMES = 2000;
+    std::vector<std::vector<Symbol>> seen(THREADS);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&symbols, &seen, t] {
+            // Each thread walks the names from a different start
+            for (int i = 0; i < NAMES; ++i) {
+                const int n = (i + t * NAMES / THREADS) % NAMES;
+                seen[t].push_back(*symbols.intern("name" + std::to_string(n)));
+                EXPECT_EQ(symbols.name(seen[t].back()), "name" + std::to_string(n));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(symbols.size(), static_cast<uint32_t>(NAMES + 1));
+    for (int n = 0; n < NAMES; ++n) {
+        EXPECT_EQ(symbols.intern("name" + std::to_string(n)), *symbols.find("name" + std::to_string(n)));
+    }
+}
+
+TEST(SymbolFilterTest, MatchesByTypeAndCamera) {
+    SymbolTable symbols;
+    const Symbol incident = *symbols.intern("incident");
+    const Symbol tick = *symbols.intern("tick");
+    const Symbol front = *symbols.intern("front");
+    const Symbol rear = *symbols.intern("rear");
+
+    EXPECT_TRUE(SymbolFilter().matches(tick, rear));
+
+    EventFilter filter;
+    filter.event_types = {"incident", "incident"};
+    filter.camera_id = "front";
+    const SymbolFilter resolved(filter, symbols);
+    EXPECT_EQ(resolved.types().size(), 1u);
+    EXPECT_TRUE(resolved.matches(incident, front));
+    EXPECT_FALSE(resolved.matches(tick, front));
+    EXPECT_FALSE(resolved.matches(incident, rear));
+    EXPECT_FALSE(resolved.matches(incident, Symbol::EMPTY));
+}
+
+TEST(SymbolFilterTest, NamesInternedLaterStillMatch) {
+    SymbolTable symbols;
+    const Symbol front = *symbols.intern("front");
+
+    EventFilter filter;
+    filter.event_types = {"tick", "crash"};
+    filter.camera_id = "side";
+    const SymbolFilter resolved(filter, symbols);
+    EXPECT_TRUE(resolved.types().empty());
+    EXPECT_FALSE(resolved.camera().has_value());
+
+    const Symbol crash = *symbols.intern("crash");
+    const Symbol side = *symbols.intern("side");
+    const Symbol other = *symbols.intern("other");
+    EXPECT_TRUE(resolved.matches(crash, side));
+    EXPECT_FALSE(resolved.matches(other, side));
+    EXPECT_FALSE(resolved.matches(crash, front));
+}
+
+} // namespace test
+} // namespace dashcam